@@ -0,0 +1,7 @@
+// per-frame camera, CameraBlock on the CPU side
+layout (std140) uniform Camera
+{
+    mat4 projection;
+    mat4 view;
+    vec4 viewPos;
+};
@@ -0,0 +1,41 @@
+// clustered point lights, see LightGrid and LightBuffers
+layout (std140) uniform Clusters
+{
+    uvec4 clusterGrid;  // tiles x, tiles y, depth slices, light count
+    vec4 clusterDepth;  // slice scale, slice bias, 1 / viewport width, 1 / viewport height
+};
+
+uniform samplerBuffer pointLights;     // (position, radius), (colour, 0) per light
+uniform usamplerBuffer lightClusters;  // (offset, count) per cluster
+uniform usamplerBuffer lightIndices;
+
+// diffuse + specular from every point light reaching this fragment's cluster
+vec3 clusteredLights(vec3 fragPos, vec3 norm, vec3 viewDir, vec3 diffuseColor, vec3 specularColor, float shininess)
+{
+    // same exponential slices as the CPU side, tiles count up from the bottom left like gl_FragCoord
+    float depth = -(view * vec4(fragPos, 1.0)).z;
+    float slice = clamp(floor(log(depth) * clusterDepth.x + clusterDepth.y), 0.0, float(clusterGrid.z - 1u));
+    uvec2 tile = min(uvec2(gl_FragCoord.xy * clusterDepth.zw * vec2(clusterGrid.xy)), clusterGrid.xy - 1u);
+    uint cluster = (uint(slice) * clusterGrid.y + tile.y) * clusterGrid.x + tile.x;
+
+    vec3 result = vec3(0.0);
+    uvec2 range = texelFetch(lightClusters, int(cluster)).xy;
+    for (uint i = 0u; i < range.y; i++)
+    {
+        int index = int(texelFetch(lightIndices, int(range.x + i)).r);
+        vec4 positionRadius = texelFetch(pointLights, index * 2);
+        vec3 color = texelFetch(pointLights, index * 2 + 1).rgb;
+
+        vec3 toLight = positionRadius.xyz - fragPos;
+        float distance = length(toLight);
+        // inverse square, windowed so it reaches exactly zero at the radius the light was binned with
+        float window = clamp(1.0 - pow(distance / positionRadius.w, 4.0), 0.0, 1.0);
+        float attenuation = window * window / (distance * distance + 1.0);
+
+        vec3 lightDir = toLight / max(distance, 1e-4);
+        float diff = max(dot(norm, lightDir), 0.0);
+        float spec = pow(max(dot(viewDir, reflect(-lightDir, norm)), 0.0), shininess);
+        result += color * attenuation * (diff * diffuseColor + spec * specularColor);
+    }
+    return result;
+}
@@ -1,44 +1,116 @@
 #version 330 core
+#ifdef BINDLESS_TEXTURES
+#extension GL_ARB_bindless_texture : require
+#extension GL_NV_gpu_shader5 : require
+#endif
 out vec4 FragColor;
 
+// compiled per permutation, see ShaderFeature: SPECULAR_MAP, NORMAL_MAP, CLUSTERED_LIGHTS, SHADOWS and
+// PACKED_MATERIALS switch parts in or out and LIGHT_COUNT is how many entries of the Lights block are shaded.
+// packed materials take their maps and shininess from the Materials block instead of the material uniform
 struct Material {
     sampler2D diffuse;
-    sampler2D specular;    
+#ifdef SPECULAR_MAP
+    sampler2D specular;
+#endif
+#ifdef NORMAL_MAP
+    sampler2D normal;
+#endif
     float shininess;
 };
-struct Light {
-    vec3 position;
-  
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-};
 
 in vec2 TexCoord;
 in vec3 Normal;
-in vec3 FragPos;  
+in vec3 FragPos;
+
+#include "camera.glsl"
+#include "lights.glsl"
+#ifdef CLUSTERED_LIGHTS
+#include "clustered_lights.glsl"
+#endif
+#ifdef SHADOWS
+#include "shadows.glsl"
+#endif
+#ifdef PACKED_MATERIALS
+flat in uint MaterialIndex;
+#include "materials.glsl"
+#endif
 
-uniform vec3 viewPos;
 uniform Material material;
-uniform Light light; 
 
-void main()
+#ifdef NORMAL_MAP
+// the vertex format has no tangents, the frame is rebuilt from screen space derivatives of position and uv
+vec3 mapNormal(vec3 norm)
+{
+    vec3 dp1 = dFdx(FragPos);
+    vec3 dp2 = dFdy(FragPos);
+    vec2 duv1 = dFdx(TexCoord);
+    vec2 duv2 = dFdy(TexCoord);
+
+    vec3 dp2perp = cross(dp2, norm);
+    vec3 dp1perp = cross(norm, dp1);
+    vec3 tangent = dp2perp * duv1.x + dp1perp * duv2.x;
+    vec3 bitangent = dp2perp * duv1.y + dp1perp * duv2.y;
+    float scale = inversesqrt(max(dot(tangent, tangent), dot(bitangent, bitangent)));
+
+    vec3 mapped = texture(material.normal, TexCoord).xyz * 2.0 - 1.0;
+    return normalize(mat3(tangent * scale, bitangent * scale, norm) * mapped);
+}
+#endif
+
+vec3 shadeLight(Light light, vec3 norm, vec3 viewDir, vec3 diffuseColor, vec3 specularColor, float shininess,
+                float shadow)
 {
     // ambient
-    vec3 ambient = light.ambient * texture(material.diffuse, TexCoord).rgb;
+    vec3 ambient = light.ambient.rgb * diffuseColor;
 
     // diffuse
-    vec3 norm = normalize(Normal);
-    vec3 lightDir = normalize(light.position - FragPos);  
+    vec3 lightDir = normalize(light.position.xyz - FragPos * light.position.w);
     float diff = max(dot(norm, lightDir), 0.0);
-    vec3 diffuse = light.diffuse * diff * texture(material.diffuse, TexCoord).rgb;
+    vec3 diffuse = light.diffuse.rgb * diff * diffuseColor;
 
     // specular
-    vec3 viewDir = normalize(viewPos - FragPos);
-    vec3 reflectDir = reflect(-lightDir, norm);  
-    float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
-    vec3 specular = light.specular * spec * texture(material.specular, TexCoord).rgb;
+    vec3 reflectDir = reflect(-lightDir, norm);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), shininess);
+    vec3 specular = light.specular.rgb * spec * specularColor;
+
+    return shadow * diffuse + ambient + shadow * specular;
+}
+
+void main()
+{
+#ifdef PACKED_MATERIALS
+    vec3 diffuseColor = packedDiffuse(MaterialIndex, TexCoord);
+    vec3 specularColor = packedSpecular(MaterialIndex, TexCoord);
+    float shininess = packedShininess(MaterialIndex);
+#else
+    vec3 diffuseColor = texture(material.diffuse, TexCoord).rgb;
+#ifdef SPECULAR_MAP
+    vec3 specularColor = texture(material.specular, TexCoord).rgb;
+#else
+    // without a map highlights take the surface colour
+    vec3 specularColor = diffuseColor;
+#endif
+    float shininess = material.shininess;
+#endif
+
+    vec3 norm = normalize(Normal);
+#ifdef NORMAL_MAP
+    norm = mapNormal(norm);
+#endif
+    vec3 viewDir = normalize(viewPos.xyz - FragPos);
 
-    vec3 lighting = diffuse + ambient + specular;
+    vec3 lighting = vec3(0.0);
+    for (int i = 0; i < LIGHT_COUNT; i++)
+    {
+        float shadow = 1.0;
+#ifdef SHADOWS
+        shadow = lightShadow(i, FragPos, norm);
+#endif
+        lighting += shadeLight(lights[i], norm, viewDir, diffuseColor, specularColor, shininess, shadow);
+    }
+#ifdef CLUSTERED_LIGHTS
+    lighting += clusteredLights(FragPos, norm, viewDir, diffuseColor, specularColor, shininess);
+#endif
     FragColor = vec4(lighting, 1.0f);
-}
\ No newline at end of file
+}
@@ -1,23 +1,48 @@
 #version 330 core
 layout (location = 0) in vec3 aPos;
-layout (location = 1) in vec3 aNormal;
+layout (location = 1) in vec2 aNormal; // octahedral encoded
 layout (location = 2) in vec2 aTexCoord;
 
+// per-instance attributes, only read when drawing instanced
+layout (location = 3) in mat4 aInstanceModel;
+layout (location = 7) in mat3 aInstanceNormal;
+#ifdef PACKED_MATERIALS
+// index into the Materials block, per instance or from materialIndex for single draws
+layout (location = 10) in uint aInstanceMaterial;
+uniform int materialIndex;
+flat out uint MaterialIndex;
+#endif
+
 out vec2 TexCoord;
 out vec3 FragPos;
 out vec3 Normal;
 
+#include "camera.glsl"
+
 uniform mat4 model;
-uniform mat4 projection;
-uniform mat4 view;
+// inverse transpose of model's upper 3x3, computed on the CPU alongside the model matrix
+uniform mat3 normalMatrix;
+uniform bool instanced;
+
+vec3 octDecode(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+    return normalize(n);
+}
 
 void main()
 {
-    FragPos = vec3(model * vec4(aPos, 1.0));
+    vec3 normal = octDecode(aNormal);
+    mat4 worldModel = instanced ? aInstanceModel : model;
+    FragPos = vec3(worldModel * vec4(aPos, 1.0));
     TexCoord = aTexCoord;
+#ifdef PACKED_MATERIALS
+    MaterialIndex = instanced ? aInstanceMaterial : uint(materialIndex);
+#endif
 
-    // inverse operations are expensive - ideally calculate on CPU, not here.
-    Normal = mat3(transpose(inverse(model))) * aNormal;
+    Normal = (instanced ? aInstanceNormal : normalMatrix) * normal;
 
-    gl_Position = projection * view * vec4(aPos, 1.0);
-}
\ No newline at end of file
+    gl_Position = projection * view * vec4(FragPos, 1.0);
+}
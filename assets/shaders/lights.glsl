@@ -0,0 +1,14 @@
+// std140 pads vec3 to vec4 anyway, so the block uses vec4 to keep the CPU mirror obvious
+struct Light {
+    vec4 position;  // w 1 for a point, w 0 for a direction towards the light
+
+    vec4 ambient;
+    vec4 diffuse;
+    vec4 specular;
+};
+
+// always MAX_LIGHTS long so every permutation shares one buffer, the first LIGHT_COUNT are shaded
+layout (std140) uniform Lights
+{
+    Light lights[MAX_LIGHTS];
+};
@@ -2,14 +2,19 @@
 layout (location = 0) in vec3 aPos;
 layout (location = 2) in vec2 aTexCoord;
 
+// per-instance model matrix, only read when drawing instanced
+layout (location = 3) in mat4 aInstanceModel;
+
 out vec2 TexCoord;
 
+#include "camera.glsl"
+
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+uniform bool instanced;
 
 void main()
 {
-	gl_Position = projection * view * model * vec4(aPos, 1.0);
+    mat4 worldModel = instanced ? aInstanceModel : model;
+    gl_Position = projection * view * worldModel * vec4(aPos, 1.0);
     TexCoord = aTexCoord;
 }
\ No newline at end of file
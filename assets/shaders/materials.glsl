@@ -0,0 +1,42 @@
+// materials packed into MaterialArrays, MaterialBlock on the CPU side. maps are the diffuse and specular
+// layers, or with bindless textures the two handles as low, high pairs
+struct MaterialEntry
+{
+    uvec4 maps;
+    vec4 params; // shininess, unused x3
+};
+
+layout (std140) uniform Materials
+{
+    MaterialEntry materials[MAX_PACKED_MATERIALS];
+};
+
+#ifdef BINDLESS_TEXTURES
+vec3 packedDiffuse(uint index, vec2 uv)
+{
+    return texture(sampler2D(materials[index].maps.xy), uv).rgb;
+}
+
+vec3 packedSpecular(uint index, vec2 uv)
+{
+    return texture(sampler2D(materials[index].maps.zw), uv).rgb;
+}
+#else
+uniform sampler2DArray diffuseLayers;
+uniform sampler2DArray specularLayers;
+
+vec3 packedDiffuse(uint index, vec2 uv)
+{
+    return texture(diffuseLayers, vec3(uv, float(materials[index].maps.x))).rgb;
+}
+
+vec3 packedSpecular(uint index, vec2 uv)
+{
+    return texture(specularLayers, vec3(uv, float(materials[index].maps.y))).rgb;
+}
+#endif
+
+float packedShininess(uint index)
+{
+    return materials[index].params.x;
+}
@@ -0,0 +1,17 @@
+#version 330 core
+// reads the position stream only, see Mesh::bindPositions()
+layout (location = 0) in vec3 aPos;
+
+// per-instance model matrix, only read when drawing instanced
+layout (location = 3) in mat4 aInstanceModel;
+
+// the shadow pass being drawn, see ShadowMaps::passMatrix()
+uniform mat4 lightViewProjection;
+uniform mat4 model;
+uniform bool instanced;
+
+void main()
+{
+    mat4 worldModel = instanced ? aInstanceModel : model;
+    gl_Position = lightViewProjection * worldModel * vec4(aPos, 1.0);
+}
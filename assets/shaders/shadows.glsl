@@ -0,0 +1,77 @@
+// shadow maps, see ShadowMaps
+layout (std140) uniform Shadows
+{
+    mat4 cascadeMatrices[MAX_CASCADES];  // world to cascade texture space
+    vec4 cascadeEnds;                    // view depth each cascade covers up to
+    vec4 cascadeTexels;                  // world size of one texel per cascade
+    vec4 cubeLight;                      // shadowed point light position, cube far plane
+    vec4 shadowParams;                   // cube near plane, 1 / cascade size, 1 / cube size, unused
+    ivec4 shadowLights;                  // Lights entries casting the cube and the cascades, -1 for none
+};
+
+uniform sampler2DArrayShadow cascadeShadows;
+uniform samplerCubeShadow cubeShadow;
+
+// every lookup is a hardware 2x2 PCF, 3x3 of them soften the edge further
+float cascadeShadow(vec3 fragPos, vec3 norm)
+{
+    float depth = -(view * vec4(fragPos, 1.0)).z;
+    int cascade = int(dot(step(cascadeEnds, vec4(depth)), vec4(1.0)));
+    if (cascade >= MAX_CASCADES)
+    {
+        return 1.0;
+    }
+
+    // pushed off the surface by a texel and a half so it doesn't shadow itself
+    vec3 offsetPos = fragPos + norm * cascadeTexels[cascade] * 1.5;
+    vec4 coord = cascadeMatrices[cascade] * vec4(offsetPos, 1.0);
+    float lit = 0.0;
+    for (int y = -1; y <= 1; y++)
+    {
+        for (int x = -1; x <= 1; x++)
+        {
+            vec2 uv = coord.xy + vec2(x, y) * shadowParams.y;
+            lit += texture(cascadeShadows, vec4(uv, float(cascade), coord.z));
+        }
+    }
+    return lit / 9.0;
+}
+
+float pointShadow(vec3 fragPos, vec3 norm)
+{
+    vec3 toFrag = fragPos - cubeLight.xyz;
+    // a face spans 2 * distance along the major axis over its texels
+    float texel = 2.0 * max(abs(toFrag.x), max(abs(toFrag.y), abs(toFrag.z))) * shadowParams.z;
+    toFrag += norm * texel * 1.5;
+
+    // the depth the face's perspective projection stored for this point
+    vec3 away = abs(toFrag);
+    float major = max(away.x, max(away.y, away.z));
+    float nearPlane = shadowParams.x;
+    float farPlane = cubeLight.w;
+    float depth = (farPlane + nearPlane) / (farPlane - nearPlane) -
+                  2.0 * farPlane * nearPlane / ((farPlane - nearPlane) * major);
+    depth = depth * 0.5 + 0.5;
+
+    // four taps on a tetrahedron around the direction, a texel and a half out
+    float spread = texel * 1.5;
+    float lit = texture(cubeShadow, vec4(toFrag + vec3(1.0, 1.0, 1.0) * spread, depth));
+    lit += texture(cubeShadow, vec4(toFrag + vec3(-1.0, -1.0, 1.0) * spread, depth));
+    lit += texture(cubeShadow, vec4(toFrag + vec3(1.0, -1.0, -1.0) * spread, depth));
+    lit += texture(cubeShadow, vec4(toFrag + vec3(-1.0, 1.0, -1.0) * spread, depth));
+    return lit * 0.25;
+}
+
+// 1 lit, 0 in shadow
+float lightShadow(int light, vec3 fragPos, vec3 norm)
+{
+    if (light == shadowLights.x)
+    {
+        return pointShadow(fragPos, norm);
+    }
+    if (light == shadowLights.y)
+    {
+        return cascadeShadow(fragPos, norm);
+    }
+    return 1.0;
+}
@@ -0,0 +1,129 @@
+// Headless BVH benchmark: build, refit and query times at 10k/100k/1M objects.
+// Build with -DBUILD_BENCHMARKS=ON -DCMAKE_BUILD_TYPE=Release and run ./bin/bvh-bench
+
+#include "bvh.h"
+#include "frustum.h"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+static double msSince(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+static bool runSize(size_t objects)
+{
+    // scale the world with the object count so density stays roughly constant
+    float worldSize = 4.0f * std::cbrt((float)objects);
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> position(-worldSize / 2, worldSize / 2);
+    std::uniform_real_distribution<float> size(0.25f, 1.0f);
+    std::uniform_real_distribution<float> jitter(-0.5f, 0.5f);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+    std::vector<Aabb> bounds(objects);
+    BoundsSoA soa;
+    soa.reserve(objects);
+    for (Aabb &box : bounds)
+    {
+        glm::vec3 center(position(rng), position(rng), position(rng));
+        glm::vec3 extents(size(rng), size(rng), size(rng));
+        box.min = center - extents;
+        box.max = center + extents;
+        soa.push(center, extents);
+    }
+
+    Bvh bvh;
+    auto start = Clock::now();
+    bvh.build(bounds);
+    double buildMs = msSince(start);
+
+    // move a tenth of the objects a little, as a frame of animation would
+    for (size_t i = 0; i < objects; i += 10)
+    {
+        glm::vec3 offset(jitter(rng), jitter(rng), jitter(rng));
+        Aabb moved = bounds[i];
+        moved.min += offset;
+        moved.max += offset;
+        bvh.update((uint32_t)i, moved);
+        soa.centerX[i] += offset.x;
+        soa.centerY[i] += offset.y;
+        soa.centerZ[i] += offset.z;
+    }
+    start = Clock::now();
+    bvh.refit();
+    double refitMs = msSince(start);
+
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f), 1280.0f / 720.0f, 0.1f, 100.0f);
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    Frustum frustum = Frustum::fromMatrix(projection * view);
+
+    std::vector<uint32_t> visible;
+    visible.reserve(objects);
+    const int frustumQueries = 20;
+    start = Clock::now();
+    for (int i = 0; i < frustumQueries; i++)
+    {
+        visible.clear();
+        bvh.queryFrustum(frustum, visible);
+    }
+    double frustumMs = msSince(start) / frustumQueries;
+
+    std::vector<uint32_t> linear(objects);
+    start = Clock::now();
+    size_t linearCount = 0;
+    for (int i = 0; i < frustumQueries; i++)
+    {
+        linearCount = culling::cullAabbsSimd(frustum, soa, linear.data());
+    }
+    double linearMs = msSince(start) / frustumQueries;
+
+    const int rays = 10000;
+    size_t hits = 0;
+    start = Clock::now();
+    for (int i = 0; i < rays; i++)
+    {
+        glm::vec3 direction = glm::normalize(glm::vec3(unit(rng), unit(rng), unit(rng)));
+        hits += bvh.raycast(glm::vec3(0.0f), direction).hit() ? 1 : 0;
+    }
+    double rayUs = msSince(start) * 1000.0 / rays;
+
+    const int lookups = 10000;
+    start = Clock::now();
+    for (int i = 0; i < lookups; i++)
+    {
+        bvh.nearest(glm::vec3(position(rng), position(rng), position(rng)));
+    }
+    double nearestUs = msSince(start) * 1000.0 / lookups;
+
+    std::printf("%8zu objects  build %8.2f ms  refit %6.2f ms  nodes %zu\n", objects, buildMs, refitMs,
+                bvh.nodeCount());
+    std::printf("          frustum %7.3f ms (linear %s %7.3f ms)  visible %zu/%zu\n", frustumMs, culling::simdPath(),
+                linearMs, visible.size(), linearCount);
+    std::printf("          raycast %7.3f us/ray (%zu hits)  nearest %7.3f us/query\n", rayUs, hits, nearestUs);
+
+    if (visible.size() != linearCount)
+    {
+        std::printf("bvh and linear frustum queries disagree\n");
+        return false;
+    }
+    return true;
+}
+
+int main()
+{
+    bool ok = true;
+    for (size_t objects : {10000, 100000, 1000000})
+    {
+        ok = runSize(objects) && ok;
+    }
+    return ok ? 0 : 1;
+}
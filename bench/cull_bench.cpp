@@ -0,0 +1,77 @@
+// Headless frustum culling benchmark: culls 1M boxes with the scalar and SIMD paths and reports ns/object.
+// Build with -DBUILD_BENCHMARKS=ON -DCMAKE_BUILD_TYPE=Release and run ./bin/cull-bench [objects] [iterations]
+
+#include "frustum.h"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+typedef size_t (*CullFn)(const Frustum &, const BoundsSoA &, uint32_t *);
+
+static double timeCull(CullFn cull, const Frustum &frustum, const BoundsSoA &bounds, std::vector<uint32_t> &visible,
+                       int iterations, size_t &visibleCount)
+{
+    // warm up caches and branch predictors once before timing
+    visibleCount = cull(frustum, bounds, visible.data());
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++)
+    {
+        visibleCount = cull(frustum, bounds, visible.data());
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    double ns = std::chrono::duration<double, std::nano>(end - start).count();
+    return ns / iterations / bounds.size();
+}
+
+int main(int argc, char *argv[])
+{
+    size_t objects = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    int iterations = argc > 2 ? std::atoi(argv[2]) : 20;
+
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> position(-200.0f, 200.0f);
+    std::uniform_real_distribution<float> size(0.25f, 2.0f);
+
+    BoundsSoA bounds;
+    bounds.reserve(objects);
+    for (size_t i = 0; i < objects; i++)
+    {
+        bounds.push(glm::vec3(position(rng), position(rng), position(rng)), glm::vec3(size(rng), size(rng), size(rng)));
+    }
+
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f), 1280.0f / 720.0f, 0.1f, 100.0f);
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 0.0f, 3.0f), glm::vec3(0.0f, 0.0f, 2.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    Frustum frustum = Frustum::fromMatrix(projection * view);
+
+    std::vector<uint32_t> visible(objects);
+    size_t scalarVisible, simdVisible;
+
+    double aabbScalar = timeCull(culling::cullAabbsScalar, frustum, bounds, visible, iterations, scalarVisible);
+    double aabbSimd = timeCull(culling::cullAabbsSimd, frustum, bounds, visible, iterations, simdVisible);
+    std::printf("aabb   scalar: %6.3f ns/object  visible %zu\n", aabbScalar, scalarVisible);
+    std::printf("aabb   %-6s: %6.3f ns/object  visible %zu  (%.2fx)\n", culling::simdPath(), aabbSimd, simdVisible,
+                aabbScalar / aabbSimd);
+    bool match = scalarVisible == simdVisible;
+
+    double sphereScalar = timeCull(culling::cullSpheresScalar, frustum, bounds, visible, iterations, scalarVisible);
+    double sphereSimd = timeCull(culling::cullSpheresSimd, frustum, bounds, visible, iterations, simdVisible);
+    std::printf("sphere scalar: %6.3f ns/object  visible %zu\n", sphereScalar, scalarVisible);
+    std::printf("sphere %-6s: %6.3f ns/object  visible %zu  (%.2fx)\n", culling::simdPath(), sphereSimd, simdVisible,
+                sphereScalar / sphereSimd);
+    match = match && scalarVisible == simdVisible;
+
+    if (!match)
+    {
+        std::printf("scalar and simd paths disagree\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,247 @@
+// Headless job system scaling benchmark: a synthetic 1M-object frame (transform update, chunked frustum cull,
+// sort key generation and instance data building, chained with dependency counters the way the renderer
+// does it) timed at 1 through N threads.
+// Build with -DBUILD_BENCHMARKS=ON -DCMAKE_BUILD_TYPE=Release and run ./bin/jobs-bench [objects] [frames] [max threads]
+
+#include "frustum.h"
+#include "job_system.h"
+#include "scene_store.h"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+static double msSince(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// same per-instance layout the renderer uploads, the normal matrix inverse is the expensive part
+struct InstanceData
+{
+    glm::mat4 model;
+    glm::mat3 normal;
+};
+
+static constexpr size_t chunkRows = 2048;
+
+struct Chunk
+{
+    size_t first, count, instances;
+    size_t instanceSlot, drawSlot;
+};
+
+struct Frame
+{
+    SceneStore *store;
+    Frustum frustum;
+    glm::vec3 viewPos;
+    std::vector<Chunk> chunks;
+    std::vector<uint32_t> visible;
+    std::vector<uint64_t> keys;
+    std::vector<glm::mat4> models;
+    std::vector<InstanceData> instances;
+};
+
+static void cullChunks(void *context, size_t begin, size_t end)
+{
+    Frame &frame = *static_cast<Frame *>(context);
+    const std::vector<uint32_t> &meshes = frame.store->meshes();
+    for (size_t c = begin; c < end; c++)
+    {
+        Chunk &chunk = frame.chunks[c];
+        uint32_t *visible = frame.visible.data() + chunk.first;
+        size_t last = std::min(chunk.first + chunkRows, frame.store->size());
+        chunk.count = culling::cullAabbsSimd(frame.frustum, frame.store->worldBounds(), chunk.first, last, visible);
+        chunk.instances = 0;
+        for (size_t i = 0; i < chunk.count; i++)
+        {
+            // even meshes stand in for instanced draws, odd ones for queued draws
+            chunk.instances += (meshes[visible[i]] & 1) == 0;
+        }
+    }
+}
+
+static void assignSlots(void *context, size_t, size_t)
+{
+    Frame &frame = *static_cast<Frame *>(context);
+    size_t visible = 0, instances = 0;
+    for (Chunk &chunk : frame.chunks)
+    {
+        chunk.instanceSlot = instances;
+        chunk.drawSlot = visible - instances;
+        visible += chunk.count;
+        instances += chunk.instances;
+    }
+    frame.keys.resize(visible - instances);
+    frame.models.resize(visible - instances);
+    frame.instances.resize(instances);
+}
+
+static void writeChunks(void *context, size_t begin, size_t end)
+{
+    Frame &frame = *static_cast<Frame *>(context);
+    const std::vector<glm::mat4> &world = frame.store->worldMatrices();
+    const std::vector<uint32_t> &meshes = frame.store->meshes();
+    const std::vector<uint32_t> &materials = frame.store->materials();
+    for (size_t c = begin; c < end; c++)
+    {
+        const Chunk &chunk = frame.chunks[c];
+        size_t instanceSlot = chunk.instanceSlot;
+        size_t drawSlot = chunk.drawSlot;
+        for (size_t i = 0; i < chunk.count; i++)
+        {
+            uint32_t row = frame.visible[chunk.first + i];
+            const glm::mat4 &m = world[row];
+            if ((meshes[row] & 1) == 0)
+            {
+                InstanceData &instance = frame.instances[instanceSlot++];
+                instance.model = m;
+                instance.normal = glm::transpose(glm::inverse(glm::mat3(m)));
+                continue;
+            }
+            // same layout as an opaque DrawQueue key
+            float depth = std::min(glm::distance(frame.viewPos, glm::vec3(m[3])) / 100.0f, 1.0f);
+            uint64_t z = (uint64_t)(depth * ((1u << 24) - 1));
+            frame.keys[drawSlot] = ((uint64_t)(materials[row] & 0xFFFF) << 39) | ((uint64_t)(meshes[row] & 0xFFF) << 27) |
+                                   (z << 3);
+            frame.models[drawSlot++] = m;
+        }
+    }
+}
+
+// one frame's CPU work, returns a checksum so every thread count can be checked against the serial result
+static uint64_t runFrame(JobSystem &jobs, Frame &frame, const std::vector<Entity> &handles, int frameIndex)
+{
+    // a quarter of the scene spins each frame, game logic would do this before the frame jobs start
+    glm::vec3 axis(0.0f, 1.0f, 0.0f);
+    for (size_t i = frameIndex % 4; i < handles.size(); i += 4)
+    {
+        frame.store->setRotation(handles[i], glm::angleAxis(0.01f * (float)(frameIndex + i), axis));
+    }
+
+    frame.store->updateTransforms(&jobs);
+
+    frame.chunks.clear();
+    for (size_t first = 0; first < frame.store->size(); first += chunkRows)
+    {
+        frame.chunks.push_back({first, 0, 0, 0, 0});
+    }
+
+    JobCounter culled, slotted, written;
+    jobs.parallelFor(frame.chunks.size(), 1, cullChunks, &frame, culled);
+    jobs.run(assignSlots, &frame, slotted, &culled);
+    jobs.parallelFor(frame.chunks.size(), 1, writeChunks, &frame, written, &slotted);
+    jobs.wait(written);
+
+    uint64_t checksum = frame.keys.size() * 0x9E3779B97F4A7C15ull + frame.instances.size();
+    for (uint64_t key : frame.keys)
+    {
+        checksum = checksum * 31 + key;
+    }
+    for (const InstanceData &instance : frame.instances)
+    {
+        uint32_t bits;
+        std::memcpy(&bits, &instance.normal[0][0], sizeof(bits));
+        checksum = checksum * 31 + bits;
+    }
+    return checksum;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t objects = argc > 1 ? (size_t)std::atoll(argv[1]) : 1000000;
+    int frames = argc > 2 ? std::atoi(argv[2]) : 20;
+    unsigned maxThreads = argc > 3 ? (unsigned)std::atoi(argv[3]) : std::thread::hardware_concurrency();
+    if (objects == 0 || frames <= 0 || maxThreads == 0)
+    {
+        std::fprintf(stderr, "usage: %s [objects] [frames] [max threads]\n", argv[0]);
+        return 1;
+    }
+
+    // a box of objects in front of the camera, roughly half of it inside the frustum
+    float worldSize = 2.0f * std::cbrt((float)objects);
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> position(-worldSize / 2, worldSize / 2);
+    std::uniform_real_distribution<float> depth(-worldSize - 2.0f, -2.0f);
+
+    SceneStore store;
+    store.reserve(objects);
+    std::vector<Entity> handles;
+    handles.reserve(objects);
+    for (size_t i = 0; i < objects; i++)
+    {
+        Transform transform;
+        transform.position = glm::vec3(position(rng), position(rng), depth(rng));
+        handles.push_back(store.create(transform, glm::vec3(-0.5f), glm::vec3(0.5f), (uint32_t)(i % 64), 0));
+    }
+    store.updateTransforms();
+
+    glm::mat4 projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 1000.0f);
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+    std::printf("%zu objects, %d frames per thread count, %u hardware threads, cull %s\n", objects, frames,
+                std::thread::hardware_concurrency(), culling::simdPath());
+
+    double serialMs = 0.0;
+    uint64_t serialChecksum = 0;
+    bool ok = true;
+    for (unsigned threads = 1; threads <= maxThreads; threads++)
+    {
+        JobSystem jobs(threads);
+        Frame frame;
+        frame.store = &store;
+        frame.frustum = Frustum::fromMatrix(projection * view);
+        frame.viewPos = glm::vec3(0.0f);
+        frame.visible.resize(objects);
+
+        // reset to the same state first so every thread count computes the same frames
+        for (Entity entity : handles)
+        {
+            store.setRotation(entity, glm::quat(1.0f, 0.0f, 0.0f, 0.0f));
+        }
+        store.updateTransforms();
+
+        std::vector<double> times;
+        uint64_t checksum = 0;
+        for (int i = -2; i < frames; i++)
+        {
+            auto start = Clock::now();
+            uint64_t result = runFrame(jobs, frame, handles, i < 0 ? 0 : i);
+            if (i >= 0)
+            {
+                times.push_back(msSince(start));
+                checksum ^= result + (uint64_t)i;
+            }
+        }
+        std::sort(times.begin(), times.end());
+        double medianMs = times[times.size() / 2];
+
+        if (threads == 1)
+        {
+            serialMs = medianMs;
+            serialChecksum = checksum;
+        }
+        else if (checksum != serialChecksum)
+        {
+            std::printf("%2u threads produced a different frame than 1 thread\n", threads);
+            ok = false;
+        }
+
+        double speedup = serialMs / medianMs;
+        std::printf("%2u threads  %8.3f ms/frame  speedup %5.2fx  efficiency %5.1f%%  (%zu draws, %zu instances)\n",
+                    threads, medianMs, speedup, 100.0 * speedup / threads, frame.keys.size(), frame.instances.size());
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,151 @@
+// Headless clustered light assignment benchmark: bins 1k to 64k point lights into the light grid, serially
+// and on the job system, and checks every lit point against its cluster's list.
+// Build with -DBUILD_BENCHMARKS=ON -DCMAKE_BUILD_TYPE=Release and run ./bin/lights-bench [frames]
+
+#include "job_system.h"
+#include "light_grid.h"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+static double msSince(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+static constexpr float nearPlane = 0.1f;
+static constexpr float farPlane = 100.0f;
+static constexpr float width = 1280.0f;
+static constexpr float height = 720.0f;
+
+// every light whose sphere holds a point has to be in the list of the cluster the shader picks for it
+static bool validate(const LightGrid &grid, const PointLights &lights, const glm::mat4 &view,
+                     const glm::mat4 &projection, size_t samples)
+{
+    std::mt19937 rng(3);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    size_t lit = 0;
+    for (size_t s = 0; s < samples; s++)
+    {
+        // a random pixel at a random depth, taken back to world space
+        float ndcX = unit(rng) * 2.0f - 1.0f;
+        float ndcY = unit(rng) * 2.0f - 1.0f;
+        float depth = nearPlane * std::pow(farPlane / nearPlane, unit(rng));
+        glm::vec4 viewPoint(ndcX * depth / projection[0][0], ndcY * depth / projection[1][1], -depth, 1.0f);
+        glm::vec3 point(glm::inverse(view) * viewPoint);
+
+        // the same lookup lighting.frag does
+        float slice = std::floor(std::log(depth) * grid.sliceScale() + grid.sliceBias());
+        slice = std::min(std::max(slice, 0.0f), (float)(LightGrid::depthSlices - 1));
+        uint32_t tileX = std::min((uint32_t)((ndcX * 0.5f + 0.5f) * LightGrid::tilesX),
+                                  LightGrid::tilesX - 1);
+        uint32_t tileY = std::min((uint32_t)((ndcY * 0.5f + 0.5f) * LightGrid::tilesY),
+                                  LightGrid::tilesY - 1);
+        uint32_t cluster = ((uint32_t)slice * LightGrid::tilesY + tileY) * LightGrid::tilesX + tileX;
+        uint32_t offset = grid.clusters()[cluster * 2];
+        uint32_t count = grid.clusters()[cluster * 2 + 1];
+        const uint16_t *first = grid.indices().data() + offset;
+
+        for (size_t i = 0; i < lights.size(); i++)
+        {
+            glm::vec3 center(lights.positionX[i], lights.positionY[i], lights.positionZ[i]);
+            // a little inside the radius, points right on the edge get no light anyway
+            if (glm::distance(center, point) > lights.radius[i] * 0.999f)
+            {
+                continue;
+            }
+            lit++;
+            if (!std::binary_search(first, first + count, (uint16_t)i))
+            {
+                std::printf("light %zu reaches (%.2f, %.2f, %.2f) but is missing from cluster %u\n", i, point.x,
+                            point.y, point.z, cluster);
+                return false;
+            }
+        }
+    }
+    return lit > 0;
+}
+
+static bool runCount(JobSystem &jobs, size_t count, int frames)
+{
+    // the same spread as the renderer's lights scene, scaled so density stays roughly constant
+    float extent = 14.0f * std::cbrt((float)count / 4096.0f);
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> across(-extent, extent);
+    std::uniform_real_distribution<float> along(-2.0f * extent, 0.0f);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+    PointLights lights;
+    lights.reserve(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        glm::vec3 position(across(rng), across(rng), along(rng) - 1.0f);
+        lights.push(position, 1.5f + 1.5f * unit(rng), glm::vec3(1.0f));
+    }
+
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f), width / height, nearPlane, farPlane);
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 0.0f, 6.0f), glm::vec3(0.0f, 0.0f, -10.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+    LightGrid serial, threaded;
+    std::vector<double> serialTimes, threadedTimes;
+    for (int frame = -2; frame < frames; frame++)
+    {
+        auto start = Clock::now();
+        serial.assign(lights, view, projection, nearPlane, farPlane);
+        double serialMs = msSince(start);
+
+        start = Clock::now();
+        threaded.assign(lights, view, projection, nearPlane, farPlane, &jobs);
+        double threadedMs = msSince(start);
+
+        if (frame >= 0)
+        {
+            serialTimes.push_back(serialMs);
+            threadedTimes.push_back(threadedMs);
+        }
+    }
+    std::sort(serialTimes.begin(), serialTimes.end());
+    std::sort(threadedTimes.begin(), threadedTimes.end());
+
+    std::printf("%6zu lights  serial %7.3f ms  %u threads %7.3f ms  %7zu indices, at most %3u per cluster\n", count,
+                serialTimes[serialTimes.size() / 2], jobs.threadCount(), threadedTimes[threadedTimes.size() / 2],
+                serial.indices().size(), serial.maxClusterLights());
+
+    bool ok = serial.clusters() == threaded.clusters() && serial.indices() == threaded.indices();
+    if (!ok)
+    {
+        std::printf("threaded assignment differs from the serial one\n");
+    }
+    return ok && validate(serial, lights, view, projection, count >= 16384 ? 2000 : 20000);
+}
+
+int main(int argc, char *argv[])
+{
+    int frames = argc > 1 ? std::atoi(argv[1]) : 50;
+    if (frames <= 0)
+    {
+        std::fprintf(stderr, "usage: %s [frames]\n", argv[0]);
+        return 1;
+    }
+
+    JobSystem jobs;
+    std::printf("%u x %u x %u clusters, per-light bounds %s\n", LightGrid::tilesX, LightGrid::tilesY,
+                LightGrid::depthSlices, LightGrid::simdPath());
+
+    bool ok = true;
+    for (size_t count : {1024, 4096, 16384, 65536})
+    {
+        ok = runCount(jobs, count, frames) && ok;
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,214 @@
+// Headless occlusion culling benchmark: the renderer's crate grid seen from a few fixed views, frustum culled
+// and then tested against the biggest crates rasterised on the CPU. Reports the cull ratio and what each
+// step costs per frame, and checks culled crates against the same occluders drawn at 4x the resolution.
+// Build with -DBUILD_BENCHMARKS=ON -DCMAKE_BUILD_TYPE=Release and run ./bin/occlusion-bench [frames] [occluders]
+
+#include "frustum.h"
+#include "occlusion.h"
+#include "scene_store.h"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iterator>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+static double msSince(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+static constexpr float nearPlane = 0.1f;
+static constexpr float farPlane = 100.0f;
+static const glm::vec3 boundsMin(-0.5f), boundsMax(0.5f);
+
+struct View
+{
+    const char *name;
+    glm::vec3 eye;
+    glm::vec3 target;
+};
+
+struct FrameTimes
+{
+    double frustum, pick, raster, pyramid, test;
+};
+
+// the per-object scene's layout, see buildScene() in renderer.cpp
+static void buildGrid(SceneStore &store, size_t count)
+{
+    int side = (int)std::ceil(std::cbrt((double)count));
+    float spacing = 1.5f;
+    float offset = (side - 1) * spacing / 2.0f;
+    glm::vec3 rotAxis = glm::normalize(glm::vec3(1.0f, 0.3f, 0.5f));
+    store.reserve(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        int x = i % side;
+        int y = (i / side) % side;
+        int z = i / (side * side);
+        Transform transform;
+        transform.position = glm::vec3(x * spacing - offset, y * spacing - offset, -z * spacing - 2.0f);
+        transform.rotation = glm::angleAxis(glm::radians(20.0f * (i % 18)), rotAxis);
+        store.create(transform, boundsMin, boundsMax, 0, 0);
+    }
+    store.updateTransforms();
+}
+
+// culled crates that still show a pixel in front of the occluders at 4x resolution, out of how many were checked
+static size_t countLeaks(const SceneStore &store, const glm::mat4 &viewProjection, const uint32_t *occluders,
+                         size_t occluderCount, const std::vector<uint32_t> &culled, size_t &checked)
+{
+    OcclusionBuffer fine(1024, 576);
+    OcclusionBuffer single(1024, 576);
+    fine.begin(viewProjection);
+    for (size_t i = 0; i < occluderCount; i++)
+    {
+        fine.drawBox(store.worldMatrices()[occluders[i]], boundsMin, boundsMax);
+    }
+
+    size_t leaks = 0;
+    checked = std::min(culled.size(), (size_t)100);
+    for (size_t i = 0; i < checked; i++)
+    {
+        uint32_t row = culled[i * culled.size() / checked];
+        single.begin(viewProjection);
+        single.drawBox(store.worldMatrices()[row], boundsMin, boundsMax);
+        const std::vector<float> &own = single.depth();
+        const std::vector<float> &front = fine.depth();
+        for (size_t p = 0; p < own.size(); p++)
+        {
+            if (own[p] < front[p])
+            {
+                leaks++;
+                break;
+            }
+        }
+    }
+    return leaks;
+}
+
+static bool runView(const SceneStore &store, const View &view, int frames, size_t maxOccluders)
+{
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f), 1280.0f / 720.0f, nearPlane, farPlane);
+    glm::mat4 viewMatrix = glm::lookAt(view.eye, view.target, glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 viewProjection = projection * viewMatrix;
+    const BoundsSoA &bounds = store.worldBounds();
+
+    OcclusionBuffer buffer;
+    std::vector<uint32_t> visible(store.size()), candidates, scalar;
+    std::vector<FrameTimes> times;
+    size_t frustumCount = 0, visibleCount = 0, occluderCount = 0;
+    for (int frame = -2; frame < frames; frame++)
+    {
+        FrameTimes t;
+        auto start = Clock::now();
+        Frustum frustum = Frustum::fromMatrix(viewProjection);
+        frustumCount = culling::cullAabbsSimd(frustum, bounds, visible.data());
+        t.frustum = msSince(start);
+
+        start = Clock::now();
+        candidates.assign(visible.begin(), visible.begin() + frustumCount);
+        occluderCount = OcclusionBuffer::pickOccluders(bounds, view.eye, candidates.data(), frustumCount, maxOccluders);
+        t.pick = msSince(start);
+
+        start = Clock::now();
+        buffer.begin(viewProjection);
+        for (size_t i = 0; i < occluderCount; i++)
+        {
+            buffer.drawBox(store.worldMatrices()[candidates[i]], boundsMin, boundsMax);
+        }
+        t.raster = msSince(start);
+
+        start = Clock::now();
+        buffer.finish();
+        t.pyramid = msSince(start);
+
+        scalar.assign(visible.begin(), visible.begin() + frustumCount);
+        start = Clock::now();
+        visibleCount = buffer.cull(bounds, visible.data(), frustumCount);
+        t.test = msSince(start);
+
+        if (frame >= 0)
+        {
+            times.push_back(t);
+        }
+    }
+
+    auto median = [&](double FrameTimes::*field) {
+        std::vector<double> values;
+        for (const FrameTimes &t : times)
+        {
+            values.push_back(t.*field);
+        }
+        std::sort(values.begin(), values.end());
+        return values[values.size() / 2];
+    };
+    double total = median(&FrameTimes::pick) + median(&FrameTimes::raster) + median(&FrameTimes::pyramid) +
+                   median(&FrameTimes::test);
+    size_t occluded = frustumCount - visibleCount;
+    std::printf("%6zu crates  %-7s frustum %5zu  occluded %5zu (%5.1f%%)  %3zu occluders %5zu tris  "
+                "pick %.3f  raster %.3f  hi-z %.3f  test %.3f  = %.3f ms  (frustum %.3f ms)\n",
+                store.size(), view.name, frustumCount, occluded, frustumCount ? 100.0 * occluded / frustumCount : 0.0,
+                occluderCount, buffer.triangles(), median(&FrameTimes::pick), median(&FrameTimes::raster),
+                median(&FrameTimes::pyramid), median(&FrameTimes::test), total, median(&FrameTimes::frustum));
+
+    std::vector<uint32_t> inFrustum = scalar;
+    size_t scalarCount = buffer.cullScalar(bounds, scalar.data(), scalar.size());
+    bool ok = scalarCount == visibleCount && std::equal(scalar.begin(), scalar.begin() + scalarCount, visible.begin());
+    if (!ok)
+    {
+        std::printf("scalar and %s tests disagree, %zu against %zu visible\n", OcclusionBuffer::simdPath(),
+                    scalarCount, visibleCount);
+    }
+
+    // both lists are in row order, what frustum culling let through minus what is still visible got culled here
+    std::vector<uint32_t> culled;
+    std::set_difference(inFrustum.begin(), inFrustum.end(), visible.begin(), visible.begin() + visibleCount,
+                        std::back_inserter(culled));
+    size_t checked = 0;
+    size_t leaks = countLeaks(store, viewProjection, candidates.data(), occluderCount, culled, checked);
+    std::printf("%6s %-7s %zu of %zu culled crates checked show through at 4x resolution\n", "", "", leaks, checked);
+    return ok && leaks == 0;
+}
+
+int main(int argc, char *argv[])
+{
+    int frames = argc > 1 ? std::atoi(argv[1]) : 50;
+    size_t maxOccluders = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 128;
+    if (frames <= 0 || maxOccluders == 0)
+    {
+        std::fprintf(stderr, "usage: %s [frames] [occluders]\n", argv[0]);
+        return 1;
+    }
+
+    OcclusionBuffer layout;
+    std::printf("%d x %d depth, %zu levels, %s\n", layout.width(), layout.height(), layout.levelCount(),
+                OcclusionBuffer::simdPath());
+
+    bool ok = true;
+    for (size_t count : {4096, 32768})
+    {
+        SceneStore store;
+        buildGrid(store, count);
+        float extent = std::ceil(std::cbrt((float)count)) * 1.5f / 2.0f;
+        const View views[] = {
+            {"front", glm::vec3(0.0f, 0.0f, 3.0f), glm::vec3(0.0f, 0.0f, -10.0f)},
+            {"corner", glm::vec3(extent + 6.0f, extent + 4.0f, 4.0f), glm::vec3(0.0f, 0.0f, -extent - 2.0f)},
+            {"inside", glm::vec3(0.3f, 0.4f, -extent), glm::vec3(0.3f, 0.4f, -4.0f * extent)},
+        };
+        for (const View &view : views)
+        {
+            ok = runView(store, view, frames, maxOccluders) && ok;
+        }
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,385 @@
+// Headless render benchmark: runs the renderer's fixed scenes offscreen along a scripted camera path and
+// writes frame time statistics as JSON. Works without a display, including Mesa llvmpipe on CI machines.
+// Build with -DBUILD_BENCHMARKS=ON -DCMAKE_BUILD_TYPE=Release and run from bin/ so assets/ resolves:
+//   ./learning-opengl-bench [--frames N] [--warmup N] [--size WxH] [--out bench.json]
+
+#include <glad/glad.h>
+
+#include "camera.h"
+#include "camera_path.h"
+#include "headless_context.h"
+#include "profiler.h"
+#include "renderer.h"
+#include "shader.h"
+#include "stats.h"
+
+#include <SDL3/SDL.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+struct BenchScene
+{
+    const char *name;
+    const char *scene; // renderer scene name
+    size_t instances;
+    const char *culling;
+    bool shaderNormals = false; // invert the normal matrix per vertex instead of uploading it
+    bool shadows = false;       // cascaded sun and cube lamp shadows
+    bool lod = false;           // per object levels of detail for the highpoly spheres
+    bool separateMaterials = false; // materials scene binding textures per material instead of texture arrays
+};
+
+// fixed so results stay comparable between commits, only append to this list
+static const BenchScene benchScenes[] = {
+    {"single", "single", 1, "off"},
+    {"per-object-4k", "per-object", 4096, "linear"},
+    {"instanced-4k", "instanced", 4096, "linear"},
+    {"instanced-64k-linear", "instanced", 65536, "linear"},
+    {"instanced-64k-bvh", "instanced", 65536, "bvh"},
+    {"instanced-64k-nocull", "instanced", 65536, "off"},
+    {"distinct-4k", "distinct", 4096, "linear"},
+    {"lights-4k", "lights", 4096, "linear"},
+    {"highpoly-64", "highpoly", 64, "linear"},
+    {"highpoly-64-shader-normals", "highpoly", 64, "linear", true},
+    {"per-object-4k-shadows", "per-object", 4096, "linear", false, true},
+    {"highpoly-64-shadows", "highpoly", 64, "linear", false, true},
+    {"per-object-4k-occlusion", "per-object", 4096, "occlusion"},
+    {"instanced-64k-occlusion", "instanced", 65536, "occlusion"},
+    {"highpoly-512", "highpoly", 512, "linear"},
+    {"highpoly-512-lod", "highpoly", 512, "linear", false, false, true},
+    {"highpoly-4k-lod", "highpoly", 4096, "linear", false, false, true},
+    {"materials-4k", "materials", 4096, "linear"},
+    {"materials-4k-separate", "materials", 4096, "linear", false, false, false, true},
+};
+
+// simulated time step, frames are rendered as fast as possible but the camera always advances by this much
+static constexpr float frameStep = 1.0f / 60.0f;
+
+// the start of the path is rendered again with the uniform location cache off, to count the queries it saves
+static constexpr int uncachedFrames = 10;
+
+struct SceneResult
+{
+    const BenchScene *scene;
+    std::vector<double> frameMs;
+    double drawCalls = 0.0;
+    double triangles = 0.0;
+    double stateChanges = 0.0;
+    double uniformUploads = 0.0;
+    // glGetUniformLocation calls per frame over the first uncachedFrames of the path, cache on and off
+    double locationQueries = 0.0;
+    double locationQueriesUncached = 0.0;
+    double cachedMs = 0.0;
+    double uncachedMs = 0.0;
+    int comparedFrames = 0;
+    double visibleObjects = 0.0;
+    double heapAllocations = 0.0;
+    uint64_t maxHeapAllocations = 0;
+    uint64_t imageHash = 0;
+};
+
+static CameraPath makeFlythrough()
+{
+    // orbits in front of the benchmark grid, dips inside it and pulls back out
+    CameraPath path;
+    path.add(0.0f, glm::vec3(0.0f, 0.0f, 6.0f), glm::vec3(0.0f, 0.0f, -10.0f));
+    path.add(2.0f, glm::vec3(14.0f, 6.0f, 2.0f), glm::vec3(0.0f, 0.0f, -12.0f));
+    path.add(4.0f, glm::vec3(4.0f, 1.0f, -12.0f), glm::vec3(-8.0f, 0.0f, -20.0f));
+    path.add(6.0f, glm::vec3(-12.0f, -4.0f, 0.0f), glm::vec3(0.0f, 0.0f, -12.0f));
+    path.add(8.0f, glm::vec3(0.0f, 0.0f, 6.0f), glm::vec3(0.0f, 0.0f, -10.0f));
+    return path;
+}
+
+// FNV-1a over the final frame, identical scenes on the same driver should produce identical hashes
+static uint64_t hashPixels(const std::vector<uint8_t> &pixels)
+{
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (uint8_t byte : pixels)
+    {
+        hash = (hash ^ byte) * 0x100000001b3ull;
+    }
+    return hash;
+}
+
+static double percentile(const std::vector<double> &sorted, double p)
+{
+    if (sorted.empty())
+    {
+        return 0.0;
+    }
+    size_t index = (size_t)(p * (sorted.size() - 1) + 0.5);
+    return sorted[std::min(index, sorted.size() - 1)];
+}
+
+static void renderFrame(Camera *camera, const CameraPath &path, float time)
+{
+    profiler::beginFrame();
+    path.apply(camera, time);
+    {
+        PROFILE_CPU("render");
+        renderer::render(camera);
+    }
+    {
+        // without a swap nothing forces the driver to finish, wait here so frame times include GPU work
+        PROFILE_CPU("finish");
+        glFinish();
+    }
+    profiler::endFrame();
+}
+
+static SceneResult runScene(const BenchScene &bench, HeadlessContext &context, Camera *camera,
+                            const CameraPath &path, int warmup, int frames)
+{
+    SceneResult result;
+    result.scene = &bench;
+    result.frameMs.reserve(frames);
+
+    renderer::setScene(bench.scene);
+    renderer::setCulling(bench.culling);
+    renderer::setInstanceCount(bench.instances);
+    renderer::setShaderNormals(bench.shaderNormals);
+    renderer::setShadows(bench.shadows);
+    renderer::setLod(bench.lod);
+    renderer::setMaterialArrays(!bench.separateMaterials);
+
+    // warmup frames rebuild the grid and settle driver caches, the camera restarts from the same point
+    for (int i = 0; i < warmup; i++)
+    {
+        renderFrame(camera, path, 0.0f);
+    }
+
+    for (int i = 0; i < frames; i++)
+    {
+        Uint64 start = SDL_GetTicksNS();
+        renderFrame(camera, path, i * frameStep);
+        result.frameMs.push_back((SDL_GetTicksNS() - start) / 1e6);
+
+        const stats::FrameCounters &counters = stats::last();
+        result.drawCalls += counters.drawCalls;
+        result.triangles += counters.triangles;
+        result.stateChanges += counters.stateChangesIssued;
+        result.uniformUploads += counters.uniformUploads;
+        result.visibleObjects += renderer::visibleObjects();
+        result.heapAllocations += counters.heapAllocations;
+        result.maxHeapAllocations = std::max(result.maxHeapAllocations, counters.heapAllocations);
+        if (i < uncachedFrames)
+        {
+            result.locationQueries += counters.uniformLocationQueries;
+            result.cachedMs += result.frameMs.back();
+        }
+    }
+
+    if (frames > 0)
+    {
+        result.drawCalls /= frames;
+        result.triangles /= frames;
+        result.stateChanges /= frames;
+        result.uniformUploads /= frames;
+        result.visibleObjects /= frames;
+        result.heapAllocations /= frames;
+    }
+
+    std::vector<uint8_t> pixels;
+    context.readPixels(pixels);
+    result.imageHash = hashPixels(pixels);
+
+    // after the hash, so the image is the cached run's
+    result.comparedFrames = std::min(frames, uncachedFrames);
+    Shader::setLocationCache(false);
+    for (int i = 0; i < result.comparedFrames; i++)
+    {
+        Uint64 start = SDL_GetTicksNS();
+        renderFrame(camera, path, i * frameStep);
+        result.uncachedMs += (SDL_GetTicksNS() - start) / 1e6;
+        result.locationQueriesUncached += stats::last().uniformLocationQueries;
+    }
+    Shader::setLocationCache(true);
+    if (result.comparedFrames > 0)
+    {
+        result.locationQueries /= result.comparedFrames;
+        result.cachedMs /= result.comparedFrames;
+        result.locationQueriesUncached /= result.comparedFrames;
+        result.uncachedMs /= result.comparedFrames;
+    }
+    return result;
+}
+
+static bool writeJson(const char *path, const std::vector<SceneResult> &results, const HeadlessContext &context,
+                      int warmup, int frames)
+{
+    FILE *file = std::fopen(path, "w");
+    if (!file)
+    {
+        SDL_Log("bench: couldn't open %s", path);
+        return false;
+    }
+
+    std::fprintf(file, "{\n");
+    std::fprintf(file, "  \"renderer\": \"%s\",\n", (const char *)glGetString(GL_RENDERER));
+    std::fprintf(file, "  \"version\": \"%s\",\n", (const char *)glGetString(GL_VERSION));
+    std::fprintf(file, "  \"width\": %d,\n  \"height\": %d,\n", context.width(), context.height());
+    std::fprintf(file, "  \"warmup\": %d,\n  \"frames\": %d,\n", warmup, frames);
+    std::fprintf(file, "  \"scenes\": [\n");
+
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const SceneResult &result = results[i];
+        std::vector<double> sorted = result.frameMs;
+        std::sort(sorted.begin(), sorted.end());
+        double total = 0.0;
+        for (double ms : sorted)
+        {
+            total += ms;
+        }
+        double mean = sorted.empty() ? 0.0 : total / sorted.size();
+
+        std::fprintf(file, "    {\n");
+        std::fprintf(file, "      \"name\": \"%s\",\n", result.scene->name);
+        std::fprintf(file, "      \"scene\": \"%s\",\n", result.scene->scene);
+        std::fprintf(file, "      \"instances\": %zu,\n", result.scene->instances);
+        std::fprintf(file, "      \"culling\": \"%s\",\n", result.scene->culling);
+        std::fprintf(file,
+                     "      \"frame_ms\": {\"mean\": %.4f, \"min\": %.4f, \"p50\": %.4f, \"p95\": %.4f, "
+                     "\"p99\": %.4f, \"max\": %.4f},\n",
+                     mean, sorted.empty() ? 0.0 : sorted.front(), percentile(sorted, 0.50),
+                     percentile(sorted, 0.95), percentile(sorted, 0.99), sorted.empty() ? 0.0 : sorted.back());
+        std::fprintf(file, "      \"draw_calls\": %.1f,\n", result.drawCalls);
+        std::fprintf(file, "      \"triangles\": %.1f,\n", result.triangles);
+        std::fprintf(file, "      \"state_changes\": %.1f,\n", result.stateChanges);
+        std::fprintf(file, "      \"uniform_uploads\": %.1f,\n", result.uniformUploads);
+        std::fprintf(file,
+                     "      \"uniform_location_queries\": {\"frames\": %d, \"cached\": %.1f, \"uncached\": %.1f, "
+                     "\"cached_frame_ms\": %.4f, \"uncached_frame_ms\": %.4f},\n",
+                     result.comparedFrames, result.locationQueries, result.locationQueriesUncached, result.cachedMs,
+                     result.uncachedMs);
+        std::fprintf(file, "      \"visible_objects\": %.1f,\n", result.visibleObjects);
+        std::fprintf(file, "      \"heap_allocations\": {\"mean\": %.1f, \"max\": %llu},\n", result.heapAllocations,
+                     (unsigned long long)result.maxHeapAllocations);
+        std::fprintf(file, "      \"image_hash\": \"%016llx\"\n", (unsigned long long)result.imageHash);
+        std::fprintf(file, "    }%s\n", i + 1 < results.size() ? "," : "");
+    }
+
+    std::fprintf(file, "  ]\n}\n");
+    std::fclose(file);
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    int frames = 300;
+    int warmup = 30;
+    int width = 1280;
+    int height = 720;
+    const char *output = "bench.json";
+    const char *only = nullptr;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+        {
+            frames = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--warmup") == 0 && i + 1 < argc)
+        {
+            warmup = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--size") == 0 && i + 1 < argc)
+        {
+            if (std::sscanf(argv[++i], "%dx%d", &width, &height) != 2)
+            {
+                std::fprintf(stderr, "expected --size WIDTHxHEIGHT\n");
+                return 1;
+            }
+        }
+        else if (std::strcmp(argv[i], "--out") == 0 && i + 1 < argc)
+        {
+            output = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--scene") == 0 && i + 1 < argc)
+        {
+            only = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--texture-budget") == 0 && i + 1 < argc)
+        {
+            // in MiB, set before init so it holds from the first frame
+            renderer::setTextureBudget((size_t)std::atoi(argv[++i]) << 20);
+        }
+        else if (std::strcmp(argv[i], "--bindless-materials") == 0)
+        {
+            renderer::setBindlessMaterials(true);
+        }
+        else
+        {
+            std::fprintf(stderr,
+                         "usage: %s [--frames N] [--warmup N] [--size WxH] [--scene NAME] [--texture-budget MiB]\n"
+                         "          [--bindless-materials] [--out bench.json]\n",
+                         argv[0]);
+            return 1;
+        }
+    }
+    if (frames <= 0 || warmup < 0 || width <= 0 || height <= 0)
+    {
+        std::fprintf(stderr, "frames, warmup and size must be positive\n");
+        return 1;
+    }
+
+    HeadlessContext context;
+    if (!context.create(width, height))
+    {
+        return 1;
+    }
+
+    renderer::init();
+    renderer::resize(width, height);
+    profiler::init();
+
+    Camera *camera = new Camera(glm::vec3(0.0f, 0.0f, 3.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    CameraPath path = makeFlythrough();
+
+    // every scene must see the real textures, not the streaming placeholders
+    Uint64 streamDeadline = SDL_GetTicksNS() + 10 * SDL_NS_PER_SECOND;
+    while (!renderer::texturesResident() && SDL_GetTicksNS() < streamDeadline)
+    {
+        renderFrame(camera, path, 0.0f);
+    }
+    if (!renderer::texturesResident())
+    {
+        SDL_Log("bench: textures still streaming after 10 s, results will include placeholders");
+    }
+
+    std::vector<SceneResult> results;
+    for (const BenchScene &bench : benchScenes)
+    {
+        if (only && std::strcmp(only, bench.name) != 0)
+        {
+            continue;
+        }
+        results.push_back(runScene(bench, context, camera, path, warmup, frames));
+
+        std::vector<double> sorted = results.back().frameMs;
+        std::sort(sorted.begin(), sorted.end());
+        SDL_Log("bench %-22s p50 %.3f ms  p95 %.3f ms  p99 %.3f ms", bench.name, percentile(sorted, 0.50),
+                percentile(sorted, 0.95), percentile(sorted, 0.99));
+    }
+
+    bool written = !results.empty() && writeJson(output, results, context, warmup, frames);
+    if (written)
+    {
+        SDL_Log("bench: wrote %s", output);
+    }
+    else if (results.empty())
+    {
+        SDL_Log("bench: no scene named %s", only);
+    }
+
+    delete camera;
+    profiler::shutdown();
+    renderer::cleanup();
+    context.destroy();
+
+    return written ? 0 : 1;
+}
@@ -0,0 +1,213 @@
+// Headless scene store benchmark: iteration, transform mutation and create/destroy churn at 10k/100k/1M
+// entities, with a heap-allocated object-per-pointer layout as the baseline for iteration, and batched
+// normal matrices against a glm inverse per matrix.
+// Build with -DBUILD_BENCHMARKS=ON -DCMAKE_BUILD_TYPE=Release and run ./bin/scene-bench
+
+#include "frustum.h"
+#include "normal_matrix.h"
+#include "scene_store.h"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+static double msSince(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// what the renderer used before the store: one allocation per object, reached through a pointer
+struct HeapObject
+{
+    Transform transform;
+    glm::mat4 world;
+    glm::vec3 boundsMin, boundsMax;
+    uint32_t mesh;
+    uint32_t material;
+};
+
+// keeps the optimiser from dropping the loops being timed
+static volatile float sink;
+
+static bool runSize(size_t count)
+{
+    float worldSize = 4.0f * std::cbrt((float)count);
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> position(-worldSize / 2, worldSize / 2);
+    std::uniform_real_distribution<float> angle(0.0f, 6.2831853f);
+    std::uniform_int_distribution<size_t> pick(0, count - 1);
+    glm::vec3 boundsMin(-0.5f), boundsMax(0.5f);
+    glm::vec3 axis = glm::normalize(glm::vec3(1.0f, 0.3f, 0.5f));
+
+    SceneStore store;
+    std::vector<Entity> handles;
+    handles.reserve(count);
+    auto start = Clock::now();
+    store.reserve(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        Transform transform;
+        transform.position = glm::vec3(position(rng), position(rng), position(rng));
+        transform.rotation = glm::angleAxis(angle(rng), axis);
+        handles.push_back(store.create(transform, boundsMin, boundsMax, (uint32_t)(i % 64), 0));
+    }
+    store.updateTransforms();
+    double createMs = msSince(start);
+
+    // allocated in creation order, then visited in a shuffled order as a long-lived scene graph ends up
+    std::vector<HeapObject *> heap;
+    heap.reserve(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        HeapObject *object = new HeapObject();
+        object->transform.position = store.positions()[i];
+        object->world = store.worldMatrices()[i];
+        heap.push_back(object);
+    }
+    std::shuffle(heap.begin(), heap.end(), rng);
+
+    const int passes = 10;
+    start = Clock::now();
+    for (int pass = 0; pass < passes; pass++)
+    {
+        float sum = 0.0f;
+        for (const glm::mat4 &world : store.worldMatrices())
+        {
+            sum += world[3].x + world[3].y + world[3].z;
+        }
+        sink = sum;
+    }
+    double linearMs = msSince(start) / passes;
+
+    start = Clock::now();
+    for (int pass = 0; pass < passes; pass++)
+    {
+        float sum = 0.0f;
+        for (const HeapObject *object : heap)
+        {
+            sum += object->world[3].x + object->world[3].y + object->world[3].z;
+        }
+        sink = sum;
+    }
+    double pointerMs = msSince(start) / passes;
+
+    // a frame where one object in a hundred moves
+    start = Clock::now();
+    for (size_t i = 0; i < count / 100; i++)
+    {
+        Entity entity = handles[pick(rng)];
+        store.setPosition(entity, store.positions()[store.row(entity)] + glm::vec3(0.1f));
+    }
+    size_t sparseUpdated = store.updateTransforms();
+    double sparseMs = msSince(start);
+
+    // and one where everything moves
+    start = Clock::now();
+    for (Entity entity : handles)
+    {
+        store.setPosition(entity, store.positions()[store.row(entity)] + glm::vec3(0.1f));
+    }
+    size_t fullUpdated = store.updateTransforms();
+    double fullMs = msSince(start);
+
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f), 1280.0f / 720.0f, 0.1f, 100.0f);
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    Frustum frustum = Frustum::fromMatrix(projection * view);
+    std::vector<uint32_t> visible(count);
+    start = Clock::now();
+    size_t visibleCount = culling::cullAabbsSimd(frustum, store.worldBounds(), visible.data());
+    double cullMs = msSince(start);
+
+    // the same matrices squashed, so every one needs a real inverse
+    std::vector<glm::mat4> squashed(store.worldMatrices());
+    for (glm::mat4 &world : squashed)
+    {
+        world = glm::scale(world, glm::vec3(1.0f, 0.5f, 2.0f));
+    }
+    std::vector<glm::mat3> reference(count), normals(count);
+    start = Clock::now();
+    for (size_t i = 0; i < count; i++)
+    {
+        reference[i] = glm::transpose(glm::inverse(glm::mat3(squashed[i])));
+    }
+    double inverseMs = msSince(start);
+    start = Clock::now();
+    normalmatrix::compute(squashed.data(), count, normals.data());
+    double batchedMs = msSince(start);
+    float normalError = 0.0f;
+    for (size_t i = 0; i < count; i++)
+    {
+        for (int c = 0; c < 3; c++)
+        {
+            glm::vec3 difference = glm::abs(normals[i][c] - reference[i][c]);
+            normalError = std::max(normalError, std::max(difference.x, std::max(difference.y, difference.z)));
+        }
+    }
+
+    // replace a tenth of the scene, the old handles must stop resolving and the new ones must
+    std::vector<Entity> destroyed;
+    size_t churn = count / 10;
+    start = Clock::now();
+    for (size_t i = 0; i < churn; i++)
+    {
+        size_t slot = pick(rng);
+        if (store.alive(handles[slot]))
+        {
+            destroyed.push_back(handles[slot]);
+            store.destroy(handles[slot]);
+        }
+        Transform transform;
+        transform.position = glm::vec3(position(rng), position(rng), position(rng));
+        handles[slot] = store.create(transform, boundsMin, boundsMax, 0, 0);
+    }
+    store.updateTransforms();
+    double churnMs = msSince(start);
+
+    for (HeapObject *object : heap)
+    {
+        delete object;
+    }
+
+    std::printf("%8zu entities  create %8.2f ms  churn %zu %7.2f ms\n", count, createMs, churn, churnMs);
+    std::printf("          iterate %7.3f ms (pointer per object %7.3f ms, %.1fx)\n", linearMs, pointerMs,
+                linearMs > 0.0 ? pointerMs / linearMs : 0.0);
+    std::printf("          update 1%% %7.3f ms (%zu rows)  update all %7.3f ms (%zu rows)  cull %7.3f ms %zu/%zu\n",
+                sparseMs, sparseUpdated, fullMs, fullUpdated, cullMs, visibleCount, store.size());
+    std::printf("          normal matrices %7.3f ms %s (glm inverse %7.3f ms, %.1fx), max error %g\n", batchedMs,
+                normalmatrix::simdPath(), inverseMs, batchedMs > 0.0 ? inverseMs / batchedMs : 0.0, normalError);
+
+    bool ok = store.size() == count && fullUpdated == count && normalError < 1e-4f;
+    for (Entity entity : destroyed)
+    {
+        ok = ok && !store.alive(entity);
+    }
+    for (Entity entity : handles)
+    {
+        uint32_t row = store.row(entity);
+        ok = ok && row != SceneStore::invalidRow && store.entities()[row].index == entity.index;
+    }
+    if (!ok)
+    {
+        std::printf("scene store handles or rows are inconsistent\n");
+    }
+    return ok;
+}
+
+int main()
+{
+    bool ok = true;
+    for (size_t count : {10000, 100000, 1000000})
+    {
+        ok = runSize(count) && ok;
+    }
+    return ok ? 0 : 1;
+}
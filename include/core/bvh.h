@@ -0,0 +1,82 @@
+#pragma once
+
+#include "frustum.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+struct Aabb
+{
+    glm::vec3 min = glm::vec3(1e30f);
+    glm::vec3 max = glm::vec3(-1e30f);
+
+    void grow(const glm::vec3 &point);
+    void grow(const Aabb &other);
+    glm::vec3 center() const
+    {
+        return (min + max) * 0.5f;
+    }
+    float surfaceArea() const;
+};
+
+struct RayHit
+{
+    uint32_t object = 0xFFFFFFFFu;
+    float distance = 1e30f;
+
+    bool hit() const
+    {
+        return object != 0xFFFFFFFFu;
+    }
+};
+
+/*
+ *  Bounding volume hierarchy over object AABBs. Built top-down with a binned surface area heuristic,
+ *  objects that move are updated in place and refit() walks the tree bottom-up without re-splitting,
+ *  which is fine as long as objects don't drift too far from where they were at build time.
+ *  Object ids are indices into the array passed to build().
+ */
+class Bvh
+{
+  public:
+    void build(const std::vector<Aabb> &bounds);
+
+    // move one object, call refit() once after all updates for the frame
+    void update(uint32_t object, const Aabb &bounds);
+    void refit();
+
+    // appends every object that intersects the frustum
+    void queryFrustum(const Frustum &frustum, std::vector<uint32_t> &result) const;
+    // closest object hit by origin + t * direction, t in [0, maxDistance]
+    RayHit raycast(const glm::vec3 &origin, const glm::vec3 &direction, float maxDistance = 1e30f) const;
+    // object whose bounds center is closest to point, e.g. the light nearest a fragment cluster
+    uint32_t nearest(const glm::vec3 &point, float *distance = nullptr) const;
+
+    size_t nodeCount() const
+    {
+        return nodes_.size();
+    }
+
+  private:
+    // 32 bytes, two per cache line. leaves have count > 0 and index their first entry in objectIds_,
+    // interior nodes have count == 0 and store their left child index, the right child follows it
+    struct Node
+    {
+        glm::vec3 min;
+        uint32_t index;
+        glm::vec3 max;
+        uint32_t count;
+    };
+
+    std::vector<Node> nodes_;
+    std::vector<uint32_t> objectIds_;
+    std::vector<Aabb> bounds_;
+    std::vector<glm::vec3> centers_;
+    bool dirty_ = false;
+
+    void buildNode(uint32_t node, uint32_t first, uint32_t count, uint32_t depth);
+    bool findSplit(const Node &node, uint32_t first, uint32_t count, const Aabb &centroidBounds, int &axis,
+                   float &position) const;
+};
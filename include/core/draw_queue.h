@@ -0,0 +1,92 @@
+#pragma once
+
+#include "geometry_pool.h"
+#include "material.h"
+#include "mesh.h"
+#include "shader.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+/*
+ *  Draws are collected as 64-bit sort keys and replayed in key order, so that state only changes
+ *  when the key says it has to. Most significant bits first:
+ *
+ *      opaque:       [63] 0 | [62..55] shader | [54..39] material | [38..27] mesh | [26..3] depth
+ *      translucent:  [63] 1 | [62..39] inverted depth | [38..31] shader | [30..15] material | [14..3] mesh
+ *
+ *  Opaque draws group by state and then go front-to-back so early-Z rejects hidden fragments,
+ *  translucent draws come last and go back-to-front so they blend correctly.
+ *
+ *  Runs of pooled meshes under the same shader and material are batched into their GeometryPool and
+ *  drawn in one submission, provided the shader reads per-instance transforms (has an "instanced" bool).
+ *  Materials packed into the same MaterialArrays count as one: a run spans all of them and each instance
+ *  carries its material's index. Unbatched draws set the "model" and, when the shader has them,
+ *  "normalMatrix" and "materialIndex" uniforms.
+ *
+ *  A positions-only flush is for depth passes: meshes are drawn from their position streams and
+ *  material state is left alone, so every draw may pass the same material and batch across materials.
+ */
+class DrawQueue
+{
+  public:
+    static constexpr uint32_t maxShaders = 1 << 8;
+    static constexpr uint32_t maxMaterials = 1 << 16;
+    static constexpr uint32_t maxMeshes = 1 << 12;
+
+    // ids index the key fields above, adding past their max asserts
+    uint32_t addShader(Shader *shader);
+    uint32_t addMaterial(const Material &material);
+    uint32_t addMesh(Mesh *mesh);
+
+    // depth is quantised against the far plane, call once per frame before submitting
+    void begin(float farPlane);
+    // computes the normal matrix from the model, write() takes one precomputed (SceneStore::normalMatrices())
+    void submit(uint32_t shader, uint32_t material, uint32_t mesh, const glm::mat4 &model, float depth,
+                bool translucent = false);
+    // reserves count draws and returns the first slot, write() fills the slots and may be called from jobs
+    // concurrently as long as each slot is written once. flush() expects every reserved slot to be written
+    size_t reserve(size_t count);
+    void write(size_t slot, uint32_t shader, uint32_t material, uint32_t mesh, const glm::mat4 &model,
+               const glm::mat3 &normal, float depth, bool translucent = false);
+    // sort and replay everything submitted since begin()
+    void flush(bool positionsOnly = false);
+
+    size_t size() const
+    {
+        return items_.size();
+    }
+
+  private:
+    struct ShaderEntry
+    {
+        Shader *shader;
+        UniformHandle<glm::mat4> model;
+        UniformHandle<glm::mat3> normal;
+        UniformHandle<float> shininess;
+        UniformHandle<bool> instanced;
+        UniformHandle<int> materialIndex;
+    };
+
+    struct SortItem
+    {
+        uint64_t key;
+        uint32_t index;
+    };
+
+    std::vector<ShaderEntry> shaders_;
+    std::vector<Material> materials_;
+    std::vector<Mesh *> meshes_;
+
+    std::vector<SortItem> items_;
+    std::vector<SortItem> scratch_;
+    std::vector<glm::mat4> models_;
+    std::vector<glm::mat3> normals_;
+    float farPlane_ = 100.0f;
+
+    void sort();
+    // whether switching from one material to the other needs no state change
+    bool sharesState(uint32_t material, uint32_t current) const;
+};
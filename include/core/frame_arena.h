@@ -0,0 +1,72 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <type_traits>
+#include <vector>
+
+/*
+ *  Linear allocator for data that lives for a frame: cull results, per-pass draw lists, scratch arrays.
+ *  Allocating bumps an atomic offset, so jobs can allocate concurrently, and nothing is freed one by one,
+ *  beginFrame() drops everything at once. There are two buffers and beginFrame() flips between them, so
+ *  what was allocated in the previous frame stays valid through the current one, long enough for work
+ *  that overlaps the next frame (the GPU reading last frame's lists, a render thread running a frame
+ *  behind) to finish with it.
+ *
+ *  A frame that asks for more than its buffer holds gets the rest from separately allocated heap blocks,
+ *  and the next time that buffer is reset it grows to cover the whole frame. Once frames stop growing
+ *  the arena makes no heap allocations at all.
+ *
+ *  Destructors are never run, only trivially destructible types go in.
+ */
+class FrameArena
+{
+  public:
+    explicit FrameArena(size_t capacity = 1 << 20);
+    ~FrameArena();
+
+    FrameArena(const FrameArena &) = delete;
+    FrameArena &operator=(const FrameArena &) = delete;
+
+    // main thread only, with no allocation in flight. invalidates everything from two frames back
+    void beginFrame();
+
+    // never returns nullptr, alignment has to be a power of two
+    void *allocate(size_t bytes, size_t alignment = alignof(std::max_align_t));
+
+    template <typename T> T *allocate(size_t count)
+    {
+        static_assert(std::is_trivially_destructible<T>::value, "the arena never runs destructors");
+        return static_cast<T *>(allocate(count * sizeof(T), alignof(T)));
+    }
+
+    // of the buffer being allocated from
+    size_t used() const;
+    size_t capacity() const;
+    // frames that spilled into heap blocks since the arena was created
+    uint64_t overflows() const
+    {
+        return overflows_;
+    }
+
+  private:
+    static constexpr size_t bufferAlignment = 64;
+
+    struct Buffer
+    {
+        char *memory = nullptr;
+        size_t capacity = 0;
+        // keeps counting past capacity, so at reset it is what the frame wanted in total
+        std::atomic<size_t> offset{0};
+        std::vector<void *> overflow;
+    };
+
+    Buffer buffers_[2];
+    unsigned current_ = 0;
+    uint64_t overflows_ = 0;
+    std::mutex overflowMutex_;
+
+    void reset(Buffer &buffer);
+};
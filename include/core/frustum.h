@@ -0,0 +1,53 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// six planes as (normal, d), a point p is inside a plane when dot(normal, p) + d >= 0
+struct Frustum
+{
+    glm::vec4 planes[6];
+
+    // Gribb/Hartmann extraction from projection * view, planes come out in world space
+    static Frustum fromMatrix(const glm::mat4 &viewProjection);
+
+    bool intersectsAabb(const glm::vec3 &center, const glm::vec3 &extents) const;
+    bool intersectsSphere(const glm::vec3 &center, float radius) const;
+};
+
+// structure-of-arrays bounds so the SIMD paths can load eight objects' worth of one component at a time
+struct BoundsSoA
+{
+    std::vector<float> centerX, centerY, centerZ;
+    std::vector<float> extentX, extentY, extentZ;
+    std::vector<float> radius;
+
+    void clear();
+    void reserve(size_t count);
+    void push(const glm::vec3 &center, const glm::vec3 &extents);
+    void set(size_t index, const glm::vec3 &center, const glm::vec3 &extents);
+    // moves the last entry into index and shrinks by one
+    void swapRemove(size_t index);
+
+    size_t size() const
+    {
+        return centerX.size();
+    }
+};
+
+// each cull writes the indices of the objects that survive into visible (sized for bounds.size()) and returns how many
+namespace culling
+{
+size_t cullAabbsScalar(const Frustum &frustum, const BoundsSoA &bounds, uint32_t *visible);
+size_t cullAabbsSimd(const Frustum &frustum, const BoundsSoA &bounds, uint32_t *visible);
+// only objects [begin, end), indices written are still absolute, so chunks can be culled on separate threads
+size_t cullAabbsSimd(const Frustum &frustum, const BoundsSoA &bounds, size_t begin, size_t end, uint32_t *visible);
+size_t cullSpheresScalar(const Frustum &frustum, const BoundsSoA &bounds, uint32_t *visible);
+size_t cullSpheresSimd(const Frustum &frustum, const BoundsSoA &bounds, uint32_t *visible);
+
+// name of the instruction set cullAabbsSimd/cullSpheresSimd were compiled for
+const char *simdPath();
+}; // namespace culling
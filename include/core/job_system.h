@@ -0,0 +1,148 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class JobCounter;
+
+typedef void (*JobFunction)(void *context, size_t begin, size_t end);
+
+struct Job
+{
+    JobFunction function;
+    void *context;
+    size_t begin, end;
+    size_t grain;
+    JobCounter *counter;
+    // next job parked on the same dependency, so parking never allocates
+    Job *next;
+    // set from allocation until the job has run, its ring slot isn't reused before then
+    std::atomic<bool> live{false};
+    // allocated on the heap because the ring slot was still live, deleted once the job has run
+    bool heap = false;
+};
+
+/*
+ *  Counts unfinished jobs. Every job is started against one, JobSystem::wait() runs other jobs until it
+ *  reaches zero, and jobs started with it as a dependency are held back until then. A counter can be
+ *  reused once it has reached zero, e.g. once per frame, but must be waited on before it is destroyed.
+ */
+class JobCounter
+{
+  public:
+    bool done() const
+    {
+        return pending_.load(std::memory_order_acquire) == 0;
+    }
+
+  private:
+    friend class JobSystem;
+
+    std::atomic<uint32_t> pending_{0};
+    std::mutex mutex_;
+    Job *waiting_ = nullptr;
+};
+
+/*
+ *  Chase-Lev work-stealing deque of job pointers. Only the owning thread pushes and pops, at the
+ *  bottom, other threads steal from the top. Fixed capacity, push() fails when full and the caller
+ *  runs the job itself.
+ */
+class WorkStealingDeque
+{
+  public:
+    static constexpr int64_t capacity = 4096;
+
+    bool push(Job *job);
+    Job *pop();
+    Job *steal();
+
+  private:
+    alignas(64) std::atomic<int64_t> top_{0};
+    alignas(64) std::atomic<int64_t> bottom_{0};
+    std::atomic<Job *> slots_[capacity];
+};
+
+/*
+ *  Fixed pool of worker threads, each with its own deque. A thread pushes the jobs it creates onto its
+ *  own deque and pops them back LIFO while they are still warm in its cache, idle threads steal the
+ *  oldest (largest) work from a random victim. parallelFor() starts one job for the whole range and
+ *  each thread that runs it pushes the upper half back until the range is down to the grain, so work
+ *  spreads across the pool without the caller splitting it up front.
+ *
+ *  The thread that created the system takes part as thread 0 while it waits, workers sleep when there
+ *  is nothing to steal. Jobs may only be started from that thread or from inside other jobs, and must
+ *  not touch GL, the creating thread keeps the context.
+ */
+class JobSystem
+{
+  public:
+    // total threads including the caller, 0 uses every hardware thread
+    explicit JobSystem(unsigned threadCount = 0);
+    ~JobSystem();
+
+    JobSystem(const JobSystem &) = delete;
+    JobSystem &operator=(const JobSystem &) = delete;
+
+    // function(context, begin, end) once
+    void run(JobFunction function, void *context, JobCounter &counter, JobCounter *dependency = nullptr);
+    // function(context, begin, end) over subranges of [0, count) no larger than grain
+    void parallelFor(size_t count, size_t grain, JobFunction function, void *context, JobCounter &counter,
+                     JobCounter *dependency = nullptr);
+    // runs jobs on this thread until counter reaches zero
+    void wait(JobCounter &counter);
+
+    // blocking parallel for over a lambda taking (size_t begin, size_t end)
+    template <typename Body> void parallelFor(size_t count, size_t grain, const Body &body)
+    {
+        JobCounter counter;
+        parallelFor(
+            count, grain,
+            [](void *context, size_t begin, size_t end) { (*static_cast<const Body *>(context))(begin, end); },
+            (void *)&body, counter);
+        wait(counter);
+    }
+
+    unsigned threadCount() const
+    {
+        return (unsigned)threads_.size();
+    }
+
+  private:
+    // jobs are recycled round robin per thread, far more than are usually in flight at once. a slot that is
+    // still live when the ring comes back round (jobs parked on a long dependency) falls back to the heap
+    static constexpr size_t jobRingSize = WorkStealingDeque::capacity * 2;
+
+    struct alignas(64) ThreadState
+    {
+        WorkStealingDeque deque;
+        std::vector<Job> jobs = std::vector<Job>(jobRingSize);
+        size_t nextJob = 0;
+        uint32_t rng = 0;
+    };
+
+    std::vector<ThreadState *> threads_;
+    std::vector<std::thread> workers_;
+
+    // queued_ counts jobs sitting in deques, sleeping_ lets submit() skip the lock when nobody waits
+    std::atomic<int64_t> queued_{0};
+    std::atomic<unsigned> sleeping_{0};
+    std::mutex sleepMutex_;
+    std::condition_variable wake_;
+    bool stopping_ = false;
+
+    void workerLoop(unsigned index);
+    unsigned currentThread() const;
+    Job *allocate(unsigned thread);
+    void release(Job *job);
+    void submit(unsigned thread, Job *job);
+    void schedule(Job *job, JobCounter *dependency);
+    Job *findJob(unsigned thread);
+    void execute(unsigned thread, Job *job);
+    void finish(JobCounter *counter);
+};
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class JobSystem;
+
+// point lights as structure of arrays so the SIMD path can load eight lights' worth of one component at a time
+struct PointLights
+{
+    std::vector<float> positionX, positionY, positionZ;
+    std::vector<float> radius;
+    std::vector<float> colorR, colorG, colorB;
+
+    void clear();
+    void reserve(size_t count);
+    void push(const glm::vec3 &position, float radius, const glm::vec3 &color);
+
+    size_t size() const
+    {
+        return positionX.size();
+    }
+};
+
+/*
+ *  Clustered light assignment. The view frustum is cut into tilesX * tilesY screen tiles and depthSlices
+ *  slices spaced exponentially in view depth, and every cluster gets the list of point lights whose sphere
+ *  reaches it. A fragment then only shades the lights of its own cluster, so cost follows how many lights
+ *  overlap that part of the screen rather than how many there are in total.
+ *
+ *  assign() runs in three steps, each split over the job system when one is given:
+ *
+ *      per light: view space bounds -> cluster ranges (SIMD)
+ *      per slice: sphere vs cluster box tests, binned by cluster
+ *      per slice: copy into the flat index list once every slice's offset is known
+ *
+ *  The result is one (offset, count) pair per cluster into indices(), ordered x fastest, then y, then
+ *  slice, which is what the lighting shader reads back. The projection is assumed to be a symmetric
+ *  perspective one, as Camera::getProjection() builds.
+ */
+class LightGrid
+{
+  public:
+    static constexpr uint32_t tilesX = 16;
+    static constexpr uint32_t tilesY = 9;
+    static constexpr uint32_t depthSlices = 24;
+    static constexpr uint32_t clusterCount = tilesX * tilesY * depthSlices;
+    // light indices are stored as 16 bits
+    static constexpr size_t maxLights = 65536;
+
+    // lights past maxLights are ignored
+    void assign(const PointLights &lights, const glm::mat4 &view, const glm::mat4 &projection, float nearPlane,
+                float farPlane, JobSystem *jobs = nullptr);
+
+    const std::vector<uint32_t> &clusters() const
+    {
+        return clusters_;
+    }
+    const std::vector<uint16_t> &indices() const
+    {
+        return indices_;
+    }
+
+    // the shader's slice = log(depth) * scale + bias, matching the slice boundaries used here
+    float sliceScale() const
+    {
+        return sliceScale_;
+    }
+    float sliceBias() const
+    {
+        return sliceBias_;
+    }
+
+    // the most lights any one cluster ended up with, the worst case a fragment has to loop over
+    uint32_t maxClusterLights() const;
+
+    // name of the instruction set the per-light step was compiled for
+    static const char *simdPath();
+
+  private:
+    struct Slice
+    {
+        std::vector<uint32_t> pairs; // (tile << 16) | light, in light order
+        uint32_t counts[tilesX * tilesY];
+        size_t first; // into indices_
+    };
+
+    const PointLights *lights_ = nullptr;
+    size_t lightCount_ = 0;
+    glm::mat4 view_;
+    float projectionX_ = 1.0f, projectionY_ = 1.0f;
+    float near_ = 0.1f, far_ = 100.0f;
+    float sliceScale_ = 0.0f, sliceBias_ = 0.0f;
+    float sliceDepths_[depthSlices + 1];
+
+    // per light, view space center and the inclusive cluster ranges it may touch. empty when minZ > maxZ
+    std::vector<float> viewX_, viewY_, viewZ_;
+    std::vector<int32_t> minX_, maxX_, minY_, maxY_, minZ_, maxZ_;
+
+    Slice slices_[depthSlices];
+    std::vector<uint32_t> clusters_;
+    std::vector<uint16_t> indices_;
+
+    void boundLights(size_t begin, size_t end);
+    void boundLightsScalar(size_t begin, size_t end);
+    void binSlice(uint32_t slice);
+    void writeSlice(uint32_t slice);
+};
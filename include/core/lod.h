@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+
+/*
+ *  Picks a level of detail from the screen space size of its error. A level's error is the distance in
+ *  mesh units its surface may be off from the source mesh (see meshopt::buildLodChain), projected that
+ *  is errorPixels = error * scale / distance * pixelsPerUnit with pixelsPerUnit the viewport height over
+ *  2 tan(fov / 2). The coarsest level under threshold pixels is drawn, so as objects get further away
+ *  or more numerous their triangles shrink with their pixels instead of piling up.
+ *
+ *  An object only moves to a coarser level once that level's error is hysteresis below the threshold,
+ *  objects hovering around a switching distance would pop between levels every frame otherwise.
+ */
+class LodSelector
+{
+  public:
+    float threshold = 1.0f;   // pixels
+    float hysteresis = 0.25f; // fraction of threshold a coarser level has to clear
+
+    // fovY in degrees, as Camera::getZoom() returns it
+    void setProjection(float fovY, int viewportHeight);
+
+    float pixelsPerUnit() const
+    {
+        return pixelsPerUnit_;
+    }
+
+    // errors[0, count) grow with the level, level 0 being the finest. current is the level the object was
+    // drawn with last, distance is from the camera to the nearest point of its bounds and scale its largest
+    float projectedError(float error, float distance, float scale) const;
+    uint32_t select(const float *errors, uint32_t count, uint32_t current, float distance, float scale) const;
+
+  private:
+    float pixelsPerUnit_ = 1.0f;
+};
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstdint>
+
+/*
+ *  Heap allocation counters. Global operator new and delete are replaced (src/core/memory.cpp) to count
+ *  every allocation made through them from any thread, so a frame's heap traffic is the difference of two
+ *  reads. malloc calls made directly, by SDL or the driver for instance, are not seen.
+ */
+namespace memory
+{
+uint64_t allocationCount();
+uint64_t allocatedBytes(); // requested, running total
+uint64_t freeCount();
+}; // namespace memory
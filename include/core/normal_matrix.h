@@ -0,0 +1,26 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+
+/*
+ *  Normals have to be transformed by the inverse transpose of the model's upper 3x3 to stay perpendicular
+ *  to surfaces under non-uniform scale. Rotations and uniform scales leave normals pointing the right way
+ *  already, the shader renormalises, so for those the upper 3x3 is used as is and nothing is inverted.
+ *
+ *  The inverse transpose of M with columns (a, b, c) is (b x c, c x a, a x b) / det(M), so the batched
+ *  version is three cross products and a divide per matrix, eight matrices at a time with AVX2.
+ */
+namespace normalmatrix
+{
+// columns orthogonal and of equal length: rotation times uniform scale, mirrors included
+bool isUniformScale(const glm::mat3 &basis);
+
+glm::mat3 compute(const glm::mat4 &model);
+// normals[i] for models[i]
+void compute(const glm::mat4 *models, size_t count, glm::mat3 *normals);
+
+// name of the instruction set the batched compute() was compiled for
+const char *simdPath();
+}; // namespace normalmatrix
@@ -0,0 +1,164 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <utility>
+#include <vector>
+
+/*
+ *  Typed pool of objects constructed in place. Slots live in fixed pages that are never moved or freed
+ *  before the pool is, so pointers from get() stay valid until the object is destroyed, and a destroyed
+ *  slot goes on a free list for the next create(). Handles carry the slot's generation like Entity does:
+ *  destroying bumps it, so a stale handle gets nullptr from get() instead of whatever reused the slot.
+ *
+ *  Not thread safe. Objects still alive when the pool goes away are destroyed with it.
+ */
+template <typename T> class ObjectPool
+{
+  public:
+    static constexpr uint32_t invalidIndex = 0xFFFFFFFFu;
+    static constexpr uint32_t pageSize = 64;
+
+    struct Handle
+    {
+        uint32_t index = invalidIndex;
+        uint32_t generation = 0;
+
+        bool valid() const
+        {
+            return index != invalidIndex;
+        }
+        bool operator==(const Handle &other) const
+        {
+            return index == other.index && generation == other.generation;
+        }
+        bool operator!=(const Handle &other) const
+        {
+            return !(*this == other);
+        }
+    };
+
+    ObjectPool() = default;
+    ~ObjectPool()
+    {
+        clear();
+        for (Slot *page : pages_)
+        {
+            delete[] page;
+        }
+    }
+
+    ObjectPool(const ObjectPool &) = delete;
+    ObjectPool &operator=(const ObjectPool &) = delete;
+
+    template <typename... Args> Handle create(Args &&...args)
+    {
+        if (freeHead_ == invalidIndex)
+        {
+            grow();
+        }
+        uint32_t index = freeHead_;
+        Slot &slot = at(index);
+        new (slot.storage) T(std::forward<Args>(args)...);
+        freeHead_ = slot.nextFree;
+        slot.alive = true;
+        live_++;
+        return Handle{index, slot.generation};
+    }
+
+    T *get(Handle handle) const
+    {
+        if (handle.index >= pages_.size() * pageSize)
+        {
+            return nullptr;
+        }
+        Slot &slot = at(handle.index);
+        return slot.alive && slot.generation == handle.generation ? object(slot) : nullptr;
+    }
+
+    // stale and invalid handles are ignored
+    void destroy(Handle handle)
+    {
+        if (!get(handle))
+        {
+            return;
+        }
+        Slot &slot = at(handle.index);
+        object(slot)->~T();
+        slot.alive = false;
+        slot.generation++;
+        slot.nextFree = freeHead_;
+        freeHead_ = handle.index;
+        live_--;
+    }
+
+    void clear()
+    {
+        for (uint32_t i = 0; i < pages_.size() * pageSize; i++)
+        {
+            Slot &slot = at(i);
+            if (slot.alive)
+            {
+                destroy(Handle{i, slot.generation});
+            }
+        }
+    }
+
+    // live objects in slot order
+    template <typename Fn> void forEach(Fn fn) const
+    {
+        for (uint32_t i = 0; i < pages_.size() * pageSize; i++)
+        {
+            Slot &slot = at(i);
+            if (slot.alive)
+            {
+                fn(Handle{i, slot.generation}, *object(slot));
+            }
+        }
+    }
+
+    size_t size() const
+    {
+        return live_;
+    }
+    size_t capacity() const
+    {
+        return pages_.size() * pageSize;
+    }
+
+  private:
+    struct Slot
+    {
+        alignas(T) unsigned char storage[sizeof(T)];
+        uint32_t generation = 0;
+        uint32_t nextFree = invalidIndex;
+        bool alive = false;
+    };
+
+    std::vector<Slot *> pages_;
+    uint32_t freeHead_ = invalidIndex;
+    size_t live_ = 0;
+
+    Slot &at(uint32_t index) const
+    {
+        return pages_[index / pageSize][index % pageSize];
+    }
+
+    static T *object(Slot &slot)
+    {
+        return std::launder(reinterpret_cast<T *>(slot.storage));
+    }
+
+    // threads the new page onto the free list in index order, so slots are handed out front to back
+    void grow()
+    {
+        uint32_t first = (uint32_t)(pages_.size() * pageSize);
+        pages_.push_back(new Slot[pageSize]);
+        for (uint32_t i = pageSize; i-- > 0;)
+        {
+            at(first + i).nextFree = freeHead_;
+            freeHead_ = first + i;
+        }
+    }
+};
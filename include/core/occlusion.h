@@ -0,0 +1,126 @@
+#pragma once
+
+#include "frustum.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*
+ *  Software occlusion culling. The biggest occluders on screen are rasterised on the CPU into a small
+ *  depth buffer and a max-depth mip pyramid (Hi-Z) is built over it, each texel of a level holding the
+ *  farthest depth of the 2x2 beneath it. An object is hidden when the nearest corner of its AABB is
+ *  behind the farthest occluder depth over the screen rect the box projects to, which the level where
+ *  that rect is at most 4x4 texels answers in a few reads.
+ *
+ *  A box is rasterised as one convex shape, the outline of its projected corners, with the depth where
+ *  a ray enters it: the farthest of its front faces' planes. The rasteriser walks the shape's bounds in
+ *  8x4 pixel tiles, drops tiles that lie outside an edge from their corners and fills the rest eight
+ *  pixels at a time. Depth is NDC z with 1 as clear. Boxes reaching across the near plane are clipped in
+ *  clip space and drawn a triangle at a time instead, so occluders may cross it.
+ *
+ *  Rasterisation is inner conservative, nothing is culled that a finer buffer would show: a pixel only
+ *  takes an occluder's depth when the shape covers all of it, and then the farthest depth over the pixel,
+ *  so a gap between occluders stays open however thin it is. Pixels along the edges between triangles
+ *  of a clipped box are covered by neither and don't occlude.
+ *
+ *      begin(viewProjection)
+ *      drawBox() per occluder
+ *      finish()                builds the pyramid
+ *      cull()                  as often as needed until the next begin(), from any thread
+ */
+class OcclusionBuffer
+{
+  public:
+    static constexpr int tileWidth = 8;
+    static constexpr int tileHeight = 4;
+
+    // sizes are rounded up to whole tiles
+    explicit OcclusionBuffer(int width = 256, int height = 144);
+
+    void begin(const glm::mat4 &viewProjection);
+    // a solid box, model maps the local box [boundsMin, boundsMax] to world space
+    void drawBox(const glm::mat4 &model, const glm::vec3 &boundsMin, const glm::vec3 &boundsMax);
+    void finish();
+
+    // keeps the entries of visible[0, count) whose world bounds aren't hidden, in order, and returns how many
+    size_t cull(const BoundsSoA &bounds, uint32_t *visible, size_t count) const;
+    // the same test projecting one corner at a time, what cull() has to agree with
+    size_t cullScalar(const BoundsSoA &bounds, uint32_t *visible, size_t count) const;
+
+    int width() const
+    {
+        return levels_[0].width;
+    }
+    int height() const
+    {
+        return levels_[0].height;
+    }
+    // level 0 is the rasterised buffer, rows bottom up
+    const std::vector<float> &depth(size_t level = 0) const
+    {
+        return levels_[level].depth;
+    }
+    size_t levelCount() const
+    {
+        return levels_.size();
+    }
+    // front facing triangles that reached the rasteriser since begin()
+    size_t triangles() const
+    {
+        return triangles_;
+    }
+
+    // moves the (at most) maxOccluders of candidates[0, count) that cover the most screen to the front, judged by
+    // bounding radius over distance, and returns how many that is
+    static size_t pickOccluders(const BoundsSoA &bounds, const glm::vec3 &viewPos, uint32_t *candidates, size_t count,
+                                size_t maxOccluders);
+
+    // name of the instruction set the rasteriser and cull() were compiled for
+    static const char *simdPath();
+
+    // a * x + b * y + c over buffer pixels, an edge (positive inside) or NDC depth
+    struct ScreenPlane
+    {
+        float a, b, c;
+    };
+
+  private:
+    // a box's outline has six edges, perspective shows at most three of its faces
+    static constexpr int maxEdges = 8;
+    static constexpr int maxDepthPlanes = 3;
+
+    struct Level
+    {
+        int width;
+        int height;
+        std::vector<float> depth;
+    };
+
+    // nearest depth and the inclusive pixel rect a box covers at level 0
+    struct ScreenRect
+    {
+        int minX, minY, maxX, maxY;
+        float minZ;
+    };
+
+    glm::mat4 viewProjection_ = glm::mat4(1.0f);
+    std::vector<Level> levels_;
+    size_t triangles_ = 0;
+
+    // false when a corner is in front of the near plane or a face is seen edge on, drawTriangle() takes those
+    bool drawSolidBox(const glm::vec4 *corners, bool mirrored);
+    void drawTriangle(const glm::vec4 &a, const glm::vec4 &b, const glm::vec4 &c);
+    // a, b and c in buffer pixels with NDC z, counter clockwise
+    void fillTriangle(const glm::vec3 &a, const glm::vec3 &b, const glm::vec3 &c);
+    // the pixels inside every edge take the farthest of the depth planes, no farther than farZ. lo and hi
+    // bound the shape in buffer pixels
+    void fillConvex(const ScreenPlane *edges, int edgeCount, const ScreenPlane *depths, int depthCount, float farZ,
+                    const glm::vec2 &lo, const glm::vec2 &hi);
+    // false when the box reaches in front of the near plane and can't be tested
+    bool projectBox(const glm::vec3 &center, const glm::vec3 &extents, ScreenRect &rect) const;
+    bool projectBoxScalar(const glm::vec3 &center, const glm::vec3 &extents, ScreenRect &rect) const;
+    bool hidden(const ScreenRect &rect) const;
+};
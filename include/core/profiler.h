@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+
+/*
+ *  Frame profiler. CPU scopes are timed with SDL_GetTicksNS and may nest, GPU passes are timed with
+ *  GL_TIME_ELAPSED queries and must not nest (GL only allows one active per target). GPU results are
+ *  read back a few frames later, only once they are available, so the profiler never stalls the pipeline.
+ *  The last historySize frames are kept in a ring buffer for summaries and Chrome trace export.
+ */
+namespace profiler
+{
+static constexpr uint32_t historySize = 1024;
+static constexpr uint32_t maxCpuEvents = 64;
+static constexpr uint32_t maxGpuPasses = 16;
+
+// needs a current GL context
+void init();
+void shutdown();
+
+void beginFrame();
+void endFrame();
+
+// names must outlive the profiler, string literals in practice. CPU scopes past maxCpuEvents in a frame
+// aren't recorded but still pair with their endCpu()
+void beginCpu(const char *name);
+void endCpu();
+void beginGpu(const char *name);
+void endGpu();
+
+// p50/p95/p99 frame times plus average pass times and per-frame counters over the history
+void logSummary();
+// writes the history as Chrome trace JSON (chrome://tracing, ui.perfetto.dev)
+bool exportChromeTrace(const char *path);
+
+class CpuScope
+{
+  public:
+    explicit CpuScope(const char *name)
+    {
+        beginCpu(name);
+    }
+    ~CpuScope()
+    {
+        endCpu();
+    }
+};
+
+class GpuScope
+{
+  public:
+    explicit GpuScope(const char *name)
+    {
+        beginGpu(name);
+    }
+    ~GpuScope()
+    {
+        endGpu();
+    }
+};
+}; // namespace profiler
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_CPU(name) profiler::CpuScope PROFILE_CONCAT(cpuScope_, __LINE__)(name)
+#define PROFILE_GPU(name) profiler::GpuScope PROFILE_CONCAT(gpuScope_, __LINE__)(name)
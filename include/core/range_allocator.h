@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+/*
+ *  Two-level segregated fit (TLSF) allocator over an abstract range of units, e.g. vertices or indices
+ *  in a GPU buffer. It never touches the memory it manages. Free blocks are binned by size: the first
+ *  level is the power of two, the second splits each power into 2^slBits linear steps. Two bitmaps
+ *  locate a large enough bin with a couple of bit scans, so allocate and free are O(1). Freed blocks
+ *  merge with free physical neighbours immediately.
+ */
+class RangeAllocator
+{
+  public:
+    static constexpr uint32_t invalid = ~0u;
+
+    struct Allocation
+    {
+        uint32_t offset = invalid;
+        uint32_t block = invalid;
+
+        bool valid() const
+        {
+            return block != invalid;
+        }
+    };
+
+    explicit RangeAllocator(uint32_t capacity = 0);
+
+    Allocation allocate(uint32_t size);
+    void free(Allocation allocation);
+    // extends the range at the end, existing allocations keep their offsets
+    void grow(uint32_t newCapacity);
+
+    uint32_t capacity() const { return capacity_; };
+    uint32_t used() const { return used_; };
+    uint32_t largestFree() const;
+
+  private:
+    static constexpr int slBits = 4;
+    static constexpr int slCount = 1 << slBits;
+    static constexpr int flCount = 32 - slBits + 1;
+
+    struct Block
+    {
+        uint32_t offset;
+        uint32_t size;
+        uint32_t prevPhysical;
+        uint32_t nextPhysical;
+        uint32_t prevFree;
+        uint32_t nextFree;
+        bool free;
+    };
+
+    std::vector<Block> blocks_;
+    std::vector<uint32_t> unusedBlocks_;
+    uint32_t flBitmap_ = 0;
+    uint32_t slBitmap_[flCount] = {};
+    uint32_t freeHeads_[flCount][slCount];
+    uint32_t lastBlock_ = invalid;
+    uint32_t capacity_ = 0;
+    uint32_t used_ = 0;
+
+    uint32_t newBlock(uint32_t offset, uint32_t size);
+    void insertFree(uint32_t block);
+    void removeFree(uint32_t block);
+    void releaseBlock(uint32_t block);
+};
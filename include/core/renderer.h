@@ -3,11 +3,43 @@
 
 #include "camera.h"
 
+#include <cstddef>
+
 namespace renderer
 {
 void render(Camera *camera);
 void init();
+void resize(int width, int height);
 void nextScene();
+void scaleInstances(bool up);
+void toggleCulling();
+void toggleShadows();
+void toggleLod();
+void toggleMaterialArrays();
+void pick(Camera *camera);
 void swapPolygonMode();
 void cleanup();
+
+// direct scene control for scripted runs, the setters return false for unknown names
+bool setScene(const char *name);
+bool setCulling(const char *name);
+void setInstanceCount(size_t count);
+// a sun with cascaded shadows next to the lamp and its cube shadow, on by default
+void setShadows(bool enabled);
+// per object levels of detail for the highpoly scene's spheres, on by default
+void setLod(bool enabled);
+// the materials scene's crates packed into texture arrays (or bindless textures) and drawn in one submission,
+// on by default. off, every material binds its own textures
+void setMaterialArrays(bool enabled);
+// pack those materials as bindless textures where the driver has them, off by default. only read when the
+// materials scene is first built, so set it before then
+void setBindlessMaterials(bool enabled);
+// draw lit objects with the variant that inverts the normal matrix per vertex, for comparison
+void setShaderNormals(bool enabled);
+// resident texture memory above this gets the least recently drawn textures evicted, 0 for no limit
+void setTextureBudget(size_t bytes);
+// every loaded texture, shader and mesh with its GPU size, through SDL_Log
+void logResources();
+bool texturesResident();
+size_t visibleObjects();
 }; // namespace renderer
\ No newline at end of file
@@ -0,0 +1,110 @@
+#pragma once
+
+#include "frustum.h"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class JobSystem;
+
+// handle to a scene object, a destroyed entity's index is reused with a new generation so stale handles fail
+struct Entity
+{
+    static constexpr uint32_t invalidIndex = 0xFFFFFFFFu;
+
+    uint32_t index = invalidIndex;
+    uint32_t generation = 0;
+
+    bool valid() const
+    {
+        return index != invalidIndex;
+    }
+};
+
+struct Transform
+{
+    glm::vec3 position = glm::vec3(0.0f);
+    glm::quat rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+    glm::vec3 scale = glm::vec3(1.0f);
+};
+
+/*
+ *  Renderable objects as one sparse set: entity indices map through sparse_ to a row, and every
+ *  component lives in its own dense array indexed by that row (structure of arrays). Systems walk
+ *  the arrays front to back, so touching a million transforms is a linear scan rather than a pointer
+ *  per object. Destroying an entity moves the last row into the hole, which keeps the arrays dense
+ *  but means rows are only stable until the next destroy.
+ *
+ *  Transform setters only mark the row dirty, updateTransforms() recomputes the world matrices, normal
+ *  matrices and world space bounds of every dirty row in one pass.
+ */
+class SceneStore
+{
+  public:
+    static constexpr uint32_t invalidRow = 0xFFFFFFFFu;
+
+    // local bounds are the mesh's object space AABB
+    Entity create(const Transform &transform, const glm::vec3 &boundsMin, const glm::vec3 &boundsMax, uint32_t mesh,
+                  uint32_t material);
+    void destroy(Entity entity);
+    bool alive(Entity entity) const;
+    void clear();
+    void reserve(size_t count);
+
+    size_t size() const
+    {
+        return entities_.size();
+    }
+    uint32_t row(Entity entity) const;
+
+    Transform transform(Entity entity) const;
+    void setTransform(Entity entity, const Transform &transform);
+    void setPosition(Entity entity, const glm::vec3 &position);
+    void setRotation(Entity entity, const glm::quat &rotation);
+    void setMesh(Entity entity, uint32_t mesh);
+    void setMaterial(Entity entity, uint32_t material);
+
+    // recomputes world matrices, normal matrices and bounds of rows changed since the last call, returns how
+    // many. rows are independent, so with a job system they are split across its threads
+    size_t updateTransforms(JobSystem *jobs = nullptr);
+
+    // dense component arrays, entry i of each belongs to entities()[i]
+    const std::vector<Entity> &entities() const { return entities_; };
+    const std::vector<glm::vec3> &positions() const { return positions_; };
+    const std::vector<glm::mat4> &worldMatrices() const { return world_; };
+    // inverse transpose of each world matrix's upper 3x3, see normal_matrix.h
+    const std::vector<glm::mat3> &normalMatrices() const { return normals_; };
+    const BoundsSoA &worldBounds() const { return worldBounds_; };
+    const std::vector<uint32_t> &meshes() const { return meshes_; };
+    const std::vector<uint32_t> &materials() const { return materials_; };
+
+  private:
+    // entity index -> row, and the current generation of every index ever handed out
+    std::vector<uint32_t> sparse_;
+    std::vector<uint32_t> generations_;
+    std::vector<uint32_t> freeIndices_;
+
+    std::vector<Entity> entities_;
+    std::vector<glm::vec3> positions_;
+    std::vector<glm::quat> rotations_;
+    std::vector<glm::vec3> scales_;
+    std::vector<glm::vec3> localCenters_;
+    std::vector<glm::vec3> localExtents_;
+    std::vector<glm::mat4> world_;
+    std::vector<glm::mat3> normals_;
+    BoundsSoA worldBounds_;
+    std::vector<uint32_t> meshes_;
+    std::vector<uint32_t> materials_;
+
+    // a flag per row plus the list of rows set, the list goes stale when destroy moves a dirty row
+    std::vector<uint8_t> dirty_;
+    std::vector<uint32_t> dirtyRows_;
+    bool dirtyRowsStale_ = false;
+
+    void markDirty(uint32_t row);
+    void updateRow(uint32_t row);
+};
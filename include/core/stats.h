@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+
+// per-frame counters of driver work, read back through stats::last() once the frame has ended
+namespace stats
+{
+struct FrameCounters
+{
+    uint64_t uniformLocationQueries = 0; // glGetUniformLocation calls
+    uint64_t uniformNameLookups = 0;     // string keyed lookups into a shader's uniform table
+    uint64_t uniformUploads = 0;         // glUniform* calls
+    uint64_t uniformBufferUpdates = 0;   // per-frame uniform buffer writes
+    uint64_t stateChangesIssued = 0;     // binds/enables that reached the driver
+    uint64_t stateChangesSkipped = 0;    // binds/enables dropped by the state cache
+    uint64_t drawCalls = 0;
+    uint64_t triangles = 0;              // triangles drawn, instances included
+    uint64_t indirectCommands = 0;       // draws issued through geometry pool batches
+    uint64_t heapAllocations = 0;        // operator new calls on any thread, see memory.h
+    uint64_t heapBytes = 0;              // bytes those asked for
+};
+
+FrameCounters &current();
+const FrameCounters &last();
+void endFrame();
+}; // namespace stats
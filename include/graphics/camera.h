@@ -13,6 +13,9 @@ class Camera
     glm::mat4 getProjection(float aspect, float nearPlane = 0.1f, float farPlane = 100.0f) const;
 
     glm::vec3 getPosition() const { return pos_; };
+    glm::vec3 getFront() const { return front_; };
+    // vertical field of view in degrees, what getProjection() uses
+    float getZoom() const { return zoom_; };
 
     void setSprint(bool sprint);
     void setForward(bool forward);
@@ -23,6 +26,10 @@ class Camera
     void setYaw(float yaw);
     void setPitch(float pitch);
 
+    // absolute placement for scripted paths, bypasses the input driven movement
+    void setPosition(glm::vec3 pos);
+    void lookAt(glm::vec3 target);
+
     void updatePos(float deltaTime);
     void updateDir();
 
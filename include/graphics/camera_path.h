@@ -0,0 +1,30 @@
+#pragma once
+#include <glm/glm.hpp>
+
+#include <vector>
+
+#include "camera.h"
+
+/*
+ *  Scripted camera movement for headless runs. Keyframes are sampled with a Catmull-Rom spline over
+ *  both the position and the look-at target, and the path loops once the last keyframe is reached.
+ *  Sampling only depends on the time passed in, so a fixed timestep gives the same frames every run.
+ */
+class CameraPath
+{
+  public:
+    struct Keyframe
+    {
+        float time; // seconds from the start of the path
+        glm::vec3 position;
+        glm::vec3 target;
+    };
+
+    void add(float time, glm::vec3 position, glm::vec3 target);
+    float duration() const;
+
+    void apply(Camera *camera, float time) const;
+
+  private:
+    std::vector<Keyframe> keys_;
+};
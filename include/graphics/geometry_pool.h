@@ -0,0 +1,102 @@
+#pragma once
+#include <glad/glad.h>
+
+#include "mesh.h"
+#include "range_allocator.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+// layout fixed by GL for glMultiDrawElementsIndirect
+struct DrawElementsIndirectCommand
+{
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint baseInstance;
+};
+
+/*
+ *  Every pooled mesh lives in one shared vertex buffer and one shared index buffer behind a single VAO,
+ *  suballocated with a TLSF allocator and grown by copying when full. Indices are 16 bit and relative
+ *  to each mesh's base vertex, so a pooled mesh can have at most 65536 vertices.
+ *
+ *  Queued draws become DrawElementsIndirectCommands, back-to-back draws of the same mesh merge into one
+ *  command, and per-draw transforms go to an instance buffer indexed by baseInstance. With GL 4.3, or
+ *  ARB_multi_draw_indirect together with ARB_base_instance, a whole batch is one glMultiDrawElementsIndirect
+ *  call; otherwise the commands are replayed with glDrawElementsInstancedBaseVertex, repointing the instance
+ *  attributes since baseInstance isn't available there.
+ *
+ *  Positions also go to a buffer of their own, suballocated at the same vertex offsets, behind a second
+ *  VAO for depth-only passes (see Mesh::bindPositions).
+ */
+class GeometryPool
+{
+  public:
+    static constexpr uint32_t invalid = ~0u;
+
+    explicit GeometryPool(VertexLayout layout, uint32_t vertexCapacity = 1 << 16, uint32_t indexCapacity = 1 << 18);
+    ~GeometryPool();
+
+    GeometryPool(const GeometryPool &) = delete;
+    GeometryPool &operator=(const GeometryPool &) = delete;
+
+    // returns the mesh id, or invalid when it can't be pooled
+    uint32_t add(const std::vector<Vertex> &vertices, const std::vector<uint32_t> &indices, glm::mat4 &decode);
+    void remove(uint32_t mesh);
+
+    void bind();
+    void bindPositions();
+    // single draw taking its transform from the model uniform
+    void draw(uint32_t mesh);
+
+    // batched draws, the model must already include the mesh's decode transform. the normal matrix is the
+    // object's own, without the decode, which only scales positions into the mesh bounds. material is the
+    // draw's index into MaterialArrays, if its shader reads one
+    void queue(uint32_t mesh, const glm::mat4 &model, const glm::mat3 &normal, uint32_t material = 0);
+    size_t queued() const { return commands_.size(); };
+    // positionsOnly draws through the position stream, for shaders that read nothing else per vertex
+    void submit(bool positionsOnly = false);
+
+    const VertexLayout &layout() const { return layout_; };
+    bool multiDrawIndirect() const { return multiDrawIndirect_; };
+    size_t meshCount() const { return meshCount_; };
+
+  private:
+    struct Entry
+    {
+        RangeAllocator::Allocation vertices;
+        RangeAllocator::Allocation indices;
+        uint32_t indexCount = 0;
+        bool live = false;
+    };
+
+    VertexLayout layout_;
+    bool multiDrawIndirect_ = false;
+
+    unsigned int vao_ = 0;
+    unsigned int vbo_ = 0;
+    unsigned int ebo_ = 0;
+    unsigned int positionVao_ = 0;
+    unsigned int positionVbo_ = 0;
+    unsigned int instanceVbo_ = 0;
+    unsigned int indirectBuffer_ = 0;
+    size_t instanceBytes_ = 0;
+    size_t indirectBytes_ = 0;
+
+    RangeAllocator vertexAllocator_;
+    RangeAllocator indexAllocator_;
+    std::vector<Entry> entries_;
+    std::vector<uint32_t> freeIds_;
+    size_t meshCount_ = 0;
+
+    std::vector<DrawElementsIndirectCommand> commands_;
+    std::vector<InstanceData> instances_;
+    uint32_t lastQueued_ = invalid;
+
+    void growVertices(uint32_t needed);
+    void growIndices(uint32_t needed);
+};
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <glad/glad.h>
+
+// glad is generated for core 3.3 with no extensions, anything newer is looked up here at runtime.
+// every feature has a flag that is only true when the driver actually provides it.
+
+// EXT_texture_compression_s3tc
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+// ARB_texture_compression_bptc / GL 4.2
+#define GL_COMPRESSED_RGBA_BPTC_UNORM 0x8E8C
+// ARB_draw_indirect / GL 4.0
+#define GL_DRAW_INDIRECT_BUFFER 0x8F3F
+// ARB_get_program_binary / GL 4.1
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+// KHR_parallel_shader_compile
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+
+namespace glext
+{
+struct Features
+{
+    int major = 0;
+    int minor = 0;
+    bool s3tc = false;
+    bool bptc = false;
+    bool multiDrawIndirect = false;
+    // at least one binary format, drivers may expose the extension with none
+    bool programBinary = false;
+    bool parallelShaderCompile = false;
+    bool bindlessTexture = false;
+};
+
+// ARB_multi_draw_indirect / GL 4.3 with ARB_base_instance / GL 4.2, null unless features().multiDrawIndirect
+typedef void(APIENTRYP MultiDrawElementsIndirectProc)(GLenum mode, GLenum type, const void *indirect,
+                                                       GLsizei drawcount, GLsizei stride);
+extern MultiDrawElementsIndirectProc multiDrawElementsIndirect;
+
+// ARB_get_program_binary / GL 4.1, null unless features().programBinary
+typedef void(APIENTRYP GetProgramBinaryProc)(GLuint program, GLsizei bufSize, GLsizei *length, GLenum *binaryFormat,
+                                             void *binary);
+typedef void(APIENTRYP ProgramBinaryProc)(GLuint program, GLenum binaryFormat, const void *binary, GLsizei length);
+typedef void(APIENTRYP ProgramParameteriProc)(GLuint program, GLenum pname, GLint value);
+extern GetProgramBinaryProc getProgramBinary;
+extern ProgramBinaryProc programBinary;
+extern ProgramParameteriProc programParameteri;
+
+// KHR_parallel_shader_compile, null unless features().parallelShaderCompile
+typedef void(APIENTRYP MaxShaderCompilerThreadsProc)(GLuint count);
+extern MaxShaderCompilerThreadsProc maxShaderCompilerThreads;
+
+// ARB_bindless_texture along with NV_gpu_shader5, null unless features().bindlessTexture
+typedef GLuint64(APIENTRYP GetTextureHandleProc)(GLuint texture);
+typedef void(APIENTRYP MakeTextureHandleResidentProc)(GLuint64 handle);
+typedef void(APIENTRYP MakeTextureHandleNonResidentProc)(GLuint64 handle);
+extern GetTextureHandleProc getTextureHandle;
+extern MakeTextureHandleResidentProc makeTextureHandleResident;
+extern MakeTextureHandleNonResidentProc makeTextureHandleNonResident;
+
+// call once after gladLoadGLLoader with the same loader
+void load(GLADloadproc loader);
+const Features &features();
+bool hasExtension(const char *name);
+bool versionAtLeast(int major, int minor);
+}; // namespace glext
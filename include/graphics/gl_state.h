@@ -0,0 +1,27 @@
+#pragma once
+
+#include <glad/glad.h>
+
+// shadow copy of the GL state we touch every frame, binds that would change nothing are dropped.
+// everything that changes this state has to go through here or the shadow copy goes stale.
+namespace glstate
+{
+void useProgram(GLuint program);
+void bindVertexArray(GLuint vao);
+void activeTexture(GLenum unit);
+void bindTexture(GLenum unit, GLenum target, GLuint texture);
+void polygonMode(GLenum mode);
+void setDepthTest(bool enabled);
+void depthMask(bool enabled);
+void depthFunc(GLenum func);
+void setBlend(bool enabled);
+void blendFunc(GLenum src, GLenum dst);
+
+// deleted objects can be reused by the driver under the same name, so drop them from the shadow copy
+void forgetProgram(GLuint program);
+void forgetVertexArray(GLuint vao);
+void forgetTexture(GLuint texture);
+
+// mark everything unknown, e.g. after code outside the renderer touched the context
+void invalidate();
+}; // namespace glstate
@@ -0,0 +1,47 @@
+#pragma once
+#include <glad/glad.h>
+
+#include <EGL/egl.h>
+
+#include <cstdint>
+#include <vector>
+
+/*
+ *  Offscreen GL 3.3 core context for machines without a display. Uses the EGL surfaceless platform when
+ *  the driver has it (Mesa, including llvmpipe) and falls back to a pbuffer on the default display.
+ *  Either way everything is rendered into an FBO owned by the context, bound as the default draw target,
+ *  so the renderer never touches framebuffer 0.
+ */
+class HeadlessContext
+{
+  public:
+    HeadlessContext() = default;
+    ~HeadlessContext();
+
+    HeadlessContext(const HeadlessContext &) = delete;
+    HeadlessContext &operator=(const HeadlessContext &) = delete;
+
+    // creates the context, makes it current, loads GL through glad and sets up the FBO
+    bool create(int width, int height);
+    void destroy();
+
+    // tightly packed RGBA8 rows, bottom row first as GL returns them
+    void readPixels(std::vector<uint8_t> &pixels) const;
+
+    int width() const { return width_; };
+    int height() const { return height_; };
+    bool surfaceless() const { return surface_ == EGL_NO_SURFACE; };
+
+  private:
+    EGLDisplay display_ = EGL_NO_DISPLAY;
+    EGLContext context_ = EGL_NO_CONTEXT;
+    EGLSurface surface_ = EGL_NO_SURFACE;
+
+    GLuint fbo_ = 0;
+    GLuint colorRbo_ = 0;
+    GLuint depthRbo_ = 0;
+    int width_ = 0;
+    int height_ = 0;
+
+    bool createFramebuffer();
+};
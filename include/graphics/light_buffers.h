@@ -0,0 +1,54 @@
+#pragma once
+
+#include "light_grid.h"
+#include "shader.h"
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <vector>
+
+/*
+ *  The clustered light data as texture buffers, which GL 3.3 has in core (SSBOs need 4.3):
+ *
+ *      pointLights    RGBA32F  two texels per light, (position, radius) then (colour, 0)
+ *      lightClusters  RG32UI   (offset, count) into lightIndices per cluster
+ *      lightIndices   R16UI    light indices, grouped by cluster
+ *
+ *  They sit on their own texture units past the material ones, so binding them once per frame is enough.
+ */
+class LightBuffers
+{
+  public:
+    static constexpr GLenum pointLightsUnit = GL_TEXTURE2;
+    static constexpr GLenum lightClustersUnit = GL_TEXTURE3;
+    static constexpr GLenum lightIndicesUnit = GL_TEXTURE4;
+
+    LightBuffers();
+    ~LightBuffers();
+
+    void upload(const PointLights &lights, const LightGrid &grid);
+    void bind();
+
+    // points a program's light samplers at the units above
+    static void setSamplers(Shader *shader);
+
+  private:
+    struct TextureBuffer
+    {
+        GLuint buffer = 0;
+        GLuint texture = 0;
+        GLenum unit = 0;
+        size_t capacityBytes = 0;
+    };
+
+    TextureBuffer pointLights_;
+    TextureBuffer lightClusters_;
+    TextureBuffer lightIndices_;
+    std::vector<glm::vec4> packed_;
+
+    static void create(TextureBuffer &target, GLenum unit, GLenum format);
+    static void fill(TextureBuffer &target, const void *data, size_t bytes);
+    static void destroy(TextureBuffer &target);
+};
@@ -0,0 +1,16 @@
+#pragma once
+
+#include "material_arrays.h"
+#include "texture.h"
+
+#include <cstdint>
+
+// either a pair of textures bound per material, or an index into arrays shared with other materials
+struct Material
+{
+    Texture *diffuse = nullptr;
+    Texture *specular = nullptr;
+    float shininess = 32.0f;
+    MaterialArrays *arrays = nullptr;
+    uint32_t index = 0;
+};
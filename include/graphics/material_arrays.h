@@ -0,0 +1,96 @@
+#pragma once
+
+#include "shader.h"
+#include "uniform_buffer.h"
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*
+ *  Materials drawn without binding textures per material. Diffuse and specular maps of one size go into
+ *  the layers of two GL_TEXTURE_2D_ARRAYs, and a material is an index into the Materials block, which holds
+ *  each one's layers and shininess. Draws of different materials then share all of their GL state, so the
+ *  draw queue batches them into one submission and the index travels per instance (InstanceData::material)
+ *  or, for single draws, in the materialIndex uniform. Shaders read them with PackedMaterialsFeature.
+ *
+ *  With ARB_bindless_texture and NV_gpu_shader5 every map can be a texture of its own instead and the block
+ *  hold their handles, so maps don't have to share a size; shaders built for it add BindlessTexturesFeature,
+ *  see bindless(). That path is opt in (allowBindless, renderer::setBindlessMaterials()), arrays are the default.
+ *
+ *  Maps are stored as RGBA8 whatever the source's channel count: grey goes to all three colour channels,
+ *  grey-alpha keeps its alpha and RGB gets an opaque one.
+ */
+class MaterialArrays
+{
+  public:
+    static constexpr GLenum diffuseUnit = GL_TEXTURE7;
+    static constexpr GLenum specularUnit = GL_TEXTURE8;
+    static constexpr uint32_t invalid = ~0u;
+
+    // width x height is the size of every map in the arrays, layerCapacity how many each array holds.
+    // allowBindless takes bindless textures instead where the driver has them
+    MaterialArrays(int width, int height, uint32_t layerCapacity, bool allowBindless = false);
+    ~MaterialArrays();
+
+    MaterialArrays(const MaterialArrays &) = delete;
+    MaterialArrays &operator=(const MaterialArrays &) = delete;
+
+    // returns the map's layer, or invalid when the array is full or the size doesn't fit it
+    uint32_t addDiffuse(const unsigned char *pixels, int width, int height, int channels);
+    uint32_t addSpecular(const unsigned char *pixels, int width, int height, int channels);
+    // returns the material's index, or invalid once maxPackedMaterials are taken
+    uint32_t addMaterial(uint32_t diffuse, uint32_t specular, float shininess);
+
+    // builds the mip chains and uploads the Materials block, call once everything is added
+    void finish();
+    void bind();
+
+    bool bindless() const
+    {
+        return bindless_;
+    }
+    // what a shader reading these needs on top of its own features
+    uint32_t shaderFeatures() const;
+    size_t materialCount() const
+    {
+        return materialCount_;
+    }
+
+    // points a program's array samplers at the units above
+    static void setSamplers(Shader *shader);
+
+  private:
+    struct Maps
+    {
+        // the array, or with bindless textures one texture per map and their handles
+        GLuint array = 0;
+        std::vector<GLuint> textures;
+        std::vector<GLuint64> handles;
+        uint32_t count = 0;
+    };
+
+    int width_, height_;
+    int levels_;
+    uint32_t layerCapacity_;
+    bool bindless_;
+    bool finished_ = false;
+    Maps diffuse_;
+    Maps specular_;
+    MaterialBlock block_ = {};
+    // diffuse and specular map of each material, finish() turns them into handles for the bindless block
+    std::vector<glm::uvec2> materialMaps_;
+    size_t materialCount_ = 0;
+    UniformBuffer *buffer_ = nullptr;
+    std::vector<unsigned char> scratch_;
+
+    void createArray(Maps &maps, GLenum unit);
+    uint32_t addMap(Maps &maps, GLenum unit, const unsigned char *pixels, int width, int height, int channels);
+    const unsigned char *expand(const unsigned char *pixels, int width, int height, int channels);
+    static void bindForEdit(GLenum unit, GLenum target, GLuint texture);
+    static void setParams(GLenum target);
+    void release(Maps &maps);
+};
@@ -0,0 +1,211 @@
+#pragma once
+
+#include "mesh.h"
+#include "object_pool.h"
+#include "shader.h"
+#include "shader_manager.h"
+#include "texture.h"
+#include "texture_streamer.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+enum class ResourceType : uint32_t
+{
+    Texture,
+    Shader,
+    Mesh,
+};
+
+static constexpr size_t resourceTypeCount = 3;
+
+class ResourceManager;
+
+/*
+ *  Shared reference to a resource, copies add a reference and the last one to go releases it. The
+ *  object stays at the same address for as long as any reference is held, evicted textures included
+ *  (they show their placeholder until streamed back in).
+ */
+template <typename T> class ResourceRef
+{
+  public:
+    ResourceRef() = default;
+    ResourceRef(const ResourceRef &other);
+    ResourceRef(ResourceRef &&other) noexcept;
+    ResourceRef &operator=(ResourceRef other) noexcept;
+    ~ResourceRef();
+
+    T *get() const
+    {
+        return object_;
+    }
+    T *operator->() const
+    {
+        return object_;
+    }
+    explicit operator bool() const
+    {
+        return object_ != nullptr;
+    }
+
+    void reset();
+
+  private:
+    friend class ResourceManager;
+
+    ResourceManager *manager_ = nullptr;
+    // the manager's entry, as the index and generation of an ObjectPool handle
+    uint32_t index_ = 0;
+    uint32_t generation_ = 0;
+    T *object_ = nullptr;
+
+    ResourceRef(ResourceManager *manager, uint32_t index, uint32_t generation, T *object)
+        : manager_(manager), index_(index), generation_(generation), object_(object)
+    {
+    }
+};
+
+typedef ResourceRef<Texture> TextureRef;
+typedef ResourceRef<Shader> ShaderRef;
+typedef ResourceRef<Mesh> MeshRef;
+
+/*
+ *  Loads textures, shaders and meshes by path, once. Each resource is keyed by a hash of its type and
+ *  path, asking for one that is loaded already adds a reference to it instead of creating another GL
+ *  object, and the last reference going away frees it. What every resource keeps on the GPU is tracked
+ *  per type for report().
+ *
+ *  Textures stream in through the TextureStreamer. When resident textures take more than the texture
+ *  budget, update() evicts the least recently used ones back to their placeholder, oldest first, but
+ *  never one drawn in the last frame. An evicted texture that gets drawn again is requested again, so
+ *  it comes back a few frames later. Shaders stay owned by the ShaderManager, which keeps programs for
+ *  hot reload until it goes away, the manager only counts references to them and their program sizes.
+ *
+ *  GL thread only. References must be released before the manager is destroyed.
+ */
+class ResourceManager
+{
+  public:
+    // budget in bytes, 0 for none
+    ResourceManager(TextureStreamer *streamer, ShaderManager *shaders, size_t textureBudget = 0);
+    ~ResourceManager();
+
+    ResourceManager(const ResourceManager &) = delete;
+    ResourceManager &operator=(const ResourceManager &) = delete;
+
+    // name as TextureStreamer::request() takes it. a texture binds to the unit it was loaded for, so the
+    // unit is part of the key
+    TextureRef texture(const std::string &name, int texUnit);
+    // file names relative to the shader manager's directory
+    ShaderRef shader(const std::string &vertexFile, const std::string &fragmentFile,
+                     ShaderPermutation permutation = 0);
+    // one level of a cooked .lmesh (see mesh_file.h), an empty ref if the file doesn't load
+    MeshRef mesh(const std::string &path, uint32_t level = 0);
+
+    // call once per frame on the GL thread, before anything is drawn
+    void update();
+
+    void setTextureBudget(size_t bytes);
+    size_t textureBudget() const
+    {
+        return textureBudget_;
+    }
+    size_t residentBytes(ResourceType type) const
+    {
+        return residentBytes_[(size_t)type];
+    }
+    size_t count(ResourceType type) const
+    {
+        return counts_[(size_t)type];
+    }
+    uint64_t evictions() const
+    {
+        return evictions_;
+    }
+
+    // one line per type and per resource through SDL_Log, largest first. GL thread, it re-reads program sizes
+    void report();
+
+  private:
+    template <typename T> friend class ResourceRef;
+
+    struct Entry
+    {
+        ResourceType type;
+        uint64_t key;
+        std::string name;
+        uint32_t references;
+        size_t bytes;
+        bool evicted;
+        Texture *texture;
+        ObjectPool<Texture>::Handle textureHandle;
+        Shader *shader;
+        Mesh *mesh;
+        ObjectPool<Mesh>::Handle meshHandle;
+    };
+
+    TextureStreamer *streamer_;
+    ShaderManager *shaders_;
+    size_t textureBudget_;
+    uint64_t frame_ = 1;
+    uint64_t evictions_ = 0;
+
+    ObjectPool<Entry> entries_;
+    std::unordered_map<uint64_t, ObjectPool<Entry>::Handle> byKey_;
+    ObjectPool<Texture> textures_;
+    ObjectPool<Mesh> meshes_;
+    size_t residentBytes_[resourceTypeCount] = {};
+    size_t counts_[resourceTypeCount] = {};
+
+    // null when the key isn't loaded, otherwise adds a reference
+    Entry *find(uint64_t key, ObjectPool<Entry>::Handle &handle);
+    ObjectPool<Entry>::Handle add(const Entry &entry);
+    void addReference(uint32_t index, uint32_t generation);
+    void release(uint32_t index, uint32_t generation);
+    void destroy(ObjectPool<Entry>::Handle handle);
+    void evictTextures();
+};
+
+template <typename T> ResourceRef<T>::ResourceRef(const ResourceRef &other)
+    : manager_(other.manager_), index_(other.index_), generation_(other.generation_), object_(other.object_)
+{
+    if (manager_)
+    {
+        manager_->addReference(index_, generation_);
+    }
+}
+
+template <typename T>
+ResourceRef<T>::ResourceRef(ResourceRef &&other) noexcept
+    : manager_(other.manager_), index_(other.index_), generation_(other.generation_), object_(other.object_)
+{
+    other.manager_ = nullptr;
+    other.object_ = nullptr;
+}
+
+template <typename T> ResourceRef<T> &ResourceRef<T>::operator=(ResourceRef other) noexcept
+{
+    std::swap(manager_, other.manager_);
+    std::swap(index_, other.index_);
+    std::swap(generation_, other.generation_);
+    std::swap(object_, other.object_);
+    return *this;
+}
+
+template <typename T> ResourceRef<T>::~ResourceRef()
+{
+    reset();
+}
+
+template <typename T> void ResourceRef<T>::reset()
+{
+    if (manager_)
+    {
+        manager_->release(index_, generation_);
+    }
+    manager_ = nullptr;
+    object_ = nullptr;
+}
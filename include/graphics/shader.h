@@ -4,6 +4,8 @@
 #include <glm/glm.hpp>
 
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 enum class ShaderType
 {
@@ -12,10 +14,32 @@ enum class ShaderType
     Program,
 };
 
+// a resolved uniform, typed so it can only be set with a matching value. it names a slot in the shader's
+// location table rather than a location, so handles survive the program being relinked
+template <typename T> struct UniformHandle
+{
+    GLint slot = -1;
+
+    bool valid() const
+    {
+        return slot >= 0;
+    }
+};
+
+// a program the driver may still be compiling, see Shader::beginProgram()
+struct PendingProgram
+{
+    GLuint program = 0;
+    GLuint vertex = 0;
+    GLuint fragment = 0;
+};
+
 class Shader
 {
   public:
     Shader(const char *vertexPath, const char *fragmentPath);
+    // takes ownership of an already linked program, 0 for one that failed
+    explicit Shader(GLuint program);
     ~Shader();
 
     GLuint getID() const
@@ -23,9 +47,37 @@ class Shader
         return id_;
     }
 
+    // false when the program failed to compile or link, nothing is drawn with it
+    bool linked() const
+    {
+        return id_ != 0;
+    }
+
+    // swaps in a newly linked program. uniform values are copied across so anything set once at init
+    // survives, and existing handles now refer to the new program's locations. replacing a program that
+    // failed has nothing to copy from, the initializer runs instead
+    void replaceProgram(GLuint program);
+
+    // the owner's one-off uniform setup, e.g. sampler units. runs now when linked and again whenever a
+    // program replaces one that failed to build
+    void setInitializer(void (*initialize)(Shader *shader));
+
     // use/activate the shader
     void use();
 
+    // resolve a uniform once, then set it through the handle on the hot path
+    template <typename T> UniformHandle<T> getUniform(const std::string &name) const
+    {
+        return UniformHandle<T>{findUniform(name)};
+    }
+
+    void set(UniformHandle<bool> handle, bool value) const;
+    void set(UniformHandle<int> handle, int value) const;
+    void set(UniformHandle<float> handle, float value) const;
+    void set(UniformHandle<glm::vec3> handle, const glm::vec3 &value) const;
+    void set(UniformHandle<glm::mat3> handle, const glm::mat3 &mat) const;
+    void set(UniformHandle<glm::mat4> handle, const glm::mat4 &mat) const;
+
     // utility uniform functions
     void setBool(const std::string &name, bool value) const;
     void setInt(const std::string &name, int value) const;
@@ -38,10 +90,41 @@ class Shader
     void setView(glm::mat4 view);
     void setModel(glm::vec3 pos, GLfloat rot);
 
+    // compiling and linking is split so a driver that compiles on its own threads is not waited on until
+    // the program is needed. programReady() is always true without KHR_parallel_shader_compile
+    static PendingProgram beginProgram(const std::string &vertexSource, const std::string &fragmentSource);
+    static bool programReady(const PendingProgram &pending);
+    // prints compile and link errors, returns the linked program or 0
+    static GLuint finishProgram(PendingProgram &pending);
+
+    static std::string loadFile(const char *filePath);
+
+    // off, every upload asks the driver for its location again the way it did before locations were cached.
+    // only there to measure what the cache saves, on by default
+    static void setLocationCache(bool enabled);
+
   private:
-    GLuint id_;
-    void checkCompileErrors(GLuint shader, ShaderType type);
-    std::string loadFile(const char *filePath);
-    GLuint compileShader(ShaderType type, const char *shaderSourceCode);
-    void createProgram(GLuint vertexShader, GLuint fragmentShader);
+    static bool locationCache_;
+
+    GLuint id_ = 0;
+    void (*initialize_)(Shader *shader) = nullptr;
+    // name -> slot, and slot -> name, location and type in the current program
+    std::unordered_map<std::string, GLint> uniforms_;
+    std::vector<std::string> names_;
+    std::vector<GLint> locations_;
+    std::vector<GLenum> types_;
+
+    GLint findUniform(const std::string &name) const;
+    GLint location(GLint slot) const
+    {
+        if (slot < 0)
+        {
+            return -1;
+        }
+        return locationCache_ ? locations_[slot] : queryLocation(slot);
+    }
+    GLint queryLocation(GLint slot) const;
+    void cacheUniforms();
+    static bool checkCompileErrors(GLuint shader, ShaderType type);
+    static GLuint compileShader(ShaderType type, const char *shaderSourceCode);
 };
\ No newline at end of file
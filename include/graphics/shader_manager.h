@@ -0,0 +1,143 @@
+#pragma once
+
+#include "object_pool.h"
+#include "shader.h"
+
+#include <glad/glad.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// optional parts of a shader. every bit set in a permutation is compiled in as a #define of the same name,
+// so a variant pays for nothing it leaves out instead of branching on uniforms per fragment
+enum ShaderFeature : uint32_t
+{
+    SpecularMapFeature = 1u << 0,
+    NormalMapFeature = 1u << 1,
+    ClusteredLightsFeature = 1u << 2,
+    ShadowsFeature = 1u << 3,
+    // maps come from MaterialArrays, picked per draw by material index
+    PackedMaterialsFeature = 1u << 4,
+    // with PackedMaterialsFeature, the material block holds ARB_bindless_texture handles instead of layers
+    BindlessTexturesFeature = 1u << 5,
+};
+
+// ShaderFeature bits, plus how many of the Lights block's entries are shaded (LIGHT_COUNT) from bit 16
+typedef uint32_t ShaderPermutation;
+
+static constexpr uint32_t lightCountShift = 16;
+
+inline ShaderPermutation makePermutation(uint32_t features, uint32_t lightCount)
+{
+    return features | (lightCount << lightCountShift);
+}
+
+/*
+ *  Builds and owns the shaders of one directory. Linked programs are written to cacheDirectory with
+ *  glGetProgramBinary, keyed by a hash of both sources and the driver's vendor, renderer and version
+ *  strings, so a warm start with the same files and driver loads binaries instead of compiling. A key
+ *  that misses (edited source, updated driver, a binary the driver rejects) compiles and overwrites.
+ *
+ *  Sources may #include "file" relative to the directory, each file once per stage. A permutation's
+ *  #defines go in right after #version and #line directives keep compiler messages pointing at the
+ *  original files: source 0 is the vertex file, 1 the fragment file and includes follow in the order they
+ *  were first read. Each file pair and permutation is built the first time it is asked for and shared
+ *  from then on.
+ *
+ *  On Linux a thread watches the directory with inotify. poll() starts relinking every program that
+ *  reads a changed file, included ones too, and swaps it in once the driver is done with it; a program
+ *  that fails to build keeps running the last version that linked. The Shader pointers load() hands out
+ *  never change, the shaders live in a pool the manager frees them with.
+ *
+ *      ProgramBinaryHeader
+ *      binary                  length bytes in the driver's own format
+ */
+static constexpr uint32_t programBinaryMagic = 0x4250474C; // "LGPB"
+static constexpr uint32_t programBinaryVersion = 1;
+
+struct ProgramBinaryHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t key;
+    uint32_t format;
+    uint32_t length;
+};
+
+static_assert(sizeof(ProgramBinaryHeader) == 24, "ProgramBinaryHeader layout is part of the file format");
+
+class ShaderManager
+{
+  public:
+    // cacheDirectory is created on the first write, empty disables the binary cache
+    explicit ShaderManager(const std::string &directory, const std::string &cacheDirectory = "shader_cache");
+    ~ShaderManager();
+
+    ShaderManager(const ShaderManager &) = delete;
+    ShaderManager &operator=(const ShaderManager &) = delete;
+
+    // file names are relative to the directory, the same pair and permutation always return the same shader
+    Shader *load(const std::string &vertexFile, const std::string &fragmentFile, ShaderPermutation permutation = 0);
+
+    // call once per frame on the GL thread, returns how many programs were swapped in
+    size_t poll();
+
+    size_t cacheHits() const
+    {
+        return cacheHits_;
+    }
+    size_t compiles() const
+    {
+        return compiles_;
+    }
+    bool watching() const
+    {
+        return watchFd_ >= 0;
+    }
+
+  private:
+    struct Program
+    {
+        std::string vertexFile;
+        std::string fragmentFile;
+        ShaderPermutation permutation;
+        // every file the last build read or tried to, indexed by #line source number
+        std::vector<std::string> files;
+        Shader *shader;
+        uint64_t key;
+        // a relink in flight, pending.program is 0 when there is none
+        PendingProgram pending;
+        uint64_t pendingKey;
+        // a file changed again while pending was building, go once more when it finishes
+        bool stale;
+    };
+
+    std::string directory_;
+    std::string cacheDirectory_;
+    std::string driver_;
+    std::vector<Program *> programs_;
+    ObjectPool<Shader> shaders_;
+    size_t cacheHits_ = 0;
+    size_t compiles_ = 0;
+
+    int watchFd_ = -1;
+    std::thread watcher_;
+    std::atomic<bool> stopping_{false};
+    std::mutex changedMutex_;
+    std::vector<std::string> changed_;
+
+    bool readSources(Program &program, std::string &vertex, std::string &fragment) const;
+    bool expand(const std::string &file, const std::string *defines, std::vector<std::string> &files,
+                std::vector<std::string> &included, std::string &out) const;
+    uint64_t hashSources(const std::string &vertex, const std::string &fragment) const;
+    std::string cachePath(uint64_t key) const;
+    GLuint loadBinary(uint64_t key);
+    void saveBinary(uint64_t key, GLuint program);
+    size_t startRelink(Program &program);
+    void watchLoop();
+};
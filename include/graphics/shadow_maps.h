@@ -0,0 +1,76 @@
+#pragma once
+
+#include "shader.h"
+#include "uniform_buffer.h"
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstddef>
+
+/*
+ *  Depth-only shadow maps for one directional and one point light, drawn by the caller one pass at a time:
+ *
+ *      passes 0-3      cascades, the layers of one GL_TEXTURE_2D_ARRAY
+ *      passes 4-9      faces of a GL_TEXTURE_CUBE_MAP, +x -x +y -y +z -z
+ *
+ *  GL 3.3 has no cube map arrays, so the point light's faces are a texture of their own.
+ *
+ *  The view up to shadowDistance is split between a logarithmic and a uniform distribution. Each cascade
+ *  is an orthographic box around its slice's bounding sphere, which doesn't change size as the camera
+ *  turns, so neither does a texel. The box moves in whole texels, so shadow edges stay put instead of
+ *  shimmering while the camera moves, and reaches back towards the light for casters outside the view.
+ *
+ *  Both textures compare in hardware with linear filtering, every lookup is already a 2x2 PCF and
+ *  lighting.frag spreads a few of them on top.
+ */
+class ShadowMaps
+{
+  public:
+    static constexpr size_t cascadeCount = maxCascades;
+    static constexpr size_t passCount = cascadeCount + 6;
+    static constexpr GLsizei cascadeSize = 2048;
+    static constexpr GLsizei cubeSize = 1024;
+    static constexpr GLenum cascadesUnit = GL_TEXTURE5;
+    static constexpr GLenum cubeUnit = GL_TEXTURE6;
+
+    ShadowMaps();
+    ~ShadowMaps();
+
+    ShadowMaps(const ShadowMaps &) = delete;
+    ShadowMaps &operator=(const ShadowMaps &) = delete;
+
+    // direction is the way the light travels, view and projection are the camera's
+    void fitCascades(const glm::vec3 &direction, const glm::mat4 &view, const glm::mat4 &projection, float nearPlane,
+                     float farPlane);
+    void placeCube(const glm::vec3 &position, float farPlane);
+
+    // what a pass renders with and is culled against
+    const glm::mat4 &passMatrix(size_t pass) const
+    {
+        return passMatrices_[pass];
+    }
+
+    // begin() keeps the bound framebuffer for end() to restore, the caller resets its own viewport
+    void begin();
+    void beginPass(size_t pass);
+    void end();
+
+    // uniforms for ShadowsBinding, the caller says which lights cast
+    ShadowBlock &block()
+    {
+        return block_;
+    }
+    void bind();
+
+    // points a program's shadow samplers at the units above
+    static void setSamplers(Shader *shader);
+
+  private:
+    GLuint cascades_ = 0;
+    GLuint cube_ = 0;
+    GLuint framebuffer_ = 0;
+    GLint previousFramebuffer_ = 0;
+    glm::mat4 passMatrices_[passCount];
+    ShadowBlock block_ = {};
+};
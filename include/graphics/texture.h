@@ -1,24 +1,68 @@
 #pragma once
 
+#include "texture_file.h"
+
 #include <glad/glad.h>
 
+#include <cstddef>
+#include <cstdint>
+
 class Texture
 {
   public:
     Texture(const char *name, int texUnit);
+    // placeholder texture, filled in later by upload(), e.g. by the TextureStreamer
+    explicit Texture(int texUnit);
+    ~Texture();
 
     void use();
 
+    // with a GL_PIXEL_UNPACK_BUFFER bound imageData is an offset into it
+    void upload(const unsigned char *imageData, int width, int height, int channels);
+    // upload every level of a cooked texture, base is file.data() or 0 when the file was copied into a bound PBO
+    void uploadCooked(const TextureFile &file, const unsigned char *base);
+
+    // whether the driver can take this cooked file as is, if not fall back to the PNG
+    static bool canUpload(const TextureFile &file);
+
+    // drops the image for the placeholder, freeing its memory until it is uploaded again
+    void evict();
+
+    // use() stamps the texture with the current frame, whoever tracks residency advances it
+    static void setFrame(uint64_t frame);
+    uint64_t lastUsed() const
+    {
+        return lastUsed_;
+    }
+
     GLuint getID() const
     {
         return id_;
     }
 
+    bool isResident() const
+    {
+        return resident_;
+    }
+    // what the driver is likely to keep for every level, uncompressed RGB counted as RGBA
+    size_t gpuBytes() const
+    {
+        return bytes_;
+    }
+
   private:
     GLuint id_;
     int textureUnit_;
     int width_, height_, nrChannels_;
+    bool resident_ = false;
+    size_t bytes_ = 0;
+    uint64_t lastUsed_ = 0;
+    static uint64_t frame_;
+
     unsigned char *loadImage(const char *filePath);
-    void compileTexture(unsigned char *imageData);
+    void uploadPlaceholder();
+    void compileTexture(const unsigned char *imageData);
+    static GLenum formatForChannels(int channels);
+    static void setSwizzle(int channels);
     void setTextureParams();
-};
\ No newline at end of file
+};
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/*
+ *  Cooked texture container (.ltex), written offline by tools/texcook and memory-mapped at runtime.
+ *
+ *      TextureFileHeader
+ *      TextureFileLevel[levelCount]    largest level first
+ *      level data                      each level 16 byte aligned, offsets are from the start of the file
+ */
+enum class TextureFileFormat : uint32_t
+{
+    R8 = 0,
+    RG8 = 1,
+    RGB8 = 2,
+    RGBA8 = 3,
+    BC1 = 4, // 4x4 blocks, 8 bytes, RGB
+    BC3 = 5, // 4x4 blocks, 16 bytes, RGB + interpolated alpha
+    BC7 = 6, // 4x4 blocks, 16 bytes, RGBA
+};
+
+static constexpr uint32_t textureFileMagic = 0x5845544C; // "LTEX"
+static constexpr uint32_t textureFileVersion = 1;
+
+struct TextureFileHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    TextureFileFormat format;
+    uint32_t width;
+    uint32_t height;
+    uint32_t channels; // channel count of the source image
+    uint32_t levelCount;
+    uint32_t reserved;
+};
+
+struct TextureFileLevel
+{
+    uint64_t offset;
+    uint64_t size;
+    uint32_t width;
+    uint32_t height;
+};
+
+static_assert(sizeof(TextureFileHeader) == 32, "TextureFileHeader layout is part of the file format");
+static_assert(sizeof(TextureFileLevel) == 24, "TextureFileLevel layout is part of the file format");
+
+inline bool isBlockCompressed(TextureFileFormat format)
+{
+    return format == TextureFileFormat::BC1 || format == TextureFileFormat::BC3 || format == TextureFileFormat::BC7;
+}
+
+// read-only memory mapping of a cooked texture
+class TextureFile
+{
+  public:
+    TextureFile() = default;
+    ~TextureFile();
+    TextureFile(const TextureFile &) = delete;
+    TextureFile &operator=(const TextureFile &) = delete;
+
+    // returns false if the file is missing or isn't a valid container
+    bool open(const std::string &path);
+
+    const TextureFileHeader &header() const
+    {
+        return *reinterpret_cast<const TextureFileHeader *>(data_);
+    }
+
+    const TextureFileLevel &level(uint32_t index) const
+    {
+        return reinterpret_cast<const TextureFileLevel *>(data_ + sizeof(TextureFileHeader))[index];
+    }
+
+    const unsigned char *data() const
+    {
+        return data_;
+    }
+
+    size_t size() const
+    {
+        return size_;
+    }
+
+  private:
+    unsigned char *data_ = nullptr;
+    size_t size_ = 0;
+
+    void close();
+    bool validate() const;
+};
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "texture.h"
+
+#include <glad/glad.h>
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+ *  Streams textures in without blocking the render thread. request() queues a file for a pool of worker
+ *  threads to decode into a texture that keeps its placeholder until then. Decoded images wait in a
+ *  bounded queue (workers block when it is full so decoded pixels can't pile up in memory) until pump()
+ *  uploads them on the GL thread through a pixel buffer object, at most frameByteBudget bytes per frame.
+ *  The textures belong to the caller, a texture destroyed while its request is in flight has to be
+ *  cancelled first.
+ */
+class TextureStreamer
+{
+  public:
+    TextureStreamer(unsigned workerCount = 0, size_t maxDecoded = 8, size_t frameByteBudget = 8 << 20);
+    ~TextureStreamer();
+
+    // name is relative to assets/textures and without an extension, the cooked .ltex is preferred
+    void request(Texture *texture, const std::string &name);
+    // drops every request for the texture, including one a worker is decoding right now
+    void cancel(Texture *texture);
+
+    // call once per frame on the GL thread, returns the number of textures made resident
+    size_t pump();
+
+    // textures requested but not resident yet
+    size_t pending() const;
+
+  private:
+    struct DecodeJob
+    {
+        Texture *texture;
+        std::string path;
+        uint64_t id;
+    };
+
+    struct DecodedImage
+    {
+        Texture *texture;
+        uint64_t id;
+        unsigned char *pixels;
+        int width, height, channels;
+        // set instead of pixels when a cooked .ltex was found
+        TextureFile *cooked;
+    };
+
+    static constexpr size_t pboCount = 3;
+
+    std::vector<std::thread> workers_;
+    std::deque<DecodeJob> jobs_;
+    std::deque<DecodedImage> decoded_;
+    mutable std::mutex mutex_;
+    std::condition_variable jobReady_;
+    std::condition_variable decodedSpace_;
+    bool stopping_ = false;
+    size_t inFlight_ = 0;
+    uint64_t nextId_ = 0;
+    // requests workers are decoding, and the ones of those cancelled meanwhile
+    std::vector<const DecodeJob *> decoding_;
+    std::vector<uint64_t> cancelled_;
+
+    size_t maxDecoded_;
+    size_t frameByteBudget_;
+
+    GLuint pbos_[pboCount];
+    size_t nextPbo_ = 0;
+
+    void workerLoop();
+    static void freeImage(DecodedImage &image);
+    void uploadImage(const DecodedImage &image);
+    void uploadCooked(const DecodedImage &image);
+    GLuint nextPbo();
+};
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstddef>
+
+// fixed binding points, every program that declares one of these blocks is bound to the same slot at link time
+enum UniformBinding : GLuint
+{
+    CameraBinding = 0,
+    LightsBinding = 1,
+    ClustersBinding = 2,
+    ShadowsBinding = 3,
+    MaterialsBinding = 4,
+};
+
+// std140 mirrors of the blocks declared in assets/shaders, vec3s are padded out to vec4s
+struct CameraBlock
+{
+    glm::mat4 projection;
+    glm::mat4 view;
+    glm::vec4 viewPos;
+};
+static_assert(sizeof(CameraBlock) == 144, "CameraBlock must match the std140 Camera block");
+
+// entries in the Lights block, a shader permutation decides how many of them it shades
+constexpr size_t maxLights = 4;
+
+struct LightData
+{
+    glm::vec4 position;
+    glm::vec4 ambient;
+    glm::vec4 diffuse;
+    glm::vec4 specular;
+};
+
+struct LightBlock
+{
+    LightData lights[maxLights];
+};
+static_assert(sizeof(LightBlock) == 64 * maxLights, "LightBlock must match the std140 Lights block");
+
+// how the lighting shader finds its cluster, see LightGrid. only read by permutations with clustered lights
+struct ClusterBlock
+{
+    glm::uvec4 grid;  // tiles x, tiles y, depth slices, light count
+    glm::vec4 depth;  // slice scale, slice bias, 1 / viewport width, 1 / viewport height
+};
+static_assert(sizeof(ClusterBlock) == 32, "ClusterBlock must match the std140 Clusters block");
+
+// cascades of the directional shadow, see ShadowMaps
+constexpr size_t maxCascades = 4;
+
+// where lighting.frag looks up shadows, only read by permutations with shadows
+struct ShadowBlock
+{
+    glm::mat4 cascades[maxCascades]; // world to cascade texture space, depth in z
+    glm::vec4 cascadeEnds;           // view depth each cascade covers up to
+    glm::vec4 cascadeTexels;         // world size of one texel per cascade
+    glm::vec4 cube;                  // shadowed point light position, cube far plane
+    glm::vec4 params;                // cube near plane, 1 / cascade size, 1 / cube size, unused
+    glm::ivec4 lights;               // Lights block entries casting the cube and the cascades, -1 for none
+};
+static_assert(sizeof(ShadowBlock) == 64 * maxCascades + 80, "ShadowBlock must match the std140 Shadows block");
+
+// materials packed into MaterialArrays, a draw picks one by index
+constexpr size_t maxPackedMaterials = 256;
+
+struct MaterialEntry
+{
+    glm::uvec4 maps;   // diffuse and specular layers, or with bindless textures both handles as low, high pairs
+    glm::vec4 params;  // shininess, unused x3
+};
+
+// only read by permutations with packed materials
+struct MaterialBlock
+{
+    MaterialEntry materials[maxPackedMaterials];
+};
+static_assert(sizeof(MaterialBlock) == 32 * maxPackedMaterials, "MaterialBlock must match the std140 Materials block");
+
+class UniformBuffer
+{
+  public:
+    UniformBuffer(UniformBinding binding, size_t size);
+    ~UniformBuffer();
+
+    // replace the whole buffer, written once per frame and shared by every program
+    void update(const void *data, size_t size);
+
+    GLuint getID() const
+    {
+        return id_;
+    }
+
+    static void bindBlocks(GLuint program);
+
+  private:
+    GLuint id_;
+    UniformBinding binding_;
+    size_t size_;
+};
@@ -1,31 +1,29 @@
 #pragma once
 
-#include "cube.h"
+#include "mesh.h"
 #include "texture.h"
 #include "shader.h"
 
 #include <glm/glm.hpp>
 
-#include <cstddef>
+#include <vector>
 
-class Cube
+class Cube : public Mesh
 {
   public:
-    Cube(glm::vec3 size, Shader *shader, Texture *diff, Texture *spec);
-    ~Cube();
-    void bind();
-    void draw();
+    Cube(glm::vec3 size, Shader *shader, Texture *diff, Texture *spec, GeometryPool *pool = nullptr);
+
+    // half positions, octahedral normals, unorm16 UVs; pools holding cubes should use the same
+    static VertexLayout vertexLayout();
     void transform(glm::vec3 translate, glm::vec3 rotate);
 
   private:
     glm::vec3 size_;
 
-    static constexpr size_t vertexStride = 8; // 3 pos vertices, 3 normals, 2 tex coord vertices
-    unsigned int vao_;
-    unsigned int vbo_;
-    unsigned int ebo_;
+    static std::vector<Vertex> buildVertices(glm::vec3 size);
+    static std::vector<uint32_t> buildIndices();
 
     Shader *shader_ = nullptr;
     Texture *diff_ = nullptr;
     Texture *spec_ = nullptr;
-};
\ No newline at end of file
+};
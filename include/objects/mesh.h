@@ -0,0 +1,172 @@
+#pragma once
+#include <glad/glad.h>
+
+#include "normal_matrix.h"
+#include "vertex.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// per-instance vertex data, normal matrix is precomputed so the shader doesn't have to invert per vertex.
+// material is an index into MaterialArrays, only read by shaders with packed materials
+struct InstanceData
+{
+    glm::mat4 model;
+    glm::mat3 normal;
+    uint32_t material = 0;
+
+    InstanceData() = default;
+    explicit InstanceData(const glm::mat4 &m) : model(m), normal(normalmatrix::compute(m))
+    {
+    }
+    InstanceData(const glm::mat4 &m, const glm::mat3 &n, uint32_t mat = 0) : model(m), normal(n), material(mat)
+    {
+    }
+};
+
+/*
+ *  Vertex attribute encodings. Normals are always octahedral (two components, decoded in the vertex
+ *  shader), only their precision changes. Snorm16 positions are quantised against the mesh bounds
+ *  and need decodeTransform() applied on top of the model matrix. Unorm16 UVs only hold [0, 1] and
+ *  fall back to half floats for meshes with tiling coordinates.
+ *
+ *      float layout:   pos 12 + normal 8 + uv 8 = 28 bytes
+ *      packed layout:  pos 8  + normal 4 + uv 4 = 16 bytes
+ */
+enum class PositionFormat
+{
+    Float32,
+    Half,
+    Snorm16,
+};
+
+enum class NormalFormat
+{
+    OctFloat32,
+    OctSnorm16,
+    OctSnorm8,
+};
+
+enum class UvFormat
+{
+    Float32,
+    Half,
+    Unorm16,
+};
+
+struct VertexLayout
+{
+    PositionFormat position = PositionFormat::Float32;
+    NormalFormat normal = NormalFormat::OctFloat32;
+    UvFormat uv = UvFormat::Float32;
+
+    static VertexLayout full()
+    {
+        return {};
+    }
+    static VertexLayout packed()
+    {
+        return {PositionFormat::Snorm16, NormalFormat::OctSnorm16, UvFormat::Unorm16};
+    }
+
+    // every attribute starts on a 4 byte boundary
+    size_t positionSize() const;
+    size_t normalSize() const;
+    size_t uvSize() const;
+    size_t stride() const
+    {
+        return positionSize() + normalSize() + uvSize();
+    }
+};
+
+// shared by Mesh and GeometryPool so both lay vertices out identically
+namespace vertexformat
+{
+bool uvsFitUnorm(const std::vector<Vertex> &vertices);
+// packs into layout and returns the snorm16 decode transform (identity for the other position formats)
+glm::mat4 pack(const std::vector<Vertex> &vertices, const VertexLayout &layout, std::vector<uint8_t> &out);
+// attributes 0-2 from the bound GL_ARRAY_BUFFER
+void setAttributes(const VertexLayout &layout);
+// the positions of a pack() result on their own, layout.positionSize() bytes apart
+void extractPositions(const std::vector<uint8_t> &packed, const VertexLayout &layout, std::vector<uint8_t> &out);
+// attribute 0 alone from the bound GL_ARRAY_BUFFER, holding extractPositions() output
+void setPositionAttribute(const VertexLayout &layout);
+// attributes 3-10 from the bound GL_ARRAY_BUFFER, starting byteOffset into it
+void setInstanceAttributes(size_t byteOffset);
+}; // namespace vertexformat
+
+class GeometryPool;
+
+/*
+ *  Indexed triangle mesh in one interleaved vertex buffer. Attribute locations 0-2 are position,
+ *  octahedral normal and UV, 3-10 are the per-instance model and normal matrices and material index.
+ *  Indices are 16 bit whenever the vertex count allows it.
+ *
+ *  Positions are kept a second time in a buffer of their own for depth-only passes, which read nothing
+ *  else: after bindPositions() the same draw calls fetch a third to a half of the bytes per vertex.
+ *
+ *  Given a pool the mesh owns no GL objects, its geometry is suballocated from the pool's shared
+ *  buffers in the pool's layout, and instanced drawing goes through GeometryPool::queue instead.
+ */
+class Mesh
+{
+  public:
+    Mesh(const std::vector<Vertex> &vertices, const std::vector<uint32_t> &indices,
+         VertexLayout layout = VertexLayout::packed(), GeometryPool *pool = nullptr);
+    virtual ~Mesh();
+
+    Mesh(const Mesh &) = delete;
+    Mesh &operator=(const Mesh &) = delete;
+
+    void bind();
+    // like bind(), for shaders that only read positions (and per-instance attributes)
+    void bindPositions();
+    void draw();
+    void drawInstanced();
+    // object-to-world models, quantized meshes fold decodeTransform() into them here
+    void setInstances(const std::vector<InstanceData> &instances);
+
+    const VertexLayout &layout() const { return layout_; };
+    size_t vertexCount() const { return vertexCount_; };
+    size_t indexCount() const { return indexCount_; };
+    size_t vertexBytes() const { return vertexCount_ * layout_.stride(); };
+    // vertices, the positions-only copy, indices and instances, in the mesh's own buffers or its pool's
+    size_t gpuBytes() const;
+    glm::vec3 boundsMin() const { return boundsMin_; };
+    glm::vec3 boundsMax() const { return boundsMax_; };
+
+    // maps snorm16 positions back to object space, identity for the other position formats
+    bool quantized() const { return layout_.position == PositionFormat::Snorm16; };
+    const glm::mat4 &decodeTransform() const { return decode_; };
+
+    GeometryPool *pool() const { return pool_; };
+    uint32_t poolId() const { return poolId_; };
+
+  private:
+    VertexLayout layout_;
+    GeometryPool *pool_ = nullptr;
+    uint32_t poolId_ = 0;
+    glm::mat4 decode_ = glm::mat4(1.0f);
+    glm::vec3 boundsMin_ = glm::vec3(0.0f);
+    glm::vec3 boundsMax_ = glm::vec3(0.0f);
+
+    unsigned int vao_ = 0;
+    unsigned int vbo_ = 0;
+    unsigned int ebo_ = 0;
+    unsigned int positionVao_ = 0;
+    unsigned int positionVbo_ = 0;
+    size_t vertexCount_ = 0;
+    size_t indexCount_ = 0;
+    GLenum indexType_ = GL_UNSIGNED_INT;
+
+    unsigned int instanceVbo_ = 0;
+    size_t instanceCapacity_ = 0;
+    size_t instanceCount_ = 0;
+    // setInstances() input with decode_ applied, for quantized meshes
+    std::vector<InstanceData> decoded_;
+
+    void initInstanceBuffer();
+};
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "mesh_simplify.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*
+ *  Cooked mesh container (.lmesh), written offline by tools/meshcook from an OBJ file with its LOD chain
+ *  already simplified and optimised, so loading one is two reads per level.
+ *
+ *      MeshFileHeader
+ *      MeshFileLod[lodCount]   finest level first
+ *      level data              Vertex[vertexCount] then uint32_t[indexCount], each level 16 byte aligned,
+ *                              offsets are from the start of the file
+ */
+static constexpr uint32_t meshFileMagic = 0x48534D4C; // "LMSH"
+static constexpr uint32_t meshFileVersion = 1;
+
+struct MeshFileHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t lodCount;
+    uint32_t reserved;
+};
+
+struct MeshFileLod
+{
+    uint64_t offset;
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    float error; // see meshopt::MeshLod
+    uint32_t reserved;
+};
+
+static_assert(sizeof(MeshFileHeader) == 16, "MeshFileHeader layout is part of the file format");
+static_assert(sizeof(MeshFileLod) == 24, "MeshFileLod layout is part of the file format");
+static_assert(sizeof(Vertex) == 32, "Vertex layout is part of the file format");
+
+namespace meshfile
+{
+// false if the file is missing or isn't a valid container
+bool load(const std::string &path, std::vector<meshopt::MeshLod> &levels);
+}; // namespace meshfile
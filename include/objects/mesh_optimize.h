@@ -0,0 +1,24 @@
+#pragma once
+
+#include "vertex.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*
+ *  Index and vertex reordering for indexed triangle lists. Run optimizeVertexCache first so triangles
+ *  reuse recently transformed vertices, then optimizeVertexFetch so vertices are stored in the order
+ *  the reordered triangles first touch them.
+ */
+namespace meshopt
+{
+// Forsyth's linear-speed vertex cache optimisation, greedy on a per-vertex score
+void optimizeVertexCache(std::vector<uint32_t> &indices, size_t vertexCount);
+
+// reorders vertices by first use and drops unreferenced ones, indices are remapped in place
+void optimizeVertexFetch(std::vector<Vertex> &vertices, std::vector<uint32_t> &indices);
+
+// average cache miss ratio (transformed vertices per triangle) against a FIFO cache, 0.5 is ideal, 3 is worst
+float averageCacheMissRatio(const std::vector<uint32_t> &indices, size_t vertexCount, unsigned cacheSize = 16);
+}; // namespace meshopt
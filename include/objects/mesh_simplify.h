@@ -0,0 +1,41 @@
+#pragma once
+
+#include "vertex.h"
+
+#include <cfloat>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*
+ *  Quadric error metric simplification (Garland and Heckbert) for indexed triangle lists. Vertices are
+ *  welded by position and every edge collapse moves one position onto a neighbouring one, so the result
+ *  indexes into the original vertex array and needs no new vertices. The error of a collapse is the area
+ *  weighted mean squared distance from the merged position to the planes of every original triangle it
+ *  absorbed, in mesh units once square rooted.
+ *
+ *  UV seams and open borders keep their shape: a position with several vertices (different uv or normal
+ *  at the same point) only collapses along a seam onto a position with as many, a border position only
+ *  slides along its border, and positions on edges shared by more than two triangles stay put. Collapses
+ *  that would flip a triangle or pinch the surface are skipped.
+ */
+namespace meshopt
+{
+// collapses edges in order of error until at most targetIndexCount indices are left or the next collapse would
+// cost more than maxError. indices are rewritten in place, returns the largest error of a collapse made
+float simplify(const std::vector<Vertex> &vertices, std::vector<uint32_t> &indices, size_t targetIndexCount,
+               float maxError = FLT_MAX);
+
+struct MeshLod
+{
+    std::vector<Vertex> vertices;
+    std::vector<uint32_t> indices;
+    float error; // in mesh units, from the source mesh, 0 for level 0
+};
+
+// level 0 is the source mesh, every level after it simplifies the one before to ratio of its triangles. each level
+// is optimised for the vertex cache and fetch and owns only the vertices it uses. stops at maxLevels or once a
+// level fails to shed a tenth of the triangles, which is where seams and borders hold what is left
+std::vector<MeshLod> buildLodChain(const std::vector<Vertex> &vertices, const std::vector<uint32_t> &indices,
+                                   size_t maxLevels, float ratio = 0.5f);
+}; // namespace meshopt
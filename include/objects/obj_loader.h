@@ -0,0 +1,18 @@
+#pragma once
+
+#include "vertex.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*
+ *  Wavefront OBJ loading. Supports v/vt/vn/f with any of the v, v/vt, v//vn and v/vt/vn face forms,
+ *  negative (relative) indices and polygons (fan triangulated). Materials, groups and smoothing groups
+ *  are ignored. Corners sharing the same v/vt/vn triple become one vertex; when the file has no normals
+ *  they are generated from area weighted face normals.
+ */
+namespace obj
+{
+bool load(const std::string &path, std::vector<Vertex> &vertices, std::vector<uint32_t> &indices);
+}; // namespace obj
@@ -0,0 +1,11 @@
+#pragma once
+
+#include "mesh.h"
+
+#include <string>
+
+namespace obj
+{
+// obj::load, reorder for the vertex cache and fetch, and upload; nullptr if the file can't be read
+Mesh *loadMesh(const std::string &path, VertexLayout layout = VertexLayout::packed());
+}; // namespace obj
@@ -0,0 +1,17 @@
+#pragma once
+
+#include "mesh.h"
+
+#include <vector>
+
+// UV sphere centred on the origin, rings latitude bands by segments longitude slices
+class Sphere : public Mesh
+{
+  public:
+    Sphere(float radius, unsigned rings, unsigned segments, VertexLayout layout = VertexLayout::packed(),
+           GeometryPool *pool = nullptr);
+
+    // the geometry the constructor uploads, for building LOD chains from
+    static std::vector<Vertex> buildVertices(float radius, unsigned rings, unsigned segments);
+    static std::vector<uint32_t> buildIndices(unsigned rings, unsigned segments);
+};
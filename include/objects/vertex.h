@@ -0,0 +1,12 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+// what loaders produce, packed into the mesh's vertex layout on upload. apart from mesh.h so the offline tools
+// can use it without GL
+struct Vertex
+{
+    glm::vec3 position;
+    glm::vec3 normal;
+    glm::vec2 uv;
+};
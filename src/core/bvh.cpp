@@ -0,0 +1,451 @@
+#include "bvh.h"
+
+#include <algorithm>
+#include <cmath>
+
+static constexpr uint32_t maxLeafSize = 4;
+static constexpr int sahBins = 12;
+// traversal keeps at most depth + 1 nodes on its stack, deeper subtrees are made into leaves
+static constexpr uint32_t maxDepth = 120;
+static constexpr int stackSize = 128;
+
+void Aabb::grow(const glm::vec3 &point)
+{
+    min = glm::min(min, point);
+    max = glm::max(max, point);
+}
+
+void Aabb::grow(const Aabb &other)
+{
+    min = glm::min(min, other.min);
+    max = glm::max(max, other.max);
+}
+
+float Aabb::surfaceArea() const
+{
+    glm::vec3 e = max - min;
+    return 2.0f * (e.x * e.y + e.y * e.z + e.z * e.x);
+}
+
+void Bvh::build(const std::vector<Aabb> &bounds)
+{
+    uint32_t count = (uint32_t)bounds.size();
+    bounds_ = bounds;
+    centers_.resize(count);
+    objectIds_.resize(count);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        centers_[i] = bounds[i].center();
+        objectIds_[i] = i;
+    }
+
+    nodes_.clear();
+    if (count == 0)
+    {
+        return;
+    }
+    nodes_.reserve(2 * (size_t)count);
+    nodes_.push_back(Node());
+    buildNode(0, 0, count, 0);
+    dirty_ = false;
+}
+
+void Bvh::buildNode(uint32_t nodeIndex, uint32_t first, uint32_t count, uint32_t depth)
+{
+    Aabb nodeBounds, centroidBounds;
+    for (uint32_t i = first; i < first + count; i++)
+    {
+        nodeBounds.grow(bounds_[objectIds_[i]]);
+        centroidBounds.grow(centers_[objectIds_[i]]);
+    }
+
+    Node &node = nodes_[nodeIndex];
+    node.min = nodeBounds.min;
+    node.max = nodeBounds.max;
+    node.index = first;
+    node.count = count;
+
+    if (count <= maxLeafSize || depth >= maxDepth)
+    {
+        return;
+    }
+
+    int axis;
+    float position;
+    uint32_t middle = first;
+    if (findSplit(node, first, count, centroidBounds, axis, position))
+    {
+        auto begin = objectIds_.begin() + first;
+        auto split = std::partition(begin, begin + count,
+                                    [&](uint32_t id) { return centers_[id][axis] < position; });
+        middle = (uint32_t)(split - objectIds_.begin());
+    }
+
+    if (middle == first || middle == first + count)
+    {
+        // SAH found nothing worth splitting for (or every centroid landed in one bin) but the node is
+        // still too big for a leaf, fall back to a median split on the widest axis
+        glm::vec3 extent = centroidBounds.max - centroidBounds.min;
+        axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+        middle = first + count / 2;
+        auto begin = objectIds_.begin() + first;
+        std::nth_element(begin, objectIds_.begin() + middle, begin + count,
+                         [&](uint32_t a, uint32_t b) { return centers_[a][axis] < centers_[b][axis]; });
+    }
+
+    // children are allocated as a pair so the right child is always left + 1
+    uint32_t left = (uint32_t)nodes_.size();
+    nodes_.push_back(Node());
+    nodes_.push_back(Node());
+    nodes_[nodeIndex].index = left;
+    nodes_[nodeIndex].count = 0;
+
+    buildNode(left, first, middle - first, depth + 1);
+    buildNode(left + 1, middle, first + count - middle, depth + 1);
+}
+
+// binned SAH, returns false when keeping the node as a leaf is cheaper than any split
+bool Bvh::findSplit(const Node &node, uint32_t first, uint32_t count, const Aabb &centroidBounds, int &axis,
+                    float &position) const
+{
+    struct Bin
+    {
+        Aabb bounds;
+        uint32_t count = 0;
+    };
+
+    float bestCost = 1e30f;
+    for (int a = 0; a < 3; a++)
+    {
+        float lo = centroidBounds.min[a];
+        float hi = centroidBounds.max[a];
+        if (hi - lo <= 1e-6f)
+        {
+            continue;
+        }
+
+        Bin bins[sahBins];
+        float scale = sahBins / (hi - lo);
+        for (uint32_t i = first; i < first + count; i++)
+        {
+            uint32_t id = objectIds_[i];
+            int bin = std::min(sahBins - 1, (int)((centers_[id][a] - lo) * scale));
+            bins[bin].count++;
+            bins[bin].bounds.grow(bounds_[id]);
+        }
+
+        // sweep from both sides so every plane between bins is costed in O(bins)
+        float leftArea[sahBins - 1], rightArea[sahBins - 1];
+        uint32_t leftCount[sahBins - 1], rightCount[sahBins - 1];
+        Aabb leftBox, rightBox;
+        uint32_t leftSum = 0, rightSum = 0;
+        for (int i = 0; i < sahBins - 1; i++)
+        {
+            leftSum += bins[i].count;
+            leftCount[i] = leftSum;
+            leftBox.grow(bins[i].bounds);
+            leftArea[i] = leftSum ? leftBox.surfaceArea() : 0.0f;
+
+            rightSum += bins[sahBins - 1 - i].count;
+            rightCount[sahBins - 2 - i] = rightSum;
+            rightBox.grow(bins[sahBins - 1 - i].bounds);
+            rightArea[sahBins - 2 - i] = rightSum ? rightBox.surfaceArea() : 0.0f;
+        }
+
+        for (int i = 0; i < sahBins - 1; i++)
+        {
+            float cost = leftCount[i] * leftArea[i] + rightCount[i] * rightArea[i];
+            if (cost < bestCost)
+            {
+                bestCost = cost;
+                axis = a;
+                position = lo + (i + 1) / scale;
+            }
+        }
+    }
+
+    Aabb nodeBounds;
+    nodeBounds.min = node.min;
+    nodeBounds.max = node.max;
+    float leafCost = count * nodeBounds.surfaceArea();
+    return bestCost < leafCost;
+}
+
+void Bvh::update(uint32_t object, const Aabb &bounds)
+{
+    bounds_[object] = bounds;
+    centers_[object] = bounds.center();
+    dirty_ = true;
+}
+
+// children always live after their parent, so one reverse sweep refits leaves before the nodes above them
+void Bvh::refit()
+{
+    if (!dirty_)
+    {
+        return;
+    }
+
+    for (size_t i = nodes_.size(); i-- > 0;)
+    {
+        Node &node = nodes_[i];
+        Aabb box;
+        if (node.count > 0)
+        {
+            for (uint32_t j = node.index; j < node.index + node.count; j++)
+            {
+                box.grow(bounds_[objectIds_[j]]);
+            }
+        }
+        else
+        {
+            const Node &left = nodes_[node.index];
+            const Node &right = nodes_[node.index + 1];
+            box.min = glm::min(left.min, right.min);
+            box.max = glm::max(left.max, right.max);
+        }
+        node.min = box.min;
+        node.max = box.max;
+    }
+    dirty_ = false;
+}
+
+enum class Containment
+{
+    Outside,
+    Intersects,
+    Inside,
+};
+
+static Containment classify(const Frustum &frustum, const glm::vec3 &min, const glm::vec3 &max)
+{
+    glm::vec3 center = (min + max) * 0.5f;
+    glm::vec3 extents = (max - min) * 0.5f;
+    Containment result = Containment::Inside;
+    for (const glm::vec4 &plane : frustum.planes)
+    {
+        glm::vec3 normal(plane);
+        float distance = glm::dot(normal, center) + plane.w;
+        float reach = glm::dot(glm::abs(normal), extents);
+        if (distance + reach < 0.0f)
+        {
+            return Containment::Outside;
+        }
+        if (distance - reach < 0.0f)
+        {
+            result = Containment::Intersects;
+        }
+    }
+    return result;
+}
+
+void Bvh::queryFrustum(const Frustum &frustum, std::vector<uint32_t> &result) const
+{
+    if (nodes_.empty())
+    {
+        return;
+    }
+
+    uint32_t stack[stackSize];
+    int top = 0;
+    stack[top++] = 0;
+
+    while (top > 0)
+    {
+        const Node &node = nodes_[stack[--top]];
+        Containment containment = classify(frustum, node.min, node.max);
+        if (containment == Containment::Outside)
+        {
+            continue;
+        }
+
+        if (node.count > 0)
+        {
+            for (uint32_t i = node.index; i < node.index + node.count; i++)
+            {
+                uint32_t id = objectIds_[i];
+                const Aabb &box = bounds_[id];
+                if (containment == Containment::Inside ||
+                    frustum.intersectsAabb(box.center(), (box.max - box.min) * 0.5f))
+                {
+                    result.push_back(id);
+                }
+            }
+        }
+        else if (containment == Containment::Inside)
+        {
+            // the whole subtree is visible, its objects are a contiguous run of objectIds_ but finding
+            // the run needs a walk anyway, so collect leaves without testing any more planes
+            uint32_t inner[stackSize];
+            int innerTop = 0;
+            inner[innerTop++] = node.index;
+            inner[innerTop++] = node.index + 1;
+            while (innerTop > 0)
+            {
+                const Node &child = nodes_[inner[--innerTop]];
+                if (child.count > 0)
+                {
+                    result.insert(result.end(), objectIds_.begin() + child.index,
+                                  objectIds_.begin() + child.index + child.count);
+                }
+                else
+                {
+                    inner[innerTop++] = child.index;
+                    inner[innerTop++] = child.index + 1;
+                }
+            }
+        }
+        else
+        {
+            stack[top++] = node.index;
+            stack[top++] = node.index + 1;
+        }
+    }
+}
+
+// slab test, returns the entry distance or a negative value on a miss
+static float intersectRay(const glm::vec3 &origin, const glm::vec3 &invDir, const glm::vec3 &min,
+                          const glm::vec3 &max, float maxDistance)
+{
+    glm::vec3 t0 = (min - origin) * invDir;
+    glm::vec3 t1 = (max - origin) * invDir;
+    glm::vec3 tNear = glm::min(t0, t1);
+    glm::vec3 tFar = glm::max(t0, t1);
+    float enter = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.0f));
+    float exit = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, maxDistance));
+    return enter <= exit ? enter : -1.0f;
+}
+
+RayHit Bvh::raycast(const glm::vec3 &origin, const glm::vec3 &direction, float maxDistance) const
+{
+    RayHit hit;
+    hit.distance = maxDistance;
+    if (nodes_.empty())
+    {
+        return hit;
+    }
+
+    glm::vec3 invDir(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+
+    uint32_t stack[stackSize];
+    int top = 0;
+    stack[top++] = 0;
+
+    while (top > 0)
+    {
+        const Node &node = nodes_[stack[--top]];
+        float entry = intersectRay(origin, invDir, node.min, node.max, hit.distance);
+        if (entry < 0.0f)
+        {
+            continue;
+        }
+
+        if (node.count > 0)
+        {
+            for (uint32_t i = node.index; i < node.index + node.count; i++)
+            {
+                uint32_t id = objectIds_[i];
+                float t = intersectRay(origin, invDir, bounds_[id].min, bounds_[id].max, hit.distance);
+                if (t >= 0.0f && t < hit.distance)
+                {
+                    hit.distance = t;
+                    hit.object = id;
+                }
+            }
+            continue;
+        }
+
+        // push the far child first so the near one is popped and can shrink hit.distance early
+        const Node &left = nodes_[node.index];
+        const Node &right = nodes_[node.index + 1];
+        float leftEntry = intersectRay(origin, invDir, left.min, left.max, hit.distance);
+        float rightEntry = intersectRay(origin, invDir, right.min, right.max, hit.distance);
+        bool leftFirst = leftEntry >= 0.0f && (rightEntry < 0.0f || leftEntry <= rightEntry);
+        if (leftFirst)
+        {
+            if (rightEntry >= 0.0f)
+            {
+                stack[top++] = node.index + 1;
+            }
+            stack[top++] = node.index;
+        }
+        else if (rightEntry >= 0.0f)
+        {
+            if (leftEntry >= 0.0f)
+            {
+                stack[top++] = node.index;
+            }
+            stack[top++] = node.index + 1;
+        }
+    }
+
+    return hit;
+}
+
+static float distanceSquared(const glm::vec3 &point, const glm::vec3 &min, const glm::vec3 &max)
+{
+    glm::vec3 closest = glm::min(glm::max(point, min), max);
+    glm::vec3 d = point - closest;
+    return glm::dot(d, d);
+}
+
+uint32_t Bvh::nearest(const glm::vec3 &point, float *distance) const
+{
+    uint32_t best = 0xFFFFFFFFu;
+    float bestDistance = 1e30f;
+    if (nodes_.empty())
+    {
+        return best;
+    }
+
+    uint32_t stack[stackSize];
+    int top = 0;
+    stack[top++] = 0;
+
+    while (top > 0)
+    {
+        const Node &node = nodes_[stack[--top]];
+        // every center lies inside its node, so a node further away than the best hit can't beat it
+        if (distanceSquared(point, node.min, node.max) >= bestDistance)
+        {
+            continue;
+        }
+
+        if (node.count > 0)
+        {
+            for (uint32_t i = node.index; i < node.index + node.count; i++)
+            {
+                uint32_t id = objectIds_[i];
+                glm::vec3 d = centers_[id] - point;
+                float dist = glm::dot(d, d);
+                if (dist < bestDistance)
+                {
+                    bestDistance = dist;
+                    best = id;
+                }
+            }
+            continue;
+        }
+
+        const Node &left = nodes_[node.index];
+        const Node &right = nodes_[node.index + 1];
+        float leftDistance = distanceSquared(point, left.min, left.max);
+        float rightDistance = distanceSquared(point, right.min, right.max);
+        if (leftDistance < rightDistance)
+        {
+            stack[top++] = node.index + 1;
+            stack[top++] = node.index;
+        }
+        else
+        {
+            stack[top++] = node.index;
+            stack[top++] = node.index + 1;
+        }
+    }
+
+    if (distance)
+    {
+        *distance = std::sqrt(bestDistance);
+    }
+    return best;
+}
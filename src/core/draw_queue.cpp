@@ -0,0 +1,293 @@
+#include "draw_queue.h"
+#include "gl_state.h"
+#include "normal_matrix.h"
+
+#include <SDL3/SDL.h>
+
+#include <algorithm>
+#include <cstring>
+
+static constexpr uint64_t depthBits = 24;
+static constexpr uint64_t depthMax = (1ull << depthBits) - 1;
+
+static constexpr uint32_t noState = 0xFFFFFFFFu;
+
+// ids are masked to their key field in write(), one past it would draw with an earlier entry's state
+uint32_t DrawQueue::addShader(Shader *shader)
+{
+    SDL_assert_release(shaders_.size() < maxShaders);
+    ShaderEntry entry;
+    entry.shader = shader;
+    entry.model = shader->getUniform<glm::mat4>("model");
+    entry.normal = shader->getUniform<glm::mat3>("normalMatrix");
+    entry.shininess = shader->getUniform<float>("material.shininess");
+    entry.instanced = shader->getUniform<bool>("instanced");
+    entry.materialIndex = shader->getUniform<int>("materialIndex");
+    shaders_.push_back(entry);
+    return (uint32_t)shaders_.size() - 1;
+}
+
+uint32_t DrawQueue::addMaterial(const Material &material)
+{
+    SDL_assert_release(materials_.size() < maxMaterials);
+    materials_.push_back(material);
+    return (uint32_t)materials_.size() - 1;
+}
+
+uint32_t DrawQueue::addMesh(Mesh *mesh)
+{
+    SDL_assert_release(meshes_.size() < maxMeshes);
+    meshes_.push_back(mesh);
+    return (uint32_t)meshes_.size() - 1;
+}
+
+void DrawQueue::begin(float farPlane)
+{
+    farPlane_ = farPlane;
+    items_.clear();
+    models_.clear();
+    normals_.clear();
+}
+
+void DrawQueue::submit(uint32_t shader, uint32_t material, uint32_t mesh, const glm::mat4 &model, float depth,
+                       bool translucent)
+{
+    write(reserve(1), shader, material, mesh, model, normalmatrix::compute(model), depth, translucent);
+}
+
+size_t DrawQueue::reserve(size_t count)
+{
+    size_t first = items_.size();
+    items_.resize(first + count);
+    models_.resize(first + count);
+    normals_.resize(first + count);
+    return first;
+}
+
+void DrawQueue::write(size_t slot, uint32_t shader, uint32_t material, uint32_t mesh, const glm::mat4 &model,
+                      const glm::mat3 &normal, float depth, bool translucent)
+{
+    float normalised = std::min(std::max(depth / farPlane_, 0.0f), 1.0f);
+    uint64_t z = (uint64_t)(normalised * depthMax);
+
+    uint64_t key;
+    if (!translucent)
+    {
+        key = ((uint64_t)(shader & 0xFF) << 55) | ((uint64_t)(material & 0xFFFF) << 39) |
+              ((uint64_t)(mesh & 0xFFF) << 27) | (z << 3);
+    }
+    else
+    {
+        key = (1ull << 63) | ((depthMax - z) << 39) | ((uint64_t)(shader & 0xFF) << 31) |
+              ((uint64_t)(material & 0xFFFF) << 15) | ((uint64_t)(mesh & 0xFFF) << 3);
+    }
+
+    items_[slot] = {key, (uint32_t)slot};
+    // quantised meshes store positions relative to their bounds, fold the decode into the model matrix
+    const Mesh *target = meshes_[mesh];
+    models_[slot] = target->quantized() ? model * target->decodeTransform() : model;
+    normals_[slot] = normal;
+}
+
+// LSD radix sort, one byte per pass, passes where every key shares the same byte are skipped
+void DrawQueue::sort()
+{
+    size_t count = items_.size();
+    scratch_.resize(count);
+
+    size_t histograms[8][256];
+    std::memset(histograms, 0, sizeof(histograms));
+    for (const SortItem &item : items_)
+    {
+        for (int pass = 0; pass < 8; pass++)
+        {
+            histograms[pass][(item.key >> (pass * 8)) & 0xFF]++;
+        }
+    }
+
+    for (int pass = 0; pass < 8; pass++)
+    {
+        size_t *histogram = histograms[pass];
+        uint8_t firstByte = (items_[0].key >> (pass * 8)) & 0xFF;
+        if (histogram[firstByte] == count)
+        {
+            continue;
+        }
+
+        size_t offset = 0;
+        for (int bucket = 0; bucket < 256; bucket++)
+        {
+            size_t bucketCount = histogram[bucket];
+            histogram[bucket] = offset;
+            offset += bucketCount;
+        }
+
+        for (const SortItem &item : items_)
+        {
+            scratch_[histogram[(item.key >> (pass * 8)) & 0xFF]++] = item;
+        }
+        items_.swap(scratch_);
+    }
+}
+
+bool DrawQueue::sharesState(uint32_t material, uint32_t current) const
+{
+    if (material == current)
+    {
+        return true;
+    }
+    if (current == noState)
+    {
+        return false;
+    }
+    const MaterialArrays *arrays = materials_[material].arrays;
+    return arrays && arrays == materials_[current].arrays;
+}
+
+void DrawQueue::flush(bool positionsOnly)
+{
+    if (items_.empty())
+    {
+        return;
+    }
+
+    sort();
+
+    uint32_t currentShader = noState;
+    uint32_t currentMaterial = noState;
+    uint32_t currentMesh = noState;
+    bool blending = false;
+
+    // pooled draws accumulate here until the state changes or an unpooled draw comes up
+    GeometryPool *batch = nullptr;
+    auto submitBatch = [&]() {
+        if (!batch)
+        {
+            return;
+        }
+        const ShaderEntry &entry = shaders_[currentShader];
+        entry.shader->set(entry.instanced, true);
+        batch->submit(positionsOnly);
+        entry.shader->set(entry.instanced, false);
+        batch = nullptr;
+        // the batch bound the pool's VAO behind our back
+        currentMesh = noState;
+    };
+
+    for (const SortItem &item : items_)
+    {
+        bool translucent = item.key >> 63;
+        uint32_t shader, material, mesh;
+        if (!translucent)
+        {
+            shader = (item.key >> 55) & 0xFF;
+            material = (item.key >> 39) & 0xFFFF;
+            mesh = (item.key >> 27) & 0xFFF;
+        }
+        else
+        {
+            shader = (item.key >> 31) & 0xFF;
+            material = (item.key >> 15) & 0xFFFF;
+            mesh = (item.key >> 3) & 0xFFF;
+        }
+
+        // depth passes leave materials alone, so only the shader splits their runs
+        if ((translucent && !blending) || shader != currentShader ||
+            (!positionsOnly && !sharesState(material, currentMaterial)))
+        {
+            submitBatch();
+        }
+
+        if (translucent && !blending)
+        {
+            glstate::setBlend(true);
+            glstate::blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+            glstate::depthMask(false);
+            blending = true;
+        }
+
+        const ShaderEntry &shaderEntry = shaders_[shader];
+        if (shader != currentShader)
+        {
+            shaderEntry.shader->use();
+            currentShader = shader;
+            // material uniforms live in the program, so a new program needs them again
+            currentMaterial = noState;
+        }
+
+        if (material != currentMaterial && !positionsOnly)
+        {
+            const Material &mat = materials_[material];
+            if (mat.arrays)
+            {
+                // shininess is in the arrays' material block
+                if (!sharesState(material, currentMaterial))
+                {
+                    mat.arrays->bind();
+                }
+            }
+            else
+            {
+                mat.diffuse->use();
+                if (mat.specular != mat.diffuse)
+                {
+                    mat.specular->use();
+                }
+                if (shaderEntry.shininess.valid())
+                {
+                    shaderEntry.shader->set(shaderEntry.shininess, mat.shininess);
+                }
+            }
+            currentMaterial = material;
+        }
+        uint32_t materialIndex = positionsOnly ? 0 : materials_[material].index;
+
+        Mesh *target = meshes_[mesh];
+        if (target->pool() && shaderEntry.instanced.valid())
+        {
+            if (batch != target->pool())
+            {
+                submitBatch();
+                batch = target->pool();
+            }
+            batch->queue(target->poolId(), models_[item.index], normals_[item.index], materialIndex);
+            continue;
+        }
+        submitBatch();
+
+        if (mesh != currentMesh)
+        {
+            if (positionsOnly)
+            {
+                target->bindPositions();
+            }
+            else
+            {
+                target->bind();
+            }
+            currentMesh = mesh;
+        }
+
+        shaderEntry.shader->set(shaderEntry.model, models_[item.index]);
+        if (shaderEntry.normal.valid())
+        {
+            shaderEntry.shader->set(shaderEntry.normal, normals_[item.index]);
+        }
+        if (shaderEntry.materialIndex.valid())
+        {
+            shaderEntry.shader->set(shaderEntry.materialIndex, (int)materialIndex);
+        }
+        target->draw();
+    }
+    submitBatch();
+
+    if (blending)
+    {
+        glstate::setBlend(false);
+        glstate::depthMask(true);
+    }
+
+    items_.clear();
+    models_.clear();
+    normals_.clear();
+}
@@ -0,0 +1,94 @@
+#include "frame_arena.h"
+
+#include <new>
+
+// growing rounds up to this, so a frame that wants a few bytes more than the last doesn't reallocate again
+static constexpr size_t growGranularity = 64 << 10;
+
+static char *allocateBuffer(size_t capacity, size_t alignment)
+{
+    return static_cast<char *>(::operator new(capacity, std::align_val_t(alignment)));
+}
+
+static void freeBuffer(void *memory, size_t alignment)
+{
+    ::operator delete(memory, std::align_val_t(alignment));
+}
+
+FrameArena::FrameArena(size_t capacity)
+{
+    for (Buffer &buffer : buffers_)
+    {
+        buffer.capacity = capacity;
+        buffer.memory = allocateBuffer(capacity, bufferAlignment);
+    }
+}
+
+FrameArena::~FrameArena()
+{
+    for (Buffer &buffer : buffers_)
+    {
+        reset(buffer);
+        freeBuffer(buffer.memory, bufferAlignment);
+    }
+}
+
+void FrameArena::beginFrame()
+{
+    current_ ^= 1;
+    reset(buffers_[current_]);
+}
+
+void FrameArena::reset(Buffer &buffer)
+{
+    size_t wanted = buffer.offset.load(std::memory_order_relaxed);
+    if (!buffer.overflow.empty())
+    {
+        for (void *block : buffer.overflow)
+        {
+            freeBuffer(block, bufferAlignment);
+        }
+        buffer.overflow.clear();
+
+        freeBuffer(buffer.memory, bufferAlignment);
+        buffer.capacity = (wanted + growGranularity - 1) / growGranularity * growGranularity;
+        buffer.memory = allocateBuffer(buffer.capacity, bufferAlignment);
+    }
+    buffer.offset.store(0, std::memory_order_relaxed);
+}
+
+void *FrameArena::allocate(size_t bytes, size_t alignment)
+{
+    Buffer &buffer = buffers_[current_];
+    // reserve enough to align within, the base is aligned to bufferAlignment so smaller alignments waste nothing
+    size_t padding = alignment > bufferAlignment ? alignment - 1 : 0;
+    size_t size = (bytes + bufferAlignment - 1) / bufferAlignment * bufferAlignment + padding;
+    size_t offset = buffer.offset.fetch_add(size, std::memory_order_relaxed);
+    char *memory;
+    if (offset + size <= buffer.capacity)
+    {
+        memory = buffer.memory + offset;
+    }
+    else
+    {
+        std::lock_guard<std::mutex> lock(overflowMutex_);
+        if (buffer.overflow.empty())
+        {
+            overflows_++;
+        }
+        memory = allocateBuffer(size, bufferAlignment);
+        buffer.overflow.push_back(memory);
+    }
+    uintptr_t address = (uintptr_t)memory;
+    return (void *)((address + alignment - 1) & ~(uintptr_t)(alignment - 1));
+}
+
+size_t FrameArena::used() const
+{
+    return buffers_[current_].offset.load(std::memory_order_relaxed);
+}
+
+size_t FrameArena::capacity() const
+{
+    return buffers_[current_].capacity;
+}
@@ -0,0 +1,337 @@
+#include "frustum.h"
+
+#include <cmath>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+Frustum Frustum::fromMatrix(const glm::mat4 &m)
+{
+    // glm is column major, so row i of the matrix is (m[0][i], m[1][i], m[2][i], m[3][i])
+    glm::vec4 rows[4];
+    for (int i = 0; i < 4; i++)
+    {
+        rows[i] = glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]);
+    }
+
+    Frustum frustum;
+    frustum.planes[0] = rows[3] + rows[0]; // left
+    frustum.planes[1] = rows[3] - rows[0]; // right
+    frustum.planes[2] = rows[3] + rows[1]; // bottom
+    frustum.planes[3] = rows[3] - rows[1]; // top
+    frustum.planes[4] = rows[3] + rows[2]; // near
+    frustum.planes[5] = rows[3] - rows[2]; // far
+
+    for (glm::vec4 &plane : frustum.planes)
+    {
+        float length = glm::length(glm::vec3(plane));
+        plane = plane / length;
+    }
+    return frustum;
+}
+
+bool Frustum::intersectsAabb(const glm::vec3 &center, const glm::vec3 &extents) const
+{
+    for (const glm::vec4 &plane : planes)
+    {
+        glm::vec3 normal(plane);
+        float distance = glm::dot(normal, center) + plane.w;
+        float reach = glm::dot(glm::abs(normal), extents);
+        if (distance + reach < 0.0f)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Frustum::intersectsSphere(const glm::vec3 &center, float radius) const
+{
+    for (const glm::vec4 &plane : planes)
+    {
+        if (glm::dot(glm::vec3(plane), center) + plane.w < -radius)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void BoundsSoA::clear()
+{
+    for (std::vector<float> *component : {&centerX, &centerY, &centerZ, &extentX, &extentY, &extentZ, &radius})
+    {
+        component->clear();
+    }
+}
+
+void BoundsSoA::reserve(size_t count)
+{
+    for (std::vector<float> *component : {&centerX, &centerY, &centerZ, &extentX, &extentY, &extentZ, &radius})
+    {
+        component->reserve(count);
+    }
+}
+
+void BoundsSoA::push(const glm::vec3 &center, const glm::vec3 &extents)
+{
+    centerX.push_back(center.x);
+    centerY.push_back(center.y);
+    centerZ.push_back(center.z);
+    extentX.push_back(extents.x);
+    extentY.push_back(extents.y);
+    extentZ.push_back(extents.z);
+    radius.push_back(glm::length(extents));
+}
+
+void BoundsSoA::set(size_t index, const glm::vec3 &center, const glm::vec3 &extents)
+{
+    centerX[index] = center.x;
+    centerY[index] = center.y;
+    centerZ[index] = center.z;
+    extentX[index] = extents.x;
+    extentY[index] = extents.y;
+    extentZ[index] = extents.z;
+    radius[index] = glm::length(extents);
+}
+
+void BoundsSoA::swapRemove(size_t index)
+{
+    for (std::vector<float> *component : {&centerX, &centerY, &centerZ, &extentX, &extentY, &extentZ, &radius})
+    {
+        (*component)[index] = component->back();
+        component->pop_back();
+    }
+}
+
+static size_t cullAabbsRange(const Frustum &frustum, const BoundsSoA &bounds, size_t begin, size_t end,
+                             uint32_t *visible, size_t count)
+{
+    for (size_t i = begin; i < end; i++)
+    {
+        glm::vec3 center(bounds.centerX[i], bounds.centerY[i], bounds.centerZ[i]);
+        glm::vec3 extents(bounds.extentX[i], bounds.extentY[i], bounds.extentZ[i]);
+        if (frustum.intersectsAabb(center, extents))
+        {
+            visible[count++] = (uint32_t)i;
+        }
+    }
+    return count;
+}
+
+static size_t cullSpheresRange(const Frustum &frustum, const BoundsSoA &bounds, size_t begin, size_t end,
+                               uint32_t *visible, size_t count)
+{
+    for (size_t i = begin; i < end; i++)
+    {
+        glm::vec3 center(bounds.centerX[i], bounds.centerY[i], bounds.centerZ[i]);
+        if (frustum.intersectsSphere(center, bounds.radius[i]))
+        {
+            visible[count++] = (uint32_t)i;
+        }
+    }
+    return count;
+}
+
+static inline unsigned lowestSetBit(unsigned mask)
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return (unsigned)index;
+#else
+    return (unsigned)__builtin_ctz(mask);
+#endif
+}
+
+// append the indices of the set bits in mask, lane 0 is the lowest bit
+static inline size_t appendMask(unsigned mask, size_t base, uint32_t *visible, size_t count)
+{
+    while (mask)
+    {
+        unsigned lane = lowestSetBit(mask);
+        visible[count++] = (uint32_t)(base + lane);
+        mask &= mask - 1;
+    }
+    return count;
+}
+
+size_t culling::cullAabbsScalar(const Frustum &frustum, const BoundsSoA &bounds, uint32_t *visible)
+{
+    return cullAabbsRange(frustum, bounds, 0, bounds.size(), visible, 0);
+}
+
+size_t culling::cullAabbsSimd(const Frustum &frustum, const BoundsSoA &bounds, uint32_t *visible)
+{
+    return cullAabbsSimd(frustum, bounds, 0, bounds.size(), visible);
+}
+
+size_t culling::cullSpheresScalar(const Frustum &frustum, const BoundsSoA &bounds, uint32_t *visible)
+{
+    return cullSpheresRange(frustum, bounds, 0, bounds.size(), visible, 0);
+}
+
+#if defined(__AVX2__) && defined(__FMA__)
+
+const char *culling::simdPath()
+{
+    return "avx2";
+}
+
+size_t culling::cullAabbsSimd(const Frustum &frustum, const BoundsSoA &bounds, size_t begin, size_t end,
+                              uint32_t *visible)
+{
+    const size_t wide = begin + ((end - begin) & ~size_t(7));
+    const __m256 signMask = _mm256_set1_ps(-0.0f);
+    size_t count = 0;
+
+    for (size_t i = begin; i < wide; i += 8)
+    {
+        __m256 cx = _mm256_loadu_ps(&bounds.centerX[i]);
+        __m256 cy = _mm256_loadu_ps(&bounds.centerY[i]);
+        __m256 cz = _mm256_loadu_ps(&bounds.centerZ[i]);
+        __m256 ex = _mm256_loadu_ps(&bounds.extentX[i]);
+        __m256 ey = _mm256_loadu_ps(&bounds.extentY[i]);
+        __m256 ez = _mm256_loadu_ps(&bounds.extentZ[i]);
+
+        __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for (const glm::vec4 &plane : frustum.planes)
+        {
+            __m256 nx = _mm256_set1_ps(plane.x);
+            __m256 ny = _mm256_set1_ps(plane.y);
+            __m256 nz = _mm256_set1_ps(plane.z);
+
+            // distance + dot(|n|, extents) >= 0 means some part of the box is in front of the plane
+            __m256 distance = _mm256_fmadd_ps(nx, cx, _mm256_fmadd_ps(ny, cy, _mm256_fmadd_ps(nz, cz, _mm256_set1_ps(plane.w))));
+            __m256 reach = _mm256_fmadd_ps(_mm256_andnot_ps(signMask, nx), ex,
+                                           _mm256_fmadd_ps(_mm256_andnot_ps(signMask, ny), ey,
+                                                           _mm256_mul_ps(_mm256_andnot_ps(signMask, nz), ez)));
+            inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(distance, reach), _mm256_setzero_ps(), _CMP_GE_OQ));
+        }
+        count = appendMask((unsigned)_mm256_movemask_ps(inside), i, visible, count);
+    }
+
+    return cullAabbsRange(frustum, bounds, wide, end, visible, count);
+}
+
+size_t culling::cullSpheresSimd(const Frustum &frustum, const BoundsSoA &bounds, uint32_t *visible)
+{
+    const size_t total = bounds.size();
+    const size_t wide = total & ~size_t(7);
+    size_t count = 0;
+
+    for (size_t i = 0; i < wide; i += 8)
+    {
+        __m256 cx = _mm256_loadu_ps(&bounds.centerX[i]);
+        __m256 cy = _mm256_loadu_ps(&bounds.centerY[i]);
+        __m256 cz = _mm256_loadu_ps(&bounds.centerZ[i]);
+        __m256 negRadius = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(&bounds.radius[i]));
+
+        __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for (const glm::vec4 &plane : frustum.planes)
+        {
+            __m256 distance = _mm256_fmadd_ps(_mm256_set1_ps(plane.x), cx,
+                                              _mm256_fmadd_ps(_mm256_set1_ps(plane.y), cy,
+                                                              _mm256_fmadd_ps(_mm256_set1_ps(plane.z), cz,
+                                                                              _mm256_set1_ps(plane.w))));
+            inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, negRadius, _CMP_GE_OQ));
+        }
+        count = appendMask((unsigned)_mm256_movemask_ps(inside), i, visible, count);
+    }
+
+    return cullSpheresRange(frustum, bounds, wide, total, visible, count);
+}
+
+#elif defined(__SSE2__)
+
+const char *culling::simdPath()
+{
+    return "sse2";
+}
+
+size_t culling::cullAabbsSimd(const Frustum &frustum, const BoundsSoA &bounds, size_t begin, size_t end,
+                              uint32_t *visible)
+{
+    const size_t wide = begin + ((end - begin) & ~size_t(3));
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+    size_t count = 0;
+
+    for (size_t i = begin; i < wide; i += 4)
+    {
+        __m128 cx = _mm_loadu_ps(&bounds.centerX[i]);
+        __m128 cy = _mm_loadu_ps(&bounds.centerY[i]);
+        __m128 cz = _mm_loadu_ps(&bounds.centerZ[i]);
+        __m128 ex = _mm_loadu_ps(&bounds.extentX[i]);
+        __m128 ey = _mm_loadu_ps(&bounds.extentY[i]);
+        __m128 ez = _mm_loadu_ps(&bounds.extentZ[i]);
+
+        __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for (const glm::vec4 &plane : frustum.planes)
+        {
+            __m128 nx = _mm_set1_ps(plane.x);
+            __m128 ny = _mm_set1_ps(plane.y);
+            __m128 nz = _mm_set1_ps(plane.z);
+
+            __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, cx), _mm_mul_ps(ny, cy)),
+                                         _mm_add_ps(_mm_mul_ps(nz, cz), _mm_set1_ps(plane.w)));
+            __m128 reach = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_andnot_ps(signMask, nx), ex),
+                                                 _mm_mul_ps(_mm_andnot_ps(signMask, ny), ey)),
+                                      _mm_mul_ps(_mm_andnot_ps(signMask, nz), ez));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(distance, reach), _mm_setzero_ps()));
+        }
+        count = appendMask((unsigned)_mm_movemask_ps(inside), i, visible, count);
+    }
+
+    return cullAabbsRange(frustum, bounds, wide, end, visible, count);
+}
+
+size_t culling::cullSpheresSimd(const Frustum &frustum, const BoundsSoA &bounds, uint32_t *visible)
+{
+    const size_t total = bounds.size();
+    const size_t wide = total & ~size_t(3);
+    size_t count = 0;
+
+    for (size_t i = 0; i < wide; i += 4)
+    {
+        __m128 cx = _mm_loadu_ps(&bounds.centerX[i]);
+        __m128 cy = _mm_loadu_ps(&bounds.centerY[i]);
+        __m128 cz = _mm_loadu_ps(&bounds.centerZ[i]);
+        __m128 negRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(&bounds.radius[i]));
+
+        __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for (const glm::vec4 &plane : frustum.planes)
+        {
+            __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.x), cx), _mm_mul_ps(_mm_set1_ps(plane.y), cy)),
+                                         _mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.z), cz), _mm_set1_ps(plane.w)));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negRadius));
+        }
+        count = appendMask((unsigned)_mm_movemask_ps(inside), i, visible, count);
+    }
+
+    return cullSpheresRange(frustum, bounds, wide, total, visible, count);
+}
+
+#else
+
+const char *culling::simdPath()
+{
+    return "scalar";
+}
+
+size_t culling::cullAabbsSimd(const Frustum &frustum, const BoundsSoA &bounds, size_t begin, size_t end,
+                              uint32_t *visible)
+{
+    return cullAabbsRange(frustum, bounds, begin, end, visible, 0);
+}
+
+size_t culling::cullSpheresSimd(const Frustum &frustum, const BoundsSoA &bounds, uint32_t *visible)
+{
+    return cullSpheresScalar(frustum, bounds, visible);
+}
+
+#endif
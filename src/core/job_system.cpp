@@ -0,0 +1,355 @@
+#include "job_system.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#endif
+
+// which system and slot the current thread belongs to, anything unregistered is thread 0
+static thread_local const JobSystem *currentSystem = nullptr;
+static thread_local unsigned currentIndex = 0;
+
+// failed steal rounds before a worker goes to sleep
+static constexpr int idleSpins = 64;
+
+static inline void cpuRelax()
+{
+#if defined(__SSE2__) || defined(_M_X64)
+    _mm_pause();
+#else
+    std::this_thread::yield();
+#endif
+}
+
+bool WorkStealingDeque::push(Job *job)
+{
+    int64_t bottom = bottom_.load(std::memory_order_relaxed);
+    int64_t top = top_.load(std::memory_order_acquire);
+    if (bottom - top >= capacity)
+    {
+        return false;
+    }
+    slots_[bottom & (capacity - 1)].store(job, std::memory_order_relaxed);
+    // publishes the job's contents to thieves, they load bottom_ with acquire
+    bottom_.store(bottom + 1, std::memory_order_release);
+    return true;
+}
+
+Job *WorkStealingDeque::pop()
+{
+    int64_t bottom = bottom_.load(std::memory_order_relaxed) - 1;
+    bottom_.store(bottom, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t top = top_.load(std::memory_order_relaxed);
+
+    if (top > bottom)
+    {
+        // empty, undo the reservation
+        bottom_.store(bottom + 1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    Job *job = slots_[bottom & (capacity - 1)].load(std::memory_order_relaxed);
+    if (top == bottom)
+    {
+        // last job, race any thief for it through top
+        if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+        {
+            job = nullptr;
+        }
+        bottom_.store(bottom + 1, std::memory_order_relaxed);
+    }
+    return job;
+}
+
+Job *WorkStealingDeque::steal()
+{
+    int64_t top = top_.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t bottom = bottom_.load(std::memory_order_acquire);
+    if (top >= bottom)
+    {
+        return nullptr;
+    }
+
+    Job *job = slots_[top & (capacity - 1)].load(std::memory_order_relaxed);
+    if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+    {
+        // lost to the owner or another thief
+        return nullptr;
+    }
+    return job;
+}
+
+JobSystem::JobSystem(unsigned threadCount)
+{
+    if (threadCount == 0)
+    {
+        threadCount = std::thread::hardware_concurrency();
+    }
+    threadCount = threadCount > 0 ? threadCount : 1;
+
+    for (unsigned i = 0; i < threadCount; i++)
+    {
+        ThreadState *state = new ThreadState();
+        state->rng = 0x9E3779B9u * (i + 1);
+        threads_.push_back(state);
+    }
+    for (unsigned i = 1; i < threadCount; i++)
+    {
+        workers_.emplace_back(&JobSystem::workerLoop, this, i);
+    }
+}
+
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    for (std::thread &worker : workers_)
+    {
+        worker.join();
+    }
+    for (ThreadState *state : threads_)
+    {
+        delete state;
+    }
+}
+
+unsigned JobSystem::currentThread() const
+{
+    return currentSystem == this ? currentIndex : 0;
+}
+
+Job *JobSystem::allocate(unsigned thread)
+{
+    ThreadState *state = threads_[thread];
+    Job *job = &state->jobs[state->nextJob];
+    state->nextJob = (state->nextJob + 1) % jobRingSize;
+    // only this thread allocates from its ring, acquire pairs with the release of whoever ran the last job here
+    if (job->live.load(std::memory_order_acquire))
+    {
+        job = new Job();
+        job->heap = true;
+    }
+    job->live.store(true, std::memory_order_relaxed);
+    return job;
+}
+
+void JobSystem::release(Job *job)
+{
+    if (job->heap)
+    {
+        delete job;
+        return;
+    }
+    job->live.store(false, std::memory_order_release);
+}
+
+void JobSystem::run(JobFunction function, void *context, JobCounter &counter, JobCounter *dependency)
+{
+    counter.pending_.fetch_add(1, std::memory_order_relaxed);
+    Job *job = allocate(currentThread());
+    job->function = function;
+    job->context = context;
+    job->begin = 0;
+    job->end = 1;
+    job->grain = 1;
+    job->counter = &counter;
+    job->next = nullptr;
+    schedule(job, dependency);
+}
+
+void JobSystem::parallelFor(size_t count, size_t grain, JobFunction function, void *context, JobCounter &counter,
+                            JobCounter *dependency)
+{
+    if (count == 0)
+    {
+        return;
+    }
+    counter.pending_.fetch_add(1, std::memory_order_relaxed);
+    Job *job = allocate(currentThread());
+    job->function = function;
+    job->context = context;
+    job->begin = 0;
+    job->end = count;
+    job->grain = grain > 0 ? grain : 1;
+    job->counter = &counter;
+    job->next = nullptr;
+    schedule(job, dependency);
+}
+
+void JobSystem::schedule(Job *job, JobCounter *dependency)
+{
+    if (dependency)
+    {
+        // parked on the dependency unless it finished already, finish() releases it otherwise
+        std::lock_guard<std::mutex> lock(dependency->mutex_);
+        if (!dependency->done())
+        {
+            job->next = dependency->waiting_;
+            dependency->waiting_ = job;
+            return;
+        }
+    }
+    submit(currentThread(), job);
+}
+
+void JobSystem::submit(unsigned thread, Job *job)
+{
+    if (!threads_[thread]->deque.push(job))
+    {
+        execute(thread, job);
+        return;
+    }
+
+    queued_.fetch_add(1, std::memory_order_seq_cst);
+    if (sleeping_.load(std::memory_order_seq_cst) > 0)
+    {
+        // taking the lock orders this notify after a sleeper's check of queued_
+        std::lock_guard<std::mutex> lock(sleepMutex_);
+        wake_.notify_one();
+    }
+}
+
+Job *JobSystem::findJob(unsigned thread)
+{
+    ThreadState *self = threads_[thread];
+    Job *job = self->deque.pop();
+    if (!job && threads_.size() > 1)
+    {
+        // xorshift for the first victim, then try everyone else once
+        uint32_t x = self->rng;
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        self->rng = x;
+
+        size_t count = threads_.size();
+        size_t start = x % count;
+        for (size_t i = 0; i < count && !job; i++)
+        {
+            size_t victim = (start + i) % count;
+            if (victim != thread)
+            {
+                job = threads_[victim]->deque.steal();
+            }
+        }
+    }
+    if (job)
+    {
+        queued_.fetch_sub(1, std::memory_order_relaxed);
+    }
+    return job;
+}
+
+void JobSystem::execute(unsigned thread, Job *job)
+{
+    // split off the upper half for others to steal until the rest is small enough to run here
+    while (job->end - job->begin > job->grain)
+    {
+        size_t middle = job->begin + (job->end - job->begin) / 2;
+        Job *upper = allocate(thread);
+        upper->function = job->function;
+        upper->context = job->context;
+        upper->begin = middle;
+        upper->end = job->end;
+        upper->grain = job->grain;
+        upper->counter = job->counter;
+        upper->next = nullptr;
+        job->end = middle;
+        job->counter->pending_.fetch_add(1, std::memory_order_relaxed);
+        submit(thread, upper);
+    }
+
+    job->function(job->context, job->begin, job->end);
+    JobCounter *counter = job->counter;
+    release(job);
+    finish(counter);
+}
+
+void JobSystem::finish(JobCounter *counter)
+{
+    uint32_t pending = counter->pending_.load(std::memory_order_relaxed);
+    while (pending > 1)
+    {
+        if (counter->pending_.compare_exchange_weak(pending, pending - 1, std::memory_order_acq_rel))
+        {
+            return;
+        }
+    }
+
+    // the last job drops the count under the lock, so schedule() can't park a job after the waiters
+    // were taken, and wait() can't return while this thread still holds the counter's mutex
+    Job *released = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(counter->mutex_);
+        if (counter->pending_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            released = counter->waiting_;
+            counter->waiting_ = nullptr;
+        }
+    }
+    unsigned thread = currentThread();
+    while (released)
+    {
+        // submitting may run the job right here and reuse it, read next first
+        Job *job = released;
+        released = job->next;
+        submit(thread, job);
+    }
+}
+
+void JobSystem::wait(JobCounter &counter)
+{
+    unsigned thread = currentThread();
+    while (!counter.done())
+    {
+        Job *job = findJob(thread);
+        if (job)
+        {
+            execute(thread, job);
+        }
+        else
+        {
+            cpuRelax();
+        }
+    }
+    // the thread that finished the last job may still be releasing dependents under the lock
+    std::lock_guard<std::mutex> lock(counter.mutex_);
+}
+
+void JobSystem::workerLoop(unsigned index)
+{
+    currentSystem = this;
+    currentIndex = index;
+
+    int idle = 0;
+    for (;;)
+    {
+        Job *job = findJob(index);
+        if (job)
+        {
+            execute(index, job);
+            idle = 0;
+            continue;
+        }
+
+        if (++idle < idleSpins)
+        {
+            cpuRelax();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleepMutex_);
+        sleeping_.fetch_add(1, std::memory_order_seq_cst);
+        wake_.wait(lock, [this] { return stopping_ || queued_.load(std::memory_order_seq_cst) > 0; });
+        sleeping_.fetch_sub(1, std::memory_order_relaxed);
+        if (stopping_)
+        {
+            return;
+        }
+        idle = 0;
+    }
+}
@@ -0,0 +1,372 @@
+#include "light_grid.h"
+#include "job_system.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__AVX2__) && defined(__FMA__)
+#include <immintrin.h>
+#endif
+
+// lights per job in the bounding step, a multiple of the SIMD width
+static constexpr size_t lightGrain = 512;
+
+static constexpr uint32_t tilesPerSlice = LightGrid::tilesX * LightGrid::tilesY;
+
+void PointLights::clear()
+{
+    for (std::vector<float> *component : {&positionX, &positionY, &positionZ, &radius, &colorR, &colorG, &colorB})
+    {
+        component->clear();
+    }
+}
+
+void PointLights::reserve(size_t count)
+{
+    for (std::vector<float> *component : {&positionX, &positionY, &positionZ, &radius, &colorR, &colorG, &colorB})
+    {
+        component->reserve(count);
+    }
+}
+
+void PointLights::push(const glm::vec3 &position, float lightRadius, const glm::vec3 &color)
+{
+    positionX.push_back(position.x);
+    positionY.push_back(position.y);
+    positionZ.push_back(position.z);
+    radius.push_back(lightRadius);
+    colorR.push_back(color.x);
+    colorG.push_back(color.y);
+    colorB.push_back(color.z);
+}
+
+void LightGrid::assign(const PointLights &lights, const glm::mat4 &view, const glm::mat4 &projection,
+                       float nearPlane, float farPlane, JobSystem *jobs)
+{
+    lights_ = &lights;
+    lightCount_ = std::min(lights.size(), maxLights);
+    view_ = view;
+    projectionX_ = projection[0][0];
+    projectionY_ = projection[1][1];
+    near_ = nearPlane;
+    far_ = farPlane;
+
+    // slice k starts at near * (far / near)^(k / slices), so every slice is the same ratio deeper than the last
+    float logRatio = std::log(far_ / near_);
+    sliceScale_ = depthSlices / logRatio;
+    sliceBias_ = -sliceScale_ * std::log(near_);
+    for (uint32_t k = 0; k <= depthSlices; k++)
+    {
+        sliceDepths_[k] = near_ * std::pow(far_ / near_, (float)k / depthSlices);
+    }
+
+    for (std::vector<float> *component : {&viewX_, &viewY_, &viewZ_})
+    {
+        component->resize(lightCount_);
+    }
+    for (std::vector<int32_t> *range : {&minX_, &maxX_, &minY_, &maxY_, &minZ_, &maxZ_})
+    {
+        range->resize(lightCount_);
+    }
+
+    auto bound = [this](size_t begin, size_t end) { boundLights(begin, end); };
+    auto bin = [this](size_t begin, size_t end) {
+        for (size_t s = begin; s < end; s++)
+        {
+            binSlice((uint32_t)s);
+        }
+    };
+    auto write = [this](size_t begin, size_t end) {
+        for (size_t s = begin; s < end; s++)
+        {
+            writeSlice((uint32_t)s);
+        }
+    };
+
+    if (jobs)
+    {
+        jobs->parallelFor(lightCount_, lightGrain, bound);
+        jobs->parallelFor(depthSlices, 1, bin);
+    }
+    else
+    {
+        bound(0, lightCount_);
+        bin(0, depthSlices);
+    }
+
+    size_t total = 0;
+    for (Slice &slice : slices_)
+    {
+        slice.first = total;
+        total += slice.pairs.size();
+    }
+    clusters_.resize(clusterCount * 2);
+    indices_.resize(total);
+
+    if (jobs)
+    {
+        jobs->parallelFor(depthSlices, 1, write);
+    }
+    else
+    {
+        write(0, depthSlices);
+    }
+}
+
+uint32_t LightGrid::maxClusterLights() const
+{
+    uint32_t most = 0;
+    for (size_t i = 1; i < clusters_.size(); i += 2)
+    {
+        most = std::max(most, clusters_[i]);
+    }
+    return most;
+}
+
+void LightGrid::boundLightsScalar(size_t begin, size_t end)
+{
+    const glm::mat4 &v = view_;
+    for (size_t i = begin; i < end; i++)
+    {
+        glm::vec4 world(lights_->positionX[i], lights_->positionY[i], lights_->positionZ[i], 1.0f);
+        glm::vec3 center(v * world);
+        float r = lights_->radius[i];
+        viewX_[i] = center.x;
+        viewY_[i] = center.y;
+        viewZ_[i] = center.z;
+
+        // the camera looks down -z, depth grows away from it
+        float minDepth = -center.z - r;
+        float maxDepth = -center.z + r;
+        bool visible = maxDepth >= near_ && minDepth <= far_;
+
+        // x / depth is smallest for the sphere's low edge at one end of its depth range and largest for its high
+        // edge at one end, only the part past the near plane can be seen so the range starts there
+        float invNear = 1.0f / std::max(minDepth, near_);
+        float invFar = 1.0f / std::max(maxDepth, near_);
+        float ndcMinX = std::min((center.x - r) * invNear, (center.x - r) * invFar) * projectionX_;
+        float ndcMaxX = std::max((center.x + r) * invNear, (center.x + r) * invFar) * projectionX_;
+        float ndcMinY = std::min((center.y - r) * invNear, (center.y - r) * invFar) * projectionY_;
+        float ndcMaxY = std::max((center.y + r) * invNear, (center.y + r) * invFar) * projectionY_;
+        visible = visible && ndcMaxX >= -1.0f && ndcMinX <= 1.0f && ndcMaxY >= -1.0f && ndcMinY <= 1.0f;
+        if (!visible)
+        {
+            minX_[i] = maxX_[i] = minY_[i] = maxY_[i] = 0;
+            minZ_[i] = depthSlices;
+            maxZ_[i] = 0;
+            continue;
+        }
+
+        auto tile = [](float ndc, uint32_t tiles) {
+            float t = std::floor((ndc * 0.5f + 0.5f) * tiles);
+            return (int32_t)std::max(std::min(t, (float)(tiles - 1)), 0.0f);
+        };
+        minX_[i] = tile(ndcMinX, tilesX);
+        maxX_[i] = tile(ndcMaxX, tilesX);
+        minY_[i] = tile(ndcMinY, tilesY);
+        maxY_[i] = tile(ndcMaxY, tilesY);
+
+        // slice = how many inner slice boundaries lie at or in front of the depth
+        int32_t minZ = 0, maxZ = 0;
+        for (uint32_t k = 1; k < depthSlices; k++)
+        {
+            minZ += sliceDepths_[k] <= minDepth;
+            maxZ += sliceDepths_[k] <= maxDepth;
+        }
+        minZ_[i] = minZ;
+        maxZ_[i] = maxZ;
+    }
+}
+
+#if defined(__AVX2__) && defined(__FMA__)
+
+const char *LightGrid::simdPath()
+{
+    return "avx2";
+}
+
+void LightGrid::boundLights(size_t begin, size_t end)
+{
+    const size_t wide = begin + ((end - begin) & ~size_t(7));
+    const glm::mat4 &v = view_;
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 half = _mm256_set1_ps(0.5f);
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 minusOne = _mm256_set1_ps(-1.0f);
+    const __m256 nearPlane = _mm256_set1_ps(near_);
+    const __m256 farPlane = _mm256_set1_ps(far_);
+    const __m256 projX = _mm256_set1_ps(projectionX_);
+    const __m256 projY = _mm256_set1_ps(projectionY_);
+    const __m256 countX = _mm256_set1_ps((float)tilesX);
+    const __m256 countY = _mm256_set1_ps((float)tilesY);
+    const __m256 lastX = _mm256_set1_ps((float)(tilesX - 1));
+    const __m256 lastY = _mm256_set1_ps((float)(tilesY - 1));
+
+    for (size_t i = begin; i < wide; i += 8)
+    {
+        __m256 px = _mm256_loadu_ps(&lights_->positionX[i]);
+        __m256 py = _mm256_loadu_ps(&lights_->positionY[i]);
+        __m256 pz = _mm256_loadu_ps(&lights_->positionZ[i]);
+        __m256 r = _mm256_loadu_ps(&lights_->radius[i]);
+
+        __m256 cx = _mm256_fmadd_ps(_mm256_set1_ps(v[0][0]), px,
+                                    _mm256_fmadd_ps(_mm256_set1_ps(v[1][0]), py,
+                                                    _mm256_fmadd_ps(_mm256_set1_ps(v[2][0]), pz, _mm256_set1_ps(v[3][0]))));
+        __m256 cy = _mm256_fmadd_ps(_mm256_set1_ps(v[0][1]), px,
+                                    _mm256_fmadd_ps(_mm256_set1_ps(v[1][1]), py,
+                                                    _mm256_fmadd_ps(_mm256_set1_ps(v[2][1]), pz, _mm256_set1_ps(v[3][1]))));
+        __m256 cz = _mm256_fmadd_ps(_mm256_set1_ps(v[0][2]), px,
+                                    _mm256_fmadd_ps(_mm256_set1_ps(v[1][2]), py,
+                                                    _mm256_fmadd_ps(_mm256_set1_ps(v[2][2]), pz, _mm256_set1_ps(v[3][2]))));
+        _mm256_storeu_ps(&viewX_[i], cx);
+        _mm256_storeu_ps(&viewY_[i], cy);
+        _mm256_storeu_ps(&viewZ_[i], cz);
+
+        __m256 minDepth = _mm256_sub_ps(_mm256_sub_ps(zero, cz), r);
+        __m256 maxDepth = _mm256_add_ps(_mm256_sub_ps(zero, cz), r);
+        __m256 visible = _mm256_and_ps(_mm256_cmp_ps(maxDepth, nearPlane, _CMP_GE_OQ),
+                                       _mm256_cmp_ps(minDepth, farPlane, _CMP_LE_OQ));
+
+        // same bounds as boundLightsScalar()
+        __m256 invNear = _mm256_div_ps(one, _mm256_max_ps(minDepth, nearPlane));
+        __m256 invFar = _mm256_div_ps(one, _mm256_max_ps(maxDepth, nearPlane));
+        __m256 lowX = _mm256_sub_ps(cx, r), highX = _mm256_add_ps(cx, r);
+        __m256 lowY = _mm256_sub_ps(cy, r), highY = _mm256_add_ps(cy, r);
+        __m256 ndcMinX = _mm256_mul_ps(_mm256_min_ps(_mm256_mul_ps(lowX, invNear), _mm256_mul_ps(lowX, invFar)), projX);
+        __m256 ndcMaxX = _mm256_mul_ps(_mm256_max_ps(_mm256_mul_ps(highX, invNear), _mm256_mul_ps(highX, invFar)), projX);
+        __m256 ndcMinY = _mm256_mul_ps(_mm256_min_ps(_mm256_mul_ps(lowY, invNear), _mm256_mul_ps(lowY, invFar)), projY);
+        __m256 ndcMaxY = _mm256_mul_ps(_mm256_max_ps(_mm256_mul_ps(highY, invNear), _mm256_mul_ps(highY, invFar)), projY);
+        visible = _mm256_and_ps(visible, _mm256_and_ps(_mm256_cmp_ps(ndcMaxX, minusOne, _CMP_GE_OQ),
+                                                       _mm256_cmp_ps(ndcMinX, one, _CMP_LE_OQ)));
+        visible = _mm256_and_ps(visible, _mm256_and_ps(_mm256_cmp_ps(ndcMaxY, minusOne, _CMP_GE_OQ),
+                                                       _mm256_cmp_ps(ndcMinY, one, _CMP_LE_OQ)));
+
+        // min before max, so a NaN from a light that is out of view anyway still lands in range
+        auto tile = [&](__m256 ndc, __m256 count, __m256 last) {
+            __m256 t = _mm256_floor_ps(_mm256_mul_ps(_mm256_fmadd_ps(ndc, half, half), count));
+            return _mm256_cvttps_epi32(_mm256_max_ps(_mm256_min_ps(t, last), zero));
+        };
+        __m256i invisible = _mm256_xor_si256(_mm256_castps_si256(visible), _mm256_set1_epi32(-1));
+        __m256i none = _mm256_setzero_si256();
+        _mm256_storeu_si256((__m256i *)&minX_[i], _mm256_blendv_epi8(tile(ndcMinX, countX, lastX), none, invisible));
+        _mm256_storeu_si256((__m256i *)&maxX_[i], _mm256_blendv_epi8(tile(ndcMaxX, countX, lastX), none, invisible));
+        _mm256_storeu_si256((__m256i *)&minY_[i], _mm256_blendv_epi8(tile(ndcMinY, countY, lastY), none, invisible));
+        _mm256_storeu_si256((__m256i *)&maxY_[i], _mm256_blendv_epi8(tile(ndcMaxY, countY, lastY), none, invisible));
+
+        // a passed boundary compares as -1, subtracting the masks counts them
+        __m256i minZ = _mm256_setzero_si256();
+        __m256i maxZ = _mm256_setzero_si256();
+        for (uint32_t k = 1; k < depthSlices; k++)
+        {
+            __m256 boundary = _mm256_set1_ps(sliceDepths_[k]);
+            minZ = _mm256_sub_epi32(minZ, _mm256_castps_si256(_mm256_cmp_ps(boundary, minDepth, _CMP_LE_OQ)));
+            maxZ = _mm256_sub_epi32(maxZ, _mm256_castps_si256(_mm256_cmp_ps(boundary, maxDepth, _CMP_LE_OQ)));
+        }
+        _mm256_storeu_si256((__m256i *)&minZ_[i], _mm256_blendv_epi8(minZ, _mm256_set1_epi32(depthSlices), invisible));
+        _mm256_storeu_si256((__m256i *)&maxZ_[i], _mm256_blendv_epi8(maxZ, none, invisible));
+    }
+
+    boundLightsScalar(wide, end);
+}
+
+#else
+
+const char *LightGrid::simdPath()
+{
+    return "scalar";
+}
+
+void LightGrid::boundLights(size_t begin, size_t end)
+{
+    boundLightsScalar(begin, end);
+}
+
+#endif
+
+// signed distance from value to the interval [low, high], zero inside it. only ever squared, and clamping
+// compiles to min/max where the max-with-zero form ends up as a data dependent branch
+static inline float outside(float value, float low, float high)
+{
+    return value - std::min(std::max(value, low), high);
+}
+
+void LightGrid::binSlice(uint32_t z)
+{
+    Slice &slice = slices_[z];
+    slice.pairs.clear();
+    std::memset(slice.counts, 0, sizeof(slice.counts));
+
+    // view space box of every cluster in this slice, x only depends on the column and y only on the row
+    float nearDepth = sliceDepths_[z];
+    float farDepth = sliceDepths_[z + 1];
+    float boxMinX[tilesX], boxMaxX[tilesX];
+    float boxMinY[tilesY], boxMaxY[tilesY];
+    for (uint32_t x = 0; x < tilesX; x++)
+    {
+        float left = 2.0f * x / tilesX - 1.0f;
+        float right = 2.0f * (x + 1) / tilesX - 1.0f;
+        boxMinX[x] = std::min(left * nearDepth, left * farDepth) / projectionX_;
+        boxMaxX[x] = std::max(right * nearDepth, right * farDepth) / projectionX_;
+    }
+    for (uint32_t y = 0; y < tilesY; y++)
+    {
+        float bottom = 2.0f * y / tilesY - 1.0f;
+        float top = 2.0f * (y + 1) / tilesY - 1.0f;
+        boxMinY[y] = std::min(bottom * nearDepth, bottom * farDepth) / projectionY_;
+        boxMaxY[y] = std::max(top * nearDepth, top * farDepth) / projectionY_;
+    }
+
+    for (size_t i = 0; i < lightCount_; i++)
+    {
+        if (minZ_[i] > (int32_t)z || maxZ_[i] < (int32_t)z)
+        {
+            continue;
+        }
+
+        float r = lights_->radius[i];
+        float radiusSq = r * r;
+        float dz = outside(viewZ_[i], -farDepth, -nearDepth);
+        float distanceZ = dz * dz;
+        for (int32_t y = minY_[i]; y <= maxY_[i]; y++)
+        {
+            float dy = outside(viewY_[i], boxMinY[y], boxMaxY[y]);
+            float distanceYZ = distanceZ + dy * dy;
+            if (distanceYZ > radiusSq)
+            {
+                continue;
+            }
+            for (int32_t x = minX_[i]; x <= maxX_[i]; x++)
+            {
+                float dx = outside(viewX_[i], boxMinX[x], boxMaxX[x]);
+                if (distanceYZ + dx * dx <= radiusSq)
+                {
+                    uint32_t tile = (uint32_t)y * tilesX + (uint32_t)x;
+                    slice.pairs.push_back((tile << 16) | (uint32_t)i);
+                    slice.counts[tile]++;
+                }
+            }
+        }
+    }
+}
+
+void LightGrid::writeSlice(uint32_t z)
+{
+    const Slice &slice = slices_[z];
+    uint32_t *clusters = clusters_.data() + (size_t)z * tilesPerSlice * 2;
+    uint32_t cursor[tilesPerSlice];
+    uint32_t offset = (uint32_t)slice.first;
+    for (uint32_t tile = 0; tile < tilesPerSlice; tile++)
+    {
+        clusters[tile * 2] = offset;
+        clusters[tile * 2 + 1] = slice.counts[tile];
+        cursor[tile] = offset;
+        offset += slice.counts[tile];
+    }
+
+    // pairs are in light order, so each cluster's list comes out sorted whichever thread binned it
+    for (uint32_t pair : slice.pairs)
+    {
+        indices_[cursor[pair >> 16]++] = (uint16_t)(pair & 0xFFFF);
+    }
+}
@@ -0,0 +1,42 @@
+#include "lod.h"
+
+#include <algorithm>
+#include <cmath>
+
+// closer than this an object is treated as this close, so one the camera is inside gets the finest level
+static constexpr float minDistance = 1e-3f;
+
+void LodSelector::setProjection(float fovY, int viewportHeight)
+{
+    float halfFov = fovY * 0.5f * 3.14159265358979f / 180.0f;
+    pixelsPerUnit_ = viewportHeight / (2.0f * std::tan(halfFov));
+}
+
+float LodSelector::projectedError(float error, float distance, float scale) const
+{
+    return error * scale * pixelsPerUnit_ / std::max(distance, minDistance);
+}
+
+uint32_t LodSelector::select(const float *errors, uint32_t count, uint32_t current, float distance, float scale) const
+{
+    if (count == 0)
+    {
+        return 0;
+    }
+
+    uint32_t level = std::min(current, count - 1);
+    // finer while the current level shows, then coarser while the next one is comfortably under the threshold
+    while (level > 0 && projectedError(errors[level], distance, scale) > threshold)
+    {
+        level--;
+    }
+    if (level == std::min(current, count - 1))
+    {
+        float coarser = threshold * (1.0f - hysteresis);
+        while (level + 1 < count && projectedError(errors[level + 1], distance, scale) <= coarser)
+        {
+            level++;
+        }
+    }
+    return level;
+}
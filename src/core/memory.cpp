@@ -0,0 +1,121 @@
+#include "memory.h"
+
+#include <atomic>
+#include <cstdlib>
+#if defined(_WIN32)
+#include <malloc.h>
+#endif
+#include <new>
+
+static std::atomic<uint64_t> allocations{0};
+static std::atomic<uint64_t> bytes{0};
+static std::atomic<uint64_t> frees{0};
+
+uint64_t memory::allocationCount()
+{
+    return allocations.load(std::memory_order_relaxed);
+}
+
+uint64_t memory::allocatedBytes()
+{
+    return bytes.load(std::memory_order_relaxed);
+}
+
+uint64_t memory::freeCount()
+{
+    return frees.load(std::memory_order_relaxed);
+}
+
+// the nothrow forms forward to these by default. array and sized forms do too in the standard library, but not
+// under every sanitizer or runtime, so they are spelled out below
+void *operator new(std::size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    bytes.fetch_add(size, std::memory_order_relaxed);
+    void *p = std::malloc(size ? size : 1);
+    if (!p)
+    {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    bytes.fetch_add(size, std::memory_order_relaxed);
+    size_t align = (size_t)alignment;
+#if defined(_WIN32)
+    void *p = _aligned_malloc(size ? size : 1, align);
+#else
+    // aligned_alloc wants the size to be a multiple of the alignment
+    void *p = std::aligned_alloc(align, (size + align - 1) / align * align);
+#endif
+    if (!p)
+    {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void *p) noexcept
+{
+    if (p)
+    {
+        frees.fetch_add(1, std::memory_order_relaxed);
+        std::free(p);
+    }
+}
+
+void operator delete(void *p, std::align_val_t) noexcept
+{
+    if (p)
+    {
+        frees.fetch_add(1, std::memory_order_relaxed);
+#if defined(_WIN32)
+        _aligned_free(p);
+#else
+        std::free(p);
+#endif
+    }
+}
+
+void *operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void *operator new[](std::size_t size, std::align_val_t alignment)
+{
+    return operator new(size, alignment);
+}
+
+void operator delete[](void *p) noexcept
+{
+    operator delete(p);
+}
+
+void operator delete[](void *p, std::align_val_t alignment) noexcept
+{
+    operator delete(p, alignment);
+}
+
+void operator delete(void *p, std::size_t) noexcept
+{
+    operator delete(p);
+}
+
+void operator delete(void *p, std::size_t, std::align_val_t alignment) noexcept
+{
+    operator delete(p, alignment);
+}
+
+void operator delete[](void *p, std::size_t) noexcept
+{
+    operator delete(p);
+}
+
+void operator delete[](void *p, std::size_t, std::align_val_t alignment) noexcept
+{
+    operator delete(p, alignment);
+}
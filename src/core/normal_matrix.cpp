@@ -0,0 +1,144 @@
+#include "normal_matrix.h"
+
+#include <cmath>
+
+#if defined(__AVX2__) && defined(__FMA__)
+#include <immintrin.h>
+#endif
+
+// relative to the squared column length, loose enough for matrices composed from float quaternions
+static constexpr float uniformTolerance = 1e-4f;
+
+bool normalmatrix::isUniformScale(const glm::mat3 &basis)
+{
+    float lengthSq = glm::dot(basis[0], basis[0]);
+    float tolerance = uniformTolerance * lengthSq;
+    return std::abs(glm::dot(basis[1], basis[1]) - lengthSq) <= tolerance &&
+           std::abs(glm::dot(basis[2], basis[2]) - lengthSq) <= tolerance &&
+           std::abs(glm::dot(basis[0], basis[1])) <= tolerance &&
+           std::abs(glm::dot(basis[0], basis[2])) <= tolerance &&
+           std::abs(glm::dot(basis[1], basis[2])) <= tolerance;
+}
+
+glm::mat3 normalmatrix::compute(const glm::mat4 &model)
+{
+    glm::mat3 basis(model);
+    if (isUniformScale(basis))
+    {
+        return basis;
+    }
+
+    glm::mat3 cofactors(glm::cross(basis[1], basis[2]), glm::cross(basis[2], basis[0]),
+                        glm::cross(basis[0], basis[1]));
+    float det = glm::dot(basis[0], cofactors[0]);
+    // degenerate, nothing sensible to invert
+    if (det == 0.0f)
+    {
+        return basis;
+    }
+    return cofactors * (1.0f / det);
+}
+
+#if defined(__AVX2__) && defined(__FMA__)
+
+const char *normalmatrix::simdPath()
+{
+    return "avx2";
+}
+
+void normalmatrix::compute(const glm::mat4 *models, size_t count, glm::mat3 *normals)
+{
+    const size_t wide = count & ~size_t(7);
+    // one lane per matrix, a mat4 is 16 floats
+    const __m256i lanes = _mm256_setr_epi32(0, 16, 32, 48, 64, 80, 96, 112);
+    const __m256 signMask = _mm256_set1_ps(-0.0f);
+    const __m256 one = _mm256_set1_ps(1.0f);
+
+    for (size_t i = 0; i < wide; i += 8)
+    {
+        // m[column][row] for eight matrices
+        __m256 m[3][3];
+        const float *base = &models[i][0][0];
+        for (int c = 0; c < 3; c++)
+        {
+            for (int r = 0; r < 3; r++)
+            {
+                m[c][r] = _mm256_i32gather_ps(base + c * 4 + r, lanes, 4);
+            }
+        }
+
+        // cofactor columns: b x c, c x a, a x b
+        __m256 cof[3][3];
+        for (int c = 0; c < 3; c++)
+        {
+            const __m256 *u = m[(c + 1) % 3];
+            const __m256 *v = m[(c + 2) % 3];
+            cof[c][0] = _mm256_fmsub_ps(u[1], v[2], _mm256_mul_ps(u[2], v[1]));
+            cof[c][1] = _mm256_fmsub_ps(u[2], v[0], _mm256_mul_ps(u[0], v[2]));
+            cof[c][2] = _mm256_fmsub_ps(u[0], v[1], _mm256_mul_ps(u[1], v[0]));
+        }
+        __m256 det = _mm256_fmadd_ps(m[0][0], cof[0][0],
+                                     _mm256_fmadd_ps(m[0][1], cof[0][1], _mm256_mul_ps(m[0][2], cof[0][2])));
+
+        // same test as isUniformScale(), lanes that pass keep their upper 3x3
+        __m256 dots[3][3];
+        for (int a = 0; a < 3; a++)
+        {
+            for (int b = a; b < 3; b++)
+            {
+                dots[a][b] = _mm256_fmadd_ps(m[a][0], m[b][0],
+                                             _mm256_fmadd_ps(m[a][1], m[b][1], _mm256_mul_ps(m[a][2], m[b][2])));
+            }
+        }
+        __m256 tolerance = _mm256_mul_ps(dots[0][0], _mm256_set1_ps(uniformTolerance));
+        auto small = [&](__m256 value) {
+            return _mm256_cmp_ps(_mm256_andnot_ps(signMask, value), tolerance, _CMP_LE_OQ);
+        };
+        __m256 keep = _mm256_and_ps(small(_mm256_sub_ps(dots[1][1], dots[0][0])),
+                                    small(_mm256_sub_ps(dots[2][2], dots[0][0])));
+        keep = _mm256_and_ps(keep, _mm256_and_ps(small(dots[0][1]), small(dots[0][2])));
+        keep = _mm256_and_ps(keep, small(dots[1][2]));
+        keep = _mm256_or_ps(keep, _mm256_cmp_ps(det, _mm256_setzero_ps(), _CMP_EQ_OQ));
+
+        __m256 inverseDet = _mm256_div_ps(one, det);
+        alignas(32) float out[9][8];
+        for (int c = 0; c < 3; c++)
+        {
+            for (int r = 0; r < 3; r++)
+            {
+                __m256 inverse = _mm256_mul_ps(cof[c][r], inverseDet);
+                _mm256_store_ps(out[c * 3 + r], _mm256_blendv_ps(inverse, m[c][r], keep));
+            }
+        }
+        for (int lane = 0; lane < 8; lane++)
+        {
+            float *normal = &normals[i + lane][0][0];
+            for (int k = 0; k < 9; k++)
+            {
+                normal[k] = out[k][lane];
+            }
+        }
+    }
+
+    for (size_t i = wide; i < count; i++)
+    {
+        normals[i] = compute(models[i]);
+    }
+}
+
+#else
+
+const char *normalmatrix::simdPath()
+{
+    return "scalar";
+}
+
+void normalmatrix::compute(const glm::mat4 *models, size_t count, glm::mat3 *normals)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        normals[i] = compute(models[i]);
+    }
+}
+
+#endif
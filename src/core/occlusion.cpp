@@ -0,0 +1,567 @@
+#include "occlusion.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__AVX2__) && defined(__FMA__)
+#include <immintrin.h>
+#endif
+
+// corner i of a box takes the max of x, y and z where bits 0, 1 and 2 are set
+static const int boxFaces[6][4] = {
+    {0, 4, 6, 2}, // -x
+    {1, 3, 7, 5}, // +x
+    {0, 1, 5, 4}, // -y
+    {2, 6, 7, 3}, // +y
+    {0, 2, 3, 1}, // -z
+    {4, 5, 7, 6}, // +z
+};
+
+static int roundUp(int value, int multiple)
+{
+    return (std::max(value, 1) + multiple - 1) / multiple * multiple;
+}
+
+OcclusionBuffer::OcclusionBuffer(int width, int height)
+{
+    Level level;
+    level.width = roundUp(width, tileWidth);
+    level.height = roundUp(height, tileHeight);
+    while (true)
+    {
+        level.depth.assign((size_t)level.width * level.height, 1.0f);
+        levels_.push_back(level);
+        if (level.width == 1 && level.height == 1)
+        {
+            break;
+        }
+        level.width = (level.width + 1) / 2;
+        level.height = (level.height + 1) / 2;
+    }
+}
+
+void OcclusionBuffer::begin(const glm::mat4 &viewProjection)
+{
+    viewProjection_ = viewProjection;
+    std::fill(levels_[0].depth.begin(), levels_[0].depth.end(), 1.0f);
+    triangles_ = 0;
+}
+
+void OcclusionBuffer::drawBox(const glm::mat4 &model, const glm::vec3 &boundsMin, const glm::vec3 &boundsMax)
+{
+    glm::mat4 clipFromLocal = viewProjection_ * model;
+    glm::vec4 corners[8];
+    for (int i = 0; i < 8; i++)
+    {
+        glm::vec3 corner(i & 1 ? boundsMax.x : boundsMin.x, i & 2 ? boundsMax.y : boundsMin.y,
+                         i & 4 ? boundsMax.z : boundsMin.z);
+        corners[i] = clipFromLocal * glm::vec4(corner, 1.0f);
+    }
+
+    // a mirroring model turns every face inside out
+    bool mirrored = glm::determinant(glm::mat3(model)) < 0.0f;
+    if (drawSolidBox(corners, mirrored))
+    {
+        return;
+    }
+    // across the near plane, clipped a triangle at a time. the edges between them don't occlude
+    for (const int *face : boxFaces)
+    {
+        if (mirrored)
+        {
+            drawTriangle(corners[face[0]], corners[face[2]], corners[face[1]]);
+            drawTriangle(corners[face[0]], corners[face[3]], corners[face[2]]);
+        }
+        else
+        {
+            drawTriangle(corners[face[0]], corners[face[1]], corners[face[2]]);
+            drawTriangle(corners[face[0]], corners[face[2]], corners[face[3]]);
+        }
+    }
+}
+
+void OcclusionBuffer::drawTriangle(const glm::vec4 &a, const glm::vec4 &b, const glm::vec4 &c)
+{
+    // clip against the near plane, z >= -w, which leaves at most four corners
+    const glm::vec4 *in[3] = {&a, &b, &c};
+    glm::vec4 clipped[4];
+    int count = 0;
+    for (int i = 0; i < 3; i++)
+    {
+        const glm::vec4 &from = *in[i];
+        const glm::vec4 &to = *in[(i + 1) % 3];
+        float fromDistance = from.z + from.w;
+        float toDistance = to.z + to.w;
+        if (fromDistance >= 0.0f)
+        {
+            clipped[count++] = from;
+        }
+        if ((fromDistance >= 0.0f) != (toDistance >= 0.0f))
+        {
+            float t = fromDistance / (fromDistance - toDistance);
+            clipped[count++] = from + (to - from) * t;
+        }
+    }
+    if (count < 3)
+    {
+        return;
+    }
+
+    const Level &level = levels_[0];
+    glm::vec3 screen[4];
+    for (int i = 0; i < count; i++)
+    {
+        float inverseW = 1.0f / clipped[i].w;
+        screen[i] = glm::vec3((clipped[i].x * inverseW * 0.5f + 0.5f) * level.width,
+                              (clipped[i].y * inverseW * 0.5f + 0.5f) * level.height, clipped[i].z * inverseW);
+    }
+    for (int i = 2; i < count; i++)
+    {
+        fillTriangle(screen[0], screen[i - 1], screen[i]);
+    }
+}
+
+void OcclusionBuffer::finish()
+{
+    for (size_t l = 1; l < levels_.size(); l++)
+    {
+        const Level &below = levels_[l - 1];
+        Level &level = levels_[l];
+        for (int y = 0; y < level.height; y++)
+        {
+            const float *row0 = &below.depth[(size_t)(2 * y) * below.width];
+            const float *row1 = &below.depth[(size_t)std::min(2 * y + 1, below.height - 1) * below.width];
+            float *out = &level.depth[(size_t)y * level.width];
+            for (int x = 0; x < level.width; x++)
+            {
+                int x0 = 2 * x;
+                int x1 = std::min(2 * x + 1, below.width - 1);
+                out[x] = std::max(std::max(row0[x0], row0[x1]), std::max(row1[x0], row1[x1]));
+            }
+        }
+    }
+}
+
+size_t OcclusionBuffer::pickOccluders(const BoundsSoA &bounds, const glm::vec3 &viewPos, uint32_t *candidates,
+                                      size_t count, size_t maxOccluders)
+{
+    if (count <= maxOccluders)
+    {
+        return count;
+    }
+    auto coverage = [&](uint32_t row) {
+        glm::vec3 center(bounds.centerX[row], bounds.centerY[row], bounds.centerZ[row]);
+        glm::vec3 offset = center - viewPos;
+        return bounds.radius[row] * bounds.radius[row] / std::max(glm::dot(offset, offset), 1e-4f);
+    };
+    std::nth_element(candidates, candidates + maxOccluders, candidates + count,
+                     [&](uint32_t a, uint32_t b) { return coverage(a) > coverage(b); });
+    return maxOccluders;
+}
+
+// screen rect of a projected box. every pixel the rect touches is tested, not only those whose centre it holds
+static void pixelRect(float minX, float minY, float maxX, float maxY, int width, int height, int &x0, int &y0,
+                      int &x1, int &y1)
+{
+    x0 = (int)std::max(std::floor((minX * 0.5f + 0.5f) * width), 0.0f);
+    y0 = (int)std::max(std::floor((minY * 0.5f + 0.5f) * height), 0.0f);
+    x1 = (int)std::min(std::floor((maxX * 0.5f + 0.5f) * width), (float)(width - 1));
+    y1 = (int)std::min(std::floor((maxY * 0.5f + 0.5f) * height), (float)(height - 1));
+}
+
+bool OcclusionBuffer::projectBoxScalar(const glm::vec3 &center, const glm::vec3 &extents, ScreenRect &rect) const
+{
+    // fused in the same order as the SIMD path so both agree to the bit
+    const glm::mat4 &m = viewProjection_;
+    float minX = INFINITY, minY = INFINITY, maxX = -INFINITY, maxY = -INFINITY;
+    rect.minZ = INFINITY;
+    for (int i = 0; i < 8; i++)
+    {
+        float px = std::fma(i & 1 ? 1.0f : -1.0f, extents.x, center.x);
+        float py = std::fma(i & 2 ? 1.0f : -1.0f, extents.y, center.y);
+        float pz = std::fma(i & 4 ? 1.0f : -1.0f, extents.z, center.z);
+        float x = std::fma(m[0][0], px, std::fma(m[1][0], py, std::fma(m[2][0], pz, m[3][0])));
+        float y = std::fma(m[0][1], px, std::fma(m[1][1], py, std::fma(m[2][1], pz, m[3][1])));
+        float z = std::fma(m[0][2], px, std::fma(m[1][2], py, std::fma(m[2][2], pz, m[3][2])));
+        float w = std::fma(m[0][3], px, std::fma(m[1][3], py, std::fma(m[2][3], pz, m[3][3])));
+        if (!(w > 0.0f) || z + w < 0.0f)
+        {
+            return false;
+        }
+        float inverseW = 1.0f / w;
+        minX = std::min(minX, x * inverseW);
+        maxX = std::max(maxX, x * inverseW);
+        minY = std::min(minY, y * inverseW);
+        maxY = std::max(maxY, y * inverseW);
+        rect.minZ = std::min(rect.minZ, z * inverseW);
+    }
+    pixelRect(minX, minY, maxX, maxY, width(), height(), rect.minX, rect.minY, rect.maxX, rect.maxY);
+    return true;
+}
+
+bool OcclusionBuffer::hidden(const ScreenRect &rect) const
+{
+    // off screen after all, the frustum test was looser than the projection. not ours to cull
+    if (rect.minX > rect.maxX || rect.minY > rect.maxY)
+    {
+        return false;
+    }
+
+    // the finest level where the rect spans at most 4x4 texels
+    size_t l = 0;
+    while (l + 1 < levels_.size() &&
+           ((rect.maxX >> l) - (rect.minX >> l) >= 4 || (rect.maxY >> l) - (rect.minY >> l) >= 4))
+    {
+        l++;
+    }
+    const Level &level = levels_[l];
+    for (int y = rect.minY >> l; y <= rect.maxY >> l; y++)
+    {
+        const float *row = &level.depth[(size_t)y * level.width];
+        for (int x = rect.minX >> l; x <= rect.maxX >> l; x++)
+        {
+            if (row[x] >= rect.minZ)
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+size_t OcclusionBuffer::cull(const BoundsSoA &bounds, uint32_t *visible, size_t count) const
+{
+    size_t kept = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        uint32_t row = visible[i];
+        glm::vec3 center(bounds.centerX[row], bounds.centerY[row], bounds.centerZ[row]);
+        glm::vec3 extents(bounds.extentX[row], bounds.extentY[row], bounds.extentZ[row]);
+        ScreenRect rect;
+        if (!projectBox(center, extents, rect) || !hidden(rect))
+        {
+            visible[kept++] = row;
+        }
+    }
+    return kept;
+}
+
+size_t OcclusionBuffer::cullScalar(const BoundsSoA &bounds, uint32_t *visible, size_t count) const
+{
+    size_t kept = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        uint32_t row = visible[i];
+        glm::vec3 center(bounds.centerX[row], bounds.centerY[row], bounds.centerZ[row]);
+        glm::vec3 extents(bounds.extentX[row], bounds.extentY[row], bounds.extentZ[row]);
+        ScreenRect rect;
+        if (!projectBoxScalar(center, extents, rect) || !hidden(rect))
+        {
+            visible[kept++] = row;
+        }
+    }
+    return kept;
+}
+
+#if defined(__AVX2__) && defined(__FMA__)
+
+const char *OcclusionBuffer::simdPath()
+{
+    return "avx2";
+}
+
+static inline float horizontalMin(__m256 v)
+{
+    __m128 m = _mm_min_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    m = _mm_min_ps(m, _mm_movehl_ps(m, m));
+    return _mm_cvtss_f32(_mm_min_ss(m, _mm_shuffle_ps(m, m, 1)));
+}
+
+static inline float horizontalMax(__m256 v)
+{
+    __m128 m = _mm_max_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    m = _mm_max_ps(m, _mm_movehl_ps(m, m));
+    return _mm_cvtss_f32(_mm_max_ss(m, _mm_shuffle_ps(m, m, 1)));
+}
+
+// the eight corners of one box, one per lane
+bool OcclusionBuffer::projectBox(const glm::vec3 &center, const glm::vec3 &extents, ScreenRect &rect) const
+{
+    const glm::mat4 &m = viewProjection_;
+    const __m256 signX = _mm256_setr_ps(-1.0f, 1.0f, -1.0f, 1.0f, -1.0f, 1.0f, -1.0f, 1.0f);
+    const __m256 signY = _mm256_setr_ps(-1.0f, -1.0f, 1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f);
+    const __m256 signZ = _mm256_setr_ps(-1.0f, -1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 1.0f, 1.0f);
+    __m256 px = _mm256_fmadd_ps(signX, _mm256_set1_ps(extents.x), _mm256_set1_ps(center.x));
+    __m256 py = _mm256_fmadd_ps(signY, _mm256_set1_ps(extents.y), _mm256_set1_ps(center.y));
+    __m256 pz = _mm256_fmadd_ps(signZ, _mm256_set1_ps(extents.z), _mm256_set1_ps(center.z));
+
+    auto row = [&](int r) {
+        return _mm256_fmadd_ps(_mm256_set1_ps(m[0][r]), px,
+                               _mm256_fmadd_ps(_mm256_set1_ps(m[1][r]), py,
+                                               _mm256_fmadd_ps(_mm256_set1_ps(m[2][r]), pz, _mm256_set1_ps(m[3][r]))));
+    };
+    __m256 x = row(0), y = row(1), z = row(2), w = row(3);
+
+    __m256 zero = _mm256_setzero_ps();
+    __m256 nearSide = _mm256_or_ps(_mm256_cmp_ps(w, zero, _CMP_NGT_UQ),
+                                   _mm256_cmp_ps(_mm256_add_ps(z, w), zero, _CMP_LT_OQ));
+    if (_mm256_movemask_ps(nearSide))
+    {
+        return false;
+    }
+
+    __m256 inverseW = _mm256_div_ps(_mm256_set1_ps(1.0f), w);
+    __m256 ndcX = _mm256_mul_ps(x, inverseW);
+    __m256 ndcY = _mm256_mul_ps(y, inverseW);
+    rect.minZ = horizontalMin(_mm256_mul_ps(z, inverseW));
+    pixelRect(horizontalMin(ndcX), horizontalMin(ndcY), horizontalMax(ndcX), horizontalMax(ndcY), width(), height(),
+              rect.minX, rect.minY, rect.maxX, rect.maxY);
+    return true;
+}
+
+#else
+
+const char *OcclusionBuffer::simdPath()
+{
+    return "scalar";
+}
+
+bool OcclusionBuffer::projectBox(const glm::vec3 &center, const glm::vec3 &extents, ScreenRect &rect) const
+{
+    return projectBoxScalar(center, extents, rect);
+}
+
+#endif
+
+// positive on the left of from -> to, inside a counter clockwise outline
+static OcclusionBuffer::ScreenPlane edgeFunction(const glm::vec2 &from, const glm::vec2 &to)
+{
+    return {from.y - to.y, to.x - from.x, from.x * to.y - from.y * to.x};
+}
+
+// depth over the screen through three points, which mustn't be in a line
+static OcclusionBuffer::ScreenPlane depthPlane(const glm::vec3 &p0, const glm::vec3 &p1, const glm::vec3 &p2)
+{
+    glm::vec3 d1 = p1 - p0, d2 = p2 - p0;
+    float inverseArea = 1.0f / (d1.x * d2.y - d1.y * d2.x);
+    float a = (d1.z * d2.y - d2.z * d1.y) * inverseArea;
+    float b = (d2.z * d1.x - d1.z * d2.x) * inverseArea;
+    return {a, b, p0.z - a * p0.x - b * p0.y};
+}
+
+template <typename Point> static float cross(const Point &o, const Point &a, const Point &b)
+{
+    return (a.x - o.x) * (b.y - o.y) - (a.y - o.y) * (b.x - o.x);
+}
+
+// monotone chain, counter clockwise without collinear points. hull needs room for 2 * count
+static int convexHull(glm::vec2 *points, int count, glm::vec2 *hull)
+{
+    std::sort(points, points + count,
+              [](const glm::vec2 &p, const glm::vec2 &q) { return p.x < q.x || (p.x == q.x && p.y < q.y); });
+    int size = 0;
+    for (int i = 0; i < count; i++)
+    {
+        while (size >= 2 && cross(hull[size - 2], hull[size - 1], points[i]) <= 0.0f)
+        {
+            size--;
+        }
+        hull[size++] = points[i];
+    }
+    for (int i = count - 2, lower = size + 1; i >= 0; i--)
+    {
+        while (size >= lower && cross(hull[size - 2], hull[size - 1], points[i]) <= 0.0f)
+        {
+            size--;
+        }
+        hull[size++] = points[i];
+    }
+    return size - 1;
+}
+
+bool OcclusionBuffer::drawSolidBox(const glm::vec4 *corners, bool mirrored)
+{
+    const Level &level = levels_[0];
+    glm::vec3 screen[8];
+    glm::vec2 points[8];
+    glm::vec2 lo(INFINITY), hi(-INFINITY);
+    float farZ = -INFINITY;
+    for (int i = 0; i < 8; i++)
+    {
+        const glm::vec4 &corner = corners[i];
+        if (!(corner.w > 0.0f) || corner.z + corner.w < 0.0f)
+        {
+            return false;
+        }
+        float inverseW = 1.0f / corner.w;
+        screen[i] = glm::vec3((corner.x * inverseW * 0.5f + 0.5f) * level.width,
+                              (corner.y * inverseW * 0.5f + 0.5f) * level.height, corner.z * inverseW);
+        points[i] = glm::vec2(screen[i].x, screen[i].y);
+        lo = glm::min(lo, points[i]);
+        hi = glm::max(hi, points[i]);
+        farZ = std::max(farZ, screen[i].z);
+    }
+
+    // a ray enters a convex solid where it crosses the last of the planes of the faces turned towards it
+    ScreenPlane depths[maxDepthPlanes];
+    int depthCount = 0;
+    for (const int *face : boxFaces)
+    {
+        const glm::vec3 &p0 = screen[face[0]], &p1 = screen[face[1]], &p2 = screen[face[2]], &p3 = screen[face[3]];
+        float first = cross(p0, p1, p2), second = cross(p0, p2, p3);
+        float area = mirrored ? -(first + second) : first + second;
+        if (!(area > 0.0f))
+        {
+            continue;
+        }
+        // a plane left out would bring the depth nearer, so faces seen this edge on go through drawTriangle()
+        if (area < 1e-6f || depthCount == maxDepthPlanes)
+        {
+            return false;
+        }
+        depths[depthCount++] = std::abs(first) > std::abs(second) ? depthPlane(p0, p1, p2) : depthPlane(p0, p2, p3);
+    }
+    triangles_ += 2 * depthCount;
+
+    glm::vec2 hull[16];
+    int hullCount = convexHull(points, 8, hull);
+    if (depthCount == 0 || hullCount < 3)
+    {
+        return true;
+    }
+    ScreenPlane edges[maxEdges];
+    for (int i = 0; i < hullCount; i++)
+    {
+        edges[i] = edgeFunction(hull[i], hull[(i + 1) % hullCount]);
+    }
+    fillConvex(edges, hullCount, depths, depthCount, farZ, lo, hi);
+    return true;
+}
+
+void OcclusionBuffer::fillTriangle(const glm::vec3 &v0, const glm::vec3 &v1, const glm::vec3 &v2)
+{
+    if (!(cross(v0, v1, v2) > 0.0f))
+    {
+        return;
+    }
+    triangles_++;
+
+    // edge i is opposite corner i
+    glm::vec2 p0(v0.x, v0.y), p1(v1.x, v1.y), p2(v2.x, v2.y);
+    ScreenPlane edges[3] = {edgeFunction(p1, p2), edgeFunction(p2, p0), edgeFunction(p0, p1)};
+    ScreenPlane depth = depthPlane(v0, v1, v2);
+    fillConvex(edges, 3, &depth, 1, std::max(std::max(v0.z, v1.z), v2.z), glm::min(glm::min(p0, p1), p2),
+               glm::max(glm::max(p0, p1), p2));
+}
+
+void OcclusionBuffer::fillConvex(const ScreenPlane *edges, int edgeCount, const ScreenPlane *depths, int depthCount,
+                                 float farZ, const glm::vec2 &lo, const glm::vec2 &hi)
+{
+    // only pixels covered entirely, so their whole square has to fit in the bounds
+    Level &level = levels_[0];
+    int minX = std::max((int)std::ceil(lo.x), 0);
+    int minY = std::max((int)std::ceil(lo.y), 0);
+    int maxX = std::min((int)std::floor(hi.x) - 1, level.width - 1);
+    int maxY = std::min((int)std::floor(hi.y) - 1, level.height - 1);
+    if (minX > maxX || minY > maxY)
+    {
+        return;
+    }
+
+    // everything is evaluated at pixel centres. moving each edge in by half a pixel tests the corner least
+    // inside it, and moving each plane back by as much gives its farthest depth over the pixel. the planes
+    // run on past the shape there, so that depth is clamped to its farthest corner
+    float a[maxEdges], b[maxEdges], c[maxEdges];
+    for (int i = 0; i < edgeCount; i++)
+    {
+        a[i] = edges[i].a;
+        b[i] = edges[i].b;
+        c[i] = edges[i].c - 0.5f * (std::abs(edges[i].a) + std::abs(edges[i].b));
+    }
+    float za[maxDepthPlanes], zb[maxDepthPlanes], zc[maxDepthPlanes];
+    for (int i = 0; i < depthCount; i++)
+    {
+        za[i] = depths[i].a;
+        zb[i] = depths[i].b;
+        zc[i] = depths[i].c + 0.5f * (std::abs(depths[i].a) + std::abs(depths[i].b));
+    }
+
+#if defined(__AVX2__) && defined(__FMA__)
+    const __m256 lanes = _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 farZs = _mm256_set1_ps(farZ);
+    __m256 stepA[maxEdges], stepZ[maxDepthPlanes];
+    for (int i = 0; i < edgeCount; i++)
+    {
+        stepA[i] = _mm256_mul_ps(_mm256_set1_ps(a[i]), lanes);
+    }
+    for (int i = 0; i < depthCount; i++)
+    {
+        stepZ[i] = _mm256_mul_ps(_mm256_set1_ps(za[i]), lanes);
+    }
+#endif
+
+    for (int ty = minY & ~(tileHeight - 1); ty <= maxY; ty += tileHeight)
+    {
+        for (int tx = minX & ~(tileWidth - 1); tx <= maxX; tx += tileWidth)
+        {
+            // skip the tile when its corner farthest inside an edge is still outside it
+            float cx = tx + 0.5f;
+            float cy = ty + 0.5f;
+            bool outside = false;
+            for (int i = 0; i < edgeCount && !outside; i++)
+            {
+                float best = a[i] * (cx + (a[i] > 0.0f ? tileWidth - 1 : 0)) +
+                             b[i] * (cy + (b[i] > 0.0f ? tileHeight - 1 : 0)) + c[i];
+                outside = best < 0.0f;
+            }
+            if (outside)
+            {
+                continue;
+            }
+
+            for (int y = ty; y < ty + tileHeight; y++)
+            {
+                float py = y + 0.5f;
+                float *out = &level.depth[(size_t)y * level.width + tx];
+#if defined(__AVX2__) && defined(__FMA__)
+                __m256 inside = _mm256_set1_ps(-1.0f);
+                for (int i = 0; i < edgeCount; i++)
+                {
+                    __m256 e = _mm256_add_ps(_mm256_set1_ps(a[i] * cx + b[i] * py + c[i]), stepA[i]);
+                    inside = _mm256_and_ps(inside, _mm256_cmp_ps(e, zero, _CMP_GE_OQ));
+                }
+                // min() picks farZ over a NaN from a plane seen nearly edge on
+                __m256 z = _mm256_add_ps(_mm256_set1_ps(za[0] * cx + zb[0] * py + zc[0]), stepZ[0]);
+                for (int i = 1; i < depthCount; i++)
+                {
+                    z = _mm256_max_ps(z, _mm256_add_ps(_mm256_set1_ps(za[i] * cx + zb[i] * py + zc[i]), stepZ[i]));
+                }
+                z = _mm256_min_ps(z, farZs);
+                __m256 old = _mm256_loadu_ps(out);
+                _mm256_storeu_ps(out, _mm256_blendv_ps(old, _mm256_min_ps(old, z), inside));
+#else
+                for (int x = 0; x < tileWidth; x++)
+                {
+                    float px = cx + x;
+                    bool inside = true;
+                    for (int i = 0; i < edgeCount && inside; i++)
+                    {
+                        inside = a[i] * px + b[i] * py + c[i] >= 0.0f;
+                    }
+                    if (!inside)
+                    {
+                        continue;
+                    }
+                    float z = za[0] * px + zb[0] * py + zc[0];
+                    for (int i = 1; i < depthCount; i++)
+                    {
+                        z = std::max(z, za[i] * px + zb[i] * py + zc[i]);
+                    }
+                    out[x] = std::min(out[x], z < farZ ? z : farZ);
+                }
+#endif
+            }
+        }
+    }
+}
@@ -0,0 +1,384 @@
+#include "profiler.h"
+#include "stats.h"
+
+#include <glad/glad.h>
+
+#include <SDL3/SDL.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+// GPU results are read this many frames after they were issued
+static constexpr uint32_t gpuLatency = 3;
+
+struct CpuEvent
+{
+    const char *name;
+    uint64_t startNs;
+    uint64_t endNs;
+};
+
+struct GpuEvent
+{
+    const char *name;
+    uint64_t ns;
+    bool available;
+};
+
+struct FrameRecord
+{
+    uint64_t index;
+    uint64_t startNs;
+    uint64_t endNs;
+    CpuEvent cpu[profiler::maxCpuEvents];
+    uint32_t cpuCount;
+    GpuEvent gpu[profiler::maxGpuPasses];
+    uint32_t gpuCount;
+    stats::FrameCounters counters;
+};
+
+struct GpuSlot
+{
+    GLuint queries[profiler::maxGpuPasses];
+    uint64_t frame;
+    uint32_t passCount;
+};
+
+static std::vector<FrameRecord> history;
+static GpuSlot gpuSlots[gpuLatency];
+static uint64_t frameIndex = 0;
+static uint64_t recordedFrames = 0;
+static FrameRecord *current = nullptr;
+
+static uint32_t openCpu[profiler::maxCpuEvents];
+static uint32_t openCpuCount = 0;
+// scopes begun once the frame's events ran out. those are always the innermost ones open, so their ends come
+// before any recorded scope's and only need counting
+static uint32_t droppedCpuCount = 0;
+static bool gpuActive = false;
+static bool initialised = false;
+
+void profiler::init()
+{
+    history.assign(historySize, FrameRecord());
+    for (GpuSlot &slot : gpuSlots)
+    {
+        glGenQueries(maxGpuPasses, slot.queries);
+        slot.frame = 0;
+        slot.passCount = 0;
+    }
+    initialised = true;
+}
+
+void profiler::shutdown()
+{
+    if (!initialised)
+    {
+        return;
+    }
+    for (GpuSlot &slot : gpuSlots)
+    {
+        glDeleteQueries(maxGpuPasses, slot.queries);
+    }
+    history.clear();
+    current = nullptr;
+    initialised = false;
+}
+
+// collect whatever the slot's queries from gpuLatency frames ago have finished, skip the rest
+static void resolveGpuSlot(GpuSlot &slot)
+{
+    if (slot.passCount == 0)
+    {
+        return;
+    }
+
+    FrameRecord &record = history[slot.frame % profiler::historySize];
+    bool stillInHistory = record.index == slot.frame;
+    for (uint32_t i = 0; i < slot.passCount; i++)
+    {
+        GLint available = 0;
+        glGetQueryObjectiv(slot.queries[i], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available || !stillInHistory)
+        {
+            continue;
+        }
+
+        GLuint64 elapsed = 0;
+        glGetQueryObjectui64v(slot.queries[i], GL_QUERY_RESULT, &elapsed);
+        record.gpu[i].ns = elapsed;
+        record.gpu[i].available = true;
+    }
+    slot.passCount = 0;
+}
+
+void profiler::beginFrame()
+{
+    if (!initialised)
+    {
+        return;
+    }
+
+    frameIndex++;
+    GpuSlot &slot = gpuSlots[frameIndex % gpuLatency];
+    resolveGpuSlot(slot);
+    slot.frame = frameIndex;
+
+    current = &history[frameIndex % historySize];
+    current->index = frameIndex;
+    current->startNs = SDL_GetTicksNS();
+    current->endNs = 0;
+    current->cpuCount = 0;
+    current->gpuCount = 0;
+    openCpuCount = 0;
+    droppedCpuCount = 0;
+}
+
+void profiler::endFrame()
+{
+    if (!current)
+    {
+        stats::endFrame();
+        return;
+    }
+
+    while (openCpuCount > 0)
+    {
+        endCpu();
+    }
+    current->endNs = SDL_GetTicksNS();
+    current->counters = stats::current();
+    recordedFrames++;
+    current = nullptr;
+    stats::endFrame();
+}
+
+void profiler::beginCpu(const char *name)
+{
+    if (!current)
+    {
+        return;
+    }
+    if (current->cpuCount >= maxCpuEvents)
+    {
+        droppedCpuCount++;
+        return;
+    }
+
+    uint32_t index = current->cpuCount++;
+    current->cpu[index] = {name, SDL_GetTicksNS(), 0};
+    openCpu[openCpuCount++] = index;
+}
+
+void profiler::endCpu()
+{
+    if (!current)
+    {
+        return;
+    }
+    if (droppedCpuCount > 0)
+    {
+        droppedCpuCount--;
+        return;
+    }
+    if (openCpuCount == 0)
+    {
+        return;
+    }
+    current->cpu[openCpu[--openCpuCount]].endNs = SDL_GetTicksNS();
+}
+
+void profiler::beginGpu(const char *name)
+{
+    if (!current || gpuActive || current->gpuCount >= maxGpuPasses)
+    {
+        if (gpuActive)
+        {
+            SDL_Log("profiler: gpu pass %s started inside another pass, GL_TIME_ELAPSED can't nest", name);
+        }
+        return;
+    }
+
+    GpuSlot &slot = gpuSlots[frameIndex % gpuLatency];
+    uint32_t index = current->gpuCount++;
+    current->gpu[index] = {name, 0, false};
+    slot.passCount = current->gpuCount;
+    glBeginQuery(GL_TIME_ELAPSED, slot.queries[index]);
+    gpuActive = true;
+}
+
+void profiler::endGpu()
+{
+    if (!gpuActive)
+    {
+        return;
+    }
+    glEndQuery(GL_TIME_ELAPSED);
+    gpuActive = false;
+}
+
+static const FrameRecord *recordAt(uint64_t age)
+{
+    // age 1 is the last completed frame
+    if (age > recordedFrames || age >= profiler::historySize || age > frameIndex)
+    {
+        return nullptr;
+    }
+    uint64_t index = frameIndex - age + 1;
+    const FrameRecord &record = history[index % profiler::historySize];
+    return record.index == index && record.endNs ? &record : nullptr;
+}
+
+static double percentile(const std::vector<double> &sorted, double p)
+{
+    size_t index = (size_t)(p * (sorted.size() - 1) + 0.5);
+    return sorted[std::min(index, sorted.size() - 1)];
+}
+
+void profiler::logSummary()
+{
+    std::vector<double> frameMs;
+    struct PassTotal
+    {
+        const char *name;
+        double ms;
+        uint32_t samples;
+    };
+    std::vector<PassTotal> cpuPasses, gpuPasses;
+    double drawCalls = 0, stateIssued = 0, stateSkipped = 0;
+
+    auto accumulate = [](std::vector<PassTotal> &totals, const char *name, double ms) {
+        for (PassTotal &total : totals)
+        {
+            if (total.name == name)
+            {
+                total.ms += ms;
+                total.samples++;
+                return;
+            }
+        }
+        totals.push_back({name, ms, 1});
+    };
+
+    for (uint64_t age = 1; age < historySize; age++)
+    {
+        const FrameRecord *record = recordAt(age);
+        if (!record)
+        {
+            break;
+        }
+        frameMs.push_back((record->endNs - record->startNs) / 1e6);
+        drawCalls += record->counters.drawCalls;
+        stateIssued += record->counters.stateChangesIssued;
+        stateSkipped += record->counters.stateChangesSkipped;
+        for (uint32_t i = 0; i < record->cpuCount; i++)
+        {
+            accumulate(cpuPasses, record->cpu[i].name, (record->cpu[i].endNs - record->cpu[i].startNs) / 1e6);
+        }
+        for (uint32_t i = 0; i < record->gpuCount; i++)
+        {
+            if (record->gpu[i].available)
+            {
+                accumulate(gpuPasses, record->gpu[i].name, record->gpu[i].ns / 1e6);
+            }
+        }
+    }
+
+    if (frameMs.empty())
+    {
+        SDL_Log("profiler: no frames recorded");
+        return;
+    }
+
+    size_t frames = frameMs.size();
+    std::sort(frameMs.begin(), frameMs.end());
+    SDL_Log("profiler: %zu frames  p50 %.3f ms  p95 %.3f ms  p99 %.3f ms  max %.3f ms", frames,
+            percentile(frameMs, 0.50), percentile(frameMs, 0.95), percentile(frameMs, 0.99), frameMs.back());
+    SDL_Log("  per frame: %.1f draw calls, %.1f state changes issued, %.1f skipped", drawCalls / frames,
+            stateIssued / frames, stateSkipped / frames);
+    for (const PassTotal &pass : cpuPasses)
+    {
+        SDL_Log("  cpu %-16s %.3f ms", pass.name, pass.ms / pass.samples);
+    }
+    for (const PassTotal &pass : gpuPasses)
+    {
+        SDL_Log("  gpu %-16s %.3f ms", pass.name, pass.ms / pass.samples);
+    }
+}
+
+bool profiler::exportChromeTrace(const char *path)
+{
+    FILE *file = std::fopen(path, "w");
+    if (!file)
+    {
+        SDL_Log("profiler: couldn't open %s", path);
+        return false;
+    }
+
+    // timestamps in microseconds, GPU passes have no CPU clock timestamp so they are laid end to end
+    // from the start of the frame on their own track
+    std::fprintf(file, "{\"traceEvents\":[\n");
+    bool first = true;
+    auto separator = [&]() {
+        if (!first)
+        {
+            std::fprintf(file, ",\n");
+        }
+        first = false;
+    };
+
+    separator();
+    std::fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"CPU\"}}");
+    separator();
+    std::fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"GPU\"}}");
+
+    for (uint64_t age = historySize - 1; age >= 1; age--)
+    {
+        const FrameRecord *record = recordAt(age);
+        if (!record)
+        {
+            continue;
+        }
+
+        double frameStart = record->startNs / 1e3;
+        separator();
+        std::fprintf(file, "{\"name\":\"frame %llu\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f}",
+                     (unsigned long long)record->index, frameStart, (record->endNs - record->startNs) / 1e3);
+
+        for (uint32_t i = 0; i < record->cpuCount; i++)
+        {
+            const CpuEvent &event = record->cpu[i];
+            separator();
+            std::fprintf(file, "{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f}",
+                         event.name, event.startNs / 1e3, (event.endNs - event.startNs) / 1e3);
+        }
+
+        double gpuCursor = frameStart;
+        for (uint32_t i = 0; i < record->gpuCount; i++)
+        {
+            const GpuEvent &event = record->gpu[i];
+            if (!event.available)
+            {
+                continue;
+            }
+            separator();
+            std::fprintf(file, "{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":2,\"ts\":%.3f,\"dur\":%.3f}",
+                         event.name, gpuCursor, event.ns / 1e3);
+            gpuCursor += event.ns / 1e3;
+        }
+
+        separator();
+        std::fprintf(file,
+                     "{\"name\":\"counters\",\"ph\":\"C\",\"pid\":1,\"ts\":%.3f,\"args\":{\"draw calls\":%llu,"
+                     "\"state changes\":%llu,\"state skipped\":%llu}}",
+                     frameStart, (unsigned long long)record->counters.drawCalls,
+                     (unsigned long long)record->counters.stateChangesIssued,
+                     (unsigned long long)record->counters.stateChangesSkipped);
+    }
+
+    std::fprintf(file, "\n]}\n");
+    std::fclose(file);
+    SDL_Log("profiler: wrote chrome trace to %s", path);
+    return true;
+}
@@ -0,0 +1,279 @@
+#include "range_allocator.h"
+
+#include <algorithm>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+static int highestSetBit(uint32_t value)
+{
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanReverse(&index, value);
+    return (int)index;
+#else
+    return 31 - __builtin_clz(value);
+#endif
+}
+
+static int lowestSetBit(uint32_t value)
+{
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, value);
+    return (int)index;
+#else
+    return __builtin_ctz(value);
+#endif
+}
+
+// bin holding blocks of exactly this size class
+static void mapping(uint32_t size, int &fl, int &sl, int slBits)
+{
+    if (size < (1u << slBits))
+    {
+        fl = 0;
+        sl = (int)size;
+        return;
+    }
+    int top = highestSetBit(size);
+    fl = top - slBits + 1;
+    sl = (int)((size >> (top - slBits)) - (1u << slBits));
+}
+
+RangeAllocator::RangeAllocator(uint32_t capacity)
+{
+    for (auto &level : freeHeads_)
+    {
+        std::fill(std::begin(level), std::end(level), invalid);
+    }
+    grow(capacity);
+}
+
+RangeAllocator::Allocation RangeAllocator::allocate(uint32_t size)
+{
+    if (size == 0)
+    {
+        return {};
+    }
+
+    // round up to the next bin boundary so any block in the bin we land on is big enough
+    uint64_t rounded = size;
+    if (size >= (1u << slBits))
+    {
+        rounded += (1ull << (highestSetBit(size) - slBits)) - 1;
+    }
+    if (rounded > 0xFFFFFFFFull)
+    {
+        return {};
+    }
+
+    int fl, sl;
+    mapping((uint32_t)rounded, fl, sl, slBits);
+
+    uint32_t slMap = slBitmap_[fl] & (~0u << sl);
+    if (!slMap)
+    {
+        uint32_t flMap = fl + 1 < 32 ? flBitmap_ & (~0u << (fl + 1)) : 0;
+        if (!flMap)
+        {
+            return {};
+        }
+        fl = lowestSetBit(flMap);
+        slMap = slBitmap_[fl];
+    }
+    sl = lowestSetBit(slMap);
+
+    uint32_t index = freeHeads_[fl][sl];
+    removeFree(index);
+
+    // split off the tail and give it back
+    if (blocks_[index].size > size)
+    {
+        uint32_t remainder = newBlock(blocks_[index].offset + size, blocks_[index].size - size);
+        blocks_[remainder].prevPhysical = index;
+        blocks_[remainder].nextPhysical = blocks_[index].nextPhysical;
+        if (blocks_[index].nextPhysical != invalid)
+        {
+            blocks_[blocks_[index].nextPhysical].prevPhysical = remainder;
+        }
+        else
+        {
+            lastBlock_ = remainder;
+        }
+        blocks_[index].nextPhysical = remainder;
+        blocks_[index].size = size;
+        insertFree(remainder);
+    }
+
+    blocks_[index].free = false;
+    used_ += size;
+    return {blocks_[index].offset, index};
+}
+
+void RangeAllocator::free(Allocation allocation)
+{
+    if (!allocation.valid())
+    {
+        return;
+    }
+
+    uint32_t index = allocation.block;
+    used_ -= blocks_[index].size;
+    blocks_[index].free = true;
+
+    uint32_t prev = blocks_[index].prevPhysical;
+    if (prev != invalid && blocks_[prev].free)
+    {
+        removeFree(prev);
+        blocks_[prev].size += blocks_[index].size;
+        blocks_[prev].nextPhysical = blocks_[index].nextPhysical;
+        if (blocks_[index].nextPhysical != invalid)
+        {
+            blocks_[blocks_[index].nextPhysical].prevPhysical = prev;
+        }
+        else
+        {
+            lastBlock_ = prev;
+        }
+        releaseBlock(index);
+        index = prev;
+    }
+
+    uint32_t next = blocks_[index].nextPhysical;
+    if (next != invalid && blocks_[next].free)
+    {
+        removeFree(next);
+        blocks_[index].size += blocks_[next].size;
+        blocks_[index].nextPhysical = blocks_[next].nextPhysical;
+        if (blocks_[next].nextPhysical != invalid)
+        {
+            blocks_[blocks_[next].nextPhysical].prevPhysical = index;
+        }
+        else
+        {
+            lastBlock_ = index;
+        }
+        releaseBlock(next);
+    }
+
+    insertFree(index);
+}
+
+void RangeAllocator::grow(uint32_t newCapacity)
+{
+    if (newCapacity <= capacity_)
+    {
+        return;
+    }
+
+    uint32_t added = newCapacity - capacity_;
+    if (lastBlock_ != invalid && blocks_[lastBlock_].free)
+    {
+        removeFree(lastBlock_);
+        blocks_[lastBlock_].size += added;
+        insertFree(lastBlock_);
+    }
+    else
+    {
+        uint32_t index = newBlock(capacity_, added);
+        blocks_[index].prevPhysical = lastBlock_;
+        if (lastBlock_ != invalid)
+        {
+            blocks_[lastBlock_].nextPhysical = index;
+        }
+        lastBlock_ = index;
+        insertFree(index);
+    }
+    capacity_ = newCapacity;
+}
+
+uint32_t RangeAllocator::largestFree() const
+{
+    if (!flBitmap_)
+    {
+        return 0;
+    }
+    int fl = highestSetBit(flBitmap_);
+    int sl = highestSetBit(slBitmap_[fl]);
+    uint32_t largest = 0;
+    for (uint32_t index = freeHeads_[fl][sl]; index != invalid; index = blocks_[index].nextFree)
+    {
+        largest = std::max(largest, blocks_[index].size);
+    }
+    return largest;
+}
+
+/* Private Functions */
+
+uint32_t RangeAllocator::newBlock(uint32_t offset, uint32_t size)
+{
+    uint32_t index;
+    if (!unusedBlocks_.empty())
+    {
+        index = unusedBlocks_.back();
+        unusedBlocks_.pop_back();
+    }
+    else
+    {
+        index = (uint32_t)blocks_.size();
+        blocks_.emplace_back();
+    }
+    blocks_[index] = {offset, size, invalid, invalid, invalid, invalid, true};
+    return index;
+}
+
+void RangeAllocator::insertFree(uint32_t index)
+{
+    Block &block = blocks_[index];
+    int fl, sl;
+    mapping(block.size, fl, sl, slBits);
+
+    block.free = true;
+    block.prevFree = invalid;
+    block.nextFree = freeHeads_[fl][sl];
+    if (block.nextFree != invalid)
+    {
+        blocks_[block.nextFree].prevFree = index;
+    }
+    freeHeads_[fl][sl] = index;
+    flBitmap_ |= 1u << fl;
+    slBitmap_[fl] |= 1u << sl;
+}
+
+void RangeAllocator::removeFree(uint32_t index)
+{
+    Block &block = blocks_[index];
+    int fl, sl;
+    mapping(block.size, fl, sl, slBits);
+
+    if (block.prevFree != invalid)
+    {
+        blocks_[block.prevFree].nextFree = block.nextFree;
+    }
+    else
+    {
+        freeHeads_[fl][sl] = block.nextFree;
+    }
+    if (block.nextFree != invalid)
+    {
+        blocks_[block.nextFree].prevFree = block.prevFree;
+    }
+
+    if (freeHeads_[fl][sl] == invalid)
+    {
+        slBitmap_[fl] &= ~(1u << sl);
+        if (!slBitmap_[fl])
+        {
+            flBitmap_ &= ~(1u << fl);
+        }
+    }
+    block.free = false;
+}
+
+void RangeAllocator::releaseBlock(uint32_t index)
+{
+    blocks_[index].free = false;
+    unusedBlocks_.push_back(index);
+}
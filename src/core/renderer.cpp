@@ -2,137 +2,1293 @@
 #include "glm/fwd.hpp"
 #include "shader.h"
 #include "texture.h"
+#include "texture_streamer.h"
 
 #include "camera.h"
 #include "constants.h"
 #include "cube.h"
+#include "bvh.h"
+#include "draw_queue.h"
+#include "frame_arena.h"
+#include "frustum.h"
+#include "geometry_pool.h"
+#include "gl_state.h"
+#include "job_system.h"
+#include "light_buffers.h"
+#include "light_grid.h"
+#include "lod.h"
+#include "material_arrays.h"
+#include "mesh_simplify.h"
+#include "object_pool.h"
+#include "occlusion.h"
+#include "profiler.h"
+#include "resource_manager.h"
+#include "scene_store.h"
+#include "shader_manager.h"
+#include "shadow_maps.h"
+#include "sphere.h"
+#include "stats.h"
+#include "uniform_buffer.h"
 
 #include <glad/glad.h>
 #include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
 
 #include <SDL3/SDL.h>
+#include <stb_image.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
 
 GLint success;
 GLchar infoLog[512];
 
-Shader *lightingShader = nullptr;
-Shader *lightsourceShader = nullptr;
-Texture *cubeDiffTexture = nullptr;
-Texture *cubeSpecTexture = nullptr;
-Texture *lightsourceTexture = nullptr;
+// the app reads shaders from the source tree so edits reload without a rebuild, the benchmark reads the
+// copy next to its binary
+#if defined(SHADER_SOURCE_DIR)
+constexpr const char *shaderDirectory = SHADER_SOURCE_DIR;
+#else
+constexpr const char *shaderDirectory = "assets/shaders";
+#endif
+ShaderManager *shaderManager = nullptr;
+// textures, shaders and file meshes are loaded once through here and shared, see ResourceManager
+ResourceManager *resources = nullptr;
+size_t textureBudget = 0;
+ShaderRef lightsourceShader;
+TextureRef cubeDiffTexture;
+TextureRef cubeSpecTexture;
+TextureRef lightsourceTexture;
 Cube *cube = nullptr;
+Cube *crate = nullptr;
 Cube *lightsource = nullptr;
+Sphere *sphere = nullptr;
+constexpr float sphereRadius = 0.5f;
+constexpr unsigned sphereRings = 128;
+constexpr unsigned sphereSegments = 256;
+
+// crate, lamp and the distinct benchmark meshes share one set of buffers and draw in pooled batches,
+// the standalone cube above keeps its own VAO for the instanced benchmark
+GeometryPool *geometryPool = nullptr;
+constexpr size_t distinctMeshCount = 1024;
+ObjectPool<Cube> cubePool;
+std::vector<ObjectPool<Cube>::Handle> distinctMeshes;
+std::vector<uint32_t> distinctMeshIds;
+
+// the materials scene's crates cycle through tinted copies of the crate material. packed into one MaterialArrays
+// they draw in a single submission, separate they bind their own textures per material, see setMaterialArrays().
+// both sets are made the first time the scene is built
+constexpr size_t materialVariantCount = 64;
+bool materialArraysEnabled = true;
+bool bindlessMaterials = false;
+MaterialArrays *materialArrays = nullptr;
+ObjectPool<Texture> variantTexturePool;
+std::vector<uint32_t> packedMaterialIds;
+std::vector<uint32_t> separateMaterialIds;
+
+// textures decode on worker threads and show a placeholder until they are uploaded
+TextureStreamer *textureStreamer = nullptr;
+Uint64 streamStartNs = 0;
+
+// per-frame data shared by every program, uploaded once per frame regardless of how many programs read it
+UniformBuffer *cameraUbo = nullptr;
+UniformBuffer *lightsUbo = nullptr;
+UniformBuffer *clustersUbo = nullptr;
+
+// the lights scene's point lights, bobbing around their anchors and binned into clusters every frame
+constexpr size_t pointLightCount = 4096;
+PointLights pointLights;
+std::vector<glm::vec3> lightAnchors;
+std::vector<float> lightPhases;
+unsigned lightFrame = 0;
+LightGrid lightGrid;
+LightBuffers *lightBuffers = nullptr;
+
+// lighting.frag permutations, built the first time a scene needs them. uniform handles are resolved then so
+// the per-frame path never looks uniforms up by name
+struct LitShader
+{
+    const char *vertexFile;
+    ShaderPermutation permutation;
+    ShaderRef shader;
+    uint32_t id; // in the draw queue
+    UniformHandle<float> shininess;
+    UniformHandle<bool> instanced;
+};
+std::vector<LitShader> litShaders;
+// the one the crate material uses in the current scene
+size_t litShaderIndex = 0;
+// the normal matrix inverted per vertex (lighting_inverse.vert), see setShaderNormals()
+bool inverseNormals = false;
+
+// the lamp casts into a cube map and a sun into cascades, both drawn through shadowQueue. it holds the same
+// meshes under the same ids as drawQueue and only the depth shader
+bool shadowsEnabled = true;
+ShadowMaps *shadowMaps = nullptr;
+UniformBuffer *shadowsUbo = nullptr;
+DrawQueue shadowQueue;
+ShaderRef shadowShader;
+uint32_t shadowShaderId;
+UniformHandle<glm::mat4> shadowViewProjection;
+const glm::vec3 sunDirection = glm::normalize(glm::vec3(-0.4f, -1.0f, -0.3f));
+constexpr float cubeShadowFar = 50.0f;
+uint32_t *shadowVisible[ShadowMaps::passCount];
+size_t shadowCasters[ShadowMaps::passCount];
+
+// everything except the instanced benchmark draw is submitted here and replayed in sort-key order
+DrawQueue drawQueue;
+uint32_t lightsourceShaderId;
+uint32_t crateMaterialId;
+uint32_t lampMaterialId;
+uint32_t cubeMeshId;
+uint32_t lightsourceMeshId;
+uint32_t sphereMeshId;
+// shader each material is drawn with, indexed by material id
+std::vector<uint32_t> materialShaders;
 
 int scene = 0;
+const char *sceneNames[] = {"single", "per-object", "instanced", "distinct", "lights", "highpoly", "materials"};
+constexpr int sceneCount = sizeof(sceneNames) / sizeof(sceneNames[0]);
 
-GLenum polygonMode = GL_FILL;
+// everything drawn lives in the scene store, rebuilt whenever the scene or instance count changes. the
+// benchmark grid is submitted per cube (scene 1), drawn in a single instanced call (scene 2), or submitted
+// per cube cycling through distinctMeshCount different pooled meshes (scene 3). scene 4 draws the grid
+// instanced again, lit by pointLightCount point lights. scene 5 submits a grid of high-poly spheres per
+// object, every other one squashed so its normal matrix is a real inverse. scene 6 submits the crate grid per
+// object again, cycling through materialVariantCount materials
+SceneStore sceneStore;
+Entity lampEntity;
+constexpr size_t minInstances = 1;
+constexpr size_t maxInstances = 1 << 20;
+size_t instanceCount = 4096;
+// each sphere is ~65k triangles, past this the highpoly scene stops being interactive. with LOD distant spheres
+// cost a few hundred triangles and the cap is a lot higher
+constexpr size_t maxSpheres = 512;
+constexpr size_t maxLodSpheres = 32768;
+std::vector<InstanceData> benchInstances;
+bool sceneDirty = true;
 
+// frustum culling of the benchmark grid, either a linear SIMD sweep or a BVH query. occlusion sweeps like
+// linear and then tests the survivors against the biggest crates in view, rasterised on the CPU
+enum class CullMode
+{
+    Off,
+    Linear,
+    Bvh,
+    Occlusion,
+};
+const char *cullModeNames[] = {"off", "linear", "bvh", "occlusion"};
+constexpr int cullModeCount = sizeof(cullModeNames) / sizeof(cullModeNames[0]);
+CullMode cullMode = CullMode::Linear;
+OcclusionBuffer occlusionBuffer;
+constexpr size_t maxOccluders = 128;
+uint32_t *occluderRows = nullptr;
+size_t occluderCount = 0;
+size_t occludedCount = 0;
+Bvh benchBvh;
+std::vector<uint32_t> benchVisible;
+std::vector<InstanceData> visibleInstances;
+size_t visibleCount = 0;
+
+// the highpoly scene's spheres pick a level per object from how many pixels its error covers, see LodSelector.
+// the chain is simplified from the sphere's own geometry the first time the scene is built with LOD on, level 0
+// is the sphere itself. lodLevels holds the level each row was drawn with last, for the hysteresis
+bool lodEnabled = true;
+LodSelector lodSelector;
+constexpr size_t sphereLodLevels = 8;
+ObjectPool<Mesh> lodMeshPool;
+std::vector<uint32_t> sphereLodIds;
+std::vector<float> sphereLodErrors;
+std::vector<uint8_t> lodLevels;
+
+/*
+ *  Per-frame CPU work runs as jobs over fixed chunks of rows while the main thread keeps the GL context:
+ *
+ *      cull + count (per chunk) -> offsets (one job) -> sort keys + instance copies (per chunk)
+ *
+ *  With occlusion culling two stages go between culling and the offsets, and counting moves to the second:
+ *
+ *      occluders (one job) -> occlusion test + count (per chunk)
+ *
+ *  Each stage waits on the previous one's counter, the main thread uploads the frame's uniform buffers in
+ *  the meantime and then helps with whatever is left.
+ */
+JobSystem *jobSystem = nullptr;
+constexpr size_t chunkRows = 2048;
 
-// world space positions of our cubes
-glm::vec3 cubePositions[] = {
-    glm::vec3(0.0f, 0.0f, 1.0f),
-    glm::vec3(3.0f, 1.0f, 1.0f),
-    glm::vec3(1.0f, 1.0f, 3.0f),
-    glm::vec3(1.0f, 3.0f, 1.0f),
-    glm::vec3(-3.0f, -1.0f, -1.0f),
-    glm::vec3(-1.0f, -1.0f, -3.0f),
-    glm::vec3(-1.0f, -3.0f, -1.0f),
+// lists that only live for a frame (occluder candidates, shadow casters) are allocated here, the jobs that
+// fill them allocate concurrently
+FrameArena frameArena;
+
+struct FrameChunk
+{
+    size_t first;         // into benchVisible
+    size_t count;         // visible rows from first
+    size_t instances;     // how many of those are instanced grid cubes
+    size_t occluded;      // how many passed the frustum but not the occlusion test
+    size_t instanceSlot;  // first slot in visibleInstances
+    size_t drawSlot;      // first slot in the draw queue
 };
 
+struct FrameJobs
+{
+    Frustum frustum;
+    glm::mat4 viewProjection;
+    glm::vec3 viewPos;
+    bool bvhVisible;      // benchVisible already holds a BVH query result
+    bool occlusion;       // test what survives the frustum against occlusionBuffer
+    bool instancedGrid;   // grid cubes go to the instance buffer instead of the draw queue
+    bool copyInstances;   // culled frames rebuild the instance buffer, unculled ones reuse it
+    bool lod;             // spheres are swapped for the level of detail their distance calls for
+    std::vector<FrameChunk> chunks;
+} frameJobs;
+
+// frame time accumulator for the benchmark log
+Uint64 statsStartNs = 0;
+unsigned statsFrames = 0;
+
+GLenum polygonMode = GL_FILL;
+int viewportWidth = SCREEN_WIDTH;
+int viewportHeight = SCREEN_HEIGHT;
+float aspectRatio = (float)SCREEN_WIDTH / (float)SCREEN_HEIGHT;
+
+
+static bool instancedScene()
+{
+    return scene == 2 || scene == 4;
+}
+
+static bool lightsScene()
+{
+    return scene == 4;
+}
+
+static bool materialsScene()
+{
+    return scene == 6;
+}
+
+static void initLitShader(Shader *shader)
+{
+    shader->setInt("material.diffuse", 0);
+    shader->setInt("material.specular", 1);
+    LightBuffers::setSamplers(shader);
+    ShadowMaps::setSamplers(shader);
+    MaterialArrays::setSamplers(shader);
+}
+
+static const LitShader &litShader(bool inverse, ShaderPermutation permutation)
+{
+    const char *vertexFile = inverse ? "lighting_inverse.vert" : "lighting.vert";
+    for (const LitShader &lit : litShaders)
+    {
+        if (std::strcmp(lit.vertexFile, vertexFile) == 0 && lit.permutation == permutation)
+        {
+            return lit;
+        }
+    }
+
+    Uint64 startNs = SDL_GetTicksNS();
+    ShaderRef shader = resources->shader(vertexFile, "lighting.frag", permutation);
+    shader->setInitializer(initLitShader);
+
+    LitShader lit = {vertexFile,
+                     permutation,
+                     shader,
+                     drawQueue.addShader(shader.get()),
+                     shader->getUniform<float>("material.shininess"),
+                     shader->getUniform<bool>("instanced")};
+    litShaders.push_back(lit);
+    SDL_Log("shaders: %s + lighting.frag permutation %08x ready in %.2f ms", vertexFile, permutation,
+            (SDL_GetTicksNS() - startNs) / 1e6);
+    return litShaders.back();
+}
+
+// only the lights scene pays for the cluster lookup, and only shadowed frames for the sun and the lookups
+static void selectLitShader()
+{
+    uint32_t features = SpecularMapFeature | (lightsScene() ? ClusteredLightsFeature : (uint32_t)0);
+    features |= shadowsEnabled ? ShadowsFeature : (uint32_t)0;
+    uint32_t lightCount = shadowsEnabled ? 2 : 1;
+    const LitShader &lit = litShader(inverseNormals, makePermutation(features, lightCount));
+    litShaderIndex = &lit - litShaders.data();
+    materialShaders[crateMaterialId] = lit.id;
+    for (uint32_t material : separateMaterialIds)
+    {
+        materialShaders[material] = lit.id;
+    }
+
+    if (materialsScene() && materialArrays)
+    {
+        // packed materials read their maps from the arrays, the permutation without a specular map does too
+        features = (features & ~SpecularMapFeature) | materialArrays->shaderFeatures();
+        uint32_t packed = litShader(inverseNormals, makePermutation(features, lightCount)).id;
+        for (uint32_t material : packedMaterialIds)
+        {
+            materialShaders[material] = packed;
+        }
+    }
+}
+
+// both queues index meshes the same way
+static uint32_t addMesh(Mesh *mesh)
+{
+    shadowQueue.addMesh(mesh);
+    return drawQueue.addMesh(mesh);
+}
+
+static void buildSphereLods()
+{
+    Uint64 startNs = SDL_GetTicksNS();
+    std::vector<meshopt::MeshLod> chain =
+        meshopt::buildLodChain(Sphere::buildVertices(sphereRadius, sphereRings, sphereSegments),
+                               Sphere::buildIndices(sphereRings, sphereSegments), sphereLodLevels);
+    sphereLodIds = {sphereMeshId};
+    sphereLodErrors = {0.0f};
+    for (size_t level = 1; level < chain.size(); level++)
+    {
+        Mesh *mesh = lodMeshPool.get(lodMeshPool.create(chain[level].vertices, chain[level].indices));
+        sphereLodIds.push_back(addMesh(mesh));
+        sphereLodErrors.push_back(chain[level].error);
+    }
+    SDL_Log("lod: sphere simplified to %zu levels in %.2f ms, %zu triangles at error %.5f", chain.size(),
+            (SDL_GetTicksNS() - startNs) / 1e6, chain.back().indices.size() / 3, chain.back().error);
+}
+
+// the level a sphere with this model matrix should be drawn with, seen from viewPos and drawn with current last
+static uint32_t sphereLod(const glm::mat4 &model, const glm::vec3 &viewPos, uint32_t current)
+{
+    float scale = std::sqrt(std::max({glm::dot(glm::vec3(model[0]), glm::vec3(model[0])),
+                                      glm::dot(glm::vec3(model[1]), glm::vec3(model[1])),
+                                      glm::dot(glm::vec3(model[2]), glm::vec3(model[2]))}));
+    float distance = glm::distance(viewPos, glm::vec3(model[3])) - sphereRadius * scale;
+    return lodSelector.select(sphereLodErrors.data(), (uint32_t)sphereLodErrors.size(), current, distance, scale);
+}
+
+// every variant tints the crate's diffuse map a different hue and keeps its specular map
+static void buildMaterialVariants()
+{
+    Uint64 startNs = SDL_GetTicksNS();
+    int width, height, channels, specWidth, specHeight, specChannels;
+    // tinting needs colour, the specular map goes in with however many channels it has
+    unsigned char *diffuse = stbi_load("assets/textures/crate_1.png", &width, &height, &channels, 4);
+    unsigned char *specular =
+        stbi_load("assets/textures/crate_1_spec.png", &specWidth, &specHeight, &specChannels, 0);
+    if (!diffuse || !specular || width != specWidth || height != specHeight)
+    {
+        SDL_Log("materials: couldn't load the crate maps, the materials scene uses the crate material");
+        stbi_image_free(diffuse);
+        stbi_image_free(specular);
+        return;
+    }
+
+    materialArrays = new MaterialArrays(width, height, materialVariantCount, bindlessMaterials);
+    uint32_t specularLayer = materialArrays->addSpecular(specular, width, height, specChannels);
+    Texture *specularTexture = variantTexturePool.get(variantTexturePool.create(GL_TEXTURE1));
+    specularTexture->upload(specular, width, height, specChannels);
+
+    std::vector<unsigned char> tinted((size_t)width * height * 4);
+    for (size_t variant = 0; variant < materialVariantCount; variant++)
+    {
+        float hue = variant * 6.0f / materialVariantCount;
+        glm::vec3 color = glm::clamp(glm::vec3(std::abs(hue - 3.0f) - 1.0f, 2.0f - std::abs(hue - 2.0f),
+                                               2.0f - std::abs(hue - 4.0f)),
+                                     0.0f, 1.0f);
+        glm::vec3 tint = glm::mix(glm::vec3(1.0f), color, 0.6f);
+        for (size_t i = 0; i < tinted.size(); i += 4)
+        {
+            for (int c = 0; c < 3; c++)
+            {
+                tinted[i + c] = (unsigned char)(diffuse[i + c] * tint[c]);
+            }
+            tinted[i + 3] = diffuse[i + 3];
+        }
+
+        uint32_t layer = materialArrays->addDiffuse(tinted.data(), width, height, 4);
+        uint32_t index = materialArrays->addMaterial(layer, specularLayer, 32.0f);
+        packedMaterialIds.push_back(drawQueue.addMaterial({nullptr, nullptr, 32.0f, materialArrays, index}));
+
+        Texture *texture = variantTexturePool.get(variantTexturePool.create(GL_TEXTURE0));
+        texture->upload(tinted.data(), width, height, 4);
+        separateMaterialIds.push_back(drawQueue.addMaterial({texture, specularTexture, 32.0f}));
+    }
+    materialArrays->finish();
+    materialShaders.resize(separateMaterialIds.back() + 1);
+    stbi_image_free(diffuse);
+    stbi_image_free(specular);
+    SDL_Log("materials: %zu crate variants in %.2f ms", materialVariantCount, (SDL_GetTicksNS() - startNs) / 1e6);
+}
+
+static void addObject(const Transform &transform, Mesh *mesh, uint32_t meshId, uint32_t materialId)
+{
+    sceneStore.create(transform, mesh->boundsMin(), mesh->boundsMax(), meshId, materialId);
+}
+
+static void buildScene()
+{
+    if (materialsScene() && !materialArrays)
+    {
+        buildMaterialVariants();
+    }
+    selectLitShader();
+    if (scene == 5 && lodEnabled && sphereLodIds.empty())
+    {
+        buildSphereLods();
+    }
+    sceneStore.clear();
+    sceneStore.reserve(scene == 0 ? 2 : instanceCount + 1);
+
+    Transform lamp;
+    lamp.position = glm::vec3(1.2f, 1.0f, 2.0f);
+    lamp.scale = glm::vec3(0.2f);
+    lampEntity = sceneStore.create(lamp, lightsource->boundsMin(), lightsource->boundsMax(), lightsourceMeshId,
+                                   lampMaterialId);
+
+    if (scene == 0)
+    {
+        addObject(Transform(), crate, cubeMeshId, crateMaterialId);
+    }
+    else
+    {
+        size_t count = scene == 5 ? std::min(instanceCount, lodEnabled ? maxLodSpheres : maxSpheres) : instanceCount;
+        int side = (int)std::ceil(std::cbrt((double)count));
+        float spacing = 1.5f;
+        float offset = (side - 1) * spacing / 2.0f;
+        glm::vec3 rotAxis = glm::normalize(glm::vec3(1.0f, 0.3f, 0.5f));
+
+        for (size_t i = 0; i < count; i++)
+        {
+            int x = i % side;
+            int y = (i / side) % side;
+            int z = i / (side * side);
+
+            Transform transform;
+            transform.position = glm::vec3(x * spacing - offset, y * spacing - offset, -z * spacing - 2.0f);
+            transform.rotation = glm::angleAxis(glm::radians(20.0f * (i % 18)), rotAxis);
+            if (scene == 3)
+            {
+                size_t mesh = i % distinctMeshCount;
+                addObject(transform, cubePool.get(distinctMeshes[mesh]), distinctMeshIds[mesh], crateMaterialId);
+            }
+            else if (scene == 5)
+            {
+                transform.scale = i % 2 ? glm::vec3(1.2f, 0.6f, 1.0f) : glm::vec3(1.0f);
+                addObject(transform, sphere, sphereMeshId, crateMaterialId);
+            }
+            else if (scene == 6 && materialArrays)
+            {
+                const std::vector<uint32_t> &variants = materialArraysEnabled ? packedMaterialIds : separateMaterialIds;
+                addObject(transform, crate, cubeMeshId, variants[i % variants.size()]);
+            }
+            else
+            {
+                addObject(transform, crate, cubeMeshId, crateMaterialId);
+            }
+        }
+    }
+    sceneStore.updateTransforms(jobSystem);
+
+    // lights scatter through the grid and a little past it, anchors are where they bob around
+    pointLights.clear();
+    lightAnchors.clear();
+    lightPhases.clear();
+    lightFrame = 0;
+    if (lightsScene())
+    {
+        int side = (int)std::ceil(std::cbrt((double)instanceCount));
+        float extent = side * 1.5f / 2.0f + 2.0f;
+        std::mt19937 rng(7);
+        std::uniform_real_distribution<float> across(-extent, extent);
+        std::uniform_real_distribution<float> along(-2.0f * extent, 0.0f);
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+        pointLights.reserve(pointLightCount);
+        for (size_t i = 0; i < pointLightCount; i++)
+        {
+            glm::vec3 anchor(across(rng), across(rng), along(rng) - 1.0f);
+            float radius = 1.5f + 1.5f * unit(rng);
+            // fully saturated hues so overlapping lights stay visible as separate colours
+            float hue = unit(rng) * 6.0f;
+            glm::vec3 color = glm::clamp(glm::vec3(std::abs(hue - 3.0f) - 1.0f, 2.0f - std::abs(hue - 2.0f),
+                                                   2.0f - std::abs(hue - 4.0f)),
+                                         0.0f, 1.0f);
+            lightAnchors.push_back(anchor);
+            lightPhases.push_back(unit(rng) * 6.2831853f);
+            pointLights.push(anchor, radius, color * 2.0f);
+        }
+    }
+
+    // nothing moves after the build, so the BVH is built once here rather than refit per frame
+    const BoundsSoA &bounds = sceneStore.worldBounds();
+    std::vector<Aabb> aabbs(bounds.size());
+    for (size_t i = 0; i < aabbs.size(); i++)
+    {
+        glm::vec3 center(bounds.centerX[i], bounds.centerY[i], bounds.centerZ[i]);
+        glm::vec3 extents(bounds.extentX[i], bounds.extentY[i], bounds.extentZ[i]);
+        aabbs[i] = {center - extents, center + extents};
+    }
+    benchBvh.build(aabbs);
+    benchVisible.resize(sceneStore.size());
+    lodLevels.assign(sceneStore.size(), 0);
+
+    // the instanced scene draws its grid from one buffer and the lamp through the draw queue. instance data is
+    // kept per row so culled frames only copy, and the unculled buffer is uploaded once here
+    benchInstances.clear();
+    if (instancedScene())
+    {
+        const std::vector<glm::mat4> &world = sceneStore.worldMatrices();
+        const std::vector<glm::mat3> &normals = sceneStore.normalMatrices();
+        const std::vector<uint32_t> &meshes = sceneStore.meshes();
+        visibleInstances.clear();
+        for (size_t i = 0; i < world.size(); i++)
+        {
+            benchInstances.emplace_back(world[i], normals[i]);
+            if (meshes[i] == cubeMeshId)
+            {
+                visibleInstances.push_back(benchInstances.back());
+            }
+        }
+        cube->setInstances(visibleInstances);
+    }
+    sceneDirty = false;
+}
+
+static void countInstances(FrameChunk &chunk)
+{
+    const std::vector<uint32_t> &meshes = sceneStore.meshes();
+    const uint32_t *visible = benchVisible.data() + chunk.first;
+    chunk.instances = 0;
+    if (frameJobs.instancedGrid)
+    {
+        for (size_t i = 0; i < chunk.count; i++)
+        {
+            chunk.instances += meshes[visible[i]] == cubeMeshId;
+        }
+    }
+}
+
+static void cullChunks(void *, size_t begin, size_t end)
+{
+    for (size_t c = begin; c < end; c++)
+    {
+        FrameChunk &chunk = frameJobs.chunks[c];
+        uint32_t *visible = benchVisible.data() + chunk.first;
+        if (!frameJobs.bvhVisible)
+        {
+            size_t last = std::min(chunk.first + chunkRows, sceneStore.size());
+            if (cullMode == CullMode::Linear || cullMode == CullMode::Occlusion)
+            {
+                chunk.count = culling::cullAabbsSimd(frameJobs.frustum, sceneStore.worldBounds(), chunk.first, last,
+                                                     visible);
+            }
+            else
+            {
+                chunk.count = last - chunk.first;
+                for (size_t i = 0; i < chunk.count; i++)
+                {
+                    visible[i] = (uint32_t)(chunk.first + i);
+                }
+            }
+        }
+
+        chunk.occluded = 0;
+        if (!frameJobs.occlusion)
+        {
+            countInstances(chunk);
+        }
+    }
+}
+
+// crates are the only occluders, they are solid and fill their bounds exactly
+static void drawOccluders(void *, size_t, size_t)
+{
+    const std::vector<uint32_t> &meshes = sceneStore.meshes();
+    size_t candidates = 0;
+    for (const FrameChunk &chunk : frameJobs.chunks)
+    {
+        candidates += chunk.count;
+    }
+    occluderRows = frameArena.allocate<uint32_t>(candidates);
+    candidates = 0;
+    for (const FrameChunk &chunk : frameJobs.chunks)
+    {
+        const uint32_t *visible = benchVisible.data() + chunk.first;
+        for (size_t i = 0; i < chunk.count; i++)
+        {
+            if (meshes[visible[i]] == cubeMeshId)
+            {
+                occluderRows[candidates++] = visible[i];
+            }
+        }
+    }
+    occluderCount = OcclusionBuffer::pickOccluders(sceneStore.worldBounds(), frameJobs.viewPos, occluderRows,
+                                                   candidates, maxOccluders);
+
+    const std::vector<glm::mat4> &world = sceneStore.worldMatrices();
+    occlusionBuffer.begin(frameJobs.viewProjection);
+    for (size_t i = 0; i < occluderCount; i++)
+    {
+        occlusionBuffer.drawBox(world[occluderRows[i]], crate->boundsMin(), crate->boundsMax());
+    }
+    occlusionBuffer.finish();
+}
+
+static void occludeChunks(void *, size_t begin, size_t end)
+{
+    for (size_t c = begin; c < end; c++)
+    {
+        FrameChunk &chunk = frameJobs.chunks[c];
+        size_t count = occlusionBuffer.cull(sceneStore.worldBounds(), benchVisible.data() + chunk.first, chunk.count);
+        chunk.occluded = chunk.count - count;
+        chunk.count = count;
+        countInstances(chunk);
+    }
+}
+
+static void assignSlots(void *, size_t, size_t)
+{
+    size_t visible = 0;
+    size_t instances = 0;
+    size_t occluded = 0;
+    for (FrameChunk &chunk : frameJobs.chunks)
+    {
+        chunk.instanceSlot = instances;
+        chunk.drawSlot = visible - instances;
+        visible += chunk.count;
+        instances += chunk.instances;
+        occluded += chunk.occluded;
+    }
+    visibleCount = visible;
+    occludedCount = occluded;
+
+    size_t firstDraw = drawQueue.reserve(visible - instances);
+    for (FrameChunk &chunk : frameJobs.chunks)
+    {
+        chunk.drawSlot += firstDraw;
+    }
+    if (frameJobs.copyInstances)
+    {
+        visibleInstances.resize(instances);
+    }
+}
+
+static void writeChunks(void *, size_t begin, size_t end)
+{
+    const std::vector<glm::mat4> &world = sceneStore.worldMatrices();
+    const std::vector<glm::mat3> &normals = sceneStore.normalMatrices();
+    const std::vector<uint32_t> &meshes = sceneStore.meshes();
+    const std::vector<uint32_t> &materials = sceneStore.materials();
+    for (size_t c = begin; c < end; c++)
+    {
+        const FrameChunk &chunk = frameJobs.chunks[c];
+        const uint32_t *visible = benchVisible.data() + chunk.first;
+        size_t instanceSlot = chunk.instanceSlot;
+        size_t drawSlot = chunk.drawSlot;
+        for (size_t i = 0; i < chunk.count; i++)
+        {
+            uint32_t row = visible[i];
+            if (frameJobs.instancedGrid && meshes[row] == cubeMeshId)
+            {
+                if (frameJobs.copyInstances)
+                {
+                    visibleInstances[instanceSlot] = benchInstances[row];
+                }
+                instanceSlot++;
+                continue;
+            }
+            const glm::mat4 &m = world[row];
+            glm::vec3 pos(m[3]);
+            uint32_t material = materials[row];
+            uint32_t mesh = meshes[row];
+            if (frameJobs.lod && mesh == sphereMeshId)
+            {
+                lodLevels[row] = (uint8_t)sphereLod(m, frameJobs.viewPos, lodLevels[row]);
+                mesh = sphereLodIds[lodLevels[row]];
+            }
+            drawQueue.write(drawSlot++, materialShaders[material], material, mesh, m, normals[row],
+                            glm::distance(frameJobs.viewPos, pos));
+        }
+    }
+}
+
+// one pass per cascade and cube face, culled against the pass' own frustum. the lamp is emissive and sits
+// inside its own cube, so it casts nothing
+static void cullShadowPasses(void *, size_t begin, size_t end)
+{
+    const std::vector<uint32_t> &materials = sceneStore.materials();
+    for (size_t pass = begin; pass < end; pass++)
+    {
+        uint32_t *visible = frameArena.allocate<uint32_t>(sceneStore.size());
+        shadowVisible[pass] = visible;
+        Frustum frustum = Frustum::fromMatrix(shadowMaps->passMatrix(pass));
+        size_t count = culling::cullAabbsSimd(frustum, sceneStore.worldBounds(), visible);
+
+        size_t casters = 0;
+        for (size_t i = 0; i < count; i++)
+        {
+            if (materials[visible[i]] != lampMaterialId)
+            {
+                visible[casters++] = visible[i];
+            }
+        }
+        shadowCasters[pass] = casters;
+    }
+}
+
+static void renderShadows(const CameraBlock &camera, const glm::vec3 &lampPos, float nearPlane, float farPlane)
+{
+    PROFILE_CPU("shadows");
+    shadowMaps->fitCascades(sunDirection, camera.view, camera.projection, nearPlane, farPlane);
+    shadowMaps->placeCube(lampPos, cubeShadowFar);
+
+    JobCounter culled;
+    jobSystem->parallelFor(ShadowMaps::passCount, 1, cullShadowPasses, nullptr, culled);
+    jobSystem->wait(culled);
+
+    const std::vector<glm::mat4> &world = sceneStore.worldMatrices();
+    const std::vector<glm::mat3> &normals = sceneStore.normalMatrices();
+    const std::vector<uint32_t> &meshes = sceneStore.meshes();
+
+    shadowMaps->begin();
+    glstate::polygonMode(GL_FILL);
+    shadowShader->use();
+    for (size_t pass = 0; pass < ShadowMaps::passCount; pass++)
+    {
+        shadowMaps->beginPass(pass);
+        shadowShader->set(shadowViewProjection, shadowMaps->passMatrix(pass));
+
+        // one material and no depth, depth-only draws gain more from batching than from their order
+        shadowQueue.begin(farPlane);
+        size_t slot = shadowQueue.reserve(shadowCasters[pass]);
+        for (size_t i = 0; i < shadowCasters[pass]; i++)
+        {
+            uint32_t row = shadowVisible[pass][i];
+            uint32_t mesh = meshes[row];
+            // the camera's jobs are still writing lodLevels, casters take the coarsest level that passes as
+            // it is, without hysteresis
+            if (frameJobs.lod && mesh == sphereMeshId)
+            {
+                uint32_t coarsest = (uint32_t)sphereLodIds.size() - 1;
+                mesh = sphereLodIds[sphereLod(world[row], glm::vec3(camera.viewPos), coarsest)];
+            }
+            shadowQueue.write(slot++, shadowShaderId, 0, mesh, world[row], normals[row], 0.0f);
+        }
+        shadowQueue.flush(true);
+    }
+    shadowMaps->end();
+    glstate::polygonMode(polygonMode);
+    glViewport(0, 0, viewportWidth, viewportHeight);
+}
+
+static void logFrameStats()
+{
+    Uint64 now = SDL_GetTicksNS();
+    if (statsStartNs == 0)
+    {
+        statsStartNs = now;
+        return;
+    }
+
+    statsFrames++;
+    Uint64 elapsed = now - statsStartNs;
+    if (elapsed < SDL_NS_PER_SECOND)
+    {
+        return;
+    }
+
+    double avgMs = (double)elapsed / statsFrames / 1e6;
+    size_t objects = sceneStore.size();
+    SDL_Log("scene %s: %zu objects, %.3f ms/frame (%u frames)", sceneNames[scene], objects, avgMs, statsFrames);
+    const char *path = cullMode == CullMode::Linear || cullMode == CullMode::Occlusion ? culling::simdPath() : "";
+    SDL_Log("  culling %s %s: %zu/%zu visible", cullModeNames[(int)cullMode], path, visibleCount, objects);
+    if (cullMode == CullMode::Occlusion)
+    {
+        SDL_Log("  occlusion %s: %zu occluded behind %zu occluders (%zu triangles at %dx%d)",
+                OcclusionBuffer::simdPath(), occludedCount, occluderCount, occlusionBuffer.triangles(),
+                occlusionBuffer.width(), occlusionBuffer.height());
+    }
+    if (lightsScene())
+    {
+        SDL_Log("  point lights: %zu in %u clusters, %zu light indices, at most %u per cluster (%s)", pointLights.size(),
+                LightGrid::clusterCount, lightGrid.indices().size(), lightGrid.maxClusterLights(),
+                LightGrid::simdPath());
+    }
+
+    const stats::FrameCounters &counters = stats::last();
+    SDL_Log("  uniforms/frame: %llu uploads, %llu driver location queries, %llu name lookups",
+            (unsigned long long)counters.uniformUploads, (unsigned long long)counters.uniformLocationQueries,
+            (unsigned long long)counters.uniformNameLookups);
+    SDL_Log("  uniform buffer updates/frame: %llu", (unsigned long long)counters.uniformBufferUpdates);
+    SDL_Log("  draw calls/frame: %llu (%llu pooled commands)", (unsigned long long)counters.drawCalls,
+            (unsigned long long)counters.indirectCommands);
+    SDL_Log("  triangles/frame: %llu", (unsigned long long)counters.triangles);
+    if (materialsScene() && materialArrays)
+    {
+        SDL_Log("  materials: %zu crate variants, %s", materialVariantCount,
+                !materialArraysEnabled       ? "separate textures"
+                : materialArrays->bindless() ? "packed, bindless textures"
+                                             : "packed in texture arrays");
+    }
+    if (frameJobs.lod && scene == 5)
+    {
+        const std::vector<uint32_t> &meshes = sceneStore.meshes();
+        size_t levels[sphereLodLevels] = {};
+        for (const FrameChunk &chunk : frameJobs.chunks)
+        {
+            for (size_t i = chunk.first; i < chunk.first + chunk.count; i++)
+            {
+                levels[lodLevels[benchVisible[i]]] += meshes[benchVisible[i]] == sphereMeshId;
+            }
+        }
+        SDL_Log("  lod: %.1f px threshold, visible spheres per level %zu %zu %zu %zu %zu %zu %zu %zu",
+                lodSelector.threshold, levels[0], levels[1], levels[2], levels[3], levels[4], levels[5], levels[6],
+                levels[7]);
+    }
+    SDL_Log("  state changes/frame: %llu issued, %llu skipped", (unsigned long long)counters.stateChangesIssued,
+            (unsigned long long)counters.stateChangesSkipped);
+    SDL_Log("  heap allocations/frame: %llu (%llu bytes), frame arena %.1f of %.1f KiB",
+            (unsigned long long)counters.heapAllocations, (unsigned long long)counters.heapBytes,
+            frameArena.used() / 1024.0, frameArena.capacity() / 1024.0);
+    statsStartNs = now;
+    statsFrames = 0;
+}
+
+static void resetFrameStats()
+{
+    statsStartNs = 0;
+    statsFrames = 0;
+}
+
+void renderer::resize(int width, int height)
+{
+    if (width <= 0 || height <= 0)
+    {
+        return;
+    }
+    glViewport(0, 0, width, height);
+    viewportWidth = width;
+    viewportHeight = height;
+    aspectRatio = (float)width / (float)height;
+}
+
 void renderer::nextScene()
 {
-    scene = (scene + 1) % 3;
+    scene = (scene + 1) % sceneCount;
+    sceneDirty = true;
+    resetFrameStats();
+}
+
+void renderer::scaleInstances(bool up)
+{
+    size_t next = up ? instanceCount * 2 : instanceCount / 2;
+    if (next < minInstances || next > maxInstances)
+    {
+        return;
+    }
+    instanceCount = next;
+    sceneDirty = true;
+    resetFrameStats();
+}
+
+void renderer::toggleCulling()
+{
+    cullMode = (CullMode)(((int)cullMode + 1) % cullModeCount);
+    sceneDirty = true;
+    resetFrameStats();
+}
+
+void renderer::toggleShadows()
+{
+    setShadows(!shadowsEnabled);
+}
+
+void renderer::toggleLod()
+{
+    setLod(!lodEnabled);
+}
+
+void renderer::toggleMaterialArrays()
+{
+    setMaterialArrays(!materialArraysEnabled);
+}
+
+// cast a ray from the camera along its view direction and report the first object it hits
+void renderer::pick(Camera *camera)
+{
+    RayHit hit = benchBvh.raycast(camera->getPosition(), camera->getFront(), 100.0f);
+    if (hit.hit())
+    {
+        Entity entity = sceneStore.entities()[hit.object];
+        glm::vec3 pos = sceneStore.positions()[hit.object];
+        SDL_Log("picked entity %u (generation %u) at (%.2f, %.2f, %.2f), %.2f units away", entity.index,
+                entity.generation, pos.x, pos.y, pos.z, hit.distance);
+    }
+    else
+    {
+        SDL_Log("picked nothing");
+    }
+}
+
+bool renderer::setScene(const char *name)
+{
+    for (int i = 0; i < sceneCount; i++)
+    {
+        if (std::strcmp(sceneNames[i], name) == 0)
+        {
+            scene = i;
+            sceneDirty = true;
+            resetFrameStats();
+            return true;
+        }
+    }
+    return false;
+}
+
+bool renderer::setCulling(const char *name)
+{
+    for (int i = 0; i < cullModeCount; i++)
+    {
+        if (std::strcmp(cullModeNames[i], name) == 0)
+        {
+            cullMode = (CullMode)i;
+            sceneDirty = true;
+            resetFrameStats();
+            return true;
+        }
+    }
+    return false;
+}
+
+void renderer::setInstanceCount(size_t count)
+{
+    instanceCount = std::clamp(count, minInstances, maxInstances);
+    sceneDirty = true;
+    resetFrameStats();
+}
+
+void renderer::setShadows(bool enabled)
+{
+    shadowsEnabled = enabled;
+    selectLitShader();
+    resetFrameStats();
+}
+
+void renderer::setLod(bool enabled)
+{
+    lodEnabled = enabled;
+    sceneDirty = true;
+    resetFrameStats();
+}
+
+void renderer::setMaterialArrays(bool enabled)
+{
+    materialArraysEnabled = enabled;
+    sceneDirty = true;
+    resetFrameStats();
+}
+
+void renderer::setShaderNormals(bool enabled)
+{
+    inverseNormals = enabled;
+    selectLitShader();
+    resetFrameStats();
+}
+
+void renderer::setBindlessMaterials(bool enabled)
+{
+    bindlessMaterials = enabled;
+}
+
+void renderer::setTextureBudget(size_t bytes)
+{
+    textureBudget = bytes;
+    if (resources)
+    {
+        resources->setTextureBudget(bytes);
+    }
+}
+
+void renderer::logResources()
+{
+    resources->report();
+}
+
+bool renderer::texturesResident()
+{
+    return streamStartNs == 0;
+}
+
+size_t renderer::visibleObjects()
+{
+    return visibleCount;
 }
 
 void renderer::swapPolygonMode()
 {
     polygonMode = polygonMode == GL_FILL ? GL_LINE : GL_FILL;
-    glPolygonMode(GL_FRONT_AND_BACK, polygonMode);
+    glstate::polygonMode(polygonMode);
 }
 
 void renderer::init()
 {
-    lightingShader = new Shader("assets/shaders/lighting.vert", "assets/shaders/lighting.frag");
-    lightsourceShader = new Shader("assets/shaders/lightsource.vert", "assets/shaders/lightsource.frag");
+    jobSystem = new JobSystem();
+    SDL_Log("job system: %u threads", jobSystem->threadCount());
 
-    cubeDiffTexture = new Texture("crate_1", GL_TEXTURE0);
-    cubeSpecTexture = new Texture("crate_1_spec", GL_TEXTURE1);
-    lightsourceTexture = new Texture("lamp_1_emission", GL_TEXTURE0);
+    Uint64 shadersStartNs = SDL_GetTicksNS();
+    shaderManager = new ShaderManager(shaderDirectory);
+    textureStreamer = new TextureStreamer();
+    resources = new ResourceManager(textureStreamer, shaderManager, textureBudget);
+    // the default lighting permutation, the others are built when a scene first asks for them
+    Shader *lightingShader = litShader(false, makePermutation(SpecularMapFeature, 1)).shader.get();
+    lightsourceShader = resources->shader("lightsource.vert", "lightsource.frag");
+    SDL_Log("shaders: %zu from the binary cache, %zu compiled in %.2f ms", shaderManager->cacheHits(),
+            shaderManager->compiles(), (SDL_GetTicksNS() - shadersStartNs) / 1e6);
+
+    streamStartNs = SDL_GetTicksNS();
+    cubeDiffTexture = resources->texture("crate_1", GL_TEXTURE0);
+    cubeSpecTexture = resources->texture("crate_1_spec", GL_TEXTURE1);
+    lightsourceTexture = resources->texture("lamp_1_emission", GL_TEXTURE0);
+
+    geometryPool = new GeometryPool(Cube::vertexLayout());
 
     glm::vec3 lightsourceObjSize(1.0f, 1.0f, 1.0f);
-    lightsource = new Cube(lightsourceObjSize, lightsourceShader, lightsourceTexture, lightsourceTexture);
+    lightsource = new Cube(lightsourceObjSize, lightsourceShader.get(), lightsourceTexture.get(),
+                           lightsourceTexture.get(), geometryPool);
 
     glm::vec3 recSize(1.0f, 1.0f, 1.0f);
-    cube = new Cube(recSize, lightingShader, cubeDiffTexture, cubeSpecTexture);
+    cube = new Cube(recSize, lightingShader, cubeDiffTexture.get(), cubeSpecTexture.get());
+    crate = new Cube(recSize, lightingShader, cubeDiffTexture.get(), cubeSpecTexture.get(), geometryPool);
+    // ~33k vertices, its own buffers so it is drawn per object through the model uniforms
+    sphere = new Sphere(sphereRadius, sphereRings, sphereSegments);
+
+    cameraUbo = new UniformBuffer(CameraBinding, sizeof(CameraBlock));
+    lightsUbo = new UniformBuffer(LightsBinding, sizeof(LightBlock));
+    clustersUbo = new UniformBuffer(ClustersBinding, sizeof(ClusterBlock));
+    lightBuffers = new LightBuffers();
+    shadowMaps = new ShadowMaps();
+    shadowsUbo = new UniformBuffer(ShadowsBinding, sizeof(ShadowBlock));
+    shadowShader = resources->shader("shadow_depth.vert", "shadow_depth.frag");
+    shadowShaderId = shadowQueue.addShader(shadowShader.get());
+    shadowViewProjection = shadowShader->getUniform<glm::mat4>("lightViewProjection");
 
-    glEnable(GL_DEPTH_TEST);
+    lightsourceShaderId = drawQueue.addShader(lightsourceShader.get());
+    crateMaterialId = drawQueue.addMaterial({cubeDiffTexture.get(), cubeSpecTexture.get(), 32.0f});
+    lampMaterialId = drawQueue.addMaterial({lightsourceTexture.get(), lightsourceTexture.get(), 0.0f});
+    cubeMeshId = addMesh(crate);
+    lightsourceMeshId = addMesh(lightsource);
+    sphereMeshId = addMesh(sphere);
+    materialShaders.resize(std::max(crateMaterialId, lampMaterialId) + 1);
+    materialShaders[crateMaterialId] = litShaders[litShaderIndex].id;
+    materialShaders[lampMaterialId] = lightsourceShaderId;
+
+    // boxes of slightly different proportions, so every one is its own mesh in the pool
+    for (size_t i = 0; i < distinctMeshCount; i++)
+    {
+        glm::vec3 size(0.6f + 0.05f * (i % 9), 0.6f + 0.05f * ((i / 9) % 9), 0.6f + 0.05f * ((i / 81) % 9));
+        ObjectPool<Cube>::Handle handle =
+            cubePool.create(size, lightingShader, cubeDiffTexture.get(), cubeSpecTexture.get(), geometryPool);
+        distinctMeshes.push_back(handle);
+        distinctMeshIds.push_back(addMesh(cubePool.get(handle)));
+    }
+
+    glstate::setDepthTest(true);
 }
 
 void renderer::render(Camera *camera)
 {
+    PROFILE_GPU("scene");
+
     glClearColor(0.2f, 0.2f, 0.2f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    frameArena.beginFrame();
 
-    lightingShader->use();
+    {
+        // evicted textures stream back in long after the first load, so this runs every frame
+        PROFILE_CPU("texture streaming");
+        if (textureStreamer->pump() && streamStartNs && textureStreamer->pending() == 0)
+        {
+            SDL_Log("textures resident after %.2f ms", (SDL_GetTicksNS() - streamStartNs) / 1e6);
+            streamStartNs = 0;
+        }
+        resources->update();
+    }
 
-    glm::vec3 lightPos(1.2f, 1.0f, 2.0f);
-    glm::vec3 lightColor(1.0f, 1.0f, 1.0f);
+    shaderManager->poll();
+
+    if (sceneDirty)
+    {
+        buildScene();
+    }
 
-    glm::vec3 lightSpecular(1.0f, 1.0f, 1.0f);
-    glm::vec3 lightDiffuse = lightColor * glm::vec3(0.5f);
-    glm::vec3 lightAmbient = lightColor * glm::vec3(0.3f);
-    lightingShader->setVec3("light.position", lightPos);
-    lightingShader->setVec3("light.ambient", lightAmbient);
-    lightingShader->setVec3("light.diffuse", lightDiffuse);
-    lightingShader->setVec3("light.specular", lightSpecular);
+    {
+        PROFILE_CPU("transforms");
+        sceneStore.updateTransforms(jobSystem);
+    }
 
-    glm::vec3 specular(0.5f, 0.5f, 0.5f);
-    float shininess = 32.0f;
-    lightingShader->setFloat("material.shininess", shininess);
+    glm::vec3 lightPos = sceneStore.transform(lampEntity).position;
+    glm::vec3 lightColor(1.0f, 1.0f, 1.0f);
 
     // view/projection transformations
-    glm::mat4 projection = camera->getProjection((float)SCREEN_WIDTH / (float)SCREEN_HEIGHT, 0.1f, 100.0f);
-    glm::mat4 view = camera->getViewMatrix();
-    glm::vec3 viewPos = camera->getPosition();
-    lightingShader->setVec3("viewPos", viewPos);
-    lightingShader->setProjection(projection);
-    lightingShader->setView(view);
-
-    // world transformation
-    glm::mat4 model = glm::mat4(1.0f);
-    lightingShader->setMat4("model", model);
-
-    // render the cube
-    cubeDiffTexture->use();
-    cubeSpecTexture->use();
-    cube->bind();
-    cube->draw();
-
-    // for (int i = 0; i < 7; i++)
-    // {
-    //     lightingShader->setModel(cubePositions[i], glm::radians(20.0f * i));
-    //     cube->draw();
-    // }
-
-    // render the light object
-    lightsourceShader->use();
-    lightsourceTexture->use();
-    lightsourceShader->setProjection(projection);
-    lightsourceShader->setView(view);
-    model = glm::mat4(1.0f);
-    model = glm::translate(model, lightPos);
-    model = glm::scale(model, glm::vec3(0.2f));
-    lightsourceShader->setMat4("model", model);
-    lightsource->bind();
-    lightsource->draw();
-
-    glBindVertexArray(0);
+    float nearPlane = 0.1f;
+    float farPlane = 100.0f;
+    CameraBlock cameraBlock;
+    cameraBlock.projection = camera->getProjection(aspectRatio, nearPlane, farPlane);
+    cameraBlock.view = camera->getViewMatrix();
+    cameraBlock.viewPos = glm::vec4(camera->getPosition(), 1.0f);
+
+    // start culling and draw building on the workers
+    frameJobs.viewProjection = cameraBlock.projection * cameraBlock.view;
+    frameJobs.frustum = Frustum::fromMatrix(frameJobs.viewProjection);
+    frameJobs.viewPos = camera->getPosition();
+    frameJobs.bvhVisible = cullMode == CullMode::Bvh;
+    frameJobs.occlusion = cullMode == CullMode::Occlusion;
+    frameJobs.instancedGrid = instancedScene();
+    frameJobs.copyInstances = frameJobs.instancedGrid && cullMode != CullMode::Off;
+    frameJobs.lod = lodEnabled && !sphereLodIds.empty();
+    lodSelector.setProjection(camera->getZoom(), viewportHeight);
+    frameJobs.chunks.clear();
+
+    size_t rows = sceneStore.size();
+    if (frameJobs.bvhVisible)
+    {
+        // the tree walk itself stays serial, its result is split into chunks like the rows would be
+        PROFILE_CPU("bvh query");
+        benchVisible.clear();
+        benchBvh.queryFrustum(frameJobs.frustum, benchVisible);
+        rows = benchVisible.size();
+        benchVisible.resize(sceneStore.size());
+    }
+    for (size_t first = 0; first < rows; first += chunkRows)
+    {
+        frameJobs.chunks.push_back({first, std::min(chunkRows, rows - first), 0, 0, 0, 0});
+    }
+
+    drawQueue.begin(farPlane);
+    JobCounter culled, rasterised, occluded, slotted, written;
+    jobSystem->parallelFor(frameJobs.chunks.size(), 1, cullChunks, nullptr, culled);
+    if (frameJobs.occlusion)
+    {
+        jobSystem->run(drawOccluders, nullptr, rasterised, &culled);
+        jobSystem->parallelFor(frameJobs.chunks.size(), 1, occludeChunks, nullptr, occluded, &rasterised);
+    }
+    jobSystem->run(assignSlots, nullptr, slotted, frameJobs.occlusion ? &occluded : &culled);
+    jobSystem->parallelFor(frameJobs.chunks.size(), 1, writeChunks, nullptr, written, &slotted);
+
+    cameraUbo->update(&cameraBlock, sizeof(cameraBlock));
+
+    // the lamp is the only light, the permutations in use shade one
+    LightBlock lightBlock = {};
+    lightBlock.lights[0].position = glm::vec4(lightPos, 1.0f);
+    lightBlock.lights[0].ambient = glm::vec4(lightColor * glm::vec3(0.3f), 1.0f);
+    lightBlock.lights[0].diffuse = glm::vec4(lightColor * glm::vec3(0.5f), 1.0f);
+    lightBlock.lights[0].specular = glm::vec4(1.0f, 1.0f, 1.0f, 1.0f);
+    if (shadowsEnabled)
+    {
+        lightBlock.lights[1].position = glm::vec4(-sunDirection, 0.0f);
+        lightBlock.lights[1].ambient = glm::vec4(0.0f);
+        lightBlock.lights[1].diffuse = glm::vec4(0.6f, 0.58f, 0.55f, 1.0f);
+        lightBlock.lights[1].specular = glm::vec4(0.4f, 0.4f, 0.4f, 1.0f);
+    }
+    lightsUbo->update(&lightBlock, sizeof(lightBlock));
+
+    // the light grid waits for its own jobs only, this thread picks up cull jobs in the meantime as well
+    ClusterBlock clusterBlock;
+    clusterBlock.grid = glm::uvec4(LightGrid::tilesX, LightGrid::tilesY, LightGrid::depthSlices, 0);
+    if (lightsScene())
+    {
+        PROFILE_CPU("light clusters");
+        float time = lightFrame++ / 60.0f;
+        for (size_t i = 0; i < pointLights.size(); i++)
+        {
+            float phase = lightPhases[i];
+            pointLights.positionX[i] = lightAnchors[i].x + 0.75f * std::sin(time * 0.7f + phase);
+            pointLights.positionY[i] = lightAnchors[i].y + 1.5f * std::sin(time + phase);
+        }
+        lightGrid.assign(pointLights, cameraBlock.view, cameraBlock.projection, nearPlane, farPlane, jobSystem);
+        lightBuffers->upload(pointLights, lightGrid);
+        clusterBlock.grid.w = (uint32_t)std::min(pointLights.size(), LightGrid::maxLights);
+    }
+    clusterBlock.depth = glm::vec4(lightGrid.sliceScale(), lightGrid.sliceBias(), 1.0f / viewportWidth,
+                                   1.0f / viewportHeight);
+    clustersUbo->update(&clusterBlock, sizeof(clusterBlock));
+    lightBuffers->bind();
+
+    if (shadowsEnabled)
+    {
+        renderShadows(cameraBlock, lightPos, nearPlane, farPlane);
+        shadowMaps->block().lights = glm::ivec4(0, 1, -1, -1);
+        shadowsUbo->update(&shadowMaps->block(), sizeof(ShadowBlock));
+        shadowMaps->bind();
+    }
+
+    {
+        PROFILE_CPU("cull + sort keys");
+        jobSystem->wait(written);
+    }
+
+    // the instanced scene's grid skipped the draw queue and is drawn in one call here
+    if (frameJobs.instancedGrid)
+    {
+        if (frameJobs.copyInstances)
+        {
+            cube->setInstances(visibleInstances);
+        }
+        const LitShader &lit = litShaders[litShaderIndex];
+        lit.shader->use();
+        lit.shader->set(lit.shininess, 32.0f);
+        lit.shader->set(lit.instanced, true);
+        cubeDiffTexture->use();
+        cubeSpecTexture->use();
+        cube->bind();
+        cube->drawInstanced();
+        lit.shader->set(lit.instanced, false);
+    }
+
+    {
+        PROFILE_CPU("flush");
+        drawQueue.flush();
+    }
+
+    glstate::bindVertexArray(0);
+
+    logFrameStats();
 }
 
 void renderer::cleanup()
 {
-    delete lightingShader;
-    delete cubeDiffTexture;
-    delete lightsourceTexture;
+    delete cameraUbo;
+    delete lightsUbo;
+    delete clustersUbo;
+    delete lightBuffers;
+    delete shadowMaps;
+    delete shadowsUbo;
     delete cube;
+    delete crate;
+    delete lightsource;
+    delete sphere;
+    // the pools outlive the GL context, their meshes have to go now
+    lodMeshPool.clear();
+    sphereLodIds.clear();
+    sphereLodErrors.clear();
+    cubePool.clear();
+    distinctMeshes.clear();
+    distinctMeshIds.clear();
+    delete materialArrays;
+    variantTexturePool.clear();
+    packedMaterialIds.clear();
+    separateMaterialIds.clear();
+    // the last references free what they hold, the cubes above were the last users
+    litShaders.clear();
+    lightsourceShader.reset();
+    shadowShader.reset();
+    cubeDiffTexture.reset();
+    cubeSpecTexture.reset();
+    lightsourceTexture.reset();
+    delete resources;
+    delete textureStreamer;
+    delete geometryPool;
+    delete shaderManager;
+    delete jobSystem;
 }
\ No newline at end of file
@@ -0,0 +1,309 @@
+#include "scene_store.h"
+#include "job_system.h"
+#include "normal_matrix.h"
+
+#include <algorithm>
+
+// past this fraction of dirty rows a sweep over the flags beats sorting the row list
+static constexpr size_t sweepDivisor = 8;
+// rows per job, enough that a job outweighs the cost of scheduling it
+static constexpr size_t updateGrain = 4096;
+
+template <typename T> static void swapRemove(std::vector<T> &values, size_t index)
+{
+    values[index] = values.back();
+    values.pop_back();
+}
+
+Entity SceneStore::create(const Transform &transform, const glm::vec3 &boundsMin, const glm::vec3 &boundsMax,
+                          uint32_t mesh, uint32_t material)
+{
+    Entity entity;
+    if (!freeIndices_.empty())
+    {
+        entity.index = freeIndices_.back();
+        freeIndices_.pop_back();
+    }
+    else
+    {
+        entity.index = (uint32_t)sparse_.size();
+        sparse_.push_back(invalidRow);
+        generations_.push_back(0);
+    }
+    entity.generation = generations_[entity.index];
+
+    uint32_t row = (uint32_t)entities_.size();
+    sparse_[entity.index] = row;
+    entities_.push_back(entity);
+    positions_.push_back(transform.position);
+    rotations_.push_back(transform.rotation);
+    scales_.push_back(transform.scale);
+    localCenters_.push_back((boundsMin + boundsMax) * 0.5f);
+    localExtents_.push_back((boundsMax - boundsMin) * 0.5f);
+    world_.push_back(glm::mat4(1.0f));
+    normals_.push_back(glm::mat3(1.0f));
+    worldBounds_.push(glm::vec3(0.0f), glm::vec3(0.0f));
+    meshes_.push_back(mesh);
+    materials_.push_back(material);
+    dirty_.push_back(0);
+    markDirty(row);
+    return entity;
+}
+
+void SceneStore::destroy(Entity entity)
+{
+    uint32_t removed = row(entity);
+    if (removed == invalidRow)
+    {
+        return;
+    }
+
+    uint32_t last = (uint32_t)entities_.size() - 1;
+    if (dirty_[removed] || dirty_[last])
+    {
+        // the row list may now name a row that moved or no longer exists, the flags stay correct
+        dirtyRowsStale_ = true;
+    }
+
+    sparse_[entities_[last].index] = removed;
+    sparse_[entity.index] = invalidRow;
+    generations_[entity.index]++;
+    freeIndices_.push_back(entity.index);
+
+    swapRemove(entities_, removed);
+    swapRemove(positions_, removed);
+    swapRemove(rotations_, removed);
+    swapRemove(scales_, removed);
+    swapRemove(localCenters_, removed);
+    swapRemove(localExtents_, removed);
+    swapRemove(world_, removed);
+    swapRemove(normals_, removed);
+    worldBounds_.swapRemove(removed);
+    swapRemove(meshes_, removed);
+    swapRemove(materials_, removed);
+    swapRemove(dirty_, removed);
+}
+
+bool SceneStore::alive(Entity entity) const
+{
+    return row(entity) != invalidRow;
+}
+
+void SceneStore::clear()
+{
+    // every live index goes back on the free list with a bumped generation so old handles stay dead
+    for (const Entity &entity : entities_)
+    {
+        sparse_[entity.index] = invalidRow;
+        generations_[entity.index]++;
+        freeIndices_.push_back(entity.index);
+    }
+
+    entities_.clear();
+    positions_.clear();
+    rotations_.clear();
+    scales_.clear();
+    localCenters_.clear();
+    localExtents_.clear();
+    world_.clear();
+    normals_.clear();
+    worldBounds_.clear();
+    meshes_.clear();
+    materials_.clear();
+    dirty_.clear();
+    dirtyRows_.clear();
+    dirtyRowsStale_ = false;
+}
+
+void SceneStore::reserve(size_t count)
+{
+    sparse_.reserve(count);
+    generations_.reserve(count);
+    entities_.reserve(count);
+    positions_.reserve(count);
+    rotations_.reserve(count);
+    scales_.reserve(count);
+    localCenters_.reserve(count);
+    localExtents_.reserve(count);
+    world_.reserve(count);
+    normals_.reserve(count);
+    worldBounds_.reserve(count);
+    meshes_.reserve(count);
+    materials_.reserve(count);
+    dirty_.reserve(count);
+}
+
+uint32_t SceneStore::row(Entity entity) const
+{
+    if (entity.index >= sparse_.size() || generations_[entity.index] != entity.generation)
+    {
+        return invalidRow;
+    }
+    return sparse_[entity.index];
+}
+
+Transform SceneStore::transform(Entity entity) const
+{
+    uint32_t r = row(entity);
+    if (r == invalidRow)
+    {
+        return Transform();
+    }
+    return {positions_[r], rotations_[r], scales_[r]};
+}
+
+void SceneStore::setTransform(Entity entity, const Transform &transform)
+{
+    uint32_t r = row(entity);
+    if (r == invalidRow)
+    {
+        return;
+    }
+    positions_[r] = transform.position;
+    rotations_[r] = transform.rotation;
+    scales_[r] = transform.scale;
+    markDirty(r);
+}
+
+void SceneStore::setPosition(Entity entity, const glm::vec3 &position)
+{
+    uint32_t r = row(entity);
+    if (r == invalidRow)
+    {
+        return;
+    }
+    positions_[r] = position;
+    markDirty(r);
+}
+
+void SceneStore::setRotation(Entity entity, const glm::quat &rotation)
+{
+    uint32_t r = row(entity);
+    if (r == invalidRow)
+    {
+        return;
+    }
+    rotations_[r] = rotation;
+    markDirty(r);
+}
+
+void SceneStore::setMesh(Entity entity, uint32_t mesh)
+{
+    uint32_t r = row(entity);
+    if (r != invalidRow)
+    {
+        meshes_[r] = mesh;
+    }
+}
+
+void SceneStore::setMaterial(Entity entity, uint32_t material)
+{
+    uint32_t r = row(entity);
+    if (r != invalidRow)
+    {
+        materials_[r] = material;
+    }
+}
+
+void SceneStore::markDirty(uint32_t row)
+{
+    if (dirty_[row])
+    {
+        return;
+    }
+    dirty_[row] = 1;
+    // once most rows are dirty the sweep is used anyway, stop growing the list
+    if (!dirtyRowsStale_)
+    {
+        dirtyRows_.push_back(row);
+        dirtyRowsStale_ = dirtyRows_.size() > entities_.size() / sweepDivisor;
+    }
+}
+
+size_t SceneStore::updateTransforms(JobSystem *jobs)
+{
+    size_t updated = 0;
+    if (dirtyRowsStale_)
+    {
+        // normal matrices go in one batch per run of dirty rows, most rows are dirty when sweeping
+        auto sweep = [this](size_t begin, size_t end) {
+            size_t r = begin;
+            while (r < end)
+            {
+                if (!dirty_[r])
+                {
+                    r++;
+                    continue;
+                }
+                size_t first = r;
+                for (; r < end && dirty_[r]; r++)
+                {
+                    updateRow((uint32_t)r);
+                }
+                normalmatrix::compute(&world_[first], r - first, &normals_[first]);
+            }
+        };
+        // count first, the flags are cleared as rows are updated
+        updated = (size_t)std::count(dirty_.begin(), dirty_.end(), (uint8_t)1);
+        if (jobs)
+        {
+            jobs->parallelFor(dirty_.size(), updateGrain, sweep);
+        }
+        else
+        {
+            sweep(0, dirty_.size());
+        }
+    }
+    else
+    {
+        // sorted so the few rows that changed are still visited front to back
+        std::sort(dirtyRows_.begin(), dirtyRows_.end());
+        auto update = [this](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++)
+            {
+                uint32_t row = dirtyRows_[i];
+                updateRow(row);
+                normals_[row] = normalmatrix::compute(world_[row]);
+            }
+        };
+        updated = dirtyRows_.size();
+        if (jobs)
+        {
+            jobs->parallelFor(updated, updateGrain, update);
+        }
+        else
+        {
+            update(0, updated);
+        }
+    }
+
+    dirtyRows_.clear();
+    dirtyRowsStale_ = false;
+    return updated;
+}
+
+void SceneStore::updateRow(uint32_t row)
+{
+    // scaled rotation columns, composed directly instead of multiplying translate * rotate * scale
+    glm::mat3 basis = glm::mat3_cast(rotations_[row]);
+    const glm::vec3 &scale = scales_[row];
+    basis[0] *= scale.x;
+    basis[1] *= scale.y;
+    basis[2] *= scale.z;
+
+    const glm::vec3 &position = positions_[row];
+    glm::mat4 &world = world_[row];
+    world[0] = glm::vec4(basis[0], 0.0f);
+    world[1] = glm::vec4(basis[1], 0.0f);
+    world[2] = glm::vec4(basis[2], 0.0f);
+    world[3] = glm::vec4(position, 1.0f);
+
+    // world AABB of the transformed local box: project the extents onto each world axis
+    const glm::vec3 &extents = localExtents_[row];
+    glm::vec3 center = basis * localCenters_[row] + position;
+    glm::vec3 worldExtents =
+        glm::abs(basis[0]) * extents.x + glm::abs(basis[1]) * extents.y + glm::abs(basis[2]) * extents.z;
+    worldBounds_.set(row, center, worldExtents);
+
+    dirty_[row] = 0;
+}
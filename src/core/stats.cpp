@@ -0,0 +1,29 @@
+#include "stats.h"
+#include "memory.h"
+
+static stats::FrameCounters currentFrame;
+static stats::FrameCounters lastFrame;
+static uint64_t frameStartAllocations = 0;
+static uint64_t frameStartBytes = 0;
+
+stats::FrameCounters &stats::current()
+{
+    return currentFrame;
+}
+
+const stats::FrameCounters &stats::last()
+{
+    return lastFrame;
+}
+
+void stats::endFrame()
+{
+    uint64_t allocations = memory::allocationCount();
+    uint64_t bytes = memory::allocatedBytes();
+    currentFrame.heapAllocations = allocations - frameStartAllocations;
+    currentFrame.heapBytes = bytes - frameStartBytes;
+    frameStartAllocations = allocations;
+    frameStartBytes = bytes;
+    lastFrame = currentFrame;
+    currentFrame = FrameCounters();
+}
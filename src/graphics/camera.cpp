@@ -57,6 +57,24 @@ void Camera::setPitch(float yrel)
     }
 }
 
+void Camera::setPosition(glm::vec3 pos)
+{
+    pos_ = pos;
+}
+
+void Camera::lookAt(glm::vec3 target)
+{
+    glm::vec3 direction = target - pos_;
+    if (glm::dot(direction, direction) < 1e-12f)
+    {
+        return;
+    }
+    direction = glm::normalize(direction);
+    yaw_ = glm::degrees(atan2(direction.z, direction.x));
+    pitch_ = glm::clamp(glm::degrees(asin(direction.y)), -89.0f, 89.0f);
+    updateDir();
+}
+
 void Camera::updatePos(float deltaTime)
 {
     if (moveForward_ && !moveBack_)
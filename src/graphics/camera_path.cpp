@@ -0,0 +1,55 @@
+#include "camera_path.h"
+
+#include <cmath>
+
+static glm::vec3 catmullRom(const glm::vec3 &p0, const glm::vec3 &p1, const glm::vec3 &p2, const glm::vec3 &p3,
+                            float t)
+{
+    float t2 = t * t;
+    float t3 = t2 * t;
+    return 0.5f * ((2.0f * p1) + (p2 - p0) * t + (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * t2 +
+                   (3.0f * p1 - p0 - 3.0f * p2 + p3) * t3);
+}
+
+void CameraPath::add(float time, glm::vec3 position, glm::vec3 target)
+{
+    keys_.push_back({time, position, target});
+}
+
+float CameraPath::duration() const
+{
+    return keys_.empty() ? 0.0f : keys_.back().time;
+}
+
+void CameraPath::apply(Camera *camera, float time) const
+{
+    if (keys_.empty())
+    {
+        return;
+    }
+    if (keys_.size() == 1 || duration() <= 0.0f)
+    {
+        camera->setPosition(keys_[0].position);
+        camera->lookAt(keys_[0].target);
+        return;
+    }
+
+    time = std::fmod(time, duration());
+    size_t segment = 0;
+    while (segment + 2 < keys_.size() && keys_[segment + 1].time <= time)
+    {
+        segment++;
+    }
+
+    // clamp the outer control points at the ends so the spline passes through the first and last keys
+    const Keyframe &k0 = keys_[segment == 0 ? 0 : segment - 1];
+    const Keyframe &k1 = keys_[segment];
+    const Keyframe &k2 = keys_[segment + 1];
+    const Keyframe &k3 = keys_[segment + 2 < keys_.size() ? segment + 2 : segment + 1];
+
+    float span = k2.time - k1.time;
+    float t = span > 0.0f ? glm::clamp((time - k1.time) / span, 0.0f, 1.0f) : 0.0f;
+
+    camera->setPosition(catmullRom(k0.position, k1.position, k2.position, k3.position, t));
+    camera->lookAt(catmullRom(k0.target, k1.target, k2.target, k3.target, t));
+}
@@ -0,0 +1,293 @@
+#include "geometry_pool.h"
+#include "gl_ext.h"
+#include "gl_state.h"
+#include "stats.h"
+
+#include <SDL3/SDL.h>
+
+#include <algorithm>
+
+// the instance buffer always holds something so attributes 3-10 never point past its end
+static constexpr size_t minInstanceCapacity = 64;
+
+// copies the old contents into a bigger buffer, the old name is deleted
+static GLuint resizeBuffer(GLuint old, size_t oldBytes, size_t newBytes)
+{
+    GLuint buffer;
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, newBytes, NULL, GL_STATIC_DRAW);
+    if (old && oldBytes)
+    {
+        glBindBuffer(GL_COPY_READ_BUFFER, old);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, oldBytes);
+    }
+    if (old)
+    {
+        glDeleteBuffers(1, &old);
+    }
+    return buffer;
+}
+
+// grows or orphans a streaming buffer and uploads into it
+static void streamUpload(GLenum target, size_t bytes, const void *data, size_t &capacityBytes)
+{
+    if (bytes > capacityBytes)
+    {
+        capacityBytes = std::max(bytes, capacityBytes * 2);
+        glBufferData(target, capacityBytes, NULL, GL_STREAM_DRAW);
+    }
+    else
+    {
+        // orphan the old storage so we don't stall on a buffer the GPU may still be reading
+        glBufferData(target, capacityBytes, NULL, GL_STREAM_DRAW);
+    }
+    glBufferSubData(target, 0, bytes, data);
+}
+
+GeometryPool::GeometryPool(VertexLayout layout, uint32_t vertexCapacity, uint32_t indexCapacity)
+    : layout_(layout), multiDrawIndirect_(glext::features().multiDrawIndirect)
+{
+    glGenVertexArrays(1, &vao_);
+    glGenVertexArrays(1, &positionVao_);
+    glGenBuffers(1, &instanceVbo_);
+
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVbo_);
+    instanceBytes_ = minInstanceCapacity * sizeof(InstanceData);
+    glBufferData(GL_ARRAY_BUFFER, instanceBytes_, NULL, GL_STREAM_DRAW);
+    for (unsigned int vao : {vao_, positionVao_})
+    {
+        glstate::bindVertexArray(vao);
+        vertexformat::setInstanceAttributes(0);
+    }
+
+    growVertices(vertexCapacity);
+    growIndices(indexCapacity);
+
+    if (multiDrawIndirect_)
+    {
+        glGenBuffers(1, &indirectBuffer_);
+    }
+    SDL_Log("geometry pool: %s submission", multiDrawIndirect_ ? "multi-draw indirect" : "per-command fallback");
+}
+
+GeometryPool::~GeometryPool()
+{
+    if (indirectBuffer_)
+    {
+        glDeleteBuffers(1, &indirectBuffer_);
+    }
+    glDeleteBuffers(1, &instanceVbo_);
+    glDeleteBuffers(1, &ebo_);
+    glDeleteBuffers(1, &vbo_);
+    glDeleteBuffers(1, &positionVbo_);
+    glstate::forgetVertexArray(vao_);
+    glDeleteVertexArrays(1, &vao_);
+    glstate::forgetVertexArray(positionVao_);
+    glDeleteVertexArrays(1, &positionVao_);
+}
+
+uint32_t GeometryPool::add(const std::vector<Vertex> &vertices, const std::vector<uint32_t> &indices,
+                           glm::mat4 &decode)
+{
+    if (vertices.empty() || indices.empty() || vertices.size() > 0x10000)
+    {
+        SDL_Log("geometry pool: can't pool a mesh with %zu vertices and %zu indices", vertices.size(),
+                indices.size());
+        return invalid;
+    }
+    if (layout_.uv == UvFormat::Unorm16 && !vertexformat::uvsFitUnorm(vertices))
+    {
+        SDL_Log("geometry pool: mesh UVs outside [0, 1] are clamped by the pool's unorm16 layout");
+    }
+
+    Entry entry;
+    entry.vertices = vertexAllocator_.allocate((uint32_t)vertices.size());
+    if (!entry.vertices.valid())
+    {
+        growVertices((uint32_t)vertices.size());
+        entry.vertices = vertexAllocator_.allocate((uint32_t)vertices.size());
+    }
+    entry.indices = indexAllocator_.allocate((uint32_t)indices.size());
+    if (!entry.indices.valid())
+    {
+        growIndices((uint32_t)indices.size());
+        entry.indices = indexAllocator_.allocate((uint32_t)indices.size());
+    }
+    entry.indexCount = (uint32_t)indices.size();
+    entry.live = true;
+
+    std::vector<uint8_t> packed, positions;
+    decode = vertexformat::pack(vertices, layout_, packed);
+    vertexformat::extractPositions(packed, layout_, positions);
+    std::vector<uint16_t> shortIndices(indices.begin(), indices.end());
+
+    // upload through the copy target so whichever VAO is bound keeps its element buffer
+    size_t stride = layout_.stride();
+    glBindBuffer(GL_COPY_WRITE_BUFFER, vbo_);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr)entry.vertices.offset * stride, packed.size(), packed.data());
+    glBindBuffer(GL_COPY_WRITE_BUFFER, positionVbo_);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr)entry.vertices.offset * layout_.positionSize(),
+                    positions.size(), positions.data());
+    glBindBuffer(GL_COPY_WRITE_BUFFER, ebo_);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr)entry.indices.offset * sizeof(uint16_t),
+                    shortIndices.size() * sizeof(uint16_t), shortIndices.data());
+
+    uint32_t id;
+    if (!freeIds_.empty())
+    {
+        id = freeIds_.back();
+        freeIds_.pop_back();
+        entries_[id] = entry;
+    }
+    else
+    {
+        id = (uint32_t)entries_.size();
+        entries_.push_back(entry);
+    }
+    meshCount_++;
+    return id;
+}
+
+void GeometryPool::remove(uint32_t mesh)
+{
+    if (mesh >= entries_.size() || !entries_[mesh].live)
+    {
+        return;
+    }
+    Entry &entry = entries_[mesh];
+    vertexAllocator_.free(entry.vertices);
+    indexAllocator_.free(entry.indices);
+    entry = Entry();
+    freeIds_.push_back(mesh);
+    meshCount_--;
+}
+
+void GeometryPool::bind()
+{
+    glstate::bindVertexArray(vao_);
+}
+
+void GeometryPool::bindPositions()
+{
+    glstate::bindVertexArray(positionVao_);
+}
+
+void GeometryPool::draw(uint32_t mesh)
+{
+    if (mesh >= entries_.size() || !entries_[mesh].live)
+    {
+        return;
+    }
+    const Entry &entry = entries_[mesh];
+    stats::current().drawCalls++;
+    stats::current().triangles += entry.indexCount / 3;
+    glDrawElementsBaseVertex(GL_TRIANGLES, (GLsizei)entry.indexCount, GL_UNSIGNED_SHORT,
+                             (void *)((size_t)entry.indices.offset * sizeof(uint16_t)),
+                             (GLint)entry.vertices.offset);
+}
+
+void GeometryPool::queue(uint32_t mesh, const glm::mat4 &model, const glm::mat3 &normal, uint32_t material)
+{
+    if (mesh >= entries_.size() || !entries_[mesh].live)
+    {
+        return;
+    }
+
+    if (mesh == lastQueued_)
+    {
+        commands_.back().instanceCount++;
+    }
+    else
+    {
+        const Entry &entry = entries_[mesh];
+        commands_.push_back({entry.indexCount, 1, entry.indices.offset, (GLint)entry.vertices.offset,
+                             (GLuint)instances_.size()});
+        lastQueued_ = mesh;
+    }
+    instances_.emplace_back(model, normal, material);
+}
+
+void GeometryPool::submit(bool positionsOnly)
+{
+    if (commands_.empty())
+    {
+        return;
+    }
+
+    if (positionsOnly)
+    {
+        bindPositions();
+    }
+    else
+    {
+        bind();
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVbo_);
+    streamUpload(GL_ARRAY_BUFFER, instances_.size() * sizeof(InstanceData), instances_.data(), instanceBytes_);
+
+    stats::current().indirectCommands += commands_.size();
+    for (const DrawElementsIndirectCommand &command : commands_)
+    {
+        stats::current().triangles += (uint64_t)command.count / 3 * command.instanceCount;
+    }
+    if (multiDrawIndirect_)
+    {
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer_);
+        streamUpload(GL_DRAW_INDIRECT_BUFFER, commands_.size() * sizeof(DrawElementsIndirectCommand),
+                     commands_.data(), indirectBytes_);
+        stats::current().drawCalls++;
+        glext::multiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_SHORT, nullptr, (GLsizei)commands_.size(), 0);
+    }
+    else
+    {
+        for (const DrawElementsIndirectCommand &command : commands_)
+        {
+            vertexformat::setInstanceAttributes((size_t)command.baseInstance * sizeof(InstanceData));
+            stats::current().drawCalls++;
+            glDrawElementsInstancedBaseVertex(GL_TRIANGLES, (GLsizei)command.count, GL_UNSIGNED_SHORT,
+                                              (void *)((size_t)command.firstIndex * sizeof(uint16_t)),
+                                              (GLsizei)command.instanceCount, command.baseVertex);
+        }
+        vertexformat::setInstanceAttributes(0);
+    }
+
+    commands_.clear();
+    instances_.clear();
+    lastQueued_ = invalid;
+}
+
+/* Private Functions */
+
+void GeometryPool::growVertices(uint32_t needed)
+{
+    uint32_t capacity = vertexAllocator_.capacity();
+    uint32_t next = std::max(capacity * 2, capacity + needed);
+    size_t stride = layout_.stride();
+    vbo_ = resizeBuffer(vbo_, (size_t)capacity * stride, (size_t)next * stride);
+    size_t positionSize = layout_.positionSize();
+    positionVbo_ = resizeBuffer(positionVbo_, (size_t)capacity * positionSize, (size_t)next * positionSize);
+    vertexAllocator_.grow(next);
+
+    // the VAOs captured the old buffer names in their attribute pointers
+    glstate::bindVertexArray(vao_);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo_);
+    vertexformat::setAttributes(layout_);
+    glstate::bindVertexArray(positionVao_);
+    glBindBuffer(GL_ARRAY_BUFFER, positionVbo_);
+    vertexformat::setPositionAttribute(layout_);
+}
+
+void GeometryPool::growIndices(uint32_t needed)
+{
+    uint32_t capacity = indexAllocator_.capacity();
+    uint32_t next = std::max(capacity * 2, capacity + needed);
+    ebo_ = resizeBuffer(ebo_, (size_t)capacity * sizeof(uint16_t), (size_t)next * sizeof(uint16_t));
+    indexAllocator_.grow(next);
+
+    for (unsigned int vao : {vao_, positionVao_})
+    {
+        glstate::bindVertexArray(vao);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo_);
+    }
+}
@@ -0,0 +1,86 @@
+#include "gl_ext.h"
+
+#include <cstring>
+
+static glext::Features loaded;
+
+glext::MultiDrawElementsIndirectProc glext::multiDrawElementsIndirect = nullptr;
+glext::GetProgramBinaryProc glext::getProgramBinary = nullptr;
+glext::ProgramBinaryProc glext::programBinary = nullptr;
+glext::ProgramParameteriProc glext::programParameteri = nullptr;
+glext::MaxShaderCompilerThreadsProc glext::maxShaderCompilerThreads = nullptr;
+glext::GetTextureHandleProc glext::getTextureHandle = nullptr;
+glext::MakeTextureHandleResidentProc glext::makeTextureHandleResident = nullptr;
+glext::MakeTextureHandleNonResidentProc glext::makeTextureHandleNonResident = nullptr;
+
+bool glext::hasExtension(const char *name)
+{
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; i++)
+    {
+        const char *extension = (const char *)glGetStringi(GL_EXTENSIONS, (GLuint)i);
+        if (extension && std::strcmp(extension, name) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool glext::versionAtLeast(int major, int minor)
+{
+    return loaded.major > major || (loaded.major == major && loaded.minor >= minor);
+}
+
+void glext::load(GLADloadproc loader)
+{
+    glGetIntegerv(GL_MAJOR_VERSION, &loaded.major);
+    glGetIntegerv(GL_MINOR_VERSION, &loaded.minor);
+
+    loaded.s3tc = hasExtension("GL_EXT_texture_compression_s3tc");
+    loaded.bptc = versionAtLeast(4, 2) || hasExtension("GL_ARB_texture_compression_bptc");
+
+    // the extension exports the same entry point without a suffix. commands find their instances through
+    // baseInstance, which must be zero without GL 4.2 or ARB_base_instance, so MDI alone isn't enough
+    bool baseInstance = versionAtLeast(4, 2) || hasExtension("GL_ARB_base_instance");
+    if (baseInstance && (versionAtLeast(4, 3) || hasExtension("GL_ARB_multi_draw_indirect")))
+    {
+        multiDrawElementsIndirect = (MultiDrawElementsIndirectProc)loader("glMultiDrawElementsIndirect");
+    }
+    loaded.multiDrawIndirect = multiDrawElementsIndirect != nullptr;
+
+    if (versionAtLeast(4, 1) || hasExtension("GL_ARB_get_program_binary"))
+    {
+        GLint formats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        if (formats > 0)
+        {
+            getProgramBinary = (GetProgramBinaryProc)loader("glGetProgramBinary");
+            programBinary = (ProgramBinaryProc)loader("glProgramBinary");
+            programParameteri = (ProgramParameteriProc)loader("glProgramParameteri");
+        }
+    }
+    loaded.programBinary = getProgramBinary && programBinary && programParameteri;
+
+    if (hasExtension("GL_KHR_parallel_shader_compile"))
+    {
+        maxShaderCompilerThreads = (MaxShaderCompilerThreadsProc)loader("glMaxShaderCompilerThreadsKHR");
+    }
+    loaded.parallelShaderCompile = maxShaderCompilerThreads != nullptr;
+
+    // handles are picked per instance, which isn't dynamically uniform. sampling through them is only defined
+    // with NV_gpu_shader5
+    if (hasExtension("GL_ARB_bindless_texture") && hasExtension("GL_NV_gpu_shader5"))
+    {
+        getTextureHandle = (GetTextureHandleProc)loader("glGetTextureHandleARB");
+        makeTextureHandleResident = (MakeTextureHandleResidentProc)loader("glMakeTextureHandleResidentARB");
+        makeTextureHandleNonResident = (MakeTextureHandleNonResidentProc)loader("glMakeTextureHandleNonResidentARB");
+    }
+    loaded.bindlessTexture = getTextureHandle && makeTextureHandleResident && makeTextureHandleNonResident;
+}
+
+const glext::Features &glext::features()
+{
+    return loaded;
+}
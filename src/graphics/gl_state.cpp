@@ -0,0 +1,209 @@
+#include "gl_state.h"
+#include "stats.h"
+
+#include <cstddef>
+
+// sentinel for "unknown", no real GL name or enum uses it
+static constexpr GLuint unknown = 0xFFFFFFFFu;
+
+static constexpr size_t maxTextureUnits = 32;
+static constexpr size_t trackedTargets = 4;
+
+struct State
+{
+    GLuint program = unknown;
+    GLuint vao = unknown;
+    GLenum activeUnit = unknown;
+    GLuint textures[maxTextureUnits][trackedTargets];
+    GLenum polygonMode = unknown;
+    GLuint depthTest = unknown;
+    GLuint depthMask = unknown;
+    GLenum depthFunc = unknown;
+    GLuint blend = unknown;
+    GLenum blendSrc = unknown;
+    GLenum blendDst = unknown;
+
+    State()
+    {
+        for (auto &unit : textures)
+        {
+            for (GLuint &texture : unit)
+            {
+                texture = unknown;
+            }
+        }
+    }
+};
+
+static State state;
+
+// returns true when the call has to be issued and records the new value
+template <typename T> static bool changes(T &current, T value)
+{
+    if (current == value)
+    {
+        stats::current().stateChangesSkipped++;
+        return false;
+    }
+    current = value;
+    stats::current().stateChangesIssued++;
+    return true;
+}
+
+static int targetIndex(GLenum target)
+{
+    switch (target)
+    {
+    case GL_TEXTURE_2D:
+        return 0;
+    case GL_TEXTURE_2D_ARRAY:
+        return 1;
+    case GL_TEXTURE_CUBE_MAP:
+        return 2;
+    case GL_TEXTURE_BUFFER:
+        return 3;
+    default:
+        return -1;
+    }
+}
+
+void glstate::useProgram(GLuint program)
+{
+    if (changes(state.program, program))
+    {
+        glUseProgram(program);
+    }
+}
+
+void glstate::bindVertexArray(GLuint vao)
+{
+    if (changes(state.vao, vao))
+    {
+        glBindVertexArray(vao);
+    }
+}
+
+void glstate::activeTexture(GLenum unit)
+{
+    if (changes(state.activeUnit, unit))
+    {
+        glActiveTexture(unit);
+    }
+}
+
+void glstate::bindTexture(GLenum unit, GLenum target, GLuint texture)
+{
+    size_t slot = unit - GL_TEXTURE0;
+    int index = targetIndex(target);
+    if (slot >= maxTextureUnits || index < 0)
+    {
+        // not tracked, always issue and forget what we knew about the active unit
+        stats::current().stateChangesIssued += 2;
+        state.activeUnit = unit;
+        glActiveTexture(unit);
+        glBindTexture(target, texture);
+        return;
+    }
+
+    GLuint &bound = state.textures[slot][index];
+    if (bound == texture)
+    {
+        stats::current().stateChangesSkipped++;
+        return;
+    }
+
+    activeTexture(unit);
+    changes(bound, texture);
+    glBindTexture(target, texture);
+}
+
+void glstate::polygonMode(GLenum mode)
+{
+    if (changes(state.polygonMode, mode))
+    {
+        glPolygonMode(GL_FRONT_AND_BACK, mode);
+    }
+}
+
+void glstate::setDepthTest(bool enabled)
+{
+    if (changes(state.depthTest, (GLuint)enabled))
+    {
+        enabled ? glEnable(GL_DEPTH_TEST) : glDisable(GL_DEPTH_TEST);
+    }
+}
+
+void glstate::depthMask(bool enabled)
+{
+    if (changes(state.depthMask, (GLuint)enabled))
+    {
+        glDepthMask(enabled ? GL_TRUE : GL_FALSE);
+    }
+}
+
+void glstate::depthFunc(GLenum func)
+{
+    if (changes(state.depthFunc, func))
+    {
+        glDepthFunc(func);
+    }
+}
+
+void glstate::setBlend(bool enabled)
+{
+    if (changes(state.blend, (GLuint)enabled))
+    {
+        enabled ? glEnable(GL_BLEND) : glDisable(GL_BLEND);
+    }
+}
+
+void glstate::blendFunc(GLenum src, GLenum dst)
+{
+    // one call sets both, so a change to either counts once
+    if (state.blendSrc == src && state.blendDst == dst)
+    {
+        stats::current().stateChangesSkipped++;
+        return;
+    }
+    state.blendSrc = src;
+    state.blendDst = dst;
+    stats::current().stateChangesIssued++;
+    glBlendFunc(src, dst);
+}
+
+void glstate::forgetProgram(GLuint program)
+{
+    if (state.program == program)
+    {
+        state.program = unknown;
+    }
+}
+
+void glstate::forgetVertexArray(GLuint vao)
+{
+    // deleting the bound vao reverts the binding to 0
+    if (state.vao == vao)
+    {
+        state.vao = 0;
+    }
+}
+
+void glstate::forgetTexture(GLuint texture)
+{
+    // deleting a bound texture reverts every binding of it to 0
+    for (auto &unit : state.textures)
+    {
+        for (GLuint &bound : unit)
+        {
+            if (bound == texture)
+            {
+                bound = 0;
+            }
+        }
+    }
+}
+
+void glstate::invalidate()
+{
+    state = State();
+}
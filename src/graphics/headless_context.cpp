@@ -0,0 +1,209 @@
+#include "headless_context.h"
+#include "gl_ext.h"
+
+#include <EGL/eglext.h>
+#include <SDL3/SDL.h>
+
+#include <cstring>
+
+static bool hasEglExtension(const char *extensions, const char *name)
+{
+    if (!extensions)
+    {
+        return false;
+    }
+    size_t length = std::strlen(name);
+    for (const char *p = std::strstr(extensions, name); p; p = std::strstr(p + length, name))
+    {
+        // whole words only, EGL_EXT_platform_base is a prefix of EGL_EXT_platform_base_something
+        bool start = p == extensions || p[-1] == ' ';
+        bool end = p[length] == ' ' || p[length] == '\0';
+        if (start && end)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+static EGLDisplay openDisplay(bool &surfaceless)
+{
+    surfaceless = false;
+
+    // client extensions are queried without a display
+    const char *clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+    if (hasEglExtension(clientExtensions, "EGL_MESA_platform_surfaceless"))
+    {
+        auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+        if (getPlatformDisplay)
+        {
+            EGLDisplay display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+            if (display != EGL_NO_DISPLAY && eglInitialize(display, nullptr, nullptr))
+            {
+                surfaceless = true;
+                return display;
+            }
+        }
+    }
+
+    EGLDisplay display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    if (display != EGL_NO_DISPLAY && eglInitialize(display, nullptr, nullptr))
+    {
+        return display;
+    }
+    return EGL_NO_DISPLAY;
+}
+
+HeadlessContext::~HeadlessContext()
+{
+    destroy();
+}
+
+bool HeadlessContext::create(int width, int height)
+{
+    width_ = width;
+    height_ = height;
+
+    bool surfaceless = false;
+    display_ = openDisplay(surfaceless);
+    if (display_ == EGL_NO_DISPLAY)
+    {
+        SDL_Log("headless: couldn't open an EGL display (0x%x)", eglGetError());
+        return false;
+    }
+
+    // the surfaceless platform still needs KHR_surfaceless_context to make a context current without a surface
+    surfaceless = surfaceless && hasEglExtension(eglQueryString(display_, EGL_EXTENSIONS), "EGL_KHR_surfaceless_context");
+
+    if (!eglBindAPI(EGL_OPENGL_API))
+    {
+        SDL_Log("headless: desktop GL isn't available through EGL (0x%x)", eglGetError());
+        return false;
+    }
+
+    // the FBO carries colour and depth, the config only needs to be GL renderable
+    const EGLint configAttribs[] = {
+        EGL_SURFACE_TYPE, surfaceless ? 0 : EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_RED_SIZE, 8,
+        EGL_GREEN_SIZE, 8,
+        EGL_BLUE_SIZE, 8,
+        EGL_NONE,
+    };
+    EGLConfig config;
+    EGLint configCount = 0;
+    if (!eglChooseConfig(display_, configAttribs, &config, 1, &configCount) || configCount == 0)
+    {
+        SDL_Log("headless: no matching EGL config (0x%x)", eglGetError());
+        return false;
+    }
+
+    const EGLint contextAttribs[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 3,
+        EGL_CONTEXT_MINOR_VERSION, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE,
+    };
+    context_ = eglCreateContext(display_, config, EGL_NO_CONTEXT, contextAttribs);
+    if (context_ == EGL_NO_CONTEXT)
+    {
+        SDL_Log("headless: couldn't create a GL 3.3 core context (0x%x)", eglGetError());
+        return false;
+    }
+
+    if (!surfaceless)
+    {
+        // only there to make the context current, nothing is ever drawn to it
+        const EGLint pbufferAttribs[] = {EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE};
+        surface_ = eglCreatePbufferSurface(display_, config, pbufferAttribs);
+        if (surface_ == EGL_NO_SURFACE)
+        {
+            SDL_Log("headless: couldn't create a pbuffer (0x%x)", eglGetError());
+            return false;
+        }
+    }
+
+    if (!eglMakeCurrent(display_, surface_, surface_, context_))
+    {
+        SDL_Log("headless: couldn't make the context current (0x%x)", eglGetError());
+        return false;
+    }
+
+    if (!gladLoadGLLoader((GLADloadproc)eglGetProcAddress))
+    {
+        SDL_Log("Failed to initialize GLAD");
+        return false;
+    }
+    glext::load((GLADloadproc)eglGetProcAddress);
+
+    SDL_Log("headless: %s, %s (%s)", (const char *)glGetString(GL_RENDERER), (const char *)glGetString(GL_VERSION),
+            surfaceless ? "surfaceless" : "pbuffer");
+
+    return createFramebuffer();
+}
+
+bool HeadlessContext::createFramebuffer()
+{
+    glGenRenderbuffers(1, &colorRbo_);
+    glBindRenderbuffer(GL_RENDERBUFFER, colorRbo_);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width_, height_);
+
+    glGenRenderbuffers(1, &depthRbo_);
+    glBindRenderbuffer(GL_RENDERBUFFER, depthRbo_);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width_, height_);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glGenFramebuffers(1, &fbo_);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo_);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorRbo_);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthRbo_);
+
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    if (status != GL_FRAMEBUFFER_COMPLETE)
+    {
+        SDL_Log("headless: framebuffer incomplete (0x%x)", status);
+        return false;
+    }
+
+    glViewport(0, 0, width_, height_);
+    return true;
+}
+
+void HeadlessContext::readPixels(std::vector<uint8_t> &pixels) const
+{
+    pixels.resize((size_t)width_ * height_ * 4);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo_);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, width_, height_, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+}
+
+void HeadlessContext::destroy()
+{
+    if (display_ == EGL_NO_DISPLAY)
+    {
+        return;
+    }
+
+    if (context_ != EGL_NO_CONTEXT)
+    {
+        // GL objects only exist once the context was current and glad loaded
+        if (fbo_)
+        {
+            glDeleteFramebuffers(1, &fbo_);
+            glDeleteRenderbuffers(1, &colorRbo_);
+            glDeleteRenderbuffers(1, &depthRbo_);
+            fbo_ = colorRbo_ = depthRbo_ = 0;
+        }
+
+        eglMakeCurrent(display_, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        eglDestroyContext(display_, context_);
+        context_ = EGL_NO_CONTEXT;
+    }
+    if (surface_ != EGL_NO_SURFACE)
+    {
+        eglDestroySurface(display_, surface_);
+        surface_ = EGL_NO_SURFACE;
+    }
+    eglTerminate(display_);
+    display_ = EGL_NO_DISPLAY;
+}
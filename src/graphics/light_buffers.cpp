@@ -0,0 +1,90 @@
+#include "light_buffers.h"
+#include "gl_state.h"
+
+#include <algorithm>
+
+// a texture buffer without storage is incomplete, so every buffer starts with a little
+static constexpr size_t minCapacityBytes = 256;
+
+LightBuffers::LightBuffers()
+{
+    create(pointLights_, pointLightsUnit, GL_RGBA32F);
+    create(lightClusters_, lightClustersUnit, GL_RG32UI);
+    create(lightIndices_, lightIndicesUnit, GL_R16UI);
+}
+
+LightBuffers::~LightBuffers()
+{
+    destroy(pointLights_);
+    destroy(lightClusters_);
+    destroy(lightIndices_);
+}
+
+void LightBuffers::upload(const PointLights &lights, const LightGrid &grid)
+{
+    size_t count = std::min(lights.size(), LightGrid::maxLights);
+    packed_.resize(count * 2);
+    for (size_t i = 0; i < count; i++)
+    {
+        packed_[i * 2] = glm::vec4(lights.positionX[i], lights.positionY[i], lights.positionZ[i], lights.radius[i]);
+        packed_[i * 2 + 1] = glm::vec4(lights.colorR[i], lights.colorG[i], lights.colorB[i], 0.0f);
+    }
+
+    fill(pointLights_, packed_.data(), packed_.size() * sizeof(glm::vec4));
+    fill(lightClusters_, grid.clusters().data(), grid.clusters().size() * sizeof(uint32_t));
+    fill(lightIndices_, grid.indices().data(), grid.indices().size() * sizeof(uint16_t));
+}
+
+void LightBuffers::bind()
+{
+    for (const TextureBuffer *target : {&pointLights_, &lightClusters_, &lightIndices_})
+    {
+        glstate::bindTexture(target->unit, GL_TEXTURE_BUFFER, target->texture);
+    }
+}
+
+void LightBuffers::setSamplers(Shader *shader)
+{
+    shader->use();
+    shader->setInt("pointLights", pointLightsUnit - GL_TEXTURE0);
+    shader->setInt("lightClusters", lightClustersUnit - GL_TEXTURE0);
+    shader->setInt("lightIndices", lightIndicesUnit - GL_TEXTURE0);
+}
+
+void LightBuffers::create(TextureBuffer &target, GLenum unit, GLenum format)
+{
+    target.unit = unit;
+    target.capacityBytes = minCapacityBytes;
+    glGenBuffers(1, &target.buffer);
+    glBindBuffer(GL_TEXTURE_BUFFER, target.buffer);
+    glBufferData(GL_TEXTURE_BUFFER, target.capacityBytes, NULL, GL_STREAM_DRAW);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+    // the texture refers to the buffer object, so it keeps seeing the data after the storage is reallocated
+    glGenTextures(1, &target.texture);
+    glstate::bindTexture(unit, GL_TEXTURE_BUFFER, target.texture);
+    glTexBuffer(GL_TEXTURE_BUFFER, format, target.buffer);
+}
+
+void LightBuffers::fill(TextureBuffer &target, const void *data, size_t bytes)
+{
+    glBindBuffer(GL_TEXTURE_BUFFER, target.buffer);
+    if (bytes > target.capacityBytes)
+    {
+        target.capacityBytes = std::max(bytes, target.capacityBytes * 2);
+    }
+    // orphan the old storage so we don't stall on a buffer the GPU may still be reading
+    glBufferData(GL_TEXTURE_BUFFER, target.capacityBytes, NULL, GL_STREAM_DRAW);
+    if (bytes > 0)
+    {
+        glBufferSubData(GL_TEXTURE_BUFFER, 0, bytes, data);
+    }
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void LightBuffers::destroy(TextureBuffer &target)
+{
+    glstate::forgetTexture(target.texture);
+    glDeleteTextures(1, &target.texture);
+    glDeleteBuffers(1, &target.buffer);
+}
@@ -0,0 +1,230 @@
+#include "material_arrays.h"
+#include "gl_ext.h"
+#include "gl_state.h"
+#include "shader_manager.h"
+
+#include <SDL3/SDL.h>
+
+#include <algorithm>
+#include <initializer_list>
+
+MaterialArrays::MaterialArrays(int width, int height, uint32_t layerCapacity, bool allowBindless)
+    : width_(width), height_(height), layerCapacity_(layerCapacity),
+      bindless_(allowBindless && glext::features().bindlessTexture)
+{
+    if (allowBindless && !bindless_)
+    {
+        SDL_Log("materials: bindless textures asked for but ARB_bindless_texture or NV_gpu_shader5 is missing");
+    }
+    levels_ = 1;
+    while ((std::max(width_, height_) >> levels_) > 0)
+    {
+        levels_++;
+    }
+    if (!bindless_)
+    {
+        createArray(diffuse_, diffuseUnit);
+        createArray(specular_, specularUnit);
+    }
+    buffer_ = new UniformBuffer(MaterialsBinding, sizeof(MaterialBlock));
+    SDL_Log("materials: %s", bindless_ ? "bindless textures" : "texture arrays");
+}
+
+MaterialArrays::~MaterialArrays()
+{
+    release(diffuse_);
+    release(specular_);
+    delete buffer_;
+}
+
+uint32_t MaterialArrays::addDiffuse(const unsigned char *pixels, int width, int height, int channels)
+{
+    return addMap(diffuse_, diffuseUnit, pixels, width, height, channels);
+}
+
+uint32_t MaterialArrays::addSpecular(const unsigned char *pixels, int width, int height, int channels)
+{
+    return addMap(specular_, specularUnit, pixels, width, height, channels);
+}
+
+uint32_t MaterialArrays::addMaterial(uint32_t diffuse, uint32_t specular, float shininess)
+{
+    if (materialCount_ == maxPackedMaterials || diffuse >= diffuse_.count || specular >= specular_.count)
+    {
+        return invalid;
+    }
+    MaterialEntry &entry = block_.materials[materialCount_];
+    entry.maps = glm::uvec4(diffuse, specular, 0, 0);
+    entry.params = glm::vec4(shininess, 0.0f, 0.0f, 0.0f);
+    materialMaps_.emplace_back(diffuse, specular);
+    finished_ = false;
+    return (uint32_t)materialCount_++;
+}
+
+void MaterialArrays::finish()
+{
+    if (finished_)
+    {
+        return;
+    }
+
+    for (Maps *maps : {&diffuse_, &specular_})
+    {
+        GLenum unit = maps == &diffuse_ ? diffuseUnit : specularUnit;
+        if (!bindless_)
+        {
+            bindForEdit(unit, GL_TEXTURE_2D_ARRAY, maps->array);
+            glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+            continue;
+        }
+        // a texture can't change once it has a handle, only maps added since the last finish() get one
+        for (size_t i = maps->handles.size(); i < maps->textures.size(); i++)
+        {
+            bindForEdit(unit, GL_TEXTURE_2D, maps->textures[i]);
+            glGenerateMipmap(GL_TEXTURE_2D);
+            GLuint64 handle = glext::getTextureHandle(maps->textures[i]);
+            glext::makeTextureHandleResident(handle);
+            maps->handles.push_back(handle);
+        }
+    }
+
+    if (bindless_)
+    {
+        for (size_t i = 0; i < materialCount_; i++)
+        {
+            GLuint64 diffuse = diffuse_.handles[materialMaps_[i].x];
+            GLuint64 specular = specular_.handles[materialMaps_[i].y];
+            block_.materials[i].maps = glm::uvec4((uint32_t)diffuse, (uint32_t)(diffuse >> 32), (uint32_t)specular,
+                                                  (uint32_t)(specular >> 32));
+        }
+    }
+    buffer_->update(&block_, materialCount_ * sizeof(MaterialEntry));
+    finished_ = true;
+}
+
+void MaterialArrays::bind()
+{
+    if (!bindless_)
+    {
+        glstate::bindTexture(diffuseUnit, GL_TEXTURE_2D_ARRAY, diffuse_.array);
+        glstate::bindTexture(specularUnit, GL_TEXTURE_2D_ARRAY, specular_.array);
+    }
+    // another set of arrays may have had the binding point since
+    glBindBufferBase(GL_UNIFORM_BUFFER, MaterialsBinding, buffer_->getID());
+}
+
+uint32_t MaterialArrays::shaderFeatures() const
+{
+    return PackedMaterialsFeature | (bindless_ ? BindlessTexturesFeature : (uint32_t)0);
+}
+
+void MaterialArrays::setSamplers(Shader *shader)
+{
+    shader->setInt("diffuseLayers", diffuseUnit - GL_TEXTURE0);
+    shader->setInt("specularLayers", specularUnit - GL_TEXTURE0);
+}
+
+/* Private Functions */
+
+// a bind glstate drops as redundant leaves the active unit where it was, edits have to land on this one
+void MaterialArrays::bindForEdit(GLenum unit, GLenum target, GLuint texture)
+{
+    glstate::bindTexture(unit, target, texture);
+    glstate::activeTexture(unit);
+}
+
+void MaterialArrays::createArray(Maps &maps, GLenum unit)
+{
+    glGenTextures(1, &maps.array);
+    bindForEdit(unit, GL_TEXTURE_2D_ARRAY, maps.array);
+    setParams(GL_TEXTURE_2D_ARRAY);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, levels_ - 1);
+    for (int level = 0; level < levels_; level++)
+    {
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, level, GL_RGBA8, std::max(width_ >> level, 1),
+                     std::max(height_ >> level, 1), (GLsizei)layerCapacity_, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    }
+}
+
+uint32_t MaterialArrays::addMap(Maps &maps, GLenum unit, const unsigned char *pixels, int width, int height,
+                                int channels)
+{
+    if (!pixels || channels < 1 || channels > 4)
+    {
+        return invalid;
+    }
+    if (!bindless_ && (width != width_ || height != height_ || maps.count == layerCapacity_))
+    {
+        SDL_Log("materials: a %dx%d map doesn't go into %dx%d arrays with %u of %u layers used", width, height, width_,
+                height_, maps.count, layerCapacity_);
+        return invalid;
+    }
+
+    const unsigned char *rgba = expand(pixels, width, height, channels);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    if (bindless_)
+    {
+        GLuint texture;
+        glGenTextures(1, &texture);
+        bindForEdit(unit, GL_TEXTURE_2D, texture);
+        setParams(GL_TEXTURE_2D);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, rgba);
+        maps.textures.push_back(texture);
+    }
+    else
+    {
+        bindForEdit(unit, GL_TEXTURE_2D_ARRAY, maps.array);
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, (GLint)maps.count, width, height, 1, GL_RGBA, GL_UNSIGNED_BYTE,
+                        rgba);
+    }
+    finished_ = false;
+    return maps.count++;
+}
+
+// GL would fill grey into red alone, so everything is widened to RGBA here
+const unsigned char *MaterialArrays::expand(const unsigned char *pixels, int width, int height, int channels)
+{
+    if (channels == 4)
+    {
+        return pixels;
+    }
+    size_t count = (size_t)width * height;
+    scratch_.resize(count * 4);
+    for (size_t i = 0; i < count; i++)
+    {
+        const unsigned char *in = pixels + i * channels;
+        unsigned char *out = scratch_.data() + i * 4;
+        bool grey = channels < 3;
+        out[0] = in[0];
+        out[1] = grey ? in[0] : in[1];
+        out[2] = grey ? in[0] : in[2];
+        out[3] = channels == 2 ? in[1] : 255;
+    }
+    return scratch_.data();
+}
+
+void MaterialArrays::setParams(GLenum target)
+{
+    glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+}
+
+void MaterialArrays::release(Maps &maps)
+{
+    for (GLuint64 handle : maps.handles)
+    {
+        glext::makeTextureHandleNonResident(handle);
+    }
+    for (GLuint texture : maps.textures)
+    {
+        glstate::forgetTexture(texture);
+        glDeleteTextures(1, &texture);
+    }
+    if (maps.array)
+    {
+        glstate::forgetTexture(maps.array);
+        glDeleteTextures(1, &maps.array);
+    }
+}
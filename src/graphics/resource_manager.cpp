@@ -0,0 +1,293 @@
+#include "resource_manager.h"
+#include "gl_ext.h"
+#include "mesh_file.h"
+
+#include <SDL3/SDL.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+static const char *typeNames[resourceTypeCount] = {"texture", "shader", "mesh"};
+
+// FNV-1a, the type goes in first so a texture and a mesh of the same path get different keys
+static uint64_t hashKey(ResourceType type, const std::string &path, uint64_t extra)
+{
+    uint64_t hash = 0xcbf29ce484222325ull;
+    hash = (hash ^ (uint64_t)type) * 0x100000001b3ull;
+    for (char c : path)
+    {
+        hash = (hash ^ (uint8_t)c) * 0x100000001b3ull;
+    }
+    for (int i = 0; i < 8; i++)
+    {
+        hash = (hash ^ ((extra >> (i * 8)) & 0xFF)) * 0x100000001b3ull;
+    }
+    return hash;
+}
+
+static size_t programBytes(const Shader *shader)
+{
+    GLint length = 0;
+    if (glext::features().programBinary && shader->linked())
+    {
+        glGetProgramiv(shader->getID(), GL_PROGRAM_BINARY_LENGTH, &length);
+    }
+    return (size_t)length;
+}
+
+ResourceManager::ResourceManager(TextureStreamer *streamer, ShaderManager *shaders, size_t textureBudget)
+    : streamer_(streamer), shaders_(shaders), textureBudget_(textureBudget)
+{
+}
+
+ResourceManager::~ResourceManager()
+{
+    if (entries_.size() > 0)
+    {
+        SDL_Log("resources: %zu still referenced at shutdown, freeing them anyway", entries_.size());
+    }
+    entries_.forEach([this](ObjectPool<Entry>::Handle, Entry &entry) {
+        if (entry.texture)
+        {
+            streamer_->cancel(entry.texture);
+        }
+    });
+    entries_.clear();
+    textures_.clear();
+    meshes_.clear();
+}
+
+ResourceManager::Entry *ResourceManager::find(uint64_t key, ObjectPool<Entry>::Handle &handle)
+{
+    std::unordered_map<uint64_t, ObjectPool<Entry>::Handle>::iterator it = byKey_.find(key);
+    if (it == byKey_.end())
+    {
+        return nullptr;
+    }
+    handle = it->second;
+    Entry *entry = entries_.get(handle);
+    entry->references++;
+    return entry;
+}
+
+ObjectPool<ResourceManager::Entry>::Handle ResourceManager::add(const Entry &entry)
+{
+    ObjectPool<Entry>::Handle handle = entries_.create(entry);
+    byKey_[entry.key] = handle;
+    residentBytes_[(size_t)entry.type] += entry.bytes;
+    counts_[(size_t)entry.type]++;
+    return handle;
+}
+
+TextureRef ResourceManager::texture(const std::string &name, int texUnit)
+{
+    uint64_t key = hashKey(ResourceType::Texture, name, (uint64_t)texUnit);
+    ObjectPool<Entry>::Handle handle;
+    if (Entry *entry = find(key, handle))
+    {
+        return TextureRef(this, handle.index, handle.generation, entry->texture);
+    }
+
+    Entry entry = {};
+    entry.type = ResourceType::Texture;
+    entry.key = key;
+    entry.name = name;
+    entry.references = 1;
+    entry.textureHandle = textures_.create(texUnit);
+    entry.texture = textures_.get(entry.textureHandle);
+    entry.bytes = entry.texture->gpuBytes();
+    streamer_->request(entry.texture, name);
+    handle = add(entry);
+    return TextureRef(this, handle.index, handle.generation, entry.texture);
+}
+
+ShaderRef ResourceManager::shader(const std::string &vertexFile, const std::string &fragmentFile,
+                                  ShaderPermutation permutation)
+{
+    uint64_t key = hashKey(ResourceType::Shader, vertexFile + "|" + fragmentFile, permutation);
+    ObjectPool<Entry>::Handle handle;
+    if (Entry *entry = find(key, handle))
+    {
+        return ShaderRef(this, handle.index, handle.generation, entry->shader);
+    }
+
+    Entry entry = {};
+    entry.type = ResourceType::Shader;
+    entry.key = key;
+    entry.name = vertexFile + " + " + fragmentFile;
+    if (permutation)
+    {
+        char suffix[16];
+        std::snprintf(suffix, sizeof(suffix), " (%08x)", permutation);
+        entry.name += suffix;
+    }
+    entry.references = 1;
+    entry.shader = shaders_->load(vertexFile, fragmentFile, permutation);
+    entry.bytes = programBytes(entry.shader);
+    handle = add(entry);
+    return ShaderRef(this, handle.index, handle.generation, entry.shader);
+}
+
+MeshRef ResourceManager::mesh(const std::string &path, uint32_t level)
+{
+    uint64_t key = hashKey(ResourceType::Mesh, path, level);
+    ObjectPool<Entry>::Handle handle;
+    if (Entry *entry = find(key, handle))
+    {
+        return MeshRef(this, handle.index, handle.generation, entry->mesh);
+    }
+
+    std::vector<meshopt::MeshLod> levels;
+    if (!meshfile::load(path, levels) || level >= levels.size())
+    {
+        SDL_Log("resources: %s has no level %u", path.c_str(), level);
+        return MeshRef();
+    }
+
+    Entry entry = {};
+    entry.type = ResourceType::Mesh;
+    entry.key = key;
+    entry.name = level ? path + " level " + std::to_string(level) : path;
+    entry.references = 1;
+    entry.meshHandle = meshes_.create(levels[level].vertices, levels[level].indices);
+    entry.mesh = meshes_.get(entry.meshHandle);
+    entry.bytes = entry.mesh->gpuBytes();
+    handle = add(entry);
+    return MeshRef(this, handle.index, handle.generation, entry.mesh);
+}
+
+void ResourceManager::addReference(uint32_t index, uint32_t generation)
+{
+    entries_.get({index, generation})->references++;
+}
+
+void ResourceManager::release(uint32_t index, uint32_t generation)
+{
+    ObjectPool<Entry>::Handle handle = {index, generation};
+    Entry *entry = entries_.get(handle);
+    if (--entry->references == 0)
+    {
+        destroy(handle);
+    }
+}
+
+void ResourceManager::destroy(ObjectPool<Entry>::Handle handle)
+{
+    Entry *entry = entries_.get(handle);
+    residentBytes_[(size_t)entry->type] -= entry->bytes;
+    counts_[(size_t)entry->type]--;
+    byKey_.erase(entry->key);
+    if (entry->texture)
+    {
+        streamer_->cancel(entry->texture);
+        textures_.destroy(entry->textureHandle);
+    }
+    if (entry->mesh)
+    {
+        meshes_.destroy(entry->meshHandle);
+    }
+    entries_.destroy(handle);
+}
+
+void ResourceManager::setTextureBudget(size_t bytes)
+{
+    textureBudget_ = bytes;
+}
+
+void ResourceManager::update()
+{
+    // textures finish streaming in between frames, so their sizes are picked up here
+    size_t &textureBytes = residentBytes_[(size_t)ResourceType::Texture];
+    entries_.forEach([&](ObjectPool<Entry>::Handle, Entry &entry) {
+        if (entry.type != ResourceType::Texture)
+        {
+            return;
+        }
+        textureBytes += entry.texture->gpuBytes() - entry.bytes;
+        entry.bytes = entry.texture->gpuBytes();
+
+        // drawn while evicted, bring it back
+        if (entry.evicted && entry.texture->lastUsed() == frame_)
+        {
+            entry.evicted = false;
+            streamer_->request(entry.texture, entry.name);
+        }
+    });
+
+    if (textureBudget_ && textureBytes > textureBudget_)
+    {
+        evictTextures();
+    }
+
+    // textures drawn from here on are stamped with the new frame, the next update() sees them as drawn last frame
+    frame_++;
+    Texture::setFrame(frame_);
+}
+
+void ResourceManager::evictTextures()
+{
+    std::vector<Entry *> candidates;
+    entries_.forEach([&](ObjectPool<Entry>::Handle, Entry &entry) {
+        // a texture drawn last frame would only be asked for again straight away
+        if (entry.type == ResourceType::Texture && entry.texture->isResident() &&
+            entry.texture->lastUsed() < frame_)
+        {
+            candidates.push_back(&entry);
+        }
+    });
+    std::sort(candidates.begin(), candidates.end(),
+              [](const Entry *a, const Entry *b) { return a->texture->lastUsed() < b->texture->lastUsed(); });
+
+    size_t &textureBytes = residentBytes_[(size_t)ResourceType::Texture];
+    for (Entry *entry : candidates)
+    {
+        if (textureBytes <= textureBudget_)
+        {
+            break;
+        }
+        entry->texture->evict();
+        entry->evicted = true;
+        textureBytes += entry->texture->gpuBytes() - entry->bytes;
+        entry->bytes = entry->texture->gpuBytes();
+        evictions_++;
+    }
+}
+
+void ResourceManager::report()
+{
+    std::vector<const Entry *> sorted;
+    entries_.forEach([&](ObjectPool<Entry>::Handle, Entry &entry) {
+        if (entry.type == ResourceType::Shader)
+        {
+            // relinked programs change size, the tracked total catches up here
+            size_t bytes = programBytes(entry.shader);
+            residentBytes_[(size_t)ResourceType::Shader] += bytes - entry.bytes;
+            entry.bytes = bytes;
+        }
+        sorted.push_back(&entry);
+    });
+    std::sort(sorted.begin(), sorted.end(), [](const Entry *a, const Entry *b) { return a->bytes > b->bytes; });
+
+    size_t total = 0;
+    for (size_t type = 0; type < resourceTypeCount; type++)
+    {
+        total += residentBytes_[type];
+    }
+    SDL_Log("resources: %.2f MiB resident, texture budget %.2f MiB (%s), %llu evictions", total / 1048576.0,
+            textureBudget_ / 1048576.0, textureBudget_ ? "enforced" : "none", (unsigned long long)evictions_);
+    for (size_t type = 0; type < resourceTypeCount; type++)
+    {
+        SDL_Log("  %-8s %4zu loaded, %10zu bytes", typeNames[type], counts_[type], residentBytes_[type]);
+    }
+    for (const Entry *entry : sorted)
+    {
+        const char *state = "";
+        if (entry->type == ResourceType::Texture)
+        {
+            state = entry->evicted ? "evicted" : entry->texture->isResident() ? "resident" : "streaming";
+        }
+        SDL_Log("  %-8s %10zu bytes  %3u refs  %-9s %s", typeNames[(size_t)entry->type], entry->bytes,
+                entry->references, state, entry->name.c_str());
+    }
+}
@@ -1,53 +1,174 @@
 #include "shader.h"
+#include "gl_ext.h"
+#include "gl_state.h"
+#include "stats.h"
+#include "uniform_buffer.h"
 
+#include <algorithm>
 #include <cstdint>
 #include <fstream>
 #include <iostream>
 #include <sstream>
+#include <vector>
 
 #include <SDL3/SDL.h>
 
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+bool Shader::locationCache_ = true;
+
 Shader::Shader(const char *vertexPath, const char *fragmentPath)
 {
-    std::string vertexCode = loadFile(vertexPath);
-    std::string fragmentCode = loadFile(fragmentPath);
+    PendingProgram pending = beginProgram(loadFile(vertexPath), loadFile(fragmentPath));
+    id_ = finishProgram(pending);
+    cacheUniforms();
+}
 
-    const char *vShaderCode = vertexCode.c_str();
-    const char *fShaderCode = fragmentCode.c_str();
+Shader::Shader(GLuint program) : id_(program)
+{
+    cacheUniforms();
+}
 
-    uint32_t vertex = compileShader(ShaderType::Vertex, vShaderCode);
-    uint32_t fragment = compileShader(ShaderType::Fragment, fShaderCode);
+Shader::~Shader()
+{
+    glstate::forgetProgram(id_);
+    glDeleteProgram(id_);
+}
 
-    // shader Program
-    createProgram(vertex, fragment);
+// copies one uniform's value between programs, to must be in use
+static void copyUniform(GLuint from, GLint fromLocation, GLint toLocation, GLenum type)
+{
+    GLfloat f[16];
+    GLint i[4];
+    GLuint u[4];
+    switch (type)
+    {
+    case GL_FLOAT:
+        glGetUniformfv(from, fromLocation, f);
+        glUniform1fv(toLocation, 1, f);
+        break;
+    case GL_FLOAT_VEC2:
+        glGetUniformfv(from, fromLocation, f);
+        glUniform2fv(toLocation, 1, f);
+        break;
+    case GL_FLOAT_VEC3:
+        glGetUniformfv(from, fromLocation, f);
+        glUniform3fv(toLocation, 1, f);
+        break;
+    case GL_FLOAT_VEC4:
+        glGetUniformfv(from, fromLocation, f);
+        glUniform4fv(toLocation, 1, f);
+        break;
+    case GL_FLOAT_MAT2:
+        glGetUniformfv(from, fromLocation, f);
+        glUniformMatrix2fv(toLocation, 1, GL_FALSE, f);
+        break;
+    case GL_FLOAT_MAT3:
+        glGetUniformfv(from, fromLocation, f);
+        glUniformMatrix3fv(toLocation, 1, GL_FALSE, f);
+        break;
+    case GL_FLOAT_MAT4:
+        glGetUniformfv(from, fromLocation, f);
+        glUniformMatrix4fv(toLocation, 1, GL_FALSE, f);
+        break;
+    case GL_INT_VEC2:
+    case GL_BOOL_VEC2:
+        glGetUniformiv(from, fromLocation, i);
+        glUniform2iv(toLocation, 1, i);
+        break;
+    case GL_INT_VEC3:
+    case GL_BOOL_VEC3:
+        glGetUniformiv(from, fromLocation, i);
+        glUniform3iv(toLocation, 1, i);
+        break;
+    case GL_INT_VEC4:
+    case GL_BOOL_VEC4:
+        glGetUniformiv(from, fromLocation, i);
+        glUniform4iv(toLocation, 1, i);
+        break;
+    case GL_UNSIGNED_INT:
+        glGetUniformuiv(from, fromLocation, u);
+        glUniform1uiv(toLocation, 1, u);
+        break;
+    case GL_UNSIGNED_INT_VEC2:
+        glGetUniformuiv(from, fromLocation, u);
+        glUniform2uiv(toLocation, 1, u);
+        break;
+    case GL_UNSIGNED_INT_VEC3:
+        glGetUniformuiv(from, fromLocation, u);
+        glUniform3uiv(toLocation, 1, u);
+        break;
+    case GL_UNSIGNED_INT_VEC4:
+        glGetUniformuiv(from, fromLocation, u);
+        glUniform4uiv(toLocation, 1, u);
+        break;
+    default:
+        // int, bool and every sampler type
+        glGetUniformiv(from, fromLocation, i);
+        glUniform1iv(toLocation, 1, i);
+        break;
+    }
+}
+
+void Shader::replaceProgram(GLuint program)
+{
+    GLuint previous = id_;
+    id_ = program;
+    cacheUniforms();
 
-    glDeleteShader(vertex);
-    glDeleteShader(fragment);
+    // every uniform both programs have keeps its value, uniforms new to this one start at zero
+    if (previous != 0 && id_ != 0)
+    {
+        glstate::useProgram(id_);
+        for (const auto &uniform : uniforms_)
+        {
+            GLint toLocation = locations_[uniform.second];
+            if (toLocation < 0)
+            {
+                continue;
+            }
+            stats::current().uniformLocationQueries++;
+            GLint fromLocation = glGetUniformLocation(previous, uniform.first.c_str());
+            if (fromLocation >= 0)
+            {
+                copyUniform(previous, fromLocation, toLocation, types_[uniform.second]);
+            }
+        }
+    }
+    else if (id_ != 0 && initialize_)
+    {
+        glstate::useProgram(id_);
+        initialize_(this);
+    }
+
+    glstate::forgetProgram(previous);
+    glDeleteProgram(previous);
 }
 
-Shader::~Shader()
+void Shader::setInitializer(void (*initialize)(Shader *shader))
 {
-    glDeleteProgram(id_);
+    initialize_ = initialize;
+    if (linked())
+    {
+        use();
+        initialize_(this);
+    }
 }
 
 void Shader::use()
 {
-    glUseProgram(id_);
+    glstate::useProgram(id_);
 }
 
 void Shader::setProjection(glm::mat4 projection)
 {
-    int projectionLoc = glGetUniformLocation(id_, "projection");
-    glUniformMatrix4fv(projectionLoc, 1, GL_FALSE, &projection[0][0]);
+    setMat4("projection", projection);
 }
 
 void Shader::setView(glm::mat4 view)
 {
-    int viewLoc = glGetUniformLocation(id_, "view");
-    glUniformMatrix4fv(viewLoc, 1, GL_FALSE, &view[0][0]);
+    setMat4("view", view);
 }
 
 void Shader::setModel(glm::vec3 pos, GLfloat rot)
@@ -55,33 +176,68 @@ void Shader::setModel(glm::vec3 pos, GLfloat rot)
     glm::mat4 model = glm::mat4(1.0f);
     model = glm::translate(model, pos);
     model = glm::rotate(model, rot, pos);
-    int modelLoc = glGetUniformLocation(id_, "model");
-    glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+    setMat4("model", model);
+}
+
+void Shader::set(UniformHandle<bool> handle, bool value) const
+{
+    stats::current().uniformUploads++;
+    glUniform1i(location(handle.slot), (int)value);
+}
+
+void Shader::set(UniformHandle<int> handle, int value) const
+{
+    stats::current().uniformUploads++;
+    glUniform1i(location(handle.slot), value);
+}
+
+void Shader::set(UniformHandle<float> handle, float value) const
+{
+    stats::current().uniformUploads++;
+    glUniform1f(location(handle.slot), value);
+}
+
+void Shader::set(UniformHandle<glm::vec3> handle, const glm::vec3 &value) const
+{
+    stats::current().uniformUploads++;
+    glUniform3f(location(handle.slot), value.x, value.y, value.z);
+}
+
+void Shader::set(UniformHandle<glm::mat3> handle, const glm::mat3 &mat) const
+{
+    stats::current().uniformUploads++;
+    glUniformMatrix3fv(location(handle.slot), 1, GL_FALSE, &mat[0][0]);
+}
+
+void Shader::set(UniformHandle<glm::mat4> handle, const glm::mat4 &mat) const
+{
+    stats::current().uniformUploads++;
+    glUniformMatrix4fv(location(handle.slot), 1, GL_FALSE, &mat[0][0]);
 }
 
 void Shader::setBool(const std::string &name, bool value) const
 {
-    glUniform1i(glGetUniformLocation(id_, name.c_str()), (int)value);
+    set(getUniform<bool>(name), value);
 }
 
 void Shader::setInt(const std::string &name, int value) const
 {
-    glUniform1i(glGetUniformLocation(id_, name.c_str()), value);
+    set(getUniform<int>(name), value);
 }
 
 void Shader::setFloat(const std::string &name, float value) const
 {
-    glUniform1f(glGetUniformLocation(id_, name.c_str()), value);
+    set(getUniform<float>(name), value);
 }
 
 void Shader::setVec3(const std::string &name, glm::vec3 value)
 {
-    glUniform3f(glGetUniformLocation(id_, name.c_str()), value.x, value.y, value.z);
+    set(getUniform<glm::vec3>(name), value);
 }
 
 void Shader::setMat4(const std::string &name, const glm::mat4 &mat)
 {
-    glUniformMatrix4fv(glGetUniformLocation(id_, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+    set(getUniform<glm::mat4>(name), mat);
 }
 
 /* Private Functions */
@@ -110,27 +266,150 @@ std::string Shader::loadFile(const char *filePath)
     return shaderCode;
 }
 
-uint32_t Shader::compileShader(ShaderType type, const char *shaderSourceCode)
+PendingProgram Shader::beginProgram(const std::string &vertexSource, const std::string &fragmentSource)
+{
+    PendingProgram pending;
+    pending.vertex = compileShader(ShaderType::Vertex, vertexSource.c_str());
+    pending.fragment = compileShader(ShaderType::Fragment, fragmentSource.c_str());
+
+    pending.program = glCreateProgram();
+    glAttachShader(pending.program, pending.vertex);
+    glAttachShader(pending.program, pending.fragment);
+    if (glext::features().programBinary)
+    {
+        glext::programParameteri(pending.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+    glLinkProgram(pending.program);
+    return pending;
+}
+
+bool Shader::programReady(const PendingProgram &pending)
+{
+    if (!glext::features().parallelShaderCompile)
+    {
+        return true;
+    }
+    GLint done = GL_TRUE;
+    glGetProgramiv(pending.program, GL_COMPLETION_STATUS_KHR, &done);
+    return done == GL_TRUE;
+}
+
+GLuint Shader::finishProgram(PendingProgram &pending)
 {
+    // the link log rarely says why a stage failed, so the stages are checked first
+    bool compiled = checkCompileErrors(pending.vertex, ShaderType::Vertex);
+    compiled = checkCompileErrors(pending.fragment, ShaderType::Fragment) && compiled;
+    bool linked = compiled && checkCompileErrors(pending.program, ShaderType::Program);
 
-    uint32_t shader = glCreateShader(type == ShaderType::Vertex ? GL_VERTEX_SHADER : GL_FRAGMENT_SHADER);
+    glDetachShader(pending.program, pending.vertex);
+    glDetachShader(pending.program, pending.fragment);
+    glDeleteShader(pending.vertex);
+    glDeleteShader(pending.fragment);
+
+    GLuint program = pending.program;
+    pending = PendingProgram();
+    if (!linked)
+    {
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
+
+GLuint Shader::compileShader(ShaderType type, const char *shaderSourceCode)
+{
+    GLuint shader = glCreateShader(type == ShaderType::Vertex ? GL_VERTEX_SHADER : GL_FRAGMENT_SHADER);
     glShaderSource(shader, 1, &shaderSourceCode, NULL);
     glCompileShader(shader);
-    checkCompileErrors(shader, type);
-
     return shader;
 }
 
-void Shader::createProgram(uint32_t vertexShader, uint32_t fragmentShader)
+void Shader::setLocationCache(bool enabled)
+{
+    locationCache_ = enabled;
+}
+
+GLint Shader::queryLocation(GLint slot) const
 {
-    id_ = glCreateProgram();
-    glAttachShader(id_, vertexShader);
-    glAttachShader(id_, fragmentShader);
-    glLinkProgram(id_);
-    checkCompileErrors(id_, ShaderType::Program);
+    if (id_ == 0)
+    {
+        return -1;
+    }
+    stats::current().uniformLocationQueries++;
+    return glGetUniformLocation(id_, names_[slot].c_str());
+}
+
+GLint Shader::findUniform(const std::string &name) const
+{
+    stats::current().uniformNameLookups++;
+    auto it = uniforms_.find(name);
+    return it != uniforms_.end() ? it->second : -1;
+}
+
+// query every active uniform once after linking so setting them never has to ask the driver. names keep
+// their slot across relinks, a uniform the new program lacks is left at location -1 where setting it is a no-op
+void Shader::cacheUniforms()
+{
+    std::fill(locations_.begin(), locations_.end(), -1);
+    if (id_ == 0)
+    {
+        return;
+    }
+    UniformBuffer::bindBlocks(id_);
+
+    auto assign = [this](const std::string &name, GLint location, GLenum type) {
+        auto it = uniforms_.find(name);
+        if (it == uniforms_.end())
+        {
+            it = uniforms_.emplace(name, (GLint)locations_.size()).first;
+            names_.push_back(name);
+            locations_.push_back(-1);
+            types_.push_back(type);
+        }
+        locations_[it->second] = location;
+        types_[it->second] = type;
+    };
+
+    GLint count = 0;
+    GLint maxLength = 0;
+    glGetProgramiv(id_, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(id_, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+    std::vector<GLchar> nameBuffer(maxLength > 0 ? maxLength : 1);
+    for (GLint i = 0; i < count; i++)
+    {
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(id_, (GLuint)i, (GLsizei)nameBuffer.size(), &length, &size, &type, nameBuffer.data());
+
+        std::string name(nameBuffer.data(), length);
+        stats::current().uniformLocationQueries++;
+        GLint location = glGetUniformLocation(id_, name.c_str());
+        if (location < 0)
+        {
+            // uniform block members have no location
+            continue;
+        }
+        assign(name, location, type);
+
+        // arrays are reported as "name[0]", register the other elements and the bare name too
+        size_t bracket = name.find("[0]");
+        if (bracket != std::string::npos && bracket + 3 == name.size())
+        {
+            std::string base = name.substr(0, bracket);
+            assign(base, location, type);
+            for (GLint element = 1; element < size; element++)
+            {
+                std::string elementName = base + "[" + std::to_string(element) + "]";
+                stats::current().uniformLocationQueries++;
+                assign(elementName, glGetUniformLocation(id_, elementName.c_str()), type);
+            }
+        }
+    }
 }
 
-void Shader::checkCompileErrors(uint32_t shader, ShaderType type)
+bool Shader::checkCompileErrors(GLuint shader, ShaderType type)
 {
     int success;
     char infoLog[1024];
@@ -169,4 +448,6 @@ void Shader::checkCompileErrors(uint32_t shader, ShaderType type)
                       << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
         }
     }
-}
\ No newline at end of file
+
+    return success != 0;
+}
@@ -0,0 +1,464 @@
+#include "shader_manager.h"
+#include "gl_ext.h"
+#include "uniform_buffer.h"
+
+#include <SDL3/SDL.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+#if defined(__linux__)
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+// how long the watcher sleeps between checks for shutdown when nothing changes
+static constexpr int watchTimeoutMs = 100;
+
+struct FeatureDefine
+{
+    ShaderFeature feature;
+    const char *name;
+};
+
+static constexpr FeatureDefine featureDefines[] = {
+    {SpecularMapFeature, "SPECULAR_MAP"},
+    {NormalMapFeature, "NORMAL_MAP"},
+    {ClusteredLightsFeature, "CLUSTERED_LIGHTS"},
+    {ShadowsFeature, "SHADOWS"},
+    {PackedMaterialsFeature, "PACKED_MATERIALS"},
+    {BindlessTexturesFeature, "BINDLESS_TEXTURES"},
+};
+
+static bool startsWith(const std::string &line, size_t start, const char *directive)
+{
+    return line.compare(start, std::strlen(directive), directive) == 0;
+}
+
+// "0 a.vert, 1 a.frag, 2 b.glsl", what the source numbers in a compiler message refer to
+static std::string sourceList(const std::vector<std::string> &files)
+{
+    std::string list;
+    for (size_t i = 0; i < files.size(); i++)
+    {
+        list += (i ? ", " : "") + std::to_string(i) + " " + files[i];
+    }
+    return list;
+}
+
+static uint64_t fnv1a(uint64_t hash, const std::string &text)
+{
+    for (unsigned char byte : text)
+    {
+        hash = (hash ^ byte) * 0x100000001b3ull;
+    }
+    // a separator, so moving text from the end of one input to the start of the next changes the hash
+    return (hash ^ 0xFF) * 0x100000001b3ull;
+}
+
+ShaderManager::ShaderManager(const std::string &directory, const std::string &cacheDirectory)
+    : directory_(directory), cacheDirectory_(cacheDirectory)
+{
+    // anything that could change what a binary means goes into the key
+    for (GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION, GL_SHADING_LANGUAGE_VERSION})
+    {
+        const char *value = (const char *)glGetString(name);
+        driver_ += value ? value : "";
+        driver_ += '\n';
+    }
+    if (!glext::features().programBinary && !cacheDirectory_.empty())
+    {
+        SDL_Log("shaders: the driver offers no program binary formats, every start compiles");
+        cacheDirectory_.clear();
+    }
+
+#if defined(__linux__)
+    watchFd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    // editors either write in place or write a new file and rename it over the old one
+    if (watchFd_ >= 0 && inotify_add_watch(watchFd_, directory_.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+    {
+        close(watchFd_);
+        watchFd_ = -1;
+    }
+    if (watchFd_ >= 0)
+    {
+        watcher_ = std::thread(&ShaderManager::watchLoop, this);
+    }
+    else
+    {
+        SDL_Log("shaders: can't watch %s, hot reload is off", directory_.c_str());
+    }
+#endif
+}
+
+ShaderManager::~ShaderManager()
+{
+    stopping_.store(true, std::memory_order_relaxed);
+    if (watcher_.joinable())
+    {
+        watcher_.join();
+    }
+#if defined(__linux__)
+    if (watchFd_ >= 0)
+    {
+        close(watchFd_);
+    }
+#endif
+
+    for (Program *program : programs_)
+    {
+        if (program->pending.program)
+        {
+            glDeleteProgram(Shader::finishProgram(program->pending));
+        }
+        delete program;
+    }
+}
+
+Shader *ShaderManager::load(const std::string &vertexFile, const std::string &fragmentFile,
+                            ShaderPermutation permutation)
+{
+    for (Program *program : programs_)
+    {
+        if (program->vertexFile == vertexFile && program->fragmentFile == fragmentFile &&
+            program->permutation == permutation)
+        {
+            return program->shader;
+        }
+    }
+
+    Program *program =
+        new Program{vertexFile, fragmentFile, permutation, {}, nullptr, 0, PendingProgram(), 0, false};
+    std::string vertex, fragment;
+    GLuint id = 0;
+    if (readSources(*program, vertex, fragment))
+    {
+        program->key = hashSources(vertex, fragment);
+        id = loadBinary(program->key);
+        if (id)
+        {
+            cacheHits_++;
+        }
+        else
+        {
+            PendingProgram pending = Shader::beginProgram(vertex, fragment);
+            compiles_++;
+            id = Shader::finishProgram(pending);
+            if (id)
+            {
+                saveBinary(program->key, id);
+            }
+        }
+    }
+    if (!id)
+    {
+        SDL_Log("shaders: %s + %s (permutation %08x) failed to build, it is reloaded once the source changes",
+                vertexFile.c_str(), fragmentFile.c_str(), permutation);
+        SDL_Log("shaders: sources %s", sourceList(program->files).c_str());
+    }
+
+    program->shader = shaders_.get(shaders_.create(id));
+    programs_.push_back(program);
+    return program->shader;
+}
+
+size_t ShaderManager::poll()
+{
+    std::vector<std::string> changed;
+    {
+        std::lock_guard<std::mutex> lock(changedMutex_);
+        changed.swap(changed_);
+    }
+    std::sort(changed.begin(), changed.end());
+    changed.erase(std::unique(changed.begin(), changed.end()), changed.end());
+
+    size_t swapped = 0;
+    for (Program *program : programs_)
+    {
+        bool touched = std::any_of(program->files.begin(), program->files.end(), [&](const std::string &file) {
+            return std::binary_search(changed.begin(), changed.end(), file);
+        });
+        if (touched && program->pending.program)
+        {
+            program->stale = true;
+        }
+        else if (touched)
+        {
+            swapped += startRelink(*program);
+        }
+
+        if (!program->pending.program || !Shader::programReady(program->pending))
+        {
+            continue;
+        }
+
+        GLuint id = Shader::finishProgram(program->pending);
+        if (id)
+        {
+            saveBinary(program->pendingKey, id);
+            program->key = program->pendingKey;
+            program->shader->replaceProgram(id);
+            swapped++;
+            SDL_Log("shaders: reloaded %s + %s (permutation %08x)", program->vertexFile.c_str(),
+                    program->fragmentFile.c_str(), program->permutation);
+        }
+        else
+        {
+            SDL_Log("shaders: %s + %s (permutation %08x) failed to build, keeping the last program that linked",
+                    program->vertexFile.c_str(), program->fragmentFile.c_str(), program->permutation);
+            SDL_Log("shaders: sources %s", sourceList(program->files).c_str());
+        }
+
+        if (program->stale)
+        {
+            program->stale = false;
+            swapped += startRelink(*program);
+        }
+    }
+    return swapped;
+}
+
+/* Private Functions */
+
+bool ShaderManager::readSources(Program &program, std::string &vertex, std::string &fragment) const
+{
+    std::string defines = "#define MAX_LIGHTS " + std::to_string(maxLights) + "\n";
+    defines += "#define MAX_CASCADES " + std::to_string(maxCascades) + "\n";
+    defines += "#define MAX_PACKED_MATERIALS " + std::to_string(maxPackedMaterials) + "\n";
+    defines += "#define LIGHT_COUNT " + std::to_string(program.permutation >> lightCountShift) + "\n";
+    for (const FeatureDefine &define : featureDefines)
+    {
+        if (program.permutation & define.feature)
+        {
+            defines += std::string("#define ") + define.name + "\n";
+        }
+    }
+
+    // a file that fails to read stays in the list, so creating or fixing it triggers the next attempt
+    program.files = {program.vertexFile, program.fragmentFile};
+    std::vector<std::string> included;
+    vertex.clear();
+    fragment.clear();
+    if (!expand(program.vertexFile, &defines, program.files, included, vertex))
+    {
+        return false;
+    }
+    included.clear();
+    return expand(program.fragmentFile, &defines, program.files, included, fragment);
+}
+
+// defines is only passed for the stage's own file, it goes in after #version
+bool ShaderManager::expand(const std::string &file, const std::string *defines, std::vector<std::string> &files,
+                           std::vector<std::string> &included, std::string &out) const
+{
+    if (std::find(included.begin(), included.end(), file) != included.end())
+    {
+        return true;
+    }
+    included.push_back(file);
+
+    size_t index = std::find(files.begin(), files.end(), file) - files.begin();
+    if (index == files.size())
+    {
+        files.push_back(file);
+    }
+    std::string source = Shader::loadFile((directory_ + "/" + file).c_str());
+    if (source.empty())
+    {
+        return false;
+    }
+
+    if (!defines)
+    {
+        out += "#line 1 " + std::to_string(index) + "\n";
+    }
+    std::istringstream lines(source);
+    std::string line;
+    for (int number = 1; std::getline(lines, line); number++)
+    {
+        size_t start = std::min(line.find_first_not_of(" \t"), line.size());
+        if (startsWith(line, start, "#include"))
+        {
+            size_t open = line.find('"', start);
+            size_t close = open == std::string::npos ? open : line.find('"', open + 1);
+            if (close == std::string::npos)
+            {
+                SDL_Log("shaders: %s:%d: expected #include \"file\"", file.c_str(), number);
+                return false;
+            }
+            if (!expand(line.substr(open + 1, close - open - 1), nullptr, files, included, out))
+            {
+                SDL_Log("shaders: %s:%d: can't include %s", file.c_str(), number, line.c_str() + open);
+                return false;
+            }
+            out += "#line " + std::to_string(number + 1) + " " + std::to_string(index) + "\n";
+            continue;
+        }
+
+        out += line;
+        out += '\n';
+        if (defines && startsWith(line, start, "#version"))
+        {
+            out += *defines;
+            out += "#line " + std::to_string(number + 1) + " " + std::to_string(index) + "\n";
+        }
+    }
+    return true;
+}
+
+uint64_t ShaderManager::hashSources(const std::string &vertex, const std::string &fragment) const
+{
+    uint64_t hash = 0xcbf29ce484222325ull;
+    hash = fnv1a(hash, driver_);
+    hash = fnv1a(hash, vertex);
+    return fnv1a(hash, fragment);
+}
+
+std::string ShaderManager::cachePath(uint64_t key) const
+{
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)key);
+    return cacheDirectory_ + "/" + name;
+}
+
+GLuint ShaderManager::loadBinary(uint64_t key)
+{
+    if (cacheDirectory_.empty())
+    {
+        return 0;
+    }
+
+    std::ifstream file(cachePath(key), std::ios::binary);
+    ProgramBinaryHeader header;
+    if (!file || !file.read((char *)&header, sizeof(header)) || header.magic != programBinaryMagic ||
+        header.version != programBinaryVersion || header.key != key)
+    {
+        return 0;
+    }
+    // a truncated or corrupted file mustn't get to size the allocation
+    std::streamoff start = file.tellg();
+    file.seekg(0, std::ios::end);
+    if (header.length == 0 || header.length > file.tellg() - start)
+    {
+        return 0;
+    }
+    file.seekg(start);
+    std::vector<char> binary(header.length);
+    if (!file.read(binary.data(), binary.size()))
+    {
+        return 0;
+    }
+
+    GLuint program = glCreateProgram();
+    glext::programBinary(program, header.format, binary.data(), (GLsizei)binary.size());
+    // drivers may refuse their own binaries, e.g. after an update that kept the version string
+    GLint linked = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (!linked)
+    {
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
+
+void ShaderManager::saveBinary(uint64_t key, GLuint program)
+{
+    if (cacheDirectory_.empty())
+    {
+        return;
+    }
+
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+    {
+        return;
+    }
+    std::vector<char> binary(length);
+    GLenum format = 0;
+    glext::getProgramBinary(program, length, &length, &format, binary.data());
+
+    std::error_code error;
+    std::filesystem::create_directories(cacheDirectory_, error);
+
+    // written next to the entry and renamed over it, so an interrupted write never leaves a truncated one
+    std::string path = cachePath(key);
+    std::string temporary = path + ".tmp";
+    {
+        ProgramBinaryHeader header = {programBinaryMagic, programBinaryVersion, key, format, (uint32_t)length};
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        file.write((const char *)&header, sizeof(header));
+        file.write(binary.data(), length);
+        if (!file)
+        {
+            SDL_Log("shaders: can't write %s", temporary.c_str());
+            return;
+        }
+    }
+    std::filesystem::rename(temporary, path, error);
+}
+
+// returns 1 when a cached binary could be swapped in straight away
+size_t ShaderManager::startRelink(Program &program)
+{
+    std::string vertex, fragment;
+    if (!readSources(program, vertex, fragment))
+    {
+        return 0;
+    }
+    uint64_t key = hashSources(vertex, fragment);
+    // editors often save without changing anything
+    if (key == program.key && program.shader->linked())
+    {
+        return 0;
+    }
+
+    GLuint cached = loadBinary(key);
+    if (cached)
+    {
+        cacheHits_++;
+        program.key = key;
+        program.shader->replaceProgram(cached);
+        SDL_Log("shaders: reloaded %s + %s (permutation %08x) from the binary cache", program.vertexFile.c_str(),
+                program.fragmentFile.c_str(), program.permutation);
+        return 1;
+    }
+
+    program.pending = Shader::beginProgram(vertex, fragment);
+    program.pendingKey = key;
+    compiles_++;
+    return 0;
+}
+
+void ShaderManager::watchLoop()
+{
+#if defined(__linux__)
+    alignas(inotify_event) char buffer[4096];
+    pollfd descriptor = {watchFd_, POLLIN, 0};
+    while (!stopping_.load(std::memory_order_relaxed))
+    {
+        if (::poll(&descriptor, 1, watchTimeoutMs) <= 0)
+        {
+            continue;
+        }
+        ssize_t bytes = read(watchFd_, buffer, sizeof(buffer));
+
+        std::lock_guard<std::mutex> lock(changedMutex_);
+        for (ssize_t offset = 0; offset < bytes;)
+        {
+            const inotify_event *event = (const inotify_event *)(buffer + offset);
+            if (event->len > 0)
+            {
+                changed_.push_back(event->name);
+            }
+            offset += sizeof(inotify_event) + event->len;
+        }
+    }
+#endif
+}
@@ -0,0 +1,219 @@
+#include "shadow_maps.h"
+#include "gl_state.h"
+
+#include <SDL3/SDL.h>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+// how far from the camera the cascades reach, past it nothing is shadowed by the directional light
+static constexpr float shadowDistance = 60.0f;
+// 1 is a purely logarithmic split, 0 a uniform one
+static constexpr float splitBlend = 0.8f;
+// extra depth behind each cascade's box towards the light, for casters between the light and the view
+static constexpr float casterReach = 40.0f;
+static constexpr float cubeNear = 0.05f;
+
+// slope scaled bias applied while drawing depth, lighting.frag offsets along the normal on top
+static constexpr float depthSlopeBias = 2.0f;
+static constexpr float depthConstantBias = 4.0f;
+
+// clip space to texture space, [-1, 1] to [0, 1] on every axis
+static const glm::mat4 textureSpace(glm::vec4(0.5f, 0.0f, 0.0f, 0.0f), glm::vec4(0.0f, 0.5f, 0.0f, 0.0f),
+                                    glm::vec4(0.0f, 0.0f, 0.5f, 0.0f), glm::vec4(0.5f, 0.5f, 0.5f, 1.0f));
+
+struct CubeFace
+{
+    glm::vec3 forward;
+    glm::vec3 up;
+};
+
+// GL's cube map conventions, in GL_TEXTURE_CUBE_MAP_POSITIVE_X + i order
+static const CubeFace cubeFaces[6] = {
+    {glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f)},
+    {glm::vec3(-1.0f, 0.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f)},
+    {glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f)},
+    {glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, 0.0f, -1.0f)},
+    {glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, -1.0f, 0.0f)},
+    {glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, -1.0f, 0.0f)},
+};
+
+static void setCompareParameters(GLenum target, GLenum wrap)
+{
+    glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(target, GL_TEXTURE_WRAP_S, wrap);
+    glTexParameteri(target, GL_TEXTURE_WRAP_T, wrap);
+    glTexParameteri(target, GL_TEXTURE_WRAP_R, wrap);
+    glTexParameteri(target, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+    glTexParameteri(target, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+}
+
+ShadowMaps::ShadowMaps()
+{
+    glGenTextures(1, &cascades_);
+    glstate::bindTexture(cascadesUnit, GL_TEXTURE_2D_ARRAY, cascades_);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT24, cascadeSize, cascadeSize, (GLsizei)cascadeCount, 0,
+                 GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+    setCompareParameters(GL_TEXTURE_2D_ARRAY, GL_CLAMP_TO_BORDER);
+    // outside every cascade reads as lit
+    const float border[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+    glTexParameterfv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BORDER_COLOR, border);
+
+    glGenTextures(1, &cube_);
+    glstate::bindTexture(cubeUnit, GL_TEXTURE_CUBE_MAP, cube_);
+    for (GLenum face = 0; face < 6; face++)
+    {
+        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, 0, GL_DEPTH_COMPONENT24, cubeSize, cubeSize, 0,
+                     GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+    }
+    setCompareParameters(GL_TEXTURE_CUBE_MAP, GL_CLAMP_TO_EDGE);
+    // filters across face edges instead of clamping at them
+    glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
+
+    // depth only, the attachment changes per pass
+    GLint previous = 0;
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previous);
+    glGenFramebuffers(1, &framebuffer_);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer_);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, cascades_, 0, 0);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        SDL_Log("shadows: the depth framebuffer is incomplete, shadow maps stay empty");
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, previous);
+
+    block_.params = glm::vec4(cubeNear, 1.0f / cascadeSize, 1.0f / cubeSize, 0.0f);
+    block_.lights = glm::ivec4(-1, -1, -1, -1);
+    SDL_Log("shadows: %zu cascades at %d, cube faces at %d", cascadeCount, cascadeSize, cubeSize);
+}
+
+ShadowMaps::~ShadowMaps()
+{
+    glDeleteFramebuffers(1, &framebuffer_);
+    glstate::forgetTexture(cascades_);
+    glstate::forgetTexture(cube_);
+    glDeleteTextures(1, &cascades_);
+    glDeleteTextures(1, &cube_);
+}
+
+void ShadowMaps::fitCascades(const glm::vec3 &direction, const glm::mat4 &view, const glm::mat4 &projection,
+                             float nearPlane, float farPlane)
+{
+    // the view frustum's corner rays, view depth changes linearly along each of them
+    glm::mat4 inverse = glm::inverse(projection * view);
+    glm::vec3 nearCorners[4], farCorners[4];
+    for (int i = 0; i < 4; i++)
+    {
+        float x = i & 1 ? 1.0f : -1.0f;
+        float y = i & 2 ? 1.0f : -1.0f;
+        glm::vec4 nearCorner = inverse * glm::vec4(x, y, -1.0f, 1.0f);
+        glm::vec4 farCorner = inverse * glm::vec4(x, y, 1.0f, 1.0f);
+        nearCorners[i] = glm::vec3(nearCorner) / nearCorner.w;
+        farCorners[i] = glm::vec3(farCorner) / farCorner.w;
+    }
+
+    glm::vec3 up = std::abs(direction.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+    float distance = std::min(shadowDistance, farPlane);
+    float begin = nearPlane;
+    for (size_t c = 0; c < cascadeCount; c++)
+    {
+        float t = (float)(c + 1) / cascadeCount;
+        float logarithmic = nearPlane * std::pow(distance / nearPlane, t);
+        float uniform = nearPlane + (distance - nearPlane) * t;
+        float end = splitBlend * logarithmic + (1.0f - splitBlend) * uniform;
+
+        glm::vec3 corners[8];
+        glm::vec3 center(0.0f);
+        for (int i = 0; i < 4; i++)
+        {
+            corners[i] = glm::mix(nearCorners[i], farCorners[i], (begin - nearPlane) / (farPlane - nearPlane));
+            corners[i + 4] = glm::mix(nearCorners[i], farCorners[i], (end - nearPlane) / (farPlane - nearPlane));
+            center += corners[i] + corners[i + 4];
+        }
+        center /= 8.0f;
+        float radius = 0.0f;
+        for (const glm::vec3 &corner : corners)
+        {
+            radius = std::max(radius, glm::length(corner - center));
+        }
+        // rounded up, so float noise in the corners can't change the texel size from one frame to the next
+        radius = std::ceil(radius * 16.0f) / 16.0f;
+
+        glm::mat4 lightView = glm::lookAt(center - direction * (radius + casterReach), center, up);
+        glm::mat4 lightProjection = glm::ortho(-radius, radius, -radius, radius, 0.0f, 2.0f * radius + casterReach);
+
+        // shift the box so the world origin falls on a texel corner, every other point then keeps its texel
+        glm::vec4 origin = lightProjection * lightView * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+        float texelsPerUnit = cascadeSize / 2.0f;
+        lightProjection[3][0] += (std::round(origin.x * texelsPerUnit) - origin.x * texelsPerUnit) / texelsPerUnit;
+        lightProjection[3][1] += (std::round(origin.y * texelsPerUnit) - origin.y * texelsPerUnit) / texelsPerUnit;
+
+        passMatrices_[c] = lightProjection * lightView;
+        block_.cascades[c] = textureSpace * passMatrices_[c];
+        block_.cascadeEnds[c] = end;
+        block_.cascadeTexels[c] = 2.0f * radius / cascadeSize;
+        begin = end;
+    }
+}
+
+void ShadowMaps::placeCube(const glm::vec3 &position, float farPlane)
+{
+    glm::mat4 projection = glm::perspective(glm::radians(90.0f), 1.0f, cubeNear, farPlane);
+    for (size_t face = 0; face < 6; face++)
+    {
+        glm::mat4 view = glm::lookAt(position, position + cubeFaces[face].forward, cubeFaces[face].up);
+        passMatrices_[cascadeCount + face] = projection * view;
+    }
+    block_.cube = glm::vec4(position, farPlane);
+}
+
+void ShadowMaps::begin()
+{
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousFramebuffer_);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer_);
+
+    glEnable(GL_POLYGON_OFFSET_FILL);
+    glPolygonOffset(depthSlopeBias, depthConstantBias);
+    // casters in front of a pass' near plane are flattened onto it instead of clipped
+    glEnable(GL_DEPTH_CLAMP);
+}
+
+void ShadowMaps::beginPass(size_t pass)
+{
+    if (pass < cascadeCount)
+    {
+        glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, cascades_, 0, (GLint)pass);
+        glViewport(0, 0, cascadeSize, cascadeSize);
+    }
+    else
+    {
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,
+                               GL_TEXTURE_CUBE_MAP_POSITIVE_X + (GLenum)(pass - cascadeCount), cube_, 0);
+        glViewport(0, 0, cubeSize, cubeSize);
+    }
+    glClear(GL_DEPTH_BUFFER_BIT);
+}
+
+void ShadowMaps::end()
+{
+    glDisable(GL_DEPTH_CLAMP);
+    glDisable(GL_POLYGON_OFFSET_FILL);
+    glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer_);
+}
+
+void ShadowMaps::bind()
+{
+    glstate::bindTexture(cascadesUnit, GL_TEXTURE_2D_ARRAY, cascades_);
+    glstate::bindTexture(cubeUnit, GL_TEXTURE_CUBE_MAP, cube_);
+}
+
+void ShadowMaps::setSamplers(Shader *shader)
+{
+    shader->use();
+    shader->setInt("cascadeShadows", cascadesUnit - GL_TEXTURE0);
+    shader->setInt("cubeShadow", cubeUnit - GL_TEXTURE0);
+}
@@ -1,23 +1,36 @@
 #include "texture.h"
+#include "gl_ext.h"
+#include "gl_state.h"
 
 #include <glad/glad.h>
 #include <iostream>
 #include <stb_image.h>
 #include <string>
 
+uint64_t Texture::frame_ = 0;
+
 Texture::Texture(const char *name, int texUnit)
 {
     textureUnit_ = texUnit;
     glGenTextures(1, &id_);
-    glActiveTexture(textureUnit_);
-    glBindTexture(GL_TEXTURE_2D, id_);
+    glstate::bindTexture(textureUnit_, GL_TEXTURE_2D, id_);
     setTextureParams();
 
-    std::string filePath = "assets/textures/" + std::string(name) + ".png";
+    // prefer the cooked texture, it already has its mip chain and is usually block compressed
+    std::string basePath = "assets/textures/" + std::string(name);
+    TextureFile cooked;
+    if (cooked.open(basePath + ".ltex") && canUpload(cooked))
+    {
+        uploadCooked(cooked, cooked.data());
+        return;
+    }
+
+    std::string filePath = basePath + ".png";
     unsigned char *data = loadImage(filePath.c_str());
     if (data)
     {
         compileTexture(data);
+        resident_ = true;
     }
     else
     {
@@ -27,10 +40,122 @@ Texture::Texture(const char *name, int texUnit)
     stbi_image_free(data);
 }
 
+Texture::Texture(int texUnit)
+{
+    textureUnit_ = texUnit;
+    glGenTextures(1, &id_);
+    glstate::bindTexture(textureUnit_, GL_TEXTURE_2D, id_);
+    setTextureParams();
+    uploadPlaceholder();
+}
+
+Texture::~Texture()
+{
+    glstate::forgetTexture(id_);
+    glDeleteTextures(1, &id_);
+}
+
 void Texture::use()
 {
-    glActiveTexture(textureUnit_);
-    glBindTexture(GL_TEXTURE_2D, id_);
+    lastUsed_ = frame_;
+    glstate::bindTexture(textureUnit_, GL_TEXTURE_2D, id_);
+}
+
+void Texture::setFrame(uint64_t frame)
+{
+    frame_ = frame;
+}
+
+void Texture::evict()
+{
+    glstate::bindTexture(textureUnit_, GL_TEXTURE_2D, id_);
+    // a cooked upload limited the level range to its own chain
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 1000);
+    uploadPlaceholder();
+    resident_ = false;
+}
+
+// 2x2 grey checker, obvious enough to spot but not distracting while the real image streams in
+void Texture::uploadPlaceholder()
+{
+    const unsigned char placeholder[] = {
+        96, 96, 96, 160, 160, 160, 160, 160, 160, 96, 96, 96,
+    };
+    width_ = 2;
+    height_ = 2;
+    nrChannels_ = 3;
+    compileTexture(placeholder);
+}
+
+void Texture::upload(const unsigned char *imageData, int width, int height, int channels)
+{
+    width_ = width;
+    height_ = height;
+    nrChannels_ = channels;
+    glstate::bindTexture(textureUnit_, GL_TEXTURE_2D, id_);
+    compileTexture(imageData);
+    resident_ = true;
+}
+
+bool Texture::canUpload(const TextureFile &file)
+{
+    switch (file.header().format)
+    {
+    case TextureFileFormat::BC1:
+    case TextureFileFormat::BC3:
+        return glext::features().s3tc;
+    case TextureFileFormat::BC7:
+        return glext::features().bptc;
+    default:
+        return true;
+    }
+}
+
+void Texture::uploadCooked(const TextureFile &file, const unsigned char *base)
+{
+    const TextureFileHeader &header = file.header();
+    width_ = header.width;
+    height_ = header.height;
+    nrChannels_ = header.channels;
+
+    glstate::bindTexture(textureUnit_, GL_TEXTURE_2D, id_);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, header.levelCount - 1);
+
+    bytes_ = 0;
+    for (uint32_t i = 0; i < header.levelCount; i++)
+    {
+        const TextureFileLevel &level = file.level(i);
+        bytes_ += level.size;
+        // base may be 0 (PBO offsets), so add as integers rather than offsetting a null pointer
+        const unsigned char *pixels = reinterpret_cast<const unsigned char *>((uintptr_t)base + level.offset);
+        switch (header.format)
+        {
+        case TextureFileFormat::BC1:
+            glCompressedTexImage2D(GL_TEXTURE_2D, i, GL_COMPRESSED_RGB_S3TC_DXT1_EXT, level.width, level.height, 0,
+                                   (GLsizei)level.size, pixels);
+            break;
+        case TextureFileFormat::BC3:
+            glCompressedTexImage2D(GL_TEXTURE_2D, i, GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, level.width, level.height, 0,
+                                   (GLsizei)level.size, pixels);
+            break;
+        case TextureFileFormat::BC7:
+            glCompressedTexImage2D(GL_TEXTURE_2D, i, GL_COMPRESSED_RGBA_BPTC_UNORM, level.width, level.height, 0,
+                                   (GLsizei)level.size, pixels);
+            break;
+        default:
+        {
+            int channels = (int)header.format - (int)TextureFileFormat::R8 + 1;
+            GLenum format = formatForChannels(channels);
+            setSwizzle(channels);
+            glTexImage2D(GL_TEXTURE_2D, i, format, level.width, level.height, 0, format, GL_UNSIGNED_BYTE, pixels);
+            break;
+        }
+        }
+    }
+    resident_ = true;
 }
 
 unsigned char *Texture::loadImage(const char *filePath)
@@ -38,10 +163,44 @@ unsigned char *Texture::loadImage(const char *filePath)
     return stbi_load(filePath, &width_, &height_, &nrChannels_, 0);
 }
 
-void Texture::compileTexture(unsigned char *imageData)
+GLenum Texture::formatForChannels(int channels)
+{
+    switch (channels)
+    {
+    case 1:
+        return GL_RED;
+    case 2:
+        return GL_RG;
+    case 4:
+        return GL_RGBA;
+    default:
+        return GL_RGB;
+    }
+}
+
+void Texture::compileTexture(const unsigned char *imageData)
 {
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width_, height_, 0, GL_RGB, GL_UNSIGNED_BYTE, imageData);
+    GLenum format = formatForChannels(nrChannels_);
+
+    // stb_image rows are tightly packed, RGB rows aren't always a multiple of 4 bytes
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    setSwizzle(nrChannels_);
+    glTexImage2D(GL_TEXTURE_2D, 0, format, width_, height_, 0, format, GL_UNSIGNED_BYTE, imageData);
     glGenerateMipmap(GL_TEXTURE_2D);
+
+    // the mip chain adds a third
+    size_t texelBytes = nrChannels_ == 3 ? 4 : nrChannels_;
+    bytes_ = (size_t)width_ * height_ * texelBytes * 4 / 3;
+}
+
+// one and two channel images are grey and grey-alpha, unswizzled they would sample as red and red-green
+void Texture::setSwizzle(int channels)
+{
+    static const GLint grey[] = {GL_RED, GL_RED, GL_RED, GL_ONE};
+    static const GLint greyAlpha[] = {GL_RED, GL_RED, GL_RED, GL_GREEN};
+    static const GLint colour[] = {GL_RED, GL_GREEN, GL_BLUE, GL_ALPHA};
+    glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA,
+                     channels == 1 ? grey : channels == 2 ? greyAlpha : colour);
 }
 
 void Texture::setTextureParams()
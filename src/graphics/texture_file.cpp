@@ -0,0 +1,107 @@
+#include "texture_file.h"
+
+#if defined(_WIN32)
+#include <fstream>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+TextureFile::~TextureFile()
+{
+    close();
+}
+
+bool TextureFile::open(const std::string &path)
+{
+    close();
+
+#if defined(_WIN32)
+    // no mmap, read the whole file instead
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file)
+    {
+        return false;
+    }
+    size_ = (size_t)file.tellg();
+    data_ = new unsigned char[size_];
+    file.seekg(0);
+    file.read(reinterpret_cast<char *>(data_), size_);
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size == 0)
+    {
+        ::close(fd);
+        return false;
+    }
+
+    size_ = (size_t)info.st_size;
+    void *mapped = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED)
+    {
+        size_ = 0;
+        return false;
+    }
+    data_ = static_cast<unsigned char *>(mapped);
+#endif
+
+    if (!validate())
+    {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void TextureFile::close()
+{
+    if (!data_)
+    {
+        return;
+    }
+#if defined(_WIN32)
+    delete[] data_;
+#else
+    munmap(data_, size_);
+#endif
+    data_ = nullptr;
+    size_ = 0;
+}
+
+bool TextureFile::validate() const
+{
+    if (size_ < sizeof(TextureFileHeader))
+    {
+        return false;
+    }
+
+    const TextureFileHeader &head = header();
+    if (head.magic != textureFileMagic || head.version != textureFileVersion || head.levelCount == 0)
+    {
+        return false;
+    }
+
+    if (sizeof(TextureFileHeader) + (size_t)head.levelCount * sizeof(TextureFileLevel) > size_)
+    {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < head.levelCount; i++)
+    {
+        const TextureFileLevel &lvl = level(i);
+        if (lvl.offset + lvl.size > size_)
+        {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,274 @@
+#include "texture_streamer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <stb_image.h>
+
+TextureStreamer::TextureStreamer(unsigned workerCount, size_t maxDecoded, size_t frameByteBudget)
+    : maxDecoded_(maxDecoded), frameByteBudget_(frameByteBudget)
+{
+    if (workerCount == 0)
+    {
+        // leave a core for the render thread
+        unsigned cores = std::thread::hardware_concurrency();
+        workerCount = cores > 2 ? cores - 1 : 1;
+    }
+
+    for (unsigned i = 0; i < workerCount; i++)
+    {
+        workers_.emplace_back(&TextureStreamer::workerLoop, this);
+    }
+
+    glGenBuffers(pboCount, pbos_);
+}
+
+TextureStreamer::~TextureStreamer()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    jobReady_.notify_all();
+    decodedSpace_.notify_all();
+    for (std::thread &worker : workers_)
+    {
+        worker.join();
+    }
+
+    for (DecodedImage &image : decoded_)
+    {
+        freeImage(image);
+    }
+    glDeleteBuffers(pboCount, pbos_);
+}
+
+void TextureStreamer::freeImage(DecodedImage &image)
+{
+    stbi_image_free(image.pixels);
+    delete image.cooked;
+    image.pixels = nullptr;
+    image.cooked = nullptr;
+}
+
+void TextureStreamer::request(Texture *texture, const std::string &name)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        jobs_.push_back({texture, "assets/textures/" + name, nextId_++});
+        inFlight_++;
+    }
+    jobReady_.notify_one();
+}
+
+void TextureStreamer::cancel(Texture *texture)
+{
+    bool freedSpace = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (size_t i = 0; i < jobs_.size();)
+        {
+            if (jobs_[i].texture == texture)
+            {
+                jobs_.erase(jobs_.begin() + i);
+                inFlight_--;
+            }
+            else
+            {
+                i++;
+            }
+        }
+        for (size_t i = 0; i < decoded_.size();)
+        {
+            if (decoded_[i].texture == texture)
+            {
+                freeImage(decoded_[i]);
+                decoded_.erase(decoded_.begin() + i);
+                inFlight_--;
+                freedSpace = true;
+            }
+            else
+            {
+                i++;
+            }
+        }
+        // the worker drops these itself once it has decoded them
+        for (const DecodeJob *job : decoding_)
+        {
+            if (job->texture == texture)
+            {
+                cancelled_.push_back(job->id);
+            }
+        }
+    }
+    if (freedSpace)
+    {
+        decodedSpace_.notify_all();
+    }
+}
+
+size_t TextureStreamer::pending() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return inFlight_;
+}
+
+void TextureStreamer::workerLoop()
+{
+    for (;;)
+    {
+        DecodeJob job;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            jobReady_.wait(lock, [this] { return stopping_ || !jobs_.empty(); });
+            if (stopping_)
+            {
+                return;
+            }
+            job = jobs_.front();
+            jobs_.pop_front();
+            decoding_.push_back(&job);
+        }
+
+        DecodedImage image = {};
+        image.texture = job.texture;
+        image.id = job.id;
+
+        // a cooked texture only needs mapping, fall back to decoding the PNG if the driver can't take its format
+        TextureFile *cooked = new TextureFile();
+        if (cooked->open(job.path + ".ltex") && Texture::canUpload(*cooked))
+        {
+            image.cooked = cooked;
+        }
+        else
+        {
+            delete cooked;
+        }
+
+        if (!image.cooked)
+        {
+            std::string pngPath = job.path + ".png";
+            image.pixels = stbi_load(pngPath.c_str(), &image.width, &image.height, &image.channels, 0);
+            if (!image.pixels)
+            {
+                std::cout << "Failed to load texture: " << pngPath << std::endl;
+            }
+        }
+
+        // the job stays in decoding_ through the wait, cancel() may run while this sleeps
+        std::unique_lock<std::mutex> lock(mutex_);
+        decodedSpace_.wait(lock, [this] { return stopping_ || decoded_.size() < maxDecoded_; });
+        if (stopping_)
+        {
+            freeImage(image);
+            return;
+        }
+        decoding_.erase(std::find(decoding_.begin(), decoding_.end(), &job));
+        std::vector<uint64_t>::iterator cancelled = std::find(cancelled_.begin(), cancelled_.end(), job.id);
+        if (cancelled != cancelled_.end())
+        {
+            cancelled_.erase(cancelled);
+            inFlight_--;
+            freeImage(image);
+            continue;
+        }
+        decoded_.push_back(image);
+    }
+}
+
+size_t TextureStreamer::pump()
+{
+    size_t uploaded = 0;
+    size_t bytes = 0;
+
+    for (;;)
+    {
+        DecodedImage image;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (decoded_.empty())
+            {
+                break;
+            }
+
+            // always upload at least one image so a texture bigger than the budget still gets through
+            const DecodedImage &next = decoded_.front();
+            size_t size = next.cooked ? next.cooked->size() : (size_t)next.width * next.height * next.channels;
+            if (uploaded > 0 && bytes + size > frameByteBudget_)
+            {
+                break;
+            }
+            bytes += size;
+
+            image = decoded_.front();
+            decoded_.pop_front();
+            inFlight_--;
+        }
+        decodedSpace_.notify_one();
+
+        if (image.cooked)
+        {
+            uploadCooked(image);
+        }
+        else if (image.pixels)
+        {
+            uploadImage(image);
+        }
+        freeImage(image);
+        uploaded++;
+    }
+
+    return uploaded;
+}
+
+// copy into a PBO and let the driver pull the pixels from there, the PBOs are used round robin so a
+// buffer the driver may still be reading from isn't written again straight away
+GLuint TextureStreamer::nextPbo()
+{
+    GLuint pbo = pbos_[nextPbo_];
+    nextPbo_ = (nextPbo_ + 1) % pboCount;
+    return pbo;
+}
+
+void TextureStreamer::uploadImage(const DecodedImage &image)
+{
+    size_t size = (size_t)image.width * image.height * image.channels;
+    GLuint pbo = nextPbo();
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, size, NULL, GL_STREAM_DRAW);
+    void *mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if (mapped)
+    {
+        std::memcpy(mapped, image.pixels, size);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        image.texture->upload(nullptr, image.width, image.height, image.channels);
+    }
+    else
+    {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        image.texture->upload(image.pixels, image.width, image.height, image.channels);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+// the whole file goes into the PBO so the level offsets in the header index straight into it
+void TextureStreamer::uploadCooked(const DecodedImage &image)
+{
+    const TextureFile &file = *image.cooked;
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, nextPbo());
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, file.size(), NULL, GL_STREAM_DRAW);
+    void *mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, file.size(), GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if (mapped)
+    {
+        std::memcpy(mapped, file.data(), file.size());
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        image.texture->uploadCooked(file, nullptr);
+    }
+    else
+    {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        image.texture->uploadCooked(file, file.data());
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
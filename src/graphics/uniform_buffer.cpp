@@ -0,0 +1,61 @@
+#include "uniform_buffer.h"
+#include "stats.h"
+
+#include <iostream>
+
+struct BlockBinding
+{
+    const char *name;
+    UniformBinding binding;
+};
+
+static const BlockBinding blockBindings[] = {
+    {"Camera", CameraBinding},
+    {"Lights", LightsBinding},
+    {"Clusters", ClustersBinding},
+    {"Shadows", ShadowsBinding},
+    {"Materials", MaterialsBinding},
+};
+
+UniformBuffer::UniformBuffer(UniformBinding binding, size_t size) : binding_(binding), size_(size)
+{
+    glGenBuffers(1, &id_);
+    glBindBuffer(GL_UNIFORM_BUFFER, id_);
+    glBufferData(GL_UNIFORM_BUFFER, size_, NULL, GL_STREAM_DRAW);
+    glBindBufferBase(GL_UNIFORM_BUFFER, binding_, id_);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+UniformBuffer::~UniformBuffer()
+{
+    glDeleteBuffers(1, &id_);
+}
+
+void UniformBuffer::update(const void *data, size_t size)
+{
+    if (size > size_)
+    {
+        std::cout << "ERROR::UNIFORM_BUFFER::UPDATE_LARGER_THAN_BUFFER" << std::endl;
+        return;
+    }
+
+    stats::current().uniformBufferUpdates++;
+    glBindBuffer(GL_UNIFORM_BUFFER, id_);
+    // orphan the previous frame's storage so the driver can hand us fresh memory instead of stalling
+    glBufferData(GL_UNIFORM_BUFFER, size_, NULL, GL_STREAM_DRAW);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, size, data);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+// GLSL 330 has no layout(binding = n), so blocks are pointed at their binding points after linking
+void UniformBuffer::bindBlocks(GLuint program)
+{
+    for (const BlockBinding &block : blockBindings)
+    {
+        GLuint index = glGetUniformBlockIndex(program, block.name);
+        if (index != GL_INVALID_INDEX)
+        {
+            glUniformBlockBinding(program, index, block.binding);
+        }
+    }
+}
@@ -7,7 +7,12 @@
 #include <SDL3/SDL.h>
 #include <SDL3/SDL_main.h>
 
+#include <cstdlib>
+#include <cstring>
+
 #include "constants.h"
+#include "gl_ext.h"
+#include "profiler.h"
 #include "renderer.h"
 #include "camera.h"
 
@@ -16,17 +21,10 @@ typedef struct
     SDL_Window *window;
     SDL_GLContext glContext;
     Camera *camera;
-    float lastFrame = 0.0f;
+    Uint64 lastFrameNs = 0;
     float deltaTime = 0.0f;
 } AppState;
 
-typedef struct
-{
-    Uint64 last_ns;
-    Uint64 frame_ns;
-    unsigned frames;
-} FPS;
-
 SDL_AppResult SDL_AppInit(void **appstate, int argc, char *argv[])
 {
     if (!SDL_Init(SDL_INIT_VIDEO))
@@ -61,6 +59,7 @@ SDL_AppResult SDL_AppInit(void **appstate, int argc, char *argv[])
         SDL_Log("Failed to initialize GLAD");
         return SDL_APP_FAILURE;
     }
+    glext::load((GLADloadproc)SDL_GL_GetProcAddress);
 
     Camera *camera = new Camera(glm::vec3(0.0f, 0.0f, 3.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
 
@@ -70,7 +69,21 @@ SDL_AppResult SDL_AppInit(void **appstate, int argc, char *argv[])
     state->camera = camera;
     *appstate = state;
 
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--texture-budget") == 0 && i + 1 < argc)
+        {
+            // in MiB
+            renderer::setTextureBudget((size_t)std::atoi(argv[++i]) << 20);
+        }
+        else if (std::strcmp(argv[i], "--bindless-materials") == 0)
+        {
+            renderer::setBindlessMaterials(true);
+        }
+    }
+
     renderer::init();
+    profiler::init();
 
     return SDL_APP_CONTINUE;
 }
@@ -89,6 +102,10 @@ SDL_AppResult SDL_AppEvent(void *appstate, SDL_Event *event)
         state->camera->setPitch(event->motion.yrel);
         break;
 
+    case SDL_EVENT_MOUSE_BUTTON_DOWN:
+        renderer::pick(state->camera);
+        break;
+
     case SDL_EVENT_KEY_DOWN:
         switch (event->key.scancode)
         {
@@ -100,6 +117,33 @@ SDL_AppResult SDL_AppEvent(void *appstate, SDL_Event *event)
         case SDL_SCANCODE_SPACE:
             renderer::nextScene();
             break;
+        case SDL_SCANCODE_UP:
+            renderer::scaleInstances(true);
+            break;
+        case SDL_SCANCODE_DOWN:
+            renderer::scaleInstances(false);
+            break;
+        case SDL_SCANCODE_C:
+            renderer::toggleCulling();
+            break;
+        case SDL_SCANCODE_H:
+            renderer::toggleShadows();
+            break;
+        case SDL_SCANCODE_L:
+            renderer::toggleLod();
+            break;
+        case SDL_SCANCODE_M:
+            renderer::toggleMaterialArrays();
+            break;
+        case SDL_SCANCODE_F1:
+            profiler::logSummary();
+            break;
+        case SDL_SCANCODE_F2:
+            profiler::exportChromeTrace("trace.json");
+            break;
+        case SDL_SCANCODE_F3:
+            renderer::logResources();
+            break;
         case SDL_SCANCODE_W:
             state->camera->setForward(true);
             break;
@@ -143,7 +187,7 @@ SDL_AppResult SDL_AppEvent(void *appstate, SDL_Event *event)
         }
         break;
     case SDL_EVENT_WINDOW_RESIZED:
-        glViewport(0, 0, event->window.data1, event->window.data2);
+        renderer::resize(event->window.data1, event->window.data2);
         break;
     }
 
@@ -154,21 +198,38 @@ SDL_AppResult SDL_AppIterate(void *appstate)
 {
     AppState *state = static_cast<AppState *>(appstate);
 
-    float currentFrame = SDL_GetTicks() / 1000.0f;
-    state->deltaTime = currentFrame - state->lastFrame;
-    state->lastFrame = currentFrame;
+    profiler::beginFrame();
+
+    Uint64 currentFrameNs = SDL_GetTicksNS();
+    if (state->lastFrameNs)
+    {
+        state->deltaTime = (currentFrameNs - state->lastFrameNs) / (float)SDL_NS_PER_SECOND;
+    }
+    state->lastFrameNs = currentFrameNs;
+
+    {
+        PROFILE_CPU("camera");
+        state->camera->updateDir();
+        state->camera->updatePos(state->deltaTime);
+    }
 
-    state->camera->updateDir();
-    state->camera->updatePos(state->deltaTime);
+    {
+        PROFILE_CPU("render");
+        renderer::render(state->camera);
+    }
 
-    renderer::render(state->camera);
+    {
+        PROFILE_CPU("swap");
+        SDL_GL_SwapWindow(state->window);
+    }
 
-    SDL_GL_SwapWindow(state->window);
+    profiler::endFrame();
     return SDL_APP_CONTINUE;
 }
 
 void SDL_AppQuit(void *appstate, SDL_AppResult result)
 {
+    profiler::shutdown();
     renderer::cleanup();
 
     AppState *state = static_cast<AppState *>(appstate);
@@ -176,6 +237,7 @@ void SDL_AppQuit(void *appstate, SDL_AppResult result)
     {
         return;
     }
+    delete state->camera;
     SDL_free(state);
     SDL_Quit();
 }
\ No newline at end of file
@@ -1,10 +1,31 @@
 #include "cube.h"
 
-
 #include <glm/gtc/matrix_transform.hpp>
 
-Cube::Cube(glm::vec3 size, Shader *shader, Texture *diff, Texture *spec)
-    : size_(size), shader_(shader), diff_(diff), spec_(spec)
+/*
+ *  Positions are half floats rather than snorm16, so the cube's instances need no decode transform. Corners
+ *  at +-size/2 keep 11 significant bits that way, exact for power-of-two sizes like the unit crates and off
+ *  by up to 1/2048 of the corner's magnitude otherwise.
+ */
+static const VertexLayout cubeLayout = {PositionFormat::Half, NormalFormat::OctSnorm16, UvFormat::Unorm16};
+
+Cube::Cube(glm::vec3 size, Shader *shader, Texture *diff, Texture *spec, GeometryPool *pool)
+    : Mesh(buildVertices(size), buildIndices(), cubeLayout, pool), size_(size), shader_(shader), diff_(diff),
+      spec_(spec)
+{
+    shader_->use();
+    shader_->setInt("material.diffuse", 0);
+    shader_->setInt("material.specular", 1);
+}
+
+VertexLayout Cube::vertexLayout()
+{
+    return cubeLayout;
+}
+
+/* Private Functions */
+
+std::vector<Vertex> Cube::buildVertices(glm::vec3 size)
 {
     float halfWidth = size.x / 2;
     float halfHeight = size.y / 2;
@@ -69,7 +90,18 @@ Cube::Cube(glm::vec3 size, Shader *shader, Texture *diff, Texture *spec)
         halfWidth, -halfHeight,-halfDepth, 0.0f, -1.0f, 0.0f, 1.0f, 1.0f,
     };
 
-    int indices[] = {
+    std::vector<Vertex> result;
+    for (size_t i = 0; i < sizeof(vertices) / sizeof(float); i += 8)
+    {
+        const float *v = vertices + i;
+        result.push_back({glm::vec3(v[0], v[1], v[2]), glm::vec3(v[3], v[4], v[5]), glm::vec2(v[6], v[7])});
+    }
+    return result;
+}
+
+std::vector<uint32_t> Cube::buildIndices()
+{
+    uint32_t indices[] = {
         // front
         0,  1,  3,
         1,  2,  3,
@@ -95,46 +127,5 @@ Cube::Cube(glm::vec3 size, Shader *shader, Texture *diff, Texture *spec)
         21, 22, 23
     };
 
-    glGenVertexArrays(1, &vao_);
-    glGenBuffers(1, &vbo_);
-    glGenBuffers(1, &ebo_);
-
-    glBindVertexArray(vao_);
-
-    glBindBuffer(GL_ARRAY_BUFFER, vbo_);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo_);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
-
-    // position attribute
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, Cube::vertexStride * sizeof(float), (void *)0);
-    glEnableVertexAttribArray(0);
-    // normals attribute
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, Cube::vertexStride * sizeof(float), (void *)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-    // texture attribute
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, Cube::vertexStride * sizeof(float), (void *)(6 * sizeof(float)));
-    glEnableVertexAttribArray(2);
-
-    shader_->use();
-    shader_->setInt("material.diffuse", 0);
-    shader_->setInt("material.specular", 1);
+    return std::vector<uint32_t>(std::begin(indices), std::end(indices));
 }
-
-Cube::~Cube()
-{
-    glDeleteBuffers(1, &ebo_);
-    glDeleteVertexArrays(1, &vao_);
-    glDeleteBuffers(1, &vbo_);
-}
-
-void Cube::bind()
-{
-    glBindVertexArray(vao_);
-}
-
-void Cube::draw()
-{
-    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-}
\ No newline at end of file
@@ -0,0 +1,463 @@
+#include "mesh.h"
+#include "geometry_pool.h"
+#include "gl_state.h"
+#include "stats.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/packing.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+size_t VertexLayout::positionSize() const
+{
+    switch (position)
+    {
+    case PositionFormat::Half:
+    case PositionFormat::Snorm16:
+        return 8; // three 16 bit components padded to four
+    default:
+        return 12;
+    }
+}
+
+size_t VertexLayout::normalSize() const
+{
+    switch (normal)
+    {
+    case NormalFormat::OctSnorm16:
+        return 4;
+    case NormalFormat::OctSnorm8:
+        return 4; // two bytes padded to four
+    default:
+        return 8;
+    }
+}
+
+size_t VertexLayout::uvSize() const
+{
+    return uv == UvFormat::Float32 ? 8 : 4;
+}
+
+// octahedral encoding: project onto the |x|+|y|+|z| = 1 octahedron and fold the lower half over the upper
+static glm::vec2 octEncode(glm::vec3 n)
+{
+    n /= (std::fabs(n.x) + std::fabs(n.y) + std::fabs(n.z));
+    glm::vec2 p(n.x, n.y);
+    if (n.z < 0.0f)
+    {
+        p = glm::vec2((1.0f - std::fabs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f),
+                      (1.0f - std::fabs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f));
+    }
+    return p;
+}
+
+template <typename T> static void write(uint8_t *dst, const T &value)
+{
+    std::memcpy(dst, &value, sizeof(T));
+}
+
+bool vertexformat::uvsFitUnorm(const std::vector<Vertex> &vertices)
+{
+    for (const Vertex &v : vertices)
+    {
+        if (v.uv.x < 0.0f || v.uv.x > 1.0f || v.uv.y < 0.0f || v.uv.y > 1.0f)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+glm::mat4 vertexformat::pack(const std::vector<Vertex> &vertices, const VertexLayout &layout,
+                             std::vector<uint8_t> &out)
+{
+    glm::vec3 boundsMin(0.0f), boundsMax(0.0f);
+    if (!vertices.empty())
+    {
+        boundsMin = boundsMax = vertices[0].position;
+    }
+    for (const Vertex &v : vertices)
+    {
+        boundsMin = glm::min(boundsMin, v.position);
+        boundsMax = glm::max(boundsMax, v.position);
+    }
+
+    /*
+     *  Snorm16 positions are stored relative to the bounds centre and divided by the largest half extent.
+     *  Using one scale for all three axes keeps the decode transform a uniform scale, so normal matrices
+     *  built from model * decode stay valid once the fragment shader normalises.
+     */
+    glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+    glm::vec3 halfExtent = (boundsMax - boundsMin) * 0.5f;
+    float scale = std::max(halfExtent.x, std::max(halfExtent.y, halfExtent.z));
+    if (scale <= 0.0f)
+    {
+        scale = 1.0f;
+    }
+    glm::mat4 decode(1.0f);
+    if (layout.position == PositionFormat::Snorm16)
+    {
+        decode = glm::scale(glm::translate(glm::mat4(1.0f), center), glm::vec3(scale));
+    }
+
+    size_t stride = layout.stride();
+    size_t normalOffset = layout.positionSize();
+    size_t uvOffset = normalOffset + layout.normalSize();
+    out.assign(vertices.size() * stride, 0);
+
+    for (size_t i = 0; i < vertices.size(); i++)
+    {
+        const Vertex &v = vertices[i];
+        uint8_t *dst = out.data() + i * stride;
+
+        switch (layout.position)
+        {
+        case PositionFormat::Float32:
+            write(dst, v.position);
+            break;
+        case PositionFormat::Half:
+            for (int c = 0; c < 3; c++)
+            {
+                write(dst + c * 2, glm::packHalf1x16(v.position[c]));
+            }
+            break;
+        case PositionFormat::Snorm16:
+            for (int c = 0; c < 3; c++)
+            {
+                write(dst + c * 2, glm::packSnorm1x16((v.position[c] - center[c]) / scale));
+            }
+            break;
+        }
+
+        glm::vec2 oct = octEncode(v.normal);
+        switch (layout.normal)
+        {
+        case NormalFormat::OctFloat32:
+            write(dst + normalOffset, oct);
+            break;
+        case NormalFormat::OctSnorm16:
+            write(dst + normalOffset, glm::packSnorm1x16(oct.x));
+            write(dst + normalOffset + 2, glm::packSnorm1x16(oct.y));
+            break;
+        case NormalFormat::OctSnorm8:
+            write(dst + normalOffset, glm::packSnorm1x8(oct.x));
+            write(dst + normalOffset + 1, glm::packSnorm1x8(oct.y));
+            break;
+        }
+
+        switch (layout.uv)
+        {
+        case UvFormat::Float32:
+            write(dst + uvOffset, v.uv);
+            break;
+        case UvFormat::Half:
+            write(dst + uvOffset, glm::packHalf1x16(v.uv.x));
+            write(dst + uvOffset + 2, glm::packHalf1x16(v.uv.y));
+            break;
+        case UvFormat::Unorm16:
+            write(dst + uvOffset, glm::packUnorm1x16(v.uv.x));
+            write(dst + uvOffset + 2, glm::packUnorm1x16(v.uv.y));
+            break;
+        }
+    }
+    return decode;
+}
+
+static void positionPointer(const VertexLayout &layout, GLsizei stride)
+{
+    switch (layout.position)
+    {
+    case PositionFormat::Float32:
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void *)0);
+        break;
+    case PositionFormat::Half:
+        glVertexAttribPointer(0, 3, GL_HALF_FLOAT, GL_FALSE, stride, (void *)0);
+        break;
+    case PositionFormat::Snorm16:
+        glVertexAttribPointer(0, 3, GL_SHORT, GL_TRUE, stride, (void *)0);
+        break;
+    }
+    glEnableVertexAttribArray(0);
+}
+
+void vertexformat::extractPositions(const std::vector<uint8_t> &packed, const VertexLayout &layout,
+                                    std::vector<uint8_t> &out)
+{
+    size_t stride = layout.stride();
+    size_t size = layout.positionSize();
+    size_t count = packed.size() / stride;
+    out.resize(count * size);
+    for (size_t i = 0; i < count; i++)
+    {
+        std::memcpy(out.data() + i * size, packed.data() + i * stride, size);
+    }
+}
+
+void vertexformat::setPositionAttribute(const VertexLayout &layout)
+{
+    positionPointer(layout, (GLsizei)layout.positionSize());
+}
+
+void vertexformat::setAttributes(const VertexLayout &layout)
+{
+    GLsizei stride = (GLsizei)layout.stride();
+    size_t normalOffset = layout.positionSize();
+    size_t uvOffset = normalOffset + layout.normalSize();
+
+    // position attribute
+    positionPointer(layout, stride);
+
+    // octahedral normal attribute
+    switch (layout.normal)
+    {
+    case NormalFormat::OctFloat32:
+        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, stride, (void *)normalOffset);
+        break;
+    case NormalFormat::OctSnorm16:
+        glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, stride, (void *)normalOffset);
+        break;
+    case NormalFormat::OctSnorm8:
+        glVertexAttribPointer(1, 2, GL_BYTE, GL_TRUE, stride, (void *)normalOffset);
+        break;
+    }
+    glEnableVertexAttribArray(1);
+
+    // texture attribute
+    switch (layout.uv)
+    {
+    case UvFormat::Float32:
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, (void *)uvOffset);
+        break;
+    case UvFormat::Half:
+        glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, stride, (void *)uvOffset);
+        break;
+    case UvFormat::Unorm16:
+        glVertexAttribPointer(2, 2, GL_UNSIGNED_SHORT, GL_TRUE, stride, (void *)uvOffset);
+        break;
+    }
+    glEnableVertexAttribArray(2);
+}
+
+void vertexformat::setInstanceAttributes(size_t byteOffset)
+{
+    // a mat4 attribute takes up 4 consecutive locations (3-6), one per column
+    for (GLuint i = 0; i < 4; i++)
+    {
+        GLuint loc = 3 + i;
+        glVertexAttribPointer(loc, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+                              (void *)(byteOffset + offsetof(InstanceData, model) + i * sizeof(glm::vec4)));
+        glEnableVertexAttribArray(loc);
+        glVertexAttribDivisor(loc, 1);
+    }
+
+    // normal matrix mat3 takes up locations 7-9
+    for (GLuint i = 0; i < 3; i++)
+    {
+        GLuint loc = 7 + i;
+        glVertexAttribPointer(loc, 3, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+                              (void *)(byteOffset + offsetof(InstanceData, normal) + i * sizeof(glm::vec3)));
+        glEnableVertexAttribArray(loc);
+        glVertexAttribDivisor(loc, 1);
+    }
+
+    // material index at location 10, an integer attribute so it isn't converted to float
+    glVertexAttribIPointer(10, 1, GL_UNSIGNED_INT, sizeof(InstanceData),
+                           (void *)(byteOffset + offsetof(InstanceData, material)));
+    glEnableVertexAttribArray(10);
+    glVertexAttribDivisor(10, 1);
+}
+
+Mesh::Mesh(const std::vector<Vertex> &vertices, const std::vector<uint32_t> &indices, VertexLayout layout,
+           GeometryPool *pool)
+    : layout_(layout), pool_(pool), vertexCount_(vertices.size()), indexCount_(indices.size())
+{
+    if (!vertices.empty())
+    {
+        boundsMin_ = boundsMax_ = vertices[0].position;
+    }
+    for (const Vertex &v : vertices)
+    {
+        boundsMin_ = glm::min(boundsMin_, v.position);
+        boundsMax_ = glm::max(boundsMax_, v.position);
+    }
+
+    if (pool_)
+    {
+        layout_ = pool_->layout();
+        poolId_ = pool_->add(vertices, indices, decode_);
+        indexType_ = GL_UNSIGNED_SHORT;
+        return;
+    }
+
+    if (layout_.uv == UvFormat::Unorm16 && !vertexformat::uvsFitUnorm(vertices))
+    {
+        layout_.uv = UvFormat::Half;
+    }
+
+    std::vector<uint8_t> packed;
+    decode_ = vertexformat::pack(vertices, layout_, packed);
+
+    glGenVertexArrays(1, &vao_);
+    glGenBuffers(1, &vbo_);
+    glGenBuffers(1, &ebo_);
+
+    glstate::bindVertexArray(vao_);
+
+    glBindBuffer(GL_ARRAY_BUFFER, vbo_);
+    glBufferData(GL_ARRAY_BUFFER, packed.size(), packed.data(), GL_STATIC_DRAW);
+
+    // no primitive restart, so every 16 bit value is a usable index
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo_);
+    if (vertices.size() <= 0x10000)
+    {
+        std::vector<uint16_t> shortIndices(indices.begin(), indices.end());
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, shortIndices.size() * sizeof(uint16_t), shortIndices.data(),
+                     GL_STATIC_DRAW);
+        indexType_ = GL_UNSIGNED_SHORT;
+    }
+    else
+    {
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(uint32_t), indices.data(), GL_STATIC_DRAW);
+        indexType_ = GL_UNSIGNED_INT;
+    }
+
+    vertexformat::setAttributes(layout_);
+
+    std::vector<uint8_t> positions;
+    vertexformat::extractPositions(packed, layout_, positions);
+    glGenVertexArrays(1, &positionVao_);
+    glGenBuffers(1, &positionVbo_);
+    glstate::bindVertexArray(positionVao_);
+    glBindBuffer(GL_ARRAY_BUFFER, positionVbo_);
+    glBufferData(GL_ARRAY_BUFFER, positions.size(), positions.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo_);
+    vertexformat::setPositionAttribute(layout_);
+}
+
+Mesh::~Mesh()
+{
+    if (pool_)
+    {
+        pool_->remove(poolId_);
+        return;
+    }
+    if (instanceVbo_)
+    {
+        glDeleteBuffers(1, &instanceVbo_);
+    }
+    glDeleteBuffers(1, &ebo_);
+    glstate::forgetVertexArray(vao_);
+    glDeleteVertexArrays(1, &vao_);
+    glDeleteBuffers(1, &vbo_);
+    glstate::forgetVertexArray(positionVao_);
+    glDeleteVertexArrays(1, &positionVao_);
+    glDeleteBuffers(1, &positionVbo_);
+}
+
+size_t Mesh::gpuBytes() const
+{
+    size_t indexSize = indexType_ == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+    return vertexBytes() + vertexCount_ * layout_.positionSize() + indexCount_ * indexSize +
+           instanceCapacity_ * sizeof(InstanceData);
+}
+
+void Mesh::bind()
+{
+    if (pool_)
+    {
+        pool_->bind();
+        return;
+    }
+    glstate::bindVertexArray(vao_);
+}
+
+void Mesh::bindPositions()
+{
+    if (pool_)
+    {
+        pool_->bindPositions();
+        return;
+    }
+    glstate::bindVertexArray(positionVao_);
+}
+
+void Mesh::draw()
+{
+    if (pool_)
+    {
+        pool_->draw(poolId_);
+        return;
+    }
+    stats::current().drawCalls++;
+    stats::current().triangles += indexCount_ / 3;
+    glDrawElements(GL_TRIANGLES, (GLsizei)indexCount_, indexType_, 0);
+}
+
+void Mesh::drawInstanced()
+{
+    if (pool_)
+    {
+        std::cout << "ERROR::MESH::POOLED_MESHES_DRAW_INSTANCES_THROUGH_THE_POOL" << std::endl;
+        return;
+    }
+    stats::current().drawCalls++;
+    stats::current().triangles += indexCount_ / 3 * instanceCount_;
+    glDrawElementsInstanced(GL_TRIANGLES, (GLsizei)indexCount_, indexType_, 0, (GLsizei)instanceCount_);
+}
+
+void Mesh::setInstances(const std::vector<InstanceData> &instances)
+{
+    if (pool_)
+    {
+        std::cout << "ERROR::MESH::POOLED_MESHES_DRAW_INSTANCES_THROUGH_THE_POOL" << std::endl;
+        return;
+    }
+    if (!instanceVbo_)
+    {
+        initInstanceBuffer();
+    }
+
+    // snorm16 positions are relative to the bounds, the decode goes into every model matrix like DrawQueue::write
+    const InstanceData *data = instances.data();
+    if (quantized())
+    {
+        decoded_.resize(instances.size());
+        for (size_t i = 0; i < instances.size(); i++)
+        {
+            decoded_[i] = InstanceData(instances[i].model * decode_, instances[i].normal, instances[i].material);
+        }
+        data = decoded_.data();
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVbo_);
+    size_t bytes = instances.size() * sizeof(InstanceData);
+    if (instances.size() > instanceCapacity_)
+    {
+        glBufferData(GL_ARRAY_BUFFER, bytes, data, GL_STREAM_DRAW);
+        instanceCapacity_ = instances.size();
+    }
+    else
+    {
+        // orphan the old storage so we don't stall on a buffer the GPU may still be reading
+        glBufferData(GL_ARRAY_BUFFER, instanceCapacity_ * sizeof(InstanceData), NULL, GL_STREAM_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, data);
+    }
+    instanceCount_ = instances.size();
+}
+
+/* Private Functions */
+
+void Mesh::initInstanceBuffer()
+{
+    glGenBuffers(1, &instanceVbo_);
+
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVbo_);
+    for (unsigned int vao : {vao_, positionVao_})
+    {
+        glstate::bindVertexArray(vao);
+        vertexformat::setInstanceAttributes(0);
+    }
+}
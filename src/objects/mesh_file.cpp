@@ -0,0 +1,64 @@
+#include "mesh_file.h"
+
+#include <SDL3/SDL.h>
+
+#include <fstream>
+
+bool meshfile::load(const std::string &path, std::vector<meshopt::MeshLod> &levels)
+{
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file)
+    {
+        return false;
+    }
+    uint64_t size = (uint64_t)file.tellg();
+    file.seekg(0);
+
+    MeshFileHeader header = {};
+    if (size < sizeof(header) || !file.read(reinterpret_cast<char *>(&header), sizeof(header)) ||
+        header.magic != meshFileMagic || header.version != meshFileVersion || header.lodCount == 0)
+    {
+        SDL_Log("meshfile: %s isn't a version %u mesh file", path.c_str(), meshFileVersion);
+        return false;
+    }
+
+    std::vector<MeshFileLod> entries(header.lodCount);
+    if (sizeof(header) + entries.size() * sizeof(MeshFileLod) > size ||
+        !file.read(reinterpret_cast<char *>(entries.data()), entries.size() * sizeof(MeshFileLod)))
+    {
+        SDL_Log("meshfile: %s: truncated level table", path.c_str());
+        return false;
+    }
+
+    levels.clear();
+    levels.resize(entries.size());
+    for (size_t i = 0; i < entries.size(); i++)
+    {
+        const MeshFileLod &entry = entries[i];
+        uint64_t bytes = (uint64_t)entry.vertexCount * sizeof(Vertex) + (uint64_t)entry.indexCount * sizeof(uint32_t);
+        if (entry.offset + bytes > size || entry.indexCount % 3 != 0)
+        {
+            SDL_Log("meshfile: %s: level %zu lies outside the file", path.c_str(), i);
+            levels.clear();
+            return false;
+        }
+
+        meshopt::MeshLod &level = levels[i];
+        level.vertices.resize(entry.vertexCount);
+        level.indices.resize(entry.indexCount);
+        level.error = entry.error;
+        file.seekg((std::streamoff)entry.offset);
+        file.read(reinterpret_cast<char *>(level.vertices.data()), level.vertices.size() * sizeof(Vertex));
+        file.read(reinterpret_cast<char *>(level.indices.data()), level.indices.size() * sizeof(uint32_t));
+        for (uint32_t index : level.indices)
+        {
+            if (index >= entry.vertexCount)
+            {
+                SDL_Log("meshfile: %s: level %zu indexes past its vertices", path.c_str(), i);
+                levels.clear();
+                return false;
+            }
+        }
+    }
+    return true;
+}
@@ -0,0 +1,220 @@
+#include "mesh_optimize.h"
+
+#include <cmath>
+
+/*
+ *  Tom Forsyth, "Linear-Speed Vertex Cache Optimisation". Every vertex scores higher the more recently
+ *  it was used (the three from the last triangle get a fixed score so they aren't favoured over the
+ *  rest of the cache) and the fewer triangles still need it, which finishes off nearly-done vertices
+ *  before they drop out. Each step emits the unemitted triangle with the highest summed score; only
+ *  triangles touching the cache can change score, so only those are rescored.
+ */
+static constexpr int cacheSize = 32;
+static constexpr float cacheDecayPower = 1.5f;
+static constexpr float lastTriScore = 0.75f;
+static constexpr float valenceBoostScale = 2.0f;
+static constexpr float valenceBoostPower = 0.5f;
+
+static float vertexScore(int cachePosition, uint32_t remainingTriangles)
+{
+    if (remainingTriangles == 0)
+    {
+        return -1.0f;
+    }
+
+    float score = 0.0f;
+    if (cachePosition >= 0)
+    {
+        if (cachePosition < 3)
+        {
+            score = lastTriScore;
+        }
+        else
+        {
+            float scaled = 1.0f - (cachePosition - 3) * (1.0f / (cacheSize - 3));
+            score = std::pow(scaled, cacheDecayPower);
+        }
+    }
+    return score + valenceBoostScale * std::pow((float)remainingTriangles, -valenceBoostPower);
+}
+
+void meshopt::optimizeVertexCache(std::vector<uint32_t> &indices, size_t vertexCount)
+{
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0)
+    {
+        return;
+    }
+
+    // vertex -> triangle adjacency, laid out CSR style; each vertex's live triangles stay at the front
+    std::vector<uint32_t> remaining(vertexCount, 0);
+    for (uint32_t index : indices)
+    {
+        remaining[index]++;
+    }
+    std::vector<uint32_t> adjacencyOffset(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; v++)
+    {
+        adjacencyOffset[v + 1] = adjacencyOffset[v] + remaining[v];
+    }
+    std::vector<uint32_t> adjacency(indices.size());
+    std::vector<uint32_t> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+    for (size_t t = 0; t < triangleCount; t++)
+    {
+        for (int c = 0; c < 3; c++)
+        {
+            adjacency[fill[indices[t * 3 + c]]++] = (uint32_t)t;
+        }
+    }
+
+    std::vector<int> cachePosition(vertexCount, -1);
+    std::vector<float> vertexScores(vertexCount);
+    for (size_t v = 0; v < vertexCount; v++)
+    {
+        vertexScores[v] = vertexScore(-1, remaining[v]);
+    }
+
+    std::vector<bool> emitted(triangleCount, false);
+    int best = 0;
+    float bestScore = -1.0f;
+    for (size_t t = 0; t < triangleCount; t++)
+    {
+        const uint32_t *tri = &indices[t * 3];
+        float score = vertexScores[tri[0]] + vertexScores[tri[1]] + vertexScores[tri[2]];
+        if (score > bestScore)
+        {
+            bestScore = score;
+            best = (int)t;
+        }
+    }
+
+    std::vector<uint32_t> output;
+    output.reserve(indices.size());
+    std::vector<uint32_t> cache;
+    std::vector<uint32_t> nextCache;
+    cache.reserve(cacheSize + 3);
+    nextCache.reserve(cacheSize + 3);
+    size_t scanCursor = 0;
+
+    while (best >= 0)
+    {
+        const uint32_t *tri = &indices[best * 3];
+        emitted[best] = true;
+
+        nextCache.clear();
+        for (int c = 0; c < 3; c++)
+        {
+            uint32_t v = tri[c];
+            output.push_back(v);
+            nextCache.push_back(v);
+
+            // swap the emitted triangle out of the vertex's live range
+            uint32_t *begin = &adjacency[adjacencyOffset[v]];
+            for (uint32_t i = 0; i < remaining[v]; i++)
+            {
+                if (begin[i] == (uint32_t)best)
+                {
+                    begin[i] = begin[remaining[v] - 1];
+                    break;
+                }
+            }
+            remaining[v]--;
+        }
+
+        // the emitted triangle's vertices move to the front, the rest shift back
+        for (uint32_t v : cache)
+        {
+            if (v != tri[0] && v != tri[1] && v != tri[2])
+            {
+                nextCache.push_back(v);
+            }
+        }
+
+        for (size_t i = 0; i < nextCache.size(); i++)
+        {
+            uint32_t v = nextCache[i];
+            cachePosition[v] = i < (size_t)cacheSize ? (int)i : -1;
+            vertexScores[v] = vertexScore(cachePosition[v], remaining[v]);
+        }
+
+        best = -1;
+        bestScore = -1.0f;
+        for (uint32_t v : nextCache)
+        {
+            const uint32_t *begin = &adjacency[adjacencyOffset[v]];
+            for (uint32_t i = 0; i < remaining[v]; i++)
+            {
+                uint32_t t = begin[i];
+                const uint32_t *other = &indices[t * 3];
+                float score = vertexScores[other[0]] + vertexScores[other[1]] + vertexScores[other[2]];
+                if (score > bestScore)
+                {
+                    bestScore = score;
+                    best = (int)t;
+                }
+            }
+        }
+
+        // vertices that fell off the end have been scored as uncached, drop them
+        if (nextCache.size() > (size_t)cacheSize)
+        {
+            nextCache.resize(cacheSize);
+        }
+        cache.swap(nextCache);
+
+        // nothing in the cache has work left, restart from the next untouched triangle
+        if (best < 0)
+        {
+            while (scanCursor < triangleCount && emitted[scanCursor])
+            {
+                scanCursor++;
+            }
+            if (scanCursor < triangleCount)
+            {
+                best = (int)scanCursor;
+            }
+        }
+    }
+
+    indices.swap(output);
+}
+
+void meshopt::optimizeVertexFetch(std::vector<Vertex> &vertices, std::vector<uint32_t> &indices)
+{
+    const uint32_t unused = ~0u;
+    std::vector<uint32_t> remap(vertices.size(), unused);
+    std::vector<Vertex> reordered;
+    reordered.reserve(vertices.size());
+
+    for (uint32_t &index : indices)
+    {
+        if (remap[index] == unused)
+        {
+            remap[index] = (uint32_t)reordered.size();
+            reordered.push_back(vertices[index]);
+        }
+        index = remap[index];
+    }
+    vertices.swap(reordered);
+}
+
+float meshopt::averageCacheMissRatio(const std::vector<uint32_t> &indices, size_t vertexCount, unsigned cacheSize)
+{
+    if (indices.size() < 3)
+    {
+        return 0.0f;
+    }
+
+    // timestamp FIFO: a vertex is cached if it entered within the last cacheSize misses
+    std::vector<uint32_t> enteredAt(vertexCount, 0);
+    uint32_t misses = 0;
+    for (uint32_t index : indices)
+    {
+        if (enteredAt[index] == 0 || misses - enteredAt[index] >= cacheSize)
+        {
+            misses++;
+            enteredAt[index] = misses;
+        }
+    }
+    return (float)misses / (float)(indices.size() / 3);
+}
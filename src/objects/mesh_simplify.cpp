@@ -0,0 +1,500 @@
+#include "mesh_simplify.h"
+#include "mesh_optimize.h"
+
+#include <algorithm>
+#include <cmath>
+
+// border edges are held in place by a plane through them at right angles to their triangle, weighted this much
+// heavier than a triangle of the same size so a border only moves when nothing else is left
+static constexpr double borderWeight = 10.0;
+
+// a collapse may turn a triangle by at most ~75 degrees
+static constexpr float minNormalCosine = 0.25f;
+
+enum VertexKind : uint8_t
+{
+    Interior,
+    Seam,   // several vertices at this position, moves along the seam only
+    Border, // on an edge with one triangle, moves along the border only
+    Locked, // on an edge with three or more triangles, or a border that is also a seam
+};
+
+// symmetric 4x4 sum of weight * p p^T over planes p = (n, d), and the summed weight to normalise by
+struct Quadric
+{
+    double a00, a01, a02, a03;
+    double a11, a12, a13;
+    double a22, a23;
+    double a33;
+    double weight;
+};
+
+struct Collapse
+{
+    uint32_t from;
+    uint32_t to;
+    float cost;
+};
+
+static Quadric planeQuadric(const glm::dvec3 &n, double d, double weight)
+{
+    return {weight * n.x * n.x, weight * n.x * n.y, weight * n.x * n.z, weight * n.x * d,
+            weight * n.y * n.y, weight * n.y * n.z, weight * n.y * d,   weight * n.z * n.z,
+            weight * n.z * d,   weight * d * d,     weight};
+}
+
+static void addQuadric(Quadric &q, const Quadric &r)
+{
+    q.a00 += r.a00;
+    q.a01 += r.a01;
+    q.a02 += r.a02;
+    q.a03 += r.a03;
+    q.a11 += r.a11;
+    q.a12 += r.a12;
+    q.a13 += r.a13;
+    q.a22 += r.a22;
+    q.a23 += r.a23;
+    q.a33 += r.a33;
+    q.weight += r.weight;
+}
+
+// weighted mean squared distance from p to the quadric's planes
+static float quadricError(const Quadric &q, const glm::vec3 &p)
+{
+    double x = p.x, y = p.y, z = p.z;
+    double r = q.a00 * x * x + q.a11 * y * y + q.a22 * z * z + q.a33;
+    r += 2.0 * (q.a01 * x * y + q.a02 * x * z + q.a12 * y * z + q.a03 * x + q.a13 * y + q.a23 * z);
+    return q.weight > 0.0 ? (float)(std::abs(r) / q.weight) : 0.0f;
+}
+
+static float collapseError(const Quadric &from, const Quadric &to, const glm::vec3 &position)
+{
+    Quadric merged = from;
+    addQuadric(merged, to);
+    return quadricError(merged, position);
+}
+
+// the current triangles around each position, CSR style
+struct Adjacency
+{
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> triangles;
+
+    void build(const std::vector<uint32_t> &corners, size_t positionCount)
+    {
+        offsets.assign(positionCount + 1, 0);
+        for (uint32_t p : corners)
+        {
+            offsets[p + 1]++;
+        }
+        for (size_t p = 0; p < positionCount; p++)
+        {
+            offsets[p + 1] += offsets[p];
+        }
+        triangles.resize(corners.size());
+        std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+        for (size_t i = 0; i < corners.size(); i++)
+        {
+            triangles[fill[corners[i]]++] = (uint32_t)(i / 3);
+        }
+    }
+};
+
+// true when the two triangles on edge a-b use different vertices (wedges) at a, the edge runs along a seam
+static bool seamEdge(const Adjacency &adjacency, const std::vector<uint32_t> &corners,
+                     const std::vector<uint32_t> &indices, uint32_t a, uint32_t b)
+{
+    uint32_t wedges[2];
+    size_t shared = 0;
+    for (uint32_t k = adjacency.offsets[a]; k < adjacency.offsets[a + 1]; k++)
+    {
+        uint32_t t = adjacency.triangles[k];
+        const uint32_t *tri = &corners[t * 3];
+        if (tri[0] != b && tri[1] != b && tri[2] != b)
+        {
+            continue;
+        }
+        if (shared == 2)
+        {
+            return false;
+        }
+        int corner = tri[0] == a ? 0 : tri[1] == a ? 1 : 2;
+        wedges[shared++] = indices[t * 3 + corner];
+    }
+    return shared == 2 && wedges[0] != wedges[1];
+}
+
+float meshopt::simplify(const std::vector<Vertex> &vertices, std::vector<uint32_t> &indices, size_t targetIndexCount,
+                        float maxError)
+{
+    if (indices.size() <= targetIndexCount)
+    {
+        return 0.0f;
+    }
+
+    // weld the vertices the triangles use by position, each group's vertices are that position's wedges
+    std::vector<uint32_t> order;
+    {
+        std::vector<bool> used(vertices.size(), false);
+        for (uint32_t index : indices)
+        {
+            used[index] = true;
+        }
+        for (uint32_t v = 0; v < (uint32_t)vertices.size(); v++)
+        {
+            if (used[v])
+            {
+                order.push_back(v);
+            }
+        }
+    }
+    std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+        const glm::vec3 &pa = vertices[a].position;
+        const glm::vec3 &pb = vertices[b].position;
+        return pa.x != pb.x ? pa.x < pb.x : pa.y != pb.y ? pa.y < pb.y : pa.z < pb.z;
+    });
+    std::vector<uint32_t> vertexPosition(vertices.size(), 0);
+    std::vector<glm::vec3> positions;
+    std::vector<uint32_t> wedgeOffsets;
+    for (size_t i = 0; i < order.size(); i++)
+    {
+        if (i == 0 || vertices[order[i]].position != vertices[order[i - 1]].position)
+        {
+            wedgeOffsets.push_back((uint32_t)i);
+            positions.push_back(vertices[order[i]].position);
+        }
+        vertexPosition[order[i]] = (uint32_t)positions.size() - 1;
+    }
+    wedgeOffsets.push_back((uint32_t)order.size());
+    size_t positionCount = positions.size();
+
+    // triangles as positions, ones that were degenerate to begin with are dropped here
+    std::vector<uint32_t> corners;
+    corners.reserve(indices.size());
+    {
+        size_t kept = 0;
+        for (size_t i = 0; i < indices.size(); i += 3)
+        {
+            uint32_t p0 = vertexPosition[indices[i]];
+            uint32_t p1 = vertexPosition[indices[i + 1]];
+            uint32_t p2 = vertexPosition[indices[i + 2]];
+            if (p0 == p1 || p1 == p2 || p0 == p2)
+            {
+                continue;
+            }
+            corners.insert(corners.end(), {p0, p1, p2});
+            std::copy(indices.begin() + i, indices.begin() + i + 3, indices.begin() + kept);
+            kept += 3;
+        }
+        indices.resize(kept);
+    }
+
+    // area weighted triangle planes
+    std::vector<Quadric> quadrics(positionCount, Quadric{});
+    for (size_t i = 0; i < corners.size(); i += 3)
+    {
+        glm::dvec3 p0 = positions[corners[i]], p1 = positions[corners[i + 1]], p2 = positions[corners[i + 2]];
+        glm::dvec3 normal = glm::cross(p1 - p0, p2 - p0);
+        double length = glm::length(normal);
+        if (length == 0.0)
+        {
+            continue;
+        }
+        normal /= length;
+        Quadric q = planeQuadric(normal, -glm::dot(normal, p0), length * 0.5);
+        for (int k = 0; k < 3; k++)
+        {
+            addQuadric(quadrics[corners[i + k]], q);
+        }
+    }
+
+    // count triangles per undirected edge: one is a border, more than two is locked
+    std::vector<uint8_t> kinds(positionCount, Interior);
+    for (size_t p = 0; p < positionCount; p++)
+    {
+        if (wedgeOffsets[p + 1] - wedgeOffsets[p] > 1)
+        {
+            kinds[p] = Seam;
+        }
+    }
+    {
+        std::vector<std::pair<uint64_t, uint32_t>> edges;
+        edges.reserve(corners.size());
+        for (size_t i = 0; i < corners.size(); i++)
+        {
+            uint32_t a = corners[i];
+            uint32_t b = corners[i - i % 3 + (i + 1) % 3];
+            uint64_t key = a < b ? (uint64_t)a << 32 | b : (uint64_t)b << 32 | a;
+            edges.push_back({key, (uint32_t)(i / 3)});
+        }
+        std::sort(edges.begin(), edges.end());
+        for (size_t i = 0; i < edges.size();)
+        {
+            size_t run = 1;
+            while (i + run < edges.size() && edges[i + run].first == edges[i].first)
+            {
+                run++;
+            }
+            uint32_t a = (uint32_t)(edges[i].first >> 32), b = (uint32_t)edges[i].first;
+            if (run == 1)
+            {
+                // seams are judged by matching wedge counts, which a border would break
+                for (uint32_t p : {a, b})
+                {
+                    kinds[p] = kinds[p] == Interior || kinds[p] == Border ? Border : Locked;
+                }
+                const uint32_t *tri = &corners[edges[i].second * 3];
+                glm::dvec3 p0 = positions[tri[0]], p1 = positions[tri[1]], p2 = positions[tri[2]];
+                glm::dvec3 edge = glm::dvec3(positions[b]) - glm::dvec3(positions[a]);
+                glm::dvec3 plane = glm::cross(edge, glm::cross(p1 - p0, p2 - p0));
+                double length = glm::length(plane);
+                if (length > 0.0)
+                {
+                    plane /= length;
+                    Quadric q = planeQuadric(plane, -glm::dot(plane, glm::dvec3(positions[a])),
+                                             borderWeight * glm::dot(edge, edge));
+                    addQuadric(quadrics[a], q);
+                    addQuadric(quadrics[b], q);
+                }
+            }
+            else if (run > 2)
+            {
+                kinds[a] = kinds[b] = Locked;
+            }
+            i += run;
+        }
+    }
+
+    auto wedgeCount = [&](uint32_t p) { return wedgeOffsets[p + 1] - wedgeOffsets[p]; };
+    auto allowed = [&](uint32_t from, uint32_t to) {
+        switch (kinds[from])
+        {
+        case Interior:
+            return true;
+        case Seam:
+            return kinds[to] == Seam && wedgeCount(to) == wedgeCount(from);
+        case Border:
+            return kinds[to] == Border || kinds[to] == Locked;
+        default:
+            return false;
+        }
+    };
+
+    // vertex each vertex is replaced by, only ever changed for the wedges of a collapsed position
+    std::vector<uint32_t> wedgeRemap(vertices.size());
+    for (uint32_t v = 0; v < (uint32_t)vertices.size(); v++)
+    {
+        wedgeRemap[v] = v;
+    }
+
+    Adjacency adjacency;
+    std::vector<Collapse> collapses;
+    std::vector<uint32_t> lockedPass(positionCount, 0);
+    std::vector<uint32_t> marks(positionCount, 0);
+    uint32_t mark = 0;
+    float maxCost = maxError < FLT_MAX ? maxError * maxError : FLT_MAX;
+    float worst = 0.0f;
+
+    for (uint32_t pass = 1; indices.size() > targetIndexCount; pass++)
+    {
+        adjacency.build(corners, positionCount);
+
+        // each edge is offered from both of its triangles, duplicates fail the lock check once the first goes
+        collapses.clear();
+        for (size_t i = 0; i < corners.size(); i++)
+        {
+            uint32_t a = corners[i];
+            uint32_t b = corners[i - i % 3 + (i + 1) % 3];
+            float ab = allowed(a, b) ? collapseError(quadrics[a], quadrics[b], positions[b]) : FLT_MAX;
+            float ba = allowed(b, a) ? collapseError(quadrics[b], quadrics[a], positions[a]) : FLT_MAX;
+            if (ab < FLT_MAX || ba < FLT_MAX)
+            {
+                collapses.push_back(ab <= ba ? Collapse{a, b, ab} : Collapse{b, a, ba});
+            }
+        }
+        std::sort(collapses.begin(), collapses.end(),
+                  [](const Collapse &a, const Collapse &b) { return a.cost < b.cost; });
+
+        size_t goal = (indices.size() - targetIndexCount + 2) / 3;
+        size_t removed = 0;
+        size_t collapsed = 0;
+        for (const Collapse &collapse : collapses)
+        {
+            if (removed >= goal || collapse.cost > maxCost)
+            {
+                break;
+            }
+            uint32_t from = collapse.from, to = collapse.to;
+            if (lockedPass[from] == pass || lockedPass[to] == pass)
+            {
+                continue;
+            }
+
+            // the neighbours the two share have to be exactly the far corners of the triangles on the edge,
+            // anything else pinches the surface into a non-manifold fin
+            mark += 2;
+            size_t shared = 0;
+            bool flips = false;
+            for (uint32_t k = adjacency.offsets[from]; k < adjacency.offsets[from + 1]; k++)
+            {
+                const uint32_t *tri = &corners[adjacency.triangles[k] * 3];
+                for (int c = 0; c < 3; c++)
+                {
+                    marks[tri[c]] = mark;
+                }
+                if (tri[0] == to || tri[1] == to || tri[2] == to)
+                {
+                    shared++;
+                    continue;
+                }
+
+                glm::vec3 p0 = positions[tri[0]], p1 = positions[tri[1]], p2 = positions[tri[2]];
+                glm::vec3 before = glm::cross(p1 - p0, p2 - p0);
+                glm::vec3 q0 = tri[0] == from ? positions[to] : p0;
+                glm::vec3 q1 = tri[1] == from ? positions[to] : p1;
+                glm::vec3 q2 = tri[2] == from ? positions[to] : p2;
+                glm::vec3 after = glm::cross(q1 - q0, q2 - q0);
+                if (glm::dot(before, after) <= minNormalCosine * glm::length(before) * glm::length(after))
+                {
+                    flips = true;
+                    break;
+                }
+            }
+            if (flips || shared == 0)
+            {
+                continue;
+            }
+            // a border edge has one triangle, a seam collapse has to run along the seam
+            if ((kinds[from] == Border && shared != 1) ||
+                (kinds[from] == Seam && !seamEdge(adjacency, corners, indices, from, to)))
+            {
+                continue;
+            }
+
+            size_t common = 0;
+            for (uint32_t k = adjacency.offsets[to]; k < adjacency.offsets[to + 1]; k++)
+            {
+                const uint32_t *tri = &corners[adjacency.triangles[k] * 3];
+                for (int c = 0; c < 3; c++)
+                {
+                    if (tri[c] != from && tri[c] != to && marks[tri[c]] == mark)
+                    {
+                        marks[tri[c]] = mark + 1;
+                        common++;
+                    }
+                }
+            }
+            if (common != shared)
+            {
+                continue;
+            }
+
+            // every vertex of from moves to the closest one of to in uv and normal...
+            for (uint32_t w = wedgeOffsets[from]; w < wedgeOffsets[from + 1]; w++)
+            {
+                const Vertex &source = vertices[order[w]];
+                uint32_t best = order[wedgeOffsets[to]];
+                float bestDistance = FLT_MAX;
+                for (uint32_t x = wedgeOffsets[to]; x < wedgeOffsets[to + 1]; x++)
+                {
+                    const Vertex &target = vertices[order[x]];
+                    glm::vec2 du = target.uv - source.uv;
+                    glm::vec3 dn = target.normal - source.normal;
+                    float distance = glm::dot(du, du) + glm::dot(dn, dn);
+                    if (distance < bestDistance)
+                    {
+                        bestDistance = distance;
+                        best = order[x];
+                    }
+                }
+                wedgeRemap[order[w]] = best;
+            }
+            // except where the triangles on the edge say which vertex of to lies on the same side, the closest
+            // one can be across a seam once to has only a few vertices left
+            for (uint32_t k = adjacency.offsets[from]; k < adjacency.offsets[from + 1]; k++)
+            {
+                uint32_t t = adjacency.triangles[k];
+                const uint32_t *tri = &corners[t * 3];
+                int toCorner = tri[0] == to ? 0 : tri[1] == to ? 1 : tri[2] == to ? 2 : -1;
+                if (toCorner >= 0)
+                {
+                    int fromCorner = tri[0] == from ? 0 : tri[1] == from ? 1 : 2;
+                    wedgeRemap[indices[t * 3 + fromCorner]] = indices[t * 3 + toCorner];
+                }
+            }
+            addQuadric(quadrics[to], quadrics[from]);
+
+            // nothing around from may move again this pass, its triangles' flip checks would be stale
+            lockedPass[from] = lockedPass[to] = pass;
+            for (uint32_t k = adjacency.offsets[from]; k < adjacency.offsets[from + 1]; k++)
+            {
+                const uint32_t *tri = &corners[adjacency.triangles[k] * 3];
+                for (int c = 0; c < 3; c++)
+                {
+                    lockedPass[tri[c]] = pass;
+                }
+            }
+            removed += shared;
+            collapsed++;
+            worst = std::max(worst, collapse.cost);
+        }
+        if (collapsed == 0)
+        {
+            break;
+        }
+
+        size_t kept = 0;
+        for (size_t i = 0; i < indices.size(); i += 3)
+        {
+            uint32_t v0 = wedgeRemap[indices[i]], v1 = wedgeRemap[indices[i + 1]], v2 = wedgeRemap[indices[i + 2]];
+            uint32_t p0 = vertexPosition[v0], p1 = vertexPosition[v1], p2 = vertexPosition[v2];
+            if (p0 == p1 || p1 == p2 || p0 == p2)
+            {
+                continue;
+            }
+            indices[kept] = v0;
+            indices[kept + 1] = v1;
+            indices[kept + 2] = v2;
+            corners[kept] = p0;
+            corners[kept + 1] = p1;
+            corners[kept + 2] = p2;
+            kept += 3;
+        }
+        indices.resize(kept);
+        corners.resize(kept);
+    }
+    return std::sqrt(worst);
+}
+
+std::vector<meshopt::MeshLod> meshopt::buildLodChain(const std::vector<Vertex> &vertices,
+                                                     const std::vector<uint32_t> &indices, size_t maxLevels,
+                                                     float ratio)
+{
+    std::vector<MeshLod> chain;
+    if (maxLevels == 0)
+    {
+        return chain;
+    }
+
+    MeshLod level = {vertices, indices, 0.0f};
+    while (true)
+    {
+        optimizeVertexCache(level.indices, level.vertices.size());
+        optimizeVertexFetch(level.vertices, level.indices);
+        chain.push_back(level);
+        if (chain.size() == maxLevels)
+        {
+            break;
+        }
+
+        size_t previousCount = level.indices.size();
+        size_t target = (size_t)(previousCount / 3 * ratio) * 3;
+        float error = simplify(level.vertices, level.indices, target);
+        if (level.indices.empty() || level.indices.size() * 10 > previousCount * 9)
+        {
+            break;
+        }
+        level.error += error;
+    }
+    return chain;
+}
@@ -0,0 +1,216 @@
+#include "obj_loader.h"
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <unordered_map>
+
+struct CornerKey
+{
+    int position;
+    int uv;
+    int normal;
+
+    bool operator==(const CornerKey &other) const
+    {
+        return position == other.position && uv == other.uv && normal == other.normal;
+    }
+};
+
+struct CornerKeyHash
+{
+    size_t operator()(const CornerKey &key) const
+    {
+        uint64_t h = (uint64_t)(uint32_t)key.position * 0x9E3779B97F4A7C15ull;
+        h ^= (uint64_t)(uint32_t)key.uv * 0xC2B2AE3D27D4EB4Full + (h << 6) + (h >> 2);
+        h ^= (uint64_t)(uint32_t)key.normal * 0x165667B19E3779F9ull + (h << 6) + (h >> 2);
+        return (size_t)h;
+    }
+};
+
+// OBJ indices are 1-based, negative ones count back from the most recent element; -1 means absent here
+static int resolveIndex(long index, size_t count)
+{
+    if (index > 0)
+    {
+        return index <= (long)count ? (int)(index - 1) : -1;
+    }
+    if (index < 0)
+    {
+        return -index <= (long)count ? (int)(count + index) : -1;
+    }
+    return -1;
+}
+
+static const char *skipSpaces(const char *p)
+{
+    while (*p == ' ' || *p == '\t')
+    {
+        p++;
+    }
+    return p;
+}
+
+// parses one "v", "v/vt", "v//vn" or "v/vt/vn" corner, returns false at the end of the line
+static bool parseCorner(const char *&p, long &v, long &vt, long &vn)
+{
+    p = skipSpaces(p);
+    char *end;
+    v = std::strtol(p, &end, 10);
+    if (end == p)
+    {
+        return false;
+    }
+    p = end;
+    vt = vn = 0;
+    if (*p == '/')
+    {
+        p++;
+        if (*p != '/')
+        {
+            vt = std::strtol(p, &end, 10);
+            p = end;
+        }
+        if (*p == '/')
+        {
+            p++;
+            vn = std::strtol(p, &end, 10);
+            p = end;
+        }
+    }
+    return true;
+}
+
+bool obj::load(const std::string &path, std::vector<Vertex> &vertices, std::vector<uint32_t> &indices)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        std::cout << "ERROR::OBJ::FAILED_TO_READ_FILE: " << path << std::endl;
+        return false;
+    }
+
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec2> uvs;
+    std::vector<glm::vec3> normals;
+    std::unordered_map<CornerKey, uint32_t, CornerKeyHash> corners;
+    std::vector<uint32_t> polygon;
+    std::vector<uint32_t> vertexPositions;
+    size_t cornerCount = 0;
+    size_t skippedFaces = 0;
+    bool needsNormals = false;
+
+    vertices.clear();
+    indices.clear();
+
+    std::string line;
+    while (std::getline(file, line))
+    {
+        const char *p = skipSpaces(line.c_str());
+        char *end;
+
+        if (p[0] == 'v' && (p[1] == ' ' || p[1] == '\t'))
+        {
+            glm::vec3 v;
+            v.x = std::strtof(p + 2, &end);
+            v.y = std::strtof(end, &end);
+            v.z = std::strtof(end, &end);
+            positions.push_back(v);
+        }
+        else if (p[0] == 'v' && p[1] == 't')
+        {
+            glm::vec2 uv;
+            uv.x = std::strtof(p + 2, &end);
+            uv.y = std::strtof(end, &end);
+            uvs.push_back(uv);
+        }
+        else if (p[0] == 'v' && p[1] == 'n')
+        {
+            glm::vec3 n;
+            n.x = std::strtof(p + 2, &end);
+            n.y = std::strtof(end, &end);
+            n.z = std::strtof(end, &end);
+            normals.push_back(n);
+        }
+        else if (p[0] == 'f' && (p[1] == ' ' || p[1] == '\t'))
+        {
+            polygon.clear();
+            p += 1;
+            long v, vt, vn;
+            bool valid = true;
+            while (parseCorner(p, v, vt, vn))
+            {
+                CornerKey key = {resolveIndex(v, positions.size()), resolveIndex(vt, uvs.size()),
+                                 resolveIndex(vn, normals.size())};
+                if (key.position < 0)
+                {
+                    valid = false;
+                    break;
+                }
+
+                auto [it, inserted] = corners.try_emplace(key, (uint32_t)vertices.size());
+                if (inserted)
+                {
+                    Vertex vertex;
+                    vertex.position = positions[key.position];
+                    vertex.uv = key.uv >= 0 ? uvs[key.uv] : glm::vec2(0.0f);
+                    vertex.normal = key.normal >= 0 ? normals[key.normal] : glm::vec3(0.0f);
+                    vertices.push_back(vertex);
+                    vertexPositions.push_back((uint32_t)key.position);
+                    needsNormals = needsNormals || key.normal < 0;
+                }
+                polygon.push_back(it->second);
+                cornerCount++;
+            }
+
+            if (!valid || polygon.size() < 3)
+            {
+                skippedFaces++;
+                continue;
+            }
+            for (size_t i = 1; i + 1 < polygon.size(); i++)
+            {
+                indices.push_back(polygon[0]);
+                indices.push_back(polygon[i]);
+                indices.push_back(polygon[i + 1]);
+            }
+        }
+    }
+
+    if (skippedFaces)
+    {
+        std::cout << "obj: " << path << ": skipped " << skippedFaces << " faces with missing or degenerate corners"
+                  << std::endl;
+    }
+
+    // generate smooth normals for corners the file didn't give one, cross products are area weighted
+    if (needsNormals)
+    {
+        std::vector<glm::vec3> accumulated(positions.size(), glm::vec3(0.0f));
+        for (size_t i = 0; i < indices.size(); i += 3)
+        {
+            const glm::vec3 &a = vertices[indices[i]].position;
+            const glm::vec3 &b = vertices[indices[i + 1]].position;
+            const glm::vec3 &c = vertices[indices[i + 2]].position;
+            glm::vec3 faceNormal = glm::cross(b - a, c - a);
+            // accumulate per position, so corners that only differ by UV still share a normal
+            for (size_t k = 0; k < 3; k++)
+            {
+                accumulated[vertexPositions[indices[i + k]]] += faceNormal;
+            }
+        }
+        for (size_t v = 0; v < vertices.size(); v++)
+        {
+            if (vertices[v].normal == glm::vec3(0.0f))
+            {
+                glm::vec3 n = accumulated[vertexPositions[v]];
+                float length = glm::length(n);
+                vertices[v].normal = length > 0.0f ? n / length : glm::vec3(0.0f, 1.0f, 0.0f);
+            }
+        }
+    }
+
+    std::cout << "obj: " << path << ": " << vertices.size() << " vertices from " << cornerCount << " face corners, "
+              << indices.size() / 3 << " triangles" << std::endl;
+    return !indices.empty();
+}
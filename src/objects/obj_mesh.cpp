@@ -0,0 +1,26 @@
+#include "obj_mesh.h"
+#include "obj_loader.h"
+#include "mesh_optimize.h"
+
+#include <SDL3/SDL.h>
+
+// apart from the parser so tools can read OBJ files without linking the GL side of Mesh
+Mesh *obj::loadMesh(const std::string &path, VertexLayout layout)
+{
+    std::vector<Vertex> vertices;
+    std::vector<uint32_t> indices;
+    if (!load(path, vertices, indices))
+    {
+        return nullptr;
+    }
+
+    float before = meshopt::averageCacheMissRatio(indices, vertices.size());
+    meshopt::optimizeVertexCache(indices, vertices.size());
+    meshopt::optimizeVertexFetch(vertices, indices);
+    float after = meshopt::averageCacheMissRatio(indices, vertices.size());
+
+    Mesh *mesh = new Mesh(vertices, indices, layout);
+    SDL_Log("obj: %s: ACMR %.3f -> %.3f, %zu vertex bytes (%zu unpacked)", path.c_str(), before, after,
+            mesh->vertexBytes(), vertices.size() * VertexLayout::full().stride());
+    return mesh;
+}
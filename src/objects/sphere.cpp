@@ -0,0 +1,49 @@
+#include "sphere.h"
+
+#include <cmath>
+
+static constexpr float pi = 3.14159265358979f;
+
+Sphere::Sphere(float radius, unsigned rings, unsigned segments, VertexLayout layout, GeometryPool *pool)
+    : Mesh(buildVertices(radius, rings, segments), buildIndices(rings, segments), layout, pool)
+{
+}
+
+// (rings + 1) * (segments + 1) vertices, the seam and the poles are duplicated so every vertex has one UV
+std::vector<Vertex> Sphere::buildVertices(float radius, unsigned rings, unsigned segments)
+{
+    std::vector<Vertex> vertices;
+    vertices.reserve((size_t)(rings + 1) * (segments + 1));
+    for (unsigned ring = 0; ring <= rings; ring++)
+    {
+        float v = (float)ring / rings;
+        float polar = v * pi;
+        for (unsigned segment = 0; segment <= segments; segment++)
+        {
+            float u = (float)segment / segments;
+            float azimuth = u * 2.0f * pi;
+            glm::vec3 normal(std::sin(polar) * std::cos(azimuth), std::cos(polar),
+                             -std::sin(polar) * std::sin(azimuth));
+            vertices.push_back({normal * radius, normal, glm::vec2(u, 1.0f - v)});
+        }
+    }
+    return vertices;
+}
+
+std::vector<uint32_t> Sphere::buildIndices(unsigned rings, unsigned segments)
+{
+    std::vector<uint32_t> indices;
+    indices.reserve((size_t)rings * segments * 6);
+    unsigned stride = segments + 1;
+    for (unsigned ring = 0; ring < rings; ring++)
+    {
+        for (unsigned segment = 0; segment < segments; segment++)
+        {
+            uint32_t top = ring * stride + segment;
+            uint32_t bottom = top + stride;
+            // counter-clockwise seen from outside
+            indices.insert(indices.end(), {top, bottom, top + 1, top + 1, bottom, bottom + 1});
+        }
+    }
+    return indices;
+}
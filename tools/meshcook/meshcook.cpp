@@ -0,0 +1,102 @@
+// meshcook - converts an OBJ file into a cooked .lmesh with a chain of simplified levels of detail, each
+// optimised for the vertex cache and fetch, see include/objects/mesh_file.h for the container layout.
+//
+// Usage: meshcook <input.obj> <output.lmesh> [--levels N] [--ratio R]
+//   levels  at most this many levels including the source mesh (default 8)
+//   ratio   triangles each level keeps of the one before it (default 0.5)
+
+#include "mesh_file.h"
+#include "mesh_optimize.h"
+#include "obj_loader.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+int main(int argc, char *argv[])
+{
+    if (argc < 3)
+    {
+        std::cerr << "usage: meshcook <input.obj> <output.lmesh> [--levels N] [--ratio R]" << std::endl;
+        return 1;
+    }
+
+    std::string input = argv[1];
+    std::string output = argv[2];
+    int maxLevels = 8;
+    float ratio = 0.5f;
+    for (int i = 3; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--levels") == 0 && i + 1 < argc)
+        {
+            maxLevels = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--ratio") == 0 && i + 1 < argc)
+        {
+            ratio = (float)std::atof(argv[++i]);
+        }
+    }
+    if (maxLevels < 1 || ratio <= 0.0f || ratio >= 1.0f)
+    {
+        std::cerr << "meshcook: levels has to be at least 1 and ratio between 0 and 1" << std::endl;
+        return 1;
+    }
+
+    std::vector<Vertex> vertices;
+    std::vector<uint32_t> indices;
+    if (!obj::load(input, vertices, indices))
+    {
+        std::cerr << "meshcook: failed to read " << input << std::endl;
+        return 1;
+    }
+
+    std::vector<meshopt::MeshLod> chain = meshopt::buildLodChain(vertices, indices, (size_t)maxLevels, ratio);
+
+    MeshFileHeader header = {};
+    header.magic = meshFileMagic;
+    header.version = meshFileVersion;
+    header.lodCount = (uint32_t)chain.size();
+
+    std::vector<MeshFileLod> levels(chain.size());
+    uint64_t offset = sizeof(MeshFileHeader) + levels.size() * sizeof(MeshFileLod);
+    for (size_t i = 0; i < chain.size(); i++)
+    {
+        offset = (offset + 15) & ~uint64_t(15);
+        levels[i].offset = offset;
+        levels[i].vertexCount = (uint32_t)chain[i].vertices.size();
+        levels[i].indexCount = (uint32_t)chain[i].indices.size();
+        levels[i].error = chain[i].error;
+        offset += chain[i].vertices.size() * sizeof(Vertex) + chain[i].indices.size() * sizeof(uint32_t);
+    }
+
+    std::ofstream file(output, std::ios::binary | std::ios::trunc);
+    if (!file)
+    {
+        std::cerr << "meshcook: failed to open " << output << " for writing" << std::endl;
+        return 1;
+    }
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char *>(levels.data()), levels.size() * sizeof(MeshFileLod));
+    for (size_t i = 0; i < chain.size(); i++)
+    {
+        static const char padding[16] = {};
+        size_t position = (size_t)file.tellp();
+        file.write(padding, levels[i].offset - position);
+        file.write(reinterpret_cast<const char *>(chain[i].vertices.data()), chain[i].vertices.size() * sizeof(Vertex));
+        file.write(reinterpret_cast<const char *>(chain[i].indices.data()),
+                   chain[i].indices.size() * sizeof(uint32_t));
+    }
+
+    std::cout << "meshcook: " << input << " -> " << output << " (" << chain.size() << " levels, " << offset
+              << " bytes)" << std::endl;
+    for (size_t i = 0; i < chain.size(); i++)
+    {
+        std::cout << "  level " << i << ": " << chain[i].indices.size() / 3 << " triangles, "
+                  << chain[i].vertices.size() << " vertices, error " << chain[i].error << ", ACMR "
+                  << meshopt::averageCacheMissRatio(chain[i].indices, chain[i].vertices.size()) << std::endl;
+    }
+    return 0;
+}
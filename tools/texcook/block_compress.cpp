@@ -0,0 +1,330 @@
+#include "block_compress.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// endpoints along the block's principal axis, found by a few rounds of power iteration on the covariance
+static void fitEndpoints(const uint8_t block[16][4], int channels, float lo[4], float hi[4])
+{
+    float mean[4] = {0, 0, 0, 0};
+    for (int i = 0; i < 16; i++)
+    {
+        for (int c = 0; c < channels; c++)
+        {
+            mean[c] += block[i][c];
+        }
+    }
+    for (int c = 0; c < channels; c++)
+    {
+        mean[c] /= 16.0f;
+    }
+
+    float cov[4][4] = {};
+    for (int i = 0; i < 16; i++)
+    {
+        float d[4];
+        for (int c = 0; c < channels; c++)
+        {
+            d[c] = block[i][c] - mean[c];
+        }
+        for (int a = 0; a < channels; a++)
+        {
+            for (int b = 0; b < channels; b++)
+            {
+                cov[a][b] += d[a] * d[b];
+            }
+        }
+    }
+
+    float axis[4] = {1, 1, 1, 1};
+    for (int iteration = 0; iteration < 8; iteration++)
+    {
+        float next[4] = {0, 0, 0, 0};
+        for (int a = 0; a < channels; a++)
+        {
+            for (int b = 0; b < channels; b++)
+            {
+                next[a] += cov[a][b] * axis[b];
+            }
+        }
+        float length = 0.0f;
+        for (int c = 0; c < channels; c++)
+        {
+            length += next[c] * next[c];
+        }
+        if (length < 1e-12f)
+        {
+            break;
+        }
+        length = std::sqrt(length);
+        for (int c = 0; c < channels; c++)
+        {
+            axis[c] = next[c] / length;
+        }
+    }
+
+    float minProj = 1e30f, maxProj = -1e30f;
+    for (int i = 0; i < 16; i++)
+    {
+        float proj = 0.0f;
+        for (int c = 0; c < channels; c++)
+        {
+            proj += (block[i][c] - mean[c]) * axis[c];
+        }
+        minProj = std::min(minProj, proj);
+        maxProj = std::max(maxProj, proj);
+    }
+
+    for (int c = 0; c < channels; c++)
+    {
+        lo[c] = std::min(255.0f, std::max(0.0f, mean[c] + axis[c] * minProj));
+        hi[c] = std::min(255.0f, std::max(0.0f, mean[c] + axis[c] * maxProj));
+    }
+}
+
+static uint16_t packRGB565(const float color[3])
+{
+    int r = (int)std::lround(color[0] * 31.0f / 255.0f);
+    int g = (int)std::lround(color[1] * 63.0f / 255.0f);
+    int b = (int)std::lround(color[2] * 31.0f / 255.0f);
+    return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+static void unpackRGB565(uint16_t packed, int color[3])
+{
+    int r = (packed >> 11) & 31;
+    int g = (packed >> 5) & 63;
+    int b = packed & 31;
+    color[0] = (r << 3) | (r >> 2);
+    color[1] = (g << 2) | (g >> 4);
+    color[2] = (b << 3) | (b >> 2);
+}
+
+static void writeLE16(uint8_t *out, uint16_t value)
+{
+    out[0] = value & 0xFF;
+    out[1] = value >> 8;
+}
+
+static void writeLE32(uint8_t *out, uint32_t value)
+{
+    for (int i = 0; i < 4; i++)
+    {
+        out[i] = (value >> (i * 8)) & 0xFF;
+    }
+}
+
+void bc::encodeBC1(const uint8_t block[16][4], uint8_t out[8])
+{
+    float lo[4], hi[4];
+    fitEndpoints(block, 3, lo, hi);
+
+    uint16_t color0 = packRGB565(hi);
+    uint16_t color1 = packRGB565(lo);
+    // color0 > color1 selects the four colour mode, the three colour mode would waste an index on black
+    if (color0 < color1)
+    {
+        std::swap(color0, color1);
+    }
+
+    uint32_t indices = 0;
+    if (color0 != color1)
+    {
+        int palette[4][3];
+        unpackRGB565(color0, palette[0]);
+        unpackRGB565(color1, palette[1]);
+        for (int c = 0; c < 3; c++)
+        {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+
+        for (int i = 0; i < 16; i++)
+        {
+            int best = 0, bestError = 1 << 30;
+            for (int p = 0; p < 4; p++)
+            {
+                int error = 0;
+                for (int c = 0; c < 3; c++)
+                {
+                    int d = block[i][c] - palette[p][c];
+                    error += d * d;
+                }
+                if (error < bestError)
+                {
+                    bestError = error;
+                    best = p;
+                }
+            }
+            indices |= (uint32_t)best << (i * 2);
+        }
+    }
+
+    writeLE16(out, color0);
+    writeLE16(out + 2, color1);
+    writeLE32(out + 4, indices);
+}
+
+// BC4 style alpha block: two endpoints and 3-bit indices into 8 interpolated values
+static void encodeAlpha(const uint8_t block[16][4], uint8_t out[8])
+{
+    int alphaMax = 0, alphaMin = 255;
+    for (int i = 0; i < 16; i++)
+    {
+        alphaMax = std::max(alphaMax, (int)block[i][3]);
+        alphaMin = std::min(alphaMin, (int)block[i][3]);
+    }
+
+    out[0] = (uint8_t)alphaMax;
+    out[1] = (uint8_t)alphaMin;
+
+    int palette[8];
+    palette[0] = alphaMax;
+    palette[1] = alphaMin;
+    for (int p = 1; p < 7; p++)
+    {
+        palette[p + 1] = ((7 - p) * alphaMax + p * alphaMin) / 7;
+    }
+
+    uint64_t indices = 0;
+    if (alphaMax != alphaMin)
+    {
+        for (int i = 0; i < 16; i++)
+        {
+            int best = 0, bestError = 1 << 30;
+            for (int p = 0; p < 8; p++)
+            {
+                int error = std::abs(block[i][3] - palette[p]);
+                if (error < bestError)
+                {
+                    bestError = error;
+                    best = p;
+                }
+            }
+            indices |= (uint64_t)best << (i * 3);
+        }
+    }
+
+    for (int i = 0; i < 6; i++)
+    {
+        out[2 + i] = (indices >> (i * 8)) & 0xFF;
+    }
+}
+
+void bc::encodeBC3(const uint8_t block[16][4], uint8_t out[16])
+{
+    encodeAlpha(block, out);
+    encodeBC1(block, out + 8);
+}
+
+// appends bits to a 128-bit little-endian block
+struct BitWriter
+{
+    uint8_t *out;
+    int position = 0;
+
+    void write(uint32_t value, int bits)
+    {
+        for (int i = 0; i < bits; i++)
+        {
+            if (value & (1u << i))
+            {
+                out[position >> 3] |= (uint8_t)(1u << (position & 7));
+            }
+            position++;
+        }
+    }
+};
+
+void bc::encodeBC7(const uint8_t block[16][4], uint8_t out[16])
+{
+    static const int weights[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+    float lo[4], hi[4];
+    fitEndpoints(block, 4, lo, hi);
+
+    // mode 6 endpoints are 7 bits per channel plus one shared low bit (p-bit) per endpoint,
+    // pick the p-bit that reconstructs each endpoint most closely
+    int endpoints[2][4];
+    int quantised[2][4];
+    int pbits[2];
+    const float *source[2] = {lo, hi};
+    for (int e = 0; e < 2; e++)
+    {
+        float bestError = 1e30f;
+        for (int p = 0; p < 2; p++)
+        {
+            float error = 0.0f;
+            int q[4];
+            for (int c = 0; c < 4; c++)
+            {
+                q[c] = std::min(127, std::max(0, (int)std::lround((source[e][c] - p) / 2.0f)));
+                float d = source[e][c] - (float)((q[c] << 1) | p);
+                error += d * d;
+            }
+            if (error < bestError)
+            {
+                bestError = error;
+                pbits[e] = p;
+                for (int c = 0; c < 4; c++)
+                {
+                    quantised[e][c] = q[c];
+                    endpoints[e][c] = (q[c] << 1) | p;
+                }
+            }
+        }
+    }
+
+    int indices[16];
+    for (int i = 0; i < 16; i++)
+    {
+        int best = 0, bestError = 1 << 30;
+        for (int w = 0; w < 16; w++)
+        {
+            int error = 0;
+            for (int c = 0; c < 4; c++)
+            {
+                int value = ((64 - weights[w]) * endpoints[0][c] + weights[w] * endpoints[1][c] + 32) >> 6;
+                int d = block[i][c] - value;
+                error += d * d;
+            }
+            if (error < bestError)
+            {
+                bestError = error;
+                best = w;
+            }
+        }
+        indices[i] = best;
+    }
+
+    // the anchor (first) index is stored with its top bit implied zero, swap the endpoints if it isn't
+    if (indices[0] & 8)
+    {
+        for (int c = 0; c < 4; c++)
+        {
+            std::swap(quantised[0][c], quantised[1][c]);
+        }
+        std::swap(pbits[0], pbits[1]);
+        for (int &index : indices)
+        {
+            index = 15 - index;
+        }
+    }
+
+    std::memset(out, 0, 16);
+    BitWriter writer{out};
+    writer.write(1 << 6, 7); // mode 6
+    for (int c = 0; c < 4; c++)
+    {
+        writer.write(quantised[0][c], 7);
+        writer.write(quantised[1][c], 7);
+    }
+    writer.write(pbits[0], 1);
+    writer.write(pbits[1], 1);
+    writer.write(indices[0], 3);
+    for (int i = 1; i < 16; i++)
+    {
+        writer.write(indices[i], 4);
+    }
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <cstdint>
+
+// CPU block compressors used by texcook. Each takes one 4x4 block of RGBA8 texels in row-major order
+// and writes the encoded block to out.
+namespace bc
+{
+void encodeBC1(const uint8_t block[16][4], uint8_t out[8]);
+void encodeBC3(const uint8_t block[16][4], uint8_t out[16]);
+// mode 6 only: one subset, RGBA endpoints and 4-bit indices
+void encodeBC7(const uint8_t block[16][4], uint8_t out[16]);
+}; // namespace bc
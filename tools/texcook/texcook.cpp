@@ -0,0 +1,245 @@
+// texcook - converts a PNG into a cooked .ltex texture with a precomputed mip chain and optional
+// block compression, see include/graphics/texture_file.h for the container layout.
+//
+// Usage: texcook <input.png> <output.ltex> [--format auto|raw|bc1|bc3|bc7]
+//   auto  BC1 for opaque images, BC3 when the image has a non-opaque alpha channel (default)
+//   raw   uncompressed, keeps the source channel count
+
+#include "block_compress.h"
+#include "texture_file.h"
+
+#include <stb_image.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+struct Image
+{
+    int width, height, channels;
+    std::vector<uint8_t> pixels;
+};
+
+// 2x2 box filter, odd edges reuse the last row/column
+static Image downsample(const Image &src)
+{
+    Image dst;
+    dst.width = std::max(1, src.width / 2);
+    dst.height = std::max(1, src.height / 2);
+    dst.channels = src.channels;
+    dst.pixels.resize((size_t)dst.width * dst.height * dst.channels);
+
+    for (int y = 0; y < dst.height; y++)
+    {
+        int y0 = std::min(src.height - 1, y * 2);
+        int y1 = std::min(src.height - 1, y * 2 + 1);
+        for (int x = 0; x < dst.width; x++)
+        {
+            int x0 = std::min(src.width - 1, x * 2);
+            int x1 = std::min(src.width - 1, x * 2 + 1);
+            for (int c = 0; c < src.channels; c++)
+            {
+                int sum = src.pixels[((size_t)y0 * src.width + x0) * src.channels + c] +
+                          src.pixels[((size_t)y0 * src.width + x1) * src.channels + c] +
+                          src.pixels[((size_t)y1 * src.width + x0) * src.channels + c] +
+                          src.pixels[((size_t)y1 * src.width + x1) * src.channels + c];
+                dst.pixels[((size_t)y * dst.width + x) * dst.channels + c] = (uint8_t)((sum + 2) / 4);
+            }
+        }
+    }
+    return dst;
+}
+
+static std::vector<uint8_t> compress(const Image &image, TextureFileFormat format)
+{
+    int blocksX = (image.width + 3) / 4;
+    int blocksY = (image.height + 3) / 4;
+    size_t blockSize = format == TextureFileFormat::BC1 ? 8 : 16;
+    std::vector<uint8_t> out((size_t)blocksX * blocksY * blockSize);
+
+    uint8_t block[16][4];
+    for (int by = 0; by < blocksY; by++)
+    {
+        for (int bx = 0; bx < blocksX; bx++)
+        {
+            // levels smaller than a block are padded by clamping to the edge
+            for (int i = 0; i < 16; i++)
+            {
+                int x = std::min(image.width - 1, bx * 4 + i % 4);
+                int y = std::min(image.height - 1, by * 4 + i / 4);
+                const uint8_t *texel = &image.pixels[((size_t)y * image.width + x) * 4];
+                std::memcpy(block[i], texel, 4);
+            }
+
+            uint8_t *dst = &out[((size_t)by * blocksX + bx) * blockSize];
+            switch (format)
+            {
+            case TextureFileFormat::BC1:
+                bc::encodeBC1(block, dst);
+                break;
+            case TextureFileFormat::BC3:
+                bc::encodeBC3(block, dst);
+                break;
+            default:
+                bc::encodeBC7(block, dst);
+                break;
+            }
+        }
+    }
+    return out;
+}
+
+static bool hasTransparency(const Image &image)
+{
+    for (size_t i = 3; i < image.pixels.size(); i += 4)
+    {
+        if (image.pixels[i] != 255)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+static TextureFileFormat rawFormat(int channels)
+{
+    switch (channels)
+    {
+    case 1:
+        return TextureFileFormat::R8;
+    case 2:
+        return TextureFileFormat::RG8;
+    case 3:
+        return TextureFileFormat::RGB8;
+    default:
+        return TextureFileFormat::RGBA8;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 3)
+    {
+        std::cerr << "usage: texcook <input.png> <output.ltex> [--format auto|raw|bc1|bc3|bc7]" << std::endl;
+        return 1;
+    }
+
+    std::string input = argv[1];
+    std::string output = argv[2];
+    std::string formatName = "auto";
+    for (int i = 3; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--format") == 0 && i + 1 < argc)
+        {
+            formatName = argv[++i];
+        }
+    }
+
+    int width, height, sourceChannels;
+    if (!stbi_info(input.c_str(), &width, &height, &sourceChannels))
+    {
+        std::cerr << "texcook: failed to read " << input << std::endl;
+        return 1;
+    }
+
+    // block compressors always work on RGBA, raw output keeps the source layout
+    bool raw = formatName == "raw";
+    Image image;
+    image.channels = raw ? sourceChannels : 4;
+    unsigned char *data = stbi_load(input.c_str(), &image.width, &image.height, &sourceChannels, image.channels);
+    if (!data)
+    {
+        std::cerr << "texcook: failed to decode " << input << std::endl;
+        return 1;
+    }
+    image.pixels.assign(data, data + (size_t)image.width * image.height * image.channels);
+    stbi_image_free(data);
+
+    TextureFileFormat format;
+    if (raw)
+    {
+        format = rawFormat(image.channels);
+    }
+    else if (formatName == "bc1")
+    {
+        format = TextureFileFormat::BC1;
+    }
+    else if (formatName == "bc3")
+    {
+        format = TextureFileFormat::BC3;
+    }
+    else if (formatName == "bc7")
+    {
+        format = TextureFileFormat::BC7;
+    }
+    else if (formatName == "auto")
+    {
+        format = hasTransparency(image) ? TextureFileFormat::BC3 : TextureFileFormat::BC1;
+    }
+    else
+    {
+        std::cerr << "texcook: unknown format " << formatName << std::endl;
+        return 1;
+    }
+
+    std::vector<std::vector<uint8_t>> levelData;
+    std::vector<TextureFileLevel> levels;
+    Image level = image;
+    for (;;)
+    {
+        levelData.push_back(isBlockCompressed(format) ? compress(level, format) : level.pixels);
+        TextureFileLevel entry = {};
+        entry.width = level.width;
+        entry.height = level.height;
+        entry.size = levelData.back().size();
+        levels.push_back(entry);
+
+        if (level.width == 1 && level.height == 1)
+        {
+            break;
+        }
+        level = downsample(level);
+    }
+
+    TextureFileHeader header = {};
+    header.magic = textureFileMagic;
+    header.version = textureFileVersion;
+    header.format = format;
+    header.width = image.width;
+    header.height = image.height;
+    header.channels = sourceChannels;
+    header.levelCount = (uint32_t)levels.size();
+
+    uint64_t offset = sizeof(TextureFileHeader) + levels.size() * sizeof(TextureFileLevel);
+    for (TextureFileLevel &entry : levels)
+    {
+        offset = (offset + 15) & ~uint64_t(15);
+        entry.offset = offset;
+        offset += entry.size;
+    }
+
+    std::ofstream file(output, std::ios::binary | std::ios::trunc);
+    if (!file)
+    {
+        std::cerr << "texcook: failed to open " << output << " for writing" << std::endl;
+        return 1;
+    }
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char *>(levels.data()), levels.size() * sizeof(TextureFileLevel));
+    for (size_t i = 0; i < levels.size(); i++)
+    {
+        static const char padding[16] = {};
+        size_t position = (size_t)file.tellp();
+        file.write(padding, levels[i].offset - position);
+        file.write(reinterpret_cast<const char *>(levelData[i].data()), levelData[i].size());
+    }
+
+    size_t sourceBytes = (size_t)image.width * image.height * 4;
+    std::cout << "texcook: " << input << " -> " << output << " (" << image.width << "x" << image.height << ", "
+              << levels.size() << " levels, " << offset << " bytes, RGBA8 with mips would be "
+              << sourceBytes * 4 / 3 << ")" << std::endl;
+    return 0;
+}